@@ -0,0 +1,134 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define MA_CRC32C_HAS_SSE42 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <nmmintrin.h>
+#define MA_CRC32C_HAS_SSE42 1
+#define MA_CRC32C_SSE42_TARGET __attribute__((target("sse4.2")))
+#endif
+
+#ifndef MA_CRC32C_SSE42_TARGET
+#define MA_CRC32C_SSE42_TARGET
+#endif
+
+/**
+ * CRC32C(Castagnoli,多项式0x82F63B78),用于落盘记录及工装数据载荷的完整性校验
+ * 可分段计算:以上一段的返回值作为_crc继续计算下一段
+ * x86上运行时检测SSE4.2,支持时用crc32指令每次处理8字节,否则查表
+ */
+namespace MA_Crc32c
+{
+	namespace Detail
+	{
+		inline const std::array<quint32, 256>& table()
+		{
+			static const std::array<quint32, 256> s_table = []()
+			{
+				std::array<quint32, 256> result{};
+				for (quint32 curIndex = 0; curIndex < 256; ++curIndex)
+				{
+					auto crc = curIndex;
+					for (auto bit = 0; bit < 8; ++bit)
+					{
+						crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+					}
+					result[curIndex] = crc;
+				}
+				return result;
+			}();
+			return s_table;
+		}
+
+		//_crc为未取反的中间值
+		inline quint32 computeTable(const uchar* _bytes, qint64 _size, quint32 _crc)
+		{
+			const auto& crcTable = table();
+			for (qint64 curIndex = 0; curIndex < _size; ++curIndex)
+			{
+				_crc = crcTable[(_crc ^ _bytes[curIndex]) & 0xFF] ^ (_crc >> 8);
+			}
+			return _crc;
+		}
+
+#ifdef MA_CRC32C_HAS_SSE42
+		inline bool isSse42Supported()
+		{
+			static const bool s_isSupported = []()
+			{
+#if defined(_MSC_VER)
+				int info[4]{};
+				__cpuid(info, 1);
+				return (info[2] & (1 << 20)) != 0;
+#else
+				unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+				if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+				{
+					return false;
+				}
+				return (ecx & bit_SSE4_2) != 0;
+#endif
+			}();
+			return s_isSupported;
+		}
+
+		MA_CRC32C_SSE42_TARGET inline quint32 computeSse42(const uchar* _bytes, qint64 _size, quint32 _crc)
+		{
+			//先按字节对齐到8字节边界
+			for (; _size > 0 && (reinterpret_cast<quintptr>(_bytes) & 7) != 0; --_size, ++_bytes)
+			{
+				_crc = _mm_crc32_u8(_crc, *_bytes);
+			}
+#if defined(_M_X64) || defined(__x86_64__)
+			quint64 crc64 = _crc;
+			for (; _size >= 8; _size -= 8, _bytes += 8)
+			{
+				quint64 word;
+				std::memcpy(&word, _bytes, sizeof(word));
+				crc64 = _mm_crc32_u64(crc64, word);
+			}
+			_crc = static_cast<quint32>(crc64);
+#endif
+			for (; _size >= 4; _size -= 4, _bytes += 4)
+			{
+				quint32 word;
+				std::memcpy(&word, _bytes, sizeof(word));
+				_crc = _mm_crc32_u32(_crc, word);
+			}
+			for (; _size > 0; --_size, ++_bytes)
+			{
+				_crc = _mm_crc32_u8(_crc, *_bytes);
+			}
+			return _crc;
+		}
+#endif
+	}
+
+	inline bool isHardwareAccelerated()
+	{
+#ifdef MA_CRC32C_HAS_SSE42
+		return Detail::isSse42Supported();
+#else
+		return false;
+#endif
+	}
+
+	inline quint32 compute(const void* _data, qint64 _size, quint32 _crc = 0)
+	{
+		auto bytes = static_cast<const uchar*>(_data);
+#ifdef MA_CRC32C_HAS_SSE42
+		if (Detail::isSse42Supported())
+		{
+			return ~Detail::computeSse42(bytes, _size, ~_crc);
+		}
+#endif
+		return ~Detail::computeTable(bytes, _size, ~_crc);
+	}
+}
@@ -0,0 +1,96 @@
+#include "MA_ToolingPayloadCodec.h"
+#include "MA_Crc32c.h"
+#include <QtEndian>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//"TPC1"
+	const quint32 s_frameMagic = 0x31435054u;
+	const int s_frameHeaderSize = 16;
+	//压缩收益太小的载荷不值得设备端解压
+	const int s_minEncodeSize = 256;
+}
+
+QString MA_ToolingPayloadCodec::codecToString(ME_ToolingPayloadCodec _codec)
+{
+	switch (_codec)
+	{
+	case ME_ToolingPayloadCodec::NONE:
+		return u8"none";
+	case ME_ToolingPayloadCodec::ZLIB:
+		return u8"zlib";
+	default:
+		break;
+	}
+	return u8"unknown";
+}
+
+bool MA_ToolingPayloadCodec::isCodecSupported(quint16 _codec)
+{
+	return _codec == static_cast<quint16>(ME_ToolingPayloadCodec::NONE)
+		|| _codec == static_cast<quint16>(ME_ToolingPayloadCodec::ZLIB);
+}
+
+QByteArray MA_ToolingPayloadCodec::encode(const QByteArray& _data, ME_ToolingPayloadCodec _codec)
+{
+	if (_codec != ME_ToolingPayloadCodec::ZLIB || _data.size() < s_minEncodeSize)
+	{
+		return _data;
+	}
+
+	//qCompress自带4字节原长前缀,帧头中的原长用于解码前校验
+	auto compressed = qCompress(_data);
+	if (compressed.size() + s_frameHeaderSize >= _data.size())
+	{
+		return _data;
+	}
+
+	QByteArray payload(s_frameHeaderSize, Qt::Uninitialized);
+	auto header = reinterpret_cast<uchar*>(payload.data());
+	qToLittleEndian<quint32>(s_frameMagic, header);
+	qToLittleEndian<quint16>(static_cast<quint16>(_codec), header + 4);
+	qToLittleEndian<quint16>(0, header + 6);
+	qToLittleEndian<quint32>(static_cast<quint32>(_data.size()), header + 8);
+	qToLittleEndian<quint32>(MA_Crc32c::compute(_data.constData(), _data.size()), header + 12);
+	payload.append(compressed);
+	return payload;
+}
+
+bool MA_ToolingPayloadCodec::isEncoded(const QByteArray& _payload)
+{
+	return _payload.size() >= s_frameHeaderSize
+		&& qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(_payload.constData())) == s_frameMagic;
+}
+
+MM_MaybeOk MA_ToolingPayloadCodec::decode(const QByteArray& _payload, QByteArray* _data)
+{
+	if (!isEncoded(_payload))
+	{
+		*_data = _payload;
+		return MM_MaybeOk();
+	}
+
+	auto header = reinterpret_cast<const uchar*>(_payload.constData());
+	auto codec = qFromLittleEndian<quint16>(header + 4);
+	auto rawSize = qFromLittleEndian<quint32>(header + 8);
+	auto crc = qFromLittleEndian<quint32>(header + 12);
+	if (codec != static_cast<quint16>(ME_ToolingPayloadCodec::ZLIB))
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Decode tooling payload: codec %1 is not supported!").arg(codec)));
+	}
+
+	auto data = qUncompress(reinterpret_cast<const uchar*>(_payload.constData()) + s_frameHeaderSize, _payload.size() - s_frameHeaderSize);
+	if (static_cast<quint32>(data.size()) != rawSize)
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Decode tooling payload: size %1 is not right, expect %2!").arg(data.size()).arg(rawSize)));
+	}
+	if (MA_Crc32c::compute(data.constData(), data.size()) != crc)
+	{
+		return MM_MaybeOk(ME_Error(u8"Decode tooling payload: crc is not right!"));
+	}
+	*_data = data;
+	return MM_MaybeOk();
+}
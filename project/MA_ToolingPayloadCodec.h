@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include <QByteArray>
+#include <QString>
+
+//工装数据载荷编码,取值与设备能力字段一致
+enum class ME_ToolingPayloadCodec : quint16
+{
+	NONE = 0,
+	ZLIB = 1,
+};
+
+/**
+ * 工装数据载荷的压缩编码
+ * 编码后的载荷为 帧头(魔数/编码/原长/原文CRC32C,共16字节) + 压缩数据,可自描述,
+ * 解码方按魔数识别,非编码载荷原样使用;压缩后不更小时不编码,直接传原文
+ */
+namespace MA_ToolingPayloadCodec
+{
+	QString codecToString(ME_ToolingPayloadCodec _codec);
+	bool isCodecSupported(quint16 _codec);
+
+	QByteArray encode(const QByteArray& _data, ME_ToolingPayloadCodec _codec);
+	bool isEncoded(const QByteArray& _payload);
+	//非编码载荷原样返回(共享缓冲区,不复制)
+	MP_Public::MM_MaybeOk decode(const QByteArray& _payload, QByteArray* _data);
+}
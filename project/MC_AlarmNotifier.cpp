@@ -0,0 +1,269 @@
+#include "MC_AlarmNotifier.h"
+#include <QApplication>
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+MC_AlarmNotifier& MC_AlarmNotifier::instance()
+{
+	static MC_AlarmNotifier s_instance;
+	return s_instance;
+}
+
+MC_AlarmNotifier::MC_AlarmNotifier()
+	: QObject(nullptr)
+{
+	qRegisterMetaType<MS_Alarm>();
+	m_clock.start();
+	//首次使用可能在控制线程,通知统一在主线程发出
+	if (QCoreApplication::instance() && thread() != QCoreApplication::instance()->thread())
+	{
+		moveToThread(QCoreApplication::instance()->thread());
+	}
+}
+
+MC_AlarmNotifier::~MC_AlarmNotifier()
+{
+}
+
+void MC_AlarmNotifier::post(ME_AlarmLevel _level, const QString& _source, const QString& _title, const QString& _message)
+{
+	QMutexLocker locker(&m_mutex);
+	auto nowMs = m_clock.elapsed();
+	auto key = std::make_tuple(_source, _title, _message);
+
+	//未取走的相同报警只计数
+	for (auto& var : m_pendingAlarms)
+	{
+		if (var.m_source == _source && var.m_title == _title && var.m_message == _message)
+		{
+			++var.m_count;
+			var.m_level = qMax(var.m_level, _level);
+			var.m_lastDateTime = QDateTime::currentDateTime();
+			m_rateStates[key].m_lastPostMs = nowMs;
+			return;
+		}
+	}
+
+	//限频间隔内延后,到期时合并为一条入队,不丢弃
+	auto& rateState = m_rateStates[key];
+	if (rateState.m_lastPostMs > 0 && nowMs - rateState.m_lastPostMs < m_minIntervalMs)
+	{
+		auto nowDateTime = QDateTime::currentDateTime();
+		if (rateState.m_deferredCount == 0)
+		{
+			rateState.m_deferredLevel = _level;
+			rateState.m_firstDeferredDateTime = nowDateTime;
+		}
+		++rateState.m_deferredCount;
+		rateState.m_deferredLevel = qMax(rateState.m_deferredLevel, _level);
+		rateState.m_lastDeferredDateTime = nowDateTime;
+		if (rateState.m_isFlushScheduled)
+		{
+			return;
+		}
+		rateState.m_isFlushScheduled = true;
+		auto delayMs = static_cast<int>(m_minIntervalMs - (nowMs - rateState.m_lastPostMs));
+		//定时器在通知器所在的主线程启动
+		QMetaObject::invokeMethod(this, [=]()
+		{
+			QTimer::singleShot(delayMs, this, [=]()
+			{
+				flushDeferredAlarm(key);
+			});
+		}, Qt::QueuedConnection);
+		return;
+	}
+
+	MS_Alarm alarm;
+	alarm.m_id = m_nextId++;
+	alarm.m_level = _level;
+	alarm.m_source = _source;
+	alarm.m_title = _title;
+	alarm.m_message = _message;
+	alarm.m_firstDateTime = QDateTime::currentDateTime();
+	alarm.m_lastDateTime = alarm.m_firstDateTime;
+	//0 保留为未入队过
+	rateState.m_lastPostMs = qMax<qint64>(1, nowMs);
+	enqueueAlarm(std::move(alarm));
+}
+
+void MC_AlarmNotifier::flushDeferredAlarm(const MT_AlarmKey& _key)
+{
+	QMutexLocker locker(&m_mutex);
+	auto iter = m_rateStates.find(_key);
+	if (iter == m_rateStates.end())
+	{
+		return;
+	}
+	auto& rateState = iter->second;
+	rateState.m_isFlushScheduled = false;
+	if (rateState.m_deferredCount == 0)
+	{
+		return;
+	}
+	auto nowMs = m_clock.elapsed();
+	rateState.m_lastPostMs = qMax<qint64>(1, nowMs);
+
+	//同一报警尚未取走时并入
+	for (auto& var : m_pendingAlarms)
+	{
+		if (var.m_source == std::get<0>(_key) && var.m_title == std::get<1>(_key) && var.m_message == std::get<2>(_key))
+		{
+			var.m_count += rateState.m_deferredCount;
+			var.m_level = qMax(var.m_level, rateState.m_deferredLevel);
+			var.m_lastDateTime = rateState.m_lastDeferredDateTime;
+			rateState.m_deferredCount = 0;
+			return;
+		}
+	}
+
+	MS_Alarm alarm;
+	alarm.m_id = m_nextId++;
+	alarm.m_level = rateState.m_deferredLevel;
+	alarm.m_source = std::get<0>(_key);
+	alarm.m_title = std::get<1>(_key);
+	alarm.m_message = std::get<2>(_key);
+	alarm.m_firstDateTime = rateState.m_firstDeferredDateTime;
+	alarm.m_lastDateTime = rateState.m_lastDeferredDateTime;
+	alarm.m_count = rateState.m_deferredCount;
+	rateState.m_deferredCount = 0;
+	enqueueAlarm(std::move(alarm));
+}
+
+void MC_AlarmNotifier::enqueueAlarm(MS_Alarm&& _alarm)
+{
+	while (static_cast<int>(m_pendingAlarms.size()) >= m_maxPendingCount)
+	{
+		m_pendingAlarms.pop_front();
+		++m_droppedCount;
+	}
+	m_pendingAlarms.push_back(std::move(_alarm));
+
+	if (m_isNotifyScheduled)
+	{
+		return;
+	}
+	m_isNotifyScheduled = true;
+	QMetaObject::invokeMethod(this, [=]()
+	{
+		emit sig_alarmsPending();
+		if (getIsPromptMessageBox())
+		{
+			promptPendingAlarms();
+		}
+	}, Qt::QueuedConnection);
+}
+
+std::vector<MS_Alarm> MC_AlarmNotifier::takePendingAlarms()
+{
+	QMutexLocker locker(&m_mutex);
+	std::vector<MS_Alarm> ret(std::make_move_iterator(m_pendingAlarms.begin()), std::make_move_iterator(m_pendingAlarms.end()));
+	m_pendingAlarms.clear();
+	m_isNotifyScheduled = false;
+	pruneRateStates();
+	return ret;
+}
+
+void MC_AlarmNotifier::pruneRateStates()
+{
+	auto nowMs = m_clock.elapsed();
+	for (auto iter = m_rateStates.begin(); iter != m_rateStates.end();)
+	{
+		const auto& rateState = iter->second;
+		if (!rateState.m_isFlushScheduled && rateState.m_deferredCount == 0 && nowMs - rateState.m_lastPostMs >= m_minIntervalMs)
+		{
+			iter = m_rateStates.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+int MC_AlarmNotifier::getPendingCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return static_cast<int>(m_pendingAlarms.size());
+}
+
+quint64 MC_AlarmNotifier::getDroppedCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_droppedCount;
+}
+
+int MC_AlarmNotifier::getMinIntervalMs() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_minIntervalMs;
+}
+
+void MC_AlarmNotifier::setMinIntervalMs(int _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_minIntervalMs = qMax(0, _val);
+}
+
+int MC_AlarmNotifier::getMaxPendingCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_maxPendingCount;
+}
+
+void MC_AlarmNotifier::setMaxPendingCount(int _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_maxPendingCount = qMax(1, _val);
+}
+
+bool MC_AlarmNotifier::getIsPromptMessageBox() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_isPromptMessageBox;
+}
+
+void MC_AlarmNotifier::setIsPromptMessageBox(bool _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_isPromptMessageBox = _val;
+}
+
+void MC_AlarmNotifier::promptPendingAlarms()
+{
+	auto alarms = takePendingAlarms();
+	//无界面程序(如基准测试)只输出
+	auto isGuiApplication = qobject_cast<QApplication*>(QCoreApplication::instance()) != nullptr;
+	for (const auto& var : alarms)
+	{
+		auto text = var.m_message;
+		if (var.m_count > 1)
+		{
+			text += QString(u8"(共%1次)").arg(var.m_count);
+		}
+		if (!isGuiApplication)
+		{
+			qWarning() << var.m_source << var.m_title << text;
+			continue;
+		}
+
+		auto icon = QMessageBox::Information;
+		if (var.m_level == ME_AlarmLevel::WARNING_LEVEL)
+		{
+			icon = QMessageBox::Warning;
+		}
+		else if (var.m_level == ME_AlarmLevel::ERROR_LEVEL)
+		{
+			icon = QMessageBox::Critical;
+		}
+		//非模态,不进入嵌套事件循环
+		auto messageBox = new QMessageBox(icon, var.m_title, text, QMessageBox::Ok);
+		messageBox->setAttribute(Qt::WA_DeleteOnClose);
+		messageBox->setWindowModality(Qt::NonModal);
+		messageBox->show();
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <vector>
+
+//与ML_LogLabel一样带后缀,避免与windows.h中的ERROR等宏冲突
+enum class ME_AlarmLevel
+{
+	INFO_LEVEL,
+	WARNING_LEVEL,
+	ERROR_LEVEL,
+};
+
+//一条待界面处理的报警,相同来源/标题/内容的重复报警(含限频期间延后的)合并计数
+struct MS_Alarm
+{
+	quint64 m_id{ 0 };
+	ME_AlarmLevel m_level{ ME_AlarmLevel::WARNING_LEVEL };
+	QString m_source;
+	QString m_title;
+	QString m_message;
+	QDateTime m_firstDateTime;
+	QDateTime m_lastDateTime;
+	int m_count{ 1 };
+};
+Q_DECLARE_METATYPE(MS_Alarm)
+
+/**
+ * 报警通知通道,替代控制流程中的模态提示框
+ * 各线程调用post只入队后立即返回,不阻塞状态机及定时器;界面收到sig_alarmsPending后按自己的节奏takePendingAlarms
+ * 未取走的相同报警合并计数;同一报警在限频间隔内再次出现时延后,间隔到期时合并为一条入队;队列满时丢弃最早的
+ * 未接管时(默认)由通知器在主线程以非模态提示框显示,界面自行展示报警时调用setIsPromptMessageBox(false)
+ */
+class MC_AlarmNotifier : public QObject
+{
+	Q_OBJECT
+
+public:
+	static MC_AlarmNotifier& instance();
+	~MC_AlarmNotifier();
+
+	void post(ME_AlarmLevel _level, const QString& _source, const QString& _title, const QString& _message);
+	std::vector<MS_Alarm> takePendingAlarms();
+	int getPendingCount() const;
+	//因队列满被丢弃的报警数
+	quint64 getDroppedCount() const;
+
+	int getMinIntervalMs() const;
+	void setMinIntervalMs(int _val);
+	int getMaxPendingCount() const;
+	void setMaxPendingCount(int _val);
+	bool getIsPromptMessageBox() const;
+	void setIsPromptMessageBox(bool _val);
+
+signals:
+	//队列由空变为非空时发出一次(主线程),取走后再有报警才会再次发出
+	void sig_alarmsPending();
+
+private:
+	MC_AlarmNotifier();
+	MC_AlarmNotifier(const MC_AlarmNotifier&) = delete;
+	MC_AlarmNotifier& operator=(const MC_AlarmNotifier&) = delete;
+
+	using MT_AlarmKey = std::tuple<QString, QString, QString>;
+
+	void promptPendingAlarms();
+	//调用方持锁
+	void enqueueAlarm(MS_Alarm&& _alarm);
+	//限频间隔到期,把期间延后的同一报警合并入队
+	void flushDeferredAlarm(const MT_AlarmKey& _key);
+	//调用方持锁,清理限频间隔已过且无延后报警的记录,报警内容含工位名等细节,不清理会一直增长
+	void pruneRateStates();
+
+	mutable QMutex m_mutex;
+	std::deque<MS_Alarm> m_pendingAlarms;
+	//每个报警最近一次入队的时间及限频期间延后的报警,取走队列时清理限频已到期的
+	struct MS_RateState
+	{
+		qint64 m_lastPostMs{ 0 };
+		int m_deferredCount{ 0 };
+		ME_AlarmLevel m_deferredLevel{ ME_AlarmLevel::INFO_LEVEL };
+		QDateTime m_firstDeferredDateTime;
+		QDateTime m_lastDeferredDateTime;
+		bool m_isFlushScheduled{ false };
+	};
+	std::map<MT_AlarmKey, MS_RateState> m_rateStates;
+	bool m_isNotifyScheduled{ false };
+	quint64 m_nextId{ 1 };
+	quint64 m_droppedCount{ 0 };
+	int m_minIntervalMs{ 1000 };
+	int m_maxPendingCount{ 128 };
+	bool m_isPromptMessageBox{ true };
+	QElapsedTimer m_clock;
+};
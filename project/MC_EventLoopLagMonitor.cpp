@@ -0,0 +1,351 @@
+#include "MC_EventLoopLagMonitor.h"
+#include "MC_OpcUaMetrics.h"
+#include "ML_AsyncLogger.h"
+#include <QAbstractEventDispatcher>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+//被监控线程的状态,统计由看门狗及导出线程读取
+struct MS_EventLoopThreadState
+{
+	QString m_threadName;
+	MC_LatencyHistogram m_queueLatency;
+	MC_LatencyHistogram m_busyDuration;
+	//本轮处理开始时间,-1 表示线程在等待事件
+	std::atomic<qint64> m_busySinceUs{ -1 };
+	std::atomic<quint64> m_longEventCount{ 0 };
+	std::atomic<quint64> m_stallCount{ 0 };
+	//看门狗已报告本轮阻塞
+	std::atomic_bool m_isStallReported{ false };
+
+	//以下只在被监控线程中访问
+	bool m_isReportedInIteration{ false };
+	int m_activityDepth{ 0 };
+
+	QMutex m_activityMutex;
+	QString m_activity;
+};
+
+namespace
+{
+	thread_local MS_EventLoopThreadState* t_threadState = nullptr;
+}
+
+/**
+ * 被监控线程中的探测对象
+ * 定时投递队列调用测量排队延迟,按事件分发器的唤醒/等待测量每轮处理耗时
+ */
+class MC_EventLoopLagProbe : public QObject
+{
+public:
+	MC_EventLoopLagProbe(std::shared_ptr<MS_EventLoopThreadState> _state, int _intervalMs)
+		: QObject(nullptr),
+		m_state(std::move(_state)),
+		m_timer(new QTimer(this))
+	{
+		m_timer->setInterval(_intervalMs);
+		QObject::connect(m_timer, &QTimer::timeout, this, [=]()
+		{
+			auto postUs = MC_EventLoopLagMonitor::nowUs();
+			QMetaObject::invokeMethod(this, [=]()
+			{
+				m_state->m_queueLatency.record(MC_EventLoopLagMonitor::nowUs() - postUs);
+			}, Qt::QueuedConnection);
+		});
+		m_timer->start();
+
+		auto dispatcher = QAbstractEventDispatcher::instance(QThread::currentThread());
+		if (dispatcher)
+		{
+			QObject::connect(dispatcher, &QAbstractEventDispatcher::awake, this, [=]()
+			{
+				onAwake();
+			}, Qt::DirectConnection);
+			QObject::connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, [=]()
+			{
+				onAboutToBlock();
+			}, Qt::DirectConnection);
+		}
+	}
+
+private:
+	void onAwake()
+	{
+		qint64 idle = -1;
+		if (m_state->m_busySinceUs.compare_exchange_strong(idle, MC_EventLoopLagMonitor::nowUs()))
+		{
+			m_state->m_isReportedInIteration = false;
+			m_state->m_isStallReported = false;
+		}
+	}
+
+	void onAboutToBlock()
+	{
+		auto busySinceUs = m_state->m_busySinceUs.exchange(-1);
+		if (busySinceUs < 0)
+		{
+			return;
+		}
+		auto durationUs = MC_EventLoopLagMonitor::nowUs() - busySinceUs;
+		m_state->m_busyDuration.record(durationUs);
+
+		auto& monitor = MC_EventLoopLagMonitor::instance();
+		if (durationUs <= monitor.getLongEventThresholdMs() * 1000LL)
+		{
+			return;
+		}
+		++m_state->m_longEventCount;
+		//已由标记处或看门狗报告过的不重复记录
+		if (!m_state->m_isReportedInIteration && !m_state->m_isStallReported)
+		{
+			monitor.reportSlowEvent(*m_state, QString(), durationUs, false);
+		}
+	}
+
+	std::shared_ptr<MS_EventLoopThreadState> m_state;
+	QTimer* m_timer{};
+};
+
+MC_EventLoopLagMonitor& MC_EventLoopLagMonitor::instance()
+{
+	static MC_EventLoopLagMonitor s_instance;
+	return s_instance;
+}
+
+MC_EventLoopLagMonitor::MC_EventLoopLagMonitor()
+	: QObject(nullptr)
+{
+	m_collectorId = MC_OpcUaMetricsRegistry::instance().addCollector([this]()
+	{
+		return toPrometheusText();
+	});
+	m_watchdogThread = std::thread([=]()
+	{
+		runWatchdog();
+	});
+}
+
+MC_EventLoopLagMonitor::~MC_EventLoopLagMonitor()
+{
+	{
+		std::lock_guard<std::mutex> locker(m_watchdogMutex);
+		m_isWatchdogStopping = true;
+	}
+	m_watchdogCondition.notify_all();
+	if (m_watchdogThread.joinable())
+	{
+		m_watchdogThread.join();
+	}
+	MC_OpcUaMetricsRegistry::instance().removeCollector(m_collectorId);
+}
+
+qint64 MC_EventLoopLagMonitor::nowUs()
+{
+	static const QElapsedTimer s_timer = []()
+	{
+		QElapsedTimer timer;
+		timer.start();
+		return timer;
+	}();
+	return s_timer.nsecsElapsed() / 1000;
+}
+
+void MC_EventLoopLagMonitor::watchCurrentThread(const QString& _threadName)
+{
+	if (t_threadState)
+	{
+		return;
+	}
+	auto state = std::make_shared<MS_EventLoopThreadState>();
+	state->m_threadName = _threadName;
+	auto probe = new MC_EventLoopLagProbe(state, m_probeIntervalMs);
+	t_threadState = state.get();
+	{
+		QMutexLocker locker(&m_mutex);
+		m_threadStates.emplace_back(state);
+	}
+
+	//finished 在结束的线程中发出,之后才处理延迟删除
+	QObject::connect(QThread::currentThread(), &QThread::finished, probe, [=]()
+	{
+		t_threadState = nullptr;
+		removeThread(state);
+		probe->deleteLater();
+	}, Qt::DirectConnection);
+}
+
+bool MC_EventLoopLagMonitor::isCurrentThreadWatched() const
+{
+	return t_threadState != nullptr;
+}
+
+void MC_EventLoopLagMonitor::removeThread(const std::shared_ptr<MS_EventLoopThreadState>& _state)
+{
+	QMutexLocker locker(&m_mutex);
+	m_threadStates.erase(std::remove(m_threadStates.begin(), m_threadStates.end(), _state), m_threadStates.end());
+}
+
+void MC_EventLoopLagMonitor::reportSlowEvent(MS_EventLoopThreadState& _state, const QString& _activity, qint64 _durationUs, bool _isStillRunning)
+{
+	auto activity = _activity.isEmpty() ? QString(u8"<unmarked>") : _activity;
+	if (_isStillRunning)
+	{
+		ML_AsyncLogger::instance().record(0, ML_LogLabel::WARNING_LABEL, u8"事件循环[%1]已阻塞%2ms,当前处理: %3", _state.m_threadName, _durationUs / 1000, activity);
+	}
+	else
+	{
+		ML_AsyncLogger::instance().record(0, ML_LogLabel::WARNING_LABEL, u8"事件循环[%1]处理耗时%2ms: %3", _state.m_threadName, _durationUs / 1000, activity);
+	}
+	emit this->sig_slowEventDetected(_state.m_threadName, _activity, _durationUs, _isStillRunning);
+}
+
+void MC_EventLoopLagMonitor::runWatchdog()
+{
+	std::unique_lock<std::mutex> locker(m_watchdogMutex);
+	while (!m_isWatchdogStopping)
+	{
+		auto thresholdUs = getLongEventThresholdMs() * 1000LL;
+		m_watchdogCondition.wait_for(locker, std::chrono::microseconds(std::max<qint64>(5000, thresholdUs / 2)));
+		if (m_isWatchdogStopping)
+		{
+			break;
+		}
+
+		std::vector<std::shared_ptr<MS_EventLoopThreadState>> states;
+		{
+			QMutexLocker stateLocker(&m_mutex);
+			states = m_threadStates;
+		}
+		auto nowUs = MC_EventLoopLagMonitor::nowUs();
+		for (const auto& var : states)
+		{
+			auto busySinceUs = var->m_busySinceUs.load();
+			if (busySinceUs < 0 || nowUs - busySinceUs <= thresholdUs)
+			{
+				continue;
+			}
+			if (var->m_isStallReported.exchange(true))
+			{
+				continue;
+			}
+			++var->m_stallCount;
+			QString activity;
+			{
+				QMutexLocker activityLocker(&var->m_activityMutex);
+				activity = var->m_activity;
+			}
+			reportSlowEvent(*var, activity, nowUs - busySinceUs, true);
+		}
+	}
+}
+
+std::vector<MS_EventLoopLagStats> MC_EventLoopLagMonitor::getStats() const
+{
+	std::vector<std::shared_ptr<MS_EventLoopThreadState>> states;
+	{
+		QMutexLocker locker(&m_mutex);
+		states = m_threadStates;
+	}
+
+	std::vector<MS_EventLoopLagStats> result;
+	for (const auto& var : states)
+	{
+		MS_EventLoopLagStats stats;
+		stats.m_threadName = var->m_threadName;
+		stats.m_queueLatencyP50Us = var->m_queueLatency.getPercentileUs(0.5);
+		stats.m_queueLatencyP99Us = var->m_queueLatency.getPercentileUs(0.99);
+		stats.m_queueLatencyMaxUs = var->m_queueLatency.getMaxUs();
+		stats.m_queueLatencyCount = var->m_queueLatency.getCount();
+		stats.m_busyP99Us = var->m_busyDuration.getPercentileUs(0.99);
+		stats.m_busyMaxUs = var->m_busyDuration.getMaxUs();
+		stats.m_longEventCount = var->m_longEventCount.load();
+		stats.m_stallCount = var->m_stallCount.load();
+		result.emplace_back(stats);
+	}
+	return result;
+}
+
+void MC_EventLoopLagMonitor::resetStats()
+{
+	QMutexLocker locker(&m_mutex);
+	for (const auto& var : m_threadStates)
+	{
+		var->m_queueLatency.reset();
+		var->m_busyDuration.reset();
+		var->m_longEventCount = 0;
+		var->m_stallCount = 0;
+	}
+}
+
+QString MC_EventLoopLagMonitor::toPrometheusText() const
+{
+	auto stats = getStats();
+	QString text;
+	QTextStream stream(&text);
+	stream << u8"# TYPE event_loop_queue_latency_seconds summary\n";
+	stream << u8"# TYPE event_loop_busy_seconds summary\n";
+	stream << u8"# TYPE event_loop_long_events_total counter\n";
+	stream << u8"# TYPE event_loop_stalls_total counter\n";
+	for (const auto& var : stats)
+	{
+		auto labels = QString(u8"thread=\"%1\"").arg(var.m_threadName);
+		stream << u8"event_loop_queue_latency_seconds{" << labels << u8",quantile=\"0.5\"} " << QString::number(var.m_queueLatencyP50Us / 1e6) << u8"\n";
+		stream << u8"event_loop_queue_latency_seconds{" << labels << u8",quantile=\"0.99\"} " << QString::number(var.m_queueLatencyP99Us / 1e6) << u8"\n";
+		stream << u8"event_loop_queue_latency_seconds{" << labels << u8",quantile=\"1\"} " << QString::number(var.m_queueLatencyMaxUs / 1e6) << u8"\n";
+		stream << u8"event_loop_queue_latency_seconds_count{" << labels << u8"} " << var.m_queueLatencyCount << u8"\n";
+		stream << u8"event_loop_busy_seconds{" << labels << u8",quantile=\"0.99\"} " << QString::number(var.m_busyP99Us / 1e6) << u8"\n";
+		stream << u8"event_loop_busy_seconds{" << labels << u8",quantile=\"1\"} " << QString::number(var.m_busyMaxUs / 1e6) << u8"\n";
+		stream << u8"event_loop_long_events_total{" << labels << u8"} " << var.m_longEventCount << u8"\n";
+		stream << u8"event_loop_stalls_total{" << labels << u8"} " << var.m_stallCount << u8"\n";
+	}
+	stream.flush();
+	return text;
+}
+
+MC_EventLoopActivityScope::MC_EventLoopActivityScope(const QString& _activity)
+	: m_state(t_threadState)
+{
+	if (!m_state)
+	{
+		return;
+	}
+	m_isOutermost = m_state->m_activityDepth++ == 0;
+	if (!m_isOutermost)
+	{
+		return;
+	}
+	{
+		QMutexLocker locker(&m_state->m_activityMutex);
+		m_state->m_activity = _activity;
+	}
+	m_startUs = MC_EventLoopLagMonitor::nowUs();
+}
+
+MC_EventLoopActivityScope::~MC_EventLoopActivityScope()
+{
+	if (!m_state)
+	{
+		return;
+	}
+	--m_state->m_activityDepth;
+	if (!m_isOutermost)
+	{
+		return;
+	}
+	QString activity;
+	{
+		QMutexLocker locker(&m_state->m_activityMutex);
+		activity.swap(m_state->m_activity);
+	}
+	auto durationUs = MC_EventLoopLagMonitor::nowUs() - m_startUs;
+	auto& monitor = MC_EventLoopLagMonitor::instance();
+	if (durationUs > monitor.getLongEventThresholdMs() * 1000LL)
+	{
+		m_state->m_isReportedInIteration = true;
+		monitor.reportSlowEvent(*m_state, activity, durationUs, false);
+	}
+}
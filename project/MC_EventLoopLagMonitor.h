@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class MC_EventLoopLagProbe;
+struct MS_EventLoopThreadState;
+
+//单个线程的事件循环统计
+struct MS_EventLoopLagStats
+{
+	QString m_threadName;
+	//投递的队列调用从投递到执行的延迟
+	qint64 m_queueLatencyP50Us{ 0 };
+	qint64 m_queueLatencyP99Us{ 0 };
+	qint64 m_queueLatencyMaxUs{ 0 };
+	quint64 m_queueLatencyCount{ 0 };
+	//一轮事件处理(唤醒到再次等待)的耗时
+	qint64 m_busyP99Us{ 0 };
+	qint64 m_busyMaxUs{ 0 };
+	//超过阈值的处理次数及看门狗发现的阻塞次数
+	quint64 m_longEventCount{ 0 };
+	quint64 m_stallCount{ 0 };
+};
+
+/**
+ * 事件循环延迟监控
+ * 被监控线程内定时投递队列调用,统计从投递到执行的延迟;按事件分发器的唤醒/等待统计每轮处理耗时;
+ * 后台看门狗发现某线程持续处理超过阈值时立即记录(此时线程仍被占用),
+ * 日志中的处理名称来自MC_EventLoopActivityScope标记,未标记时只有线程名
+ * 统计通过MC_OpcUaMetricsRegistry导出,超阈值写入异步日志并发出sig_slowEventDetected
+ */
+class MC_EventLoopLagMonitor : public QObject
+{
+	Q_OBJECT
+
+public:
+	static MC_EventLoopLagMonitor& instance();
+	~MC_EventLoopLagMonitor();
+
+	//在被监控线程中调用,同一线程重复调用无效;线程结束时自动移除
+	void watchCurrentThread(const QString& _threadName);
+	bool isCurrentThreadWatched() const;
+
+	//队列调用的投递间隔
+	int getProbeIntervalMs() const { return m_probeIntervalMs; }
+	void setProbeIntervalMs(int _val) { m_probeIntervalMs = qMax(1, _val); }
+	//单次处理超过该时间记为慢处理,看门狗按该阈值判定阻塞
+	int getLongEventThresholdMs() const { return m_longEventThresholdMs.load(); }
+	void setLongEventThresholdMs(int _val) { m_longEventThresholdMs = qMax(1, _val); }
+
+	std::vector<MS_EventLoopLagStats> getStats() const;
+	//清空各线程的统计,线程仍保持监控
+	void resetStats();
+	QString toPrometheusText() const;
+
+	//当前线程的单调时间(微秒),各线程共用同一起点
+	static qint64 nowUs();
+
+signals:
+	//_activity 为空表示未标记的处理;_isStillRunning 为真时由看门狗发现,处理尚未结束
+	void sig_slowEventDetected(const QString& _threadName, const QString& _activity, qint64 _durationUs, bool _isStillRunning);
+
+private:
+	friend class MC_EventLoopLagProbe;
+	friend class MC_EventLoopActivityScope;
+
+	MC_EventLoopLagMonitor();
+
+	void removeThread(const std::shared_ptr<MS_EventLoopThreadState>& _state);
+	void reportSlowEvent(MS_EventLoopThreadState& _state, const QString& _activity, qint64 _durationUs, bool _isStillRunning);
+	void runWatchdog();
+
+	mutable QMutex m_mutex;
+	std::vector<std::shared_ptr<MS_EventLoopThreadState>> m_threadStates;
+	int m_collectorId{ -1 };
+	int m_probeIntervalMs{ 100 };
+	std::atomic_int m_longEventThresholdMs{ 50 };
+
+	std::mutex m_watchdogMutex;
+	std::condition_variable m_watchdogCondition;
+	bool m_isWatchdogStopping{ false };
+	std::thread m_watchdogThread;
+};
+
+/**
+ * 标记当前线程正在进行的处理,供慢处理日志定位具体的槽
+ * 线程未被监控时不做任何事;嵌套时以最外层为准
+ */
+class MC_EventLoopActivityScope
+{
+public:
+	explicit MC_EventLoopActivityScope(const QString& _activity);
+	~MC_EventLoopActivityScope();
+
+private:
+	MC_EventLoopActivityScope(const MC_EventLoopActivityScope&) = delete;
+	MC_EventLoopActivityScope& operator=(const MC_EventLoopActivityScope&) = delete;
+
+	MS_EventLoopThreadState* m_state{};
+	bool m_isOutermost{ false };
+	qint64 m_startUs{ 0 };
+};
@@ -3,6 +3,10 @@
 #include "MT_Transition.h"
 #include "ML_GlobalLog.h"
 #include "MA_Auxiliary.h"
+#include "MC_EventLoopLagMonitor.h"
+#include "MC_ToolingUploadJournal.h"
+#include "MC_ToolingDataCache.h"
+#include "MI_GS600PDeviceField.h"
 #include <QStateMachine>
 #include <QState>
 #include <QTimer>
@@ -34,7 +38,8 @@ MC_GS600PDeviceControlBase::MC_GS600PDeviceControlBase(QObject *_parent)
 	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectResult, this, [=](const MM_MaybeOk& _val)
 	{
 		emit sig_connectResult(_val);
-		if (!_val.hasError())
+		//沿用上次会话时节点及信号连接仍有效,无需重建
+		if (!_val.hasError() && !m_client->isSessionResumed())
 		{
 			clearConnectionMakeWhenConnection();
 			Q_ASSERT(m_client);
@@ -42,6 +47,10 @@ MC_GS600PDeviceControlBase::MC_GS600PDeviceControlBase(QObject *_parent)
 			makeNodesValChangedConnections();
 
 		}
+		if (!_val.hasError())
+		{
+			readToolingPayloadCodecCapability();
+		}
 	});
 
 
@@ -50,11 +59,19 @@ MC_GS600PDeviceControlBase::MC_GS600PDeviceControlBase(QObject *_parent)
 		emit this->sig_connectStateChanged(_val);
 	});
 
+	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectionEstablished, this, &MC_GS600PDeviceControlBase::sig_connectionEstablished);
+	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectionLost, this, &MC_GS600PDeviceControlBase::sig_connectionLost);
+
 
 	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_log, this, [=](ML_LogLabel _label, const QString & _log) {
 		emit sig_log(_label, _log);
 	});
 
+	//异步日志回显到界面,只投递本工位的记录
+	ML_AsyncLogger::instance().setEchoTarget(reinterpret_cast<quintptr>(this), this, [=](ML_LogLabel _label, const QString& _log) {
+		emit sig_log(_label, _log);
+	});
+
 	QObject::connect(m_onCheckRequireDataTimer, &QTimer::timeout, this, [=]() {
 		if (getDeviceIsRequireDataState() == MS_DeviceRequireDataState::REQUIRE)
 		{
@@ -80,7 +97,134 @@ MC_GS600PDeviceControlBase::MC_GS600PDeviceControlBase(QObject *_parent)
 
 void MC_GS600PDeviceControlBase::onHasUploadData()
 {
-	m_onClientUploadDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+	//启用日志时分控已在落盘后释放,这里只确认日志交付的记录
+	if (m_isUploadJournalEnabled)
+	{
+		QMetaObject::invokeMethod(m_uploadJournal, [=]()
+		{
+			m_uploadJournal->acknowledgeHead();
+		});
+		return;
+	}
+	if (getUploadSlotCount() <= 0)
+	{
+		m_onClientUploadDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+		return;
+	}
+
+	//批量上传时全部确认后才完成,没有待确认的记录时忽略
+	auto pendingCount = m_pendingUploadAckCount.load();
+	do
+	{
+		if (pendingCount <= 0)
+		{
+			log(ML_LogLabel::WARNING_LABEL, u8"批量上传没有待确认的记录,忽略本次确认");
+			return;
+		}
+	} while (!m_pendingUploadAckCount.compare_exchange_weak(pendingCount, pendingCount - 1));
+
+	//只有本轮已全部交付时才完成,失败轮次的确认在重读期间到达时不提前完成
+	if (pendingCount == 1 && m_isWaitingBatchUploadAck.exchange(false))
+	{
+		m_onClientUploadDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+	}
+}
+
+MM_MaybeOk MC_GS600PDeviceControlBase::enableUploadJournal(const QString& _filePath)
+{
+	if (!m_uploadJournal)
+	{
+		m_uploadJournal = new MC_ToolingUploadJournal(this);
+		QObject::connect(m_uploadJournal, &MC_ToolingUploadJournal::sig_recordReady, this, [=](const MS_ToolingUploadRecord& _record)
+		{
+			logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据日志交付第%1条,未确认%2条", _record.m_seq, m_uploadJournal->getPendingCount());
+			emit sig_deviceUploadData(MR_WorkToolingData(MI_ToolingIdentifier(_record.m_identifier, _record.m_identifierType), _record.m_toolingIndex, _record.m_data));
+		});
+		QObject::connect(m_uploadJournal, &MC_ToolingUploadJournal::sig_syncFailed, this, [=](const QString& _error)
+		{
+			log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据日志刷盘失败 : %1").arg(_error));
+		});
+	}
+
+	m_uploadJournal->close();
+	auto result = m_uploadJournal->open(_filePath);
+	m_isUploadJournalEnabled = !result.hasError();
+	if (!result.hasError())
+	{
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据日志已启用,未确认%1条", m_uploadJournal->getPendingCount());
+	}
+	return result;
+}
+
+void MC_GS600PDeviceControlBase::disableUploadJournal()
+{
+	m_isUploadJournalEnabled = false;
+	if (m_uploadJournal)
+	{
+		m_uploadJournal->close();
+	}
+}
+
+MS_ByteStringChunkParam MC_GS600PDeviceControlBase::getToolingDataChunkParam() const
+{
+	QMutexLocker locker(&m_toolingDataChunkParamMutex);
+	return m_toolingDataChunkParam;
+}
+
+void MC_GS600PDeviceControlBase::setToolingDataChunkParam(const MS_ByteStringChunkParam& _val)
+{
+	QMutexLocker locker(&m_toolingDataChunkParamMutex);
+	m_toolingDataChunkParam = _val;
+}
+
+namespace
+{
+	//批量上传槽位的字段名
+	QString uploadSlotFieldName(const QString& _fieldName, int _slotIndex)
+	{
+		return QString(u8"%1_%2").arg(_fieldName).arg(_slotIndex);
+	}
+}
+
+ME_ToolingPayloadCodec MC_GS600PDeviceControlBase::getNegotiatedToolingPayloadCodec() const
+{
+	//本端关闭编码时上传也按原文处理
+	return m_isUseToolingPayloadCodec ? getToolingPayloadCodec() : ME_ToolingPayloadCodec::NONE;
+}
+
+void MC_GS600PDeviceControlBase::readToolingPayloadCodecCapability()
+{
+	m_isReadingToolingPayloadCodec = true;
+	auto onReadFinished = [=]()
+	{
+		m_isReadingToolingPayloadCodec = false;
+		auto waitFuns = std::move(m_waitToolingPayloadCodecFuns);
+		m_waitToolingPayloadCodecFuns.clear();
+		for (const auto& var : waitFuns)
+		{
+			var();
+		}
+	};
+	readVal(MI_GS600PDeviceField::s_deviceToolingPayloadCodecName,
+		[=](ME_Error const& _error)
+	{
+		//旧设备没有该字段,按不编码传输
+		m_toolingPayloadCodec = static_cast<quint16>(ME_ToolingPayloadCodec::NONE);
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"设备未提供载荷编码能力,工装数据不压缩传输 : %1", _error.getMessage());
+		onReadFinished();
+	},
+		[=](QVariant const& _val)
+	{
+		auto codec = _val.value<quint16>();
+		if (!MA_ToolingPayloadCodec::isCodecSupported(codec))
+		{
+			log(ML_LogLabel::WARNING_LABEL, QString(u8"设备载荷编码[%1]不支持,工装数据不压缩传输").arg(codec));
+			codec = static_cast<quint16>(ME_ToolingPayloadCodec::NONE);
+		}
+		m_toolingPayloadCodec = codec;
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"工装数据载荷编码 : %1", MA_ToolingPayloadCodec::codecToString(static_cast<ME_ToolingPayloadCodec>(codec)));
+		onReadFinished();
+	});
 }
 
 void MC_GS600PDeviceControlBase::makeNodesValChangedConnections()
@@ -186,6 +330,7 @@ void MC_GS600PDeviceControlBase::makeReceiveToolingValConnections()
 
 MC_GS600PDeviceControlBase::~MC_GS600PDeviceControlBase()
 {
+	ML_AsyncLogger::instance().removeEchoTarget(reinterpret_cast<quintptr>(this));
 	m_onClientRequireDataMachine->stop();
 	m_onClientUploadDataMachine->stop();
 }
@@ -210,7 +355,9 @@ void MC_GS600PDeviceControlBase::setDeviceReadyToSendOutState(quint16 _val)
 	}
 
 	if (_val == MS_IsReadyReceiveAndSendToolingState::HAS_READY) {
-		setDeviceReadyToSendOutDateTime(QDateTime::currentDateTime());
+		auto curDateTime = QDateTime::currentDateTime();
+		setDeviceReadyToSendOutDateTime(curDateTime);
+		markCycle(ME_StationMoveType::SEND, ME_StationCyclePhase::READY, curDateTime.toMSecsSinceEpoch());
 	}
 
 	m_deviceReadyToSendOutState = _val;
@@ -238,7 +385,9 @@ void MC_GS600PDeviceControlBase::setDeviceReadyToReceiveInState(quint16 _val)
 	}
 
 	if (_val == MS_IsReadyReceiveAndSendToolingState::HAS_READY) {
-		setDeviceReadyToReceiveInDateTime(QDateTime::currentDateTime());
+		auto curDateTime = QDateTime::currentDateTime();
+		setDeviceReadyToReceiveInDateTime(curDateTime);
+		markCycle(ME_StationMoveType::RECEIVE, ME_StationCyclePhase::READY, curDateTime.toMSecsSinceEpoch());
 	}
 	m_deviceReadyToReceiveInState = _val;
 
@@ -269,7 +418,7 @@ void MC_GS600PDeviceControlBase::initOnClientRequireDataMachine()
 	auto readRequireDataCommandFirstTimeState = new QState();
 	QObject::connect(readRequireDataCommandFirstTimeState, &QState::entered, this, [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"等待请求数据指令...");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"等待请求数据指令...");
 		m_onCheckRequireDataTimer->start(300);
 		setStateOnExitAction(curMachine, readRequireDataCommandFirstTimeState, [=]()
 		{
@@ -285,7 +434,7 @@ void MC_GS600PDeviceControlBase::initOnClientRequireDataMachine()
 	auto startExecuteState = new QState();
 	QObject::connect(startExecuteState, &QState::entered, this, [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"收到请求数据指令,开始执行...");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"收到请求数据指令,开始执行...");
 		std::vector<QString> keyNames;
 		keyNames.emplace_back(MI_Device::s_deviceRequireDataToolingIdentifierTypeName);
 		keyNames.emplace_back(MI_Device::s_deviceRequireDataToolingIdentifierName);
@@ -332,13 +481,37 @@ void MC_GS600PDeviceControlBase::initOnClientRequireDataMachine()
 			auto identifierType = typeResultIter->second.value<quint16>();
 			auto identifier = identifierResultIter->second.value<QByteArray>();
 
+			//缓存命中时直接下发数据,不再等待上位机查找
+			auto cachedData = m_isUseToolingDataCache ? MC_ToolingDataCache::instance().find(identifierType, identifier) : boost::none;
+			if (cachedData)
+			{
+				logAsync(ML_LogLabel::NORMAL_LABEL, u8"请求数据指令命中缓存,直接下发数据(识别码类型[%1] 识别码[%2])...", identifierType, identifier);
+				auto toolingData = *cachedData;
+				//先置执行中,再写数据(服务器不保证一次请求内各项的处理顺序)
+				writeSingleVal(MI_Device::s_deviceRequireDataExecuteStateName, MS_ExecuteState::EXECUTING, QOpcUa::Types::UInt16, [=](const ME_Error& _error)
+				{
+					log(ML_LogLabel::WARNING_LABEL, QString(u8"请求数据指令下发数据写执行状态失败 : %1").arg(_error.getMessage()));
+					onError();
+				}, [=]()
+				{
+					writeToolingData(toolingData.m_data, toolingData.m_isDataValid, toolingData.m_isDoAll, {}, [=](const ME_Error& _error)
+					{
+						log(ML_LogLabel::WARNING_LABEL, QString(u8"请求数据指令下发缓存数据失败 : %1").arg(_error.getMessage()));
+						onError();
+					}, [=]()
+					{
+						emit sig_deviceRequireDataServedFromCache(MI_ToolingIdentifier(identifier, identifierType));
+						curMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::CommandWriteDataSuccess));
+					});
+				});
+				return;
+			}
+
 			//写执行状态
 			auto watch = m_client->writeNodeVariable(MI_Device::s_deviceRequireDataExecuteStateName, MS_ExecuteState::EXECUTING, QOpcUa::Types::UInt16);
 			QObject::connect(watch, &MC_FutureWatchBase::finished, this, [=]()
 			{
-				log(ML_LogLabel::NORMAL_LABEL, QString(u8"请求数据指令下发数据(识别码类型[%1] 识别码[%2])...")
-					.arg(QString::number(identifierType))
-					.arg(QString(identifier)));
+				logAsync(ML_LogLabel::NORMAL_LABEL, u8"请求数据指令下发数据(识别码类型[%1] 识别码[%2])...", identifierType, identifier);
 
 				ME_DestructExecuter onDeleteObject([=]() {
 					watch->deleteLater();
@@ -351,7 +524,7 @@ void MC_GS600PDeviceControlBase::initOnClientRequireDataMachine()
 				}
 				emit sig_deviceRequireData(MI_ToolingIdentifier(identifier, identifierType));
 				//等待写入数据
-				log(ML_LogLabel::NORMAL_LABEL, u8"请求数据指令等待查找数据...");
+				logAsync(ML_LogLabel::NORMAL_LABEL, u8"请求数据指令等待查找数据...");
 			});
 
 		});
@@ -361,39 +534,28 @@ void MC_GS600PDeviceControlBase::initOnClientRequireDataMachine()
 	auto writeExecuteFinishState = new QState();
 	QObject::connect(writeExecuteFinishState, &QState::entered, this, [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"请求数据指令已下发数据");
-		log(ML_LogLabel::NORMAL_LABEL, u8"重置不请求数据指令...");
-		//写不请求数据指令
-		auto writeNotRequireDataWatch = m_client->writeNodeVariable(MI_Device::s_deviceRequireDataCommandName, MI_SendCommand::NOT_EXECUTE, QOpcUa::Types::UInt16);
-		QObject::connect(writeNotRequireDataWatch, &MC_FutureWatchBase::finished, this, [=]()
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"请求数据指令已下发数据");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"重置不请求数据指令...");
+		//写不请求数据指令,成功后再写执行完成(服务器不保证一次请求内各项的处理顺序)
+		writeSingleVal(MI_Device::s_deviceRequireDataCommandName, MI_SendCommand::NOT_EXECUTE, QOpcUa::Types::UInt16,
+			[=](const ME_Error& _error)
 		{
-			ME_DestructExecuter onDeleteObject([=]() {
-				writeNotRequireDataWatch->deleteLater();
-			});
-			if (!writeNotRequireDataWatch->getIsSuccess())
+			log(ML_LogLabel::WARNING_LABEL, QString(u8"重置不请求数据指令失败 : %1").arg(_error.getMessage()));
+			onError();
+		},
+			[=]()
+		{
+			setDeviceIsRequireDataState(MS_DeviceRequireDataState::NOT_REQUIRE);
+			writeSingleVal(MI_Device::s_deviceRequireDataExecuteStateName, MS_ExecuteState::FINIHED, QOpcUa::Types::UInt16,
+				[=](const ME_Error& _error)
 			{
-				log(ML_LogLabel::WARNING_LABEL, QString(u8"重置不请求数据指令失败 : %1").arg(writeNotRequireDataWatch->getErrorString()));
+				log(ML_LogLabel::WARNING_LABEL, QString(u8"请求数据指令置完成失败 : %1").arg(_error.getMessage()));
 				onError();
-				return;
-			}
-			setDeviceIsRequireDataState(MS_DeviceRequireDataState::NOT_REQUIRE);
-
-			//写执行完成
-			auto writeExecuteFinishedWatch = m_client->writeNodeVariable(MI_Device::s_deviceRequireDataExecuteStateName, MS_ExecuteState::FINIHED, QOpcUa::Types::UInt16);
-			QObject::connect(writeExecuteFinishedWatch, &MC_FutureWatchBase::finished, this, [=]()
+			},
+				[=]()
 			{
-				ME_DestructExecuter onDeleteObject([=]() {
-					writeExecuteFinishedWatch->deleteLater();
-				});
-				if (!writeExecuteFinishedWatch->getIsSuccess())
-				{
-					log(ML_LogLabel::WARNING_LABEL, QString(u8"请求数据指令置完成失败 : %1").arg(writeExecuteFinishedWatch->getErrorString()));
-					onError();
-					return;
-				}
 				curMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::CommandExecuteFinished));
 			});
-
 		});
 	});
 
@@ -407,7 +569,7 @@ void MC_GS600PDeviceControlBase::initOnClientRequireDataMachine()
 	auto onSuccessState = new QState();
 	QObject::connect(onSuccessState, &QState::entered, this, [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"下发数据成功！");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"下发数据成功！");
 		qDebug() << u8"Execute device require data success! ";
 	});
 
@@ -458,7 +620,7 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 	auto readUploadCommandFirstTimeState = new QState();
 	QObject::connect(readUploadCommandFirstTimeState, &QState::entered, this, [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"等待上传数据指令...");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"等待上传数据指令...");
 		m_onCheckRequireUploadTimer->start(300);
 		setStateOnExitAction(curMachine, readUploadCommandFirstTimeState, [=]()
 		{
@@ -474,8 +636,14 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 	auto checkDataValidState = new QState();
 	QObject::connect(checkDataValidState, &QState::entered, this, [=]()
 	{
+		//批量上传按槽位各自的有效位
+		if (getUploadSlotCount() > 0)
+		{
+			curMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataIsValid));
+			return;
+		}
 		//读数据是否有效
-		log(ML_LogLabel::NORMAL_LABEL, u8"上传数据读取数据有效位...");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据读取数据有效位...");
 		readVal(MI_Device::s_deviceUploadWorkResultDataToolingDataIsValidName,
 			[=](ME_Error const& _val)
 		{
@@ -490,7 +658,7 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 			}
 			else
 			{
-				log(ML_LogLabel::NORMAL_LABEL, u8"上传数据检查数据有效!");
+				logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据检查数据有效!");
 				curMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataIsValid));
 			}
 		});
@@ -498,14 +666,18 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 
 	//读数据并置执行中状态
 	auto startExecuteState = new QState();
-	QObject::connect(startExecuteState, &QState::entered, this, [=]()
+	auto startExecute = [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"上传数据读取数据中...");
+		if (getUploadSlotCount() > 0)
+		{
+			startExecuteBatchUpload(curMachine);
+			return;
+		}
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据读取数据中...");
 		std::vector<QString> keyNames;
 		keyNames.emplace_back(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierTypeName);
 		keyNames.emplace_back(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierName);
 		keyNames.emplace_back(MI_Device::s_deviceUploadWorkResultDataToolingIndexName);
-		keyNames.emplace_back(MI_Device::s_deviceUploadWorkResultDataContentName);
 
 		auto logReadValFailFun = [=](const QString& _key) {
 			log(ML_LogLabel::WARNING_LABEL, QString(u8"读取上传数据:[%1] 读取失败!").arg(_key));
@@ -515,11 +687,13 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 			log(ML_LogLabel::WARNING_LABEL, QString(u8"读取上传数据:[%1] 数据类型不正确!").arg(_key));
 		};
 
-		readMultiVal(keyNames, [=](ME_Error const& _val)
+		auto onReadFail = [=](ME_Error const& _val)
 		{
 			log(ML_LogLabel::WARNING_LABEL, _val.getMessage());
 			onError();
-		}, [=](std::map<QString, QVariant> const& _result)
+		};
+
+		auto onUploadDataRead = [=](std::map<QString, QVariant> const& _result)
 		{
 			//确认是否有数据
 			QString curKeyName = MI_Device::s_deviceUploadWorkResultDataToolingIdentifierTypeName;
@@ -595,12 +769,20 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 			auto identifierType = typeResultIter->second.value<quint16>();
 			auto identifier = identifierResultIter->second.value<QByteArray>();
 			auto toolingIndex = iterToolingIndex->second.value<quint64>();
+			//ByteString的值即为隐式共享的QByteArray,此处及之后传递到MR_WorkToolingData都只增加引用计数,不要对其做非const访问以免分离复制
 			auto toolingData = iterData->second.value<QByteArray>();
+			if (getNegotiatedToolingPayloadCodec() != ME_ToolingPayloadCodec::NONE)
+			{
+				auto decodeResult = MA_ToolingPayloadCodec::decode(iterData->second.value<QByteArray>(), &toolingData);
+				if (decodeResult.hasError())
+				{
+					log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据解码失败 : %1").arg(decodeResult.getError()->getMessage()));
+					onError();
+					return;
+				}
+			}
 
-			log(ML_LogLabel::NORMAL_LABEL, QString(u8"准备上传数据: 识别码类型[%1] 识别码[%2] 工装数据[%3]")
-				.arg(QString::number(identifierType))
-				.arg(QString(identifier))
-				.arg(QString(toolingData)));
+			logAsync(ML_LogLabel::NORMAL_LABEL, u8"准备上传数据: 识别码类型[%1] 识别码[%2] 工装数据[%3]", identifierType, identifier, toolingData);
 
 			//写执行状态
 			auto watch = m_client->writeNodeVariable(MI_Device::s_deviceUploadWorkResultDataCommandName, MS_ExecuteState::EXECUTING, QOpcUa::Types::UInt16);
@@ -615,12 +797,77 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 					onError();
 					return;
 				}
-				log(ML_LogLabel::NORMAL_LABEL, u8"上传数据等待完成...");
+				//写入日志,落盘即可置完成,交付由日志负责
+				if (m_isUploadJournalEnabled)
+				{
+					MS_ToolingUploadRecord record;
+					record.m_identifierType = identifierType;
+					record.m_identifier = identifier;
+					record.m_toolingIndex = toolingIndex;
+					record.m_data = toolingData;
+					m_uploadJournal->append(record, [=](const MM_MaybeOk& _result)
+					{
+						if (_result.hasError())
+						{
+							log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据写入日志失败 : %1").arg(_result.getError()->getMessage()));
+							onError();
+							return;
+						}
+						curMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+					});
+					return;
+				}
+				logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据等待完成...");
 				emit sig_deviceUploadData(MR_WorkToolingData(MI_ToolingIdentifier(identifier, identifierType), toolingIndex, toolingData));
 				//等待上传
 			});
 
+		};
+
+		auto chunkParam = getToolingDataChunkParam();
+		if (chunkParam.m_chunkSize <= 0)
+		{
+			keyNames.emplace_back(MI_Device::s_deviceUploadWorkResultDataContentName);
+			readMultiVal(keyNames, onReadFail, onUploadDataRead);
+			return;
+		}
+
+		//内容分块读取(定长节点,按长度字段截取),读完与其余字段合并
+		chunkParam.m_lengthKeyName = MI_GS600PDeviceField::s_deviceUploadWorkResultDataContentLengthName;
+		readMultiVal(keyNames, onReadFail, [=](std::map<QString, QVariant> const& _result)
+		{
+			auto watch = m_client->readByteStringChunked(MI_Device::s_deviceUploadWorkResultDataContentName, chunkParam);
+			QObject::connect(watch, &MC_FutureWatchBase::finished, this, [=]()
+			{
+				ME_DestructExecuter onDeleteObject([=]() {
+					watch->deleteLater();
+				});
+				if (!watch->getIsSuccess())
+				{
+					onReadFail(ME_Error(watch->getErrorString()));
+					return;
+				}
+				auto result = _result;
+				result[MI_Device::s_deviceUploadWorkResultDataContentName] = QVariant(watch->getResult());
+				onUploadDataRead(result);
+			});
 		});
+	};
+	QObject::connect(startExecuteState, &QState::entered, this, [=]()
+	{
+		//编码未协商完时等待,避免按上次连接的编码解码;等待期间已离开本状态的不再执行
+		if (m_isReadingToolingPayloadCodec)
+		{
+			m_waitToolingPayloadCodecFuns.emplace_back([=]()
+			{
+				if (startExecuteState->active())
+				{
+					startExecute();
+				}
+			});
+			return;
+		}
+		startExecute();
 	});
 
 	//写执行完成
@@ -639,37 +886,36 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 				return;
 			}*/
 
-			//重置上传数据指令为不执行
-		auto writeNotRequireDataWatch = m_client->writeNodeVariable(MI_Device::s_deviceUploadWorkResultDataCommandName, MI_SendCommand::NOT_EXECUTE, QOpcUa::Types::UInt16);
-		QObject::connect(writeNotRequireDataWatch, &MC_FutureWatchBase::finished, this, [=]()
+			//清除已读槽位的有效位并重置上传数据指令为不执行(互不依赖,一次写入),成功后再写执行完成
+		std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>> finishVals;
+		for (auto slotIndex : m_drainedUploadSlots)
 		{
-			ME_DestructExecuter onDeleteObject([=]() {
-				writeNotRequireDataWatch->deleteLater();
-			});
-			if (!writeNotRequireDataWatch->getIsSuccess())
+			finishVals.emplace_back(std::make_pair(uploadSlotFieldName(MI_Device::s_deviceUploadWorkResultDataToolingDataIsValidName, slotIndex),
+				std::make_pair(QOpcUa::Types::UInt16, QVariant(MS_DataValidState::NOT_VALID))));
+		}
+		m_drainedUploadSlots.clear();
+		finishVals.emplace_back(std::make_pair(MI_Device::s_deviceUploadWorkResultDataCommandName, std::make_pair(QOpcUa::Types::UInt16, QVariant(MI_SendCommand::NOT_EXECUTE))));
+		writeMultiVals(finishVals,
+			[=](const ME_Error& _error)
+		{
+			log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据指令置不执行失败 : %1").arg(_error.getMessage()));
+			onError();
+		},
+			[=]()
+		{
+			//有效位已清除,这些记录不会再被读到
+			m_deliveredUploadKeys.clear();
+			setDeviceIsRequireUploadDataState(MS_DeviceReuireUploadDataState::NOT_REQUIRE);
+			writeSingleVal(MI_Device::s_deviceUploadWorkResultDataExecuteStateName, MS_ExecuteState::FINIHED, QOpcUa::Types::UInt16,
+				[=](const ME_Error& _error)
 			{
-				log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据指令置不执行失败 : %1").arg(writeNotRequireDataWatch->getErrorString()));
+				log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据指令写执行完成失败 : %1").arg(_error.getMessage()));
 				onError();
-				return;
-			}
-
-			setDeviceIsRequireUploadDataState(MS_DeviceReuireUploadDataState::NOT_REQUIRE);
-			//写执行完成
-			auto writeExecuteFinishedWatch = m_client->writeNodeVariable(MI_Device::s_deviceUploadWorkResultDataExecuteStateName, MS_ExecuteState::FINIHED, QOpcUa::Types::UInt16);
-			QObject::connect(writeExecuteFinishedWatch, &MC_FutureWatchBase::finished, this, [=]()
+			},
+				[=]()
 			{
-				ME_DestructExecuter onDeleteObject([=]() {
-					writeExecuteFinishedWatch->deleteLater();
-				});
-				if (!writeExecuteFinishedWatch->getIsSuccess())
-				{
-					log(ML_LogLabel::WARNING_LABEL, QString(u8"上传数据指令写执行完成失败 : %1").arg(writeExecuteFinishedWatch->getErrorString()));
-					onError();
-					return;
-				}
 				curMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::CommandExecuteFinished));
 			});
-
 		});
 
 		//	});
@@ -680,12 +926,15 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 	QObject::connect(onFailState, &QState::entered, this, [=]()
 	{
 		log(ML_LogLabel::WARNING_LABEL, u8"上传数据失败！");
+		//未清除有效位的槽位下次上传时重新读取;已交付记录的待确认数保留,下一轮不重复交付
+		m_isWaitingBatchUploadAck = false;
+		m_drainedUploadSlots.clear();
 		qDebug() << u8"Execute device upload data fail! ";
 	});
 	auto onSuccessState = new QState();
 	QObject::connect(onSuccessState, &QState::entered, this, [=]()
 	{
-		log(ML_LogLabel::NORMAL_LABEL, u8"上传数据成功！");
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"上传数据成功！");
 		qDebug() << u8"Execute device upload data success! ";
 	});
 
@@ -735,6 +984,171 @@ void MC_GS600PDeviceControlBase::initOnClinetUploadDataMachine()
 
 }
 
+void MC_GS600PDeviceControlBase::startExecuteBatchUpload(QStateMachine* _machine)
+{
+	auto onError = [=]()
+	{
+		_machine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::ExistError));
+	};
+
+	auto slotCount = getUploadSlotCount();
+	logAsync(ML_LogLabel::NORMAL_LABEL, u8"批量上传读取%1个槽位...", slotCount);
+	std::vector<QString> keyNames;
+	keyNames.reserve(slotCount * 5);
+	for (auto slotIndex = 1; slotIndex <= slotCount; ++slotIndex)
+	{
+		keyNames.emplace_back(uploadSlotFieldName(MI_Device::s_deviceUploadWorkResultDataToolingDataIsValidName, slotIndex));
+		keyNames.emplace_back(uploadSlotFieldName(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierTypeName, slotIndex));
+		keyNames.emplace_back(uploadSlotFieldName(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierName, slotIndex));
+		keyNames.emplace_back(uploadSlotFieldName(MI_Device::s_deviceUploadWorkResultDataToolingIndexName, slotIndex));
+		keyNames.emplace_back(uploadSlotFieldName(MI_Device::s_deviceUploadWorkResultDataContentName, slotIndex));
+	}
+
+	readMultiVal(keyNames, [=](ME_Error const& _val)
+	{
+		log(ML_LogLabel::WARNING_LABEL, QString(u8"批量上传读取槽位失败 : %1").arg(_val.getMessage()));
+		onError();
+	}, [=](std::map<QString, QVariant> const& _result)
+	{
+		auto findVal = [&](const QString& _fieldName, int _slotIndex) -> const QVariant*
+		{
+			auto iter = _result.find(uploadSlotFieldName(_fieldName, _slotIndex));
+			return iter == _result.end() ? nullptr : &iter->second;
+		};
+
+		std::vector<int> slotIndexes;
+		std::vector<MS_ToolingUploadRecord> records;
+		std::vector<std::tuple<int, quint16, QByteArray, quint64, QByteArray>> recordKeys;
+		auto deliveredCount = 0;
+		for (auto slotIndex = 1; slotIndex <= slotCount; ++slotIndex)
+		{
+			auto isValidVal = findVal(MI_Device::s_deviceUploadWorkResultDataToolingDataIsValidName, slotIndex);
+			if (!isValidVal || isValidVal->value<quint16>() != MS_DataValidState::IS_VALID)
+			{
+				continue;
+			}
+
+			auto typeVal = findVal(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierTypeName, slotIndex);
+			auto identifierVal = findVal(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierName, slotIndex);
+			auto toolingIndexVal = findVal(MI_Device::s_deviceUploadWorkResultDataToolingIndexName, slotIndex);
+			auto contentVal = findVal(MI_Device::s_deviceUploadWorkResultDataContentName, slotIndex);
+			if (!typeVal || !typeVal->canConvert<quint16>()
+				|| !identifierVal || !identifierVal->canConvert<QByteArray>()
+				|| !toolingIndexVal || !toolingIndexVal->canConvert<quint64>()
+				|| !contentVal || !contentVal->canConvert<QByteArray>())
+			{
+				log(ML_LogLabel::WARNING_LABEL, QString(u8"批量上传槽位[%1]数据缺失或类型不正确!").arg(slotIndex));
+				onError();
+				return;
+			}
+
+			//与单条上传相同,内容只增加引用计数
+			auto toolingData = contentVal->value<QByteArray>();
+			if (getNegotiatedToolingPayloadCodec() != ME_ToolingPayloadCodec::NONE)
+			{
+				auto decodeResult = MA_ToolingPayloadCodec::decode(contentVal->value<QByteArray>(), &toolingData);
+				if (decodeResult.hasError())
+				{
+					log(ML_LogLabel::WARNING_LABEL, QString(u8"批量上传槽位[%1]解码失败 : %2").arg(slotIndex).arg(decodeResult.getError()->getMessage()));
+					onError();
+					return;
+				}
+			}
+			MS_ToolingUploadRecord record;
+			record.m_identifierType = typeVal->value<quint16>();
+			record.m_identifier = identifierVal->value<QByteArray>();
+			record.m_toolingIndex = toolingIndexVal->value<quint64>();
+			record.m_data = toolingData;
+			slotIndexes.push_back(slotIndex);
+
+			//上一轮失败前已交付的记录只需清除有效位
+			auto recordKey = std::make_tuple(slotIndex, record.m_identifierType, record.m_identifier, record.m_toolingIndex, record.m_data);
+			if (m_deliveredUploadKeys.count(recordKey))
+			{
+				++deliveredCount;
+				continue;
+			}
+			records.push_back(record);
+			recordKeys.push_back(recordKey);
+		}
+
+		if (slotIndexes.empty())
+		{
+			log(ML_LogLabel::WARNING_LABEL, u8"批量上传没有有效的槽位!");
+			onError();
+			return;
+		}
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"批量上传读到%1条数据,其中%2条已在失败的上一轮交付", static_cast<int>(slotIndexes.size()), deliveredCount);
+		m_drainedUploadSlots = slotIndexes;
+
+		//写执行状态
+		auto watch = m_client->writeNodeVariable(MI_Device::s_deviceUploadWorkResultDataCommandName, MS_ExecuteState::EXECUTING, QOpcUa::Types::UInt16);
+		QObject::connect(watch, &MC_FutureWatchBase::finished, this, [=]()
+		{
+			ME_DestructExecuter onDeleteObject([=]() {
+				watch->deleteLater();
+			});
+			if (!watch->getIsSuccess())
+			{
+				log(ML_LogLabel::WARNING_LABEL, QString(u8"批量上传写执行状态失败 : %1").arg(watch->getErrorString()));
+				onError();
+				return;
+			}
+
+			//全部落盘后即可置完成
+			if (m_isUploadJournalEnabled)
+			{
+				if (records.empty())
+				{
+					_machine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+					return;
+				}
+				auto durableCount = std::make_shared<int>(0);
+				auto isFailed = std::make_shared<bool>(false);
+				for (std::size_t curIndex = 0; curIndex < records.size(); ++curIndex)
+				{
+					auto recordKey = recordKeys[curIndex];
+					m_uploadJournal->append(records[curIndex], [=](const MM_MaybeOk& _result)
+					{
+						if (*isFailed)
+						{
+							return;
+						}
+						if (_result.hasError())
+						{
+							*isFailed = true;
+							log(ML_LogLabel::WARNING_LABEL, QString(u8"批量上传写入日志失败 : %1").arg(_result.getError()->getMessage()));
+							onError();
+							return;
+						}
+						m_deliveredUploadKeys.insert(recordKey);
+						if (++*durableCount == static_cast<int>(records.size()))
+						{
+							_machine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+						}
+					});
+				}
+				return;
+			}
+
+			//先置计数,上位机可能在信号中直接确认
+			m_pendingUploadAckCount += static_cast<int>(records.size());
+			m_deliveredUploadKeys.insert(recordKeys.begin(), recordKeys.end());
+			logAsync(ML_LogLabel::NORMAL_LABEL, u8"批量上传等待完成...");
+			for (const auto& var : records)
+			{
+				emit sig_deviceUploadData(MR_WorkToolingData(MI_ToolingIdentifier(var.m_identifier, var.m_identifierType), var.m_toolingIndex, var.m_data));
+			}
+			//交付过程中或之前已全部确认时在此完成
+			m_isWaitingBatchUploadAck = true;
+			if (m_pendingUploadAckCount.load() == 0 && m_isWaitingBatchUploadAck.exchange(false))
+			{
+				_machine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::DataUploadFinished));
+			}
+		});
+	});
+}
+
 void MC_GS600PDeviceControlBase::readDeviceIfUploadDataUntilSuccess()
 {
 	readVal(MI_Device::s_deviceUploadWorkResultDataCommandName,
@@ -833,6 +1247,10 @@ void MC_GS600PDeviceControlBase::setSendToolingCommandExecuteState(quint16 _val)
 		return;
 	}
 	m_sendToolingCommandExecuteState = _val;
+	if (_val == MS_ExecuteState::FINIHED)
+	{
+		markCycle(ME_StationMoveType::SEND, ME_StationCyclePhase::FINISHED);
+	}
 	emit this->sig_sendToolingCommandExecuteStateChanged(_val);
 }
 
@@ -861,6 +1279,7 @@ void MC_GS600PDeviceControlBase::makeNodeValueChangedConnection(const QString& _
 			}
 			if (_val.canConvert<quint16>())
 			{
+				MC_EventLoopActivityScope activityScope(_fieldName);
 				_onValChanedFun(_val.value<quint16>());
 			}
 		});
@@ -904,6 +1323,10 @@ void MC_GS600PDeviceControlBase::setReceiveToolingCommandExecuteState(quint16 _v
 	}
 
 	m_receiveToolingCommandExecuteState = _val;
+	if (_val == MS_ExecuteState::FINIHED)
+	{
+		markCycle(ME_StationMoveType::RECEIVE, ME_StationCyclePhase::FINISHED);
+	}
 	emit this->sig_receiveToolingCommandExecuteStateChanged(_val);
 }
 
@@ -914,6 +1337,10 @@ void MC_GS600PDeviceControlBase::tryConnect(const QHostAddress& _serverIpAddress
 	{
 		return;
 	}
+	{
+		QMutexLocker locker(&m_stationNameMutex);
+		m_serverName = QString(u8"%1:%2").arg(_serverIpAddress.toString()).arg(_port);
+	}
 	m_client->createAndConnectServer(_serverIpAddress, _port);
 }
 
@@ -1266,6 +1693,7 @@ void MC_GS600PDeviceControlBase::planReceiveTooling()
 		emit sig_startExecutePlanReceiveToolingResult(_val);
 	}, [=]()
 	{
+		markCycle(ME_StationMoveType::RECEIVE, ME_StationCyclePhase::PLANNED);
 		emit sig_startExecutePlanReceiveToolingResult(MM_MaybeOk());
 	});
 }
@@ -1279,6 +1707,7 @@ void MC_GS600PDeviceControlBase::planSendTooling()
 		emit sig_startExecutePlanSendToolingResult(_val);
 	}, [=]()
 	{
+		markCycle(ME_StationMoveType::SEND, ME_StationCyclePhase::PLANNED);
 		emit sig_startExecutePlanSendToolingResult(MM_MaybeOk());
 	});
 }
@@ -1290,6 +1719,10 @@ void MC_GS600PDeviceControlBase::executeSendToolingCommand()
 		MI_Device::s_sendToolingCommandName,
 		[=](MM_MaybeOk const & _val)
 	{
+		if (!_val.hasError())
+		{
+			markCycle(ME_StationMoveType::SEND, ME_StationCyclePhase::COMMANDED);
+		}
 		emit sig_startExecuteSendToolingCommandResult(_val);
 	},
 		[=]() {
@@ -1326,49 +1759,100 @@ void MC_GS600PDeviceControlBase::readDeviceIfConfigMainControl()
 	});
 }
 
-void MC_GS600PDeviceControlBase::onSendToolingData(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll)
+std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>> MC_GS600PDeviceControlBase::makeToolingDataVals(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll) const
 {
 	std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>> dataToWrite;
 	dataToWrite.emplace_back(std::make_pair(MI_Device::s_deviceRequireDataToolingIndexName, std::make_pair(QOpcUa::Types::UInt64, _data.m_toolingIndex)));
 	if (!_isDoAll)
 	{
-		dataToWrite.emplace_back(std::make_pair(MI_Device::s_deviceRequireDataToolingDataContentName, std::make_pair(QOpcUa::Types::ByteString, _data.m_data)));
+		//与工装数据共享缓冲区,到后端编码前不复制
+		dataToWrite.emplace_back(std::make_pair(MI_Device::s_deviceRequireDataToolingDataContentName, std::make_pair(QOpcUa::Types::ByteString, QVariant(_data.m_data))));
 
 	}
 	dataToWrite.emplace_back(std::make_pair(MI_Device::s_deviceRequireDataToolingIfDoAllName, std::make_pair(QOpcUa::Types::UInt16, (_isDoAll ? MS_IfWorkToolingDoAllFlag::DO_ALL : MS_IfWorkToolingDoAllFlag::NOT_DO_ALL))));
 	dataToWrite.emplace_back(std::make_pair(MI_Device::s_deviceRequireDataToolingDataIsValidName, std::make_pair(QOpcUa::Types::UInt16, (_isDataValid ? MS_DataValidState::IS_VALID : MS_DataValidState::NOT_VALID))));
+	return dataToWrite;
+}
 
-	if (_isDoAll) {
-		log(ML_LogLabel::NORMAL_LABEL, QString(u8"准备下发数据:全做"));
-	}
-	else
+void MC_GS600PDeviceControlBase::writeToolingData(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll,
+	const std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>>& _headVals,
+	std::function<void(MP_Public::ME_Error const & _val)> _onError, std::function<void()> _onSuccess)
+{
+	//编码未协商完时等待,避免按上次连接的编码下发
+	if (m_isReadingToolingPayloadCodec)
 	{
-		if (!_isDataValid) {
-			log(ML_LogLabel::NORMAL_LABEL, QString(u8"准备下发数据:数据无效"));
-		}
-		else
+		m_waitToolingPayloadCodecFuns.emplace_back([=]()
 		{
-			log(ML_LogLabel::NORMAL_LABEL, QString(u8"准备下发数据:%1").arg(QString(_data.m_data)));
-		}
+			writeToolingData(_data, _isDataValid, _isDoAll, _headVals, _onError, _onSuccess);
+		});
+		return;
 	}
 
+	//按协商的编码压缩内容,分块按压缩后的长度
+	auto payload = _data;
+	if (!_isDoAll && getNegotiatedToolingPayloadCodec() != ME_ToolingPayloadCodec::NONE)
+	{
+		payload.m_data = MA_ToolingPayloadCodec::encode(_data.m_data, getNegotiatedToolingPayloadCodec());
+	}
 
-	auto watch = m_client->writeMultiNodeVariables(dataToWrite);
-	QObject::connect(watch, &MC_FutureWatchBase::finished, this, [=]()
+	auto dataToWrite = _headVals;
+	auto toolingVals = makeToolingDataVals(payload, _isDataValid, _isDoAll);
+	auto chunkParam = getToolingDataChunkParam();
+	if (_isDoAll || chunkParam.m_chunkSize <= 0)
 	{
+		dataToWrite.insert(dataToWrite.end(), toolingVals.begin(), toolingVals.end());
+		writeMultiVals(dataToWrite, _onError, _onSuccess);
+		return;
+	}
 
+	//分块模式下内容节点为定长,不足一块也按块写入并写实际长度;其余字段在内容写完后一次写入
+	chunkParam.m_lengthKeyName = MI_GS600PDeviceField::s_deviceRequireDataToolingDataContentLengthName;
+	for (const auto& var : toolingVals)
+	{
+		if (var.first != MI_Device::s_deviceRequireDataToolingDataContentName)
+		{
+			dataToWrite.push_back(var);
+		}
+	}
+	auto watch = m_client->writeByteStringChunked(MI_Device::s_deviceRequireDataToolingDataContentName, payload.m_data, chunkParam);
+	QObject::connect(watch, &MC_FutureWatchBase::finished, this, [=]()
+	{
 		ME_DestructExecuter onDeleteObject([=]() {
 			watch->deleteLater();
 		});
-
 		if (!watch->getIsSuccess())
 		{
-			this->m_onClientRequireDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::ExistError));
+			_onError(ME_Error(watch->getErrorString()));
+			return;
+		}
+		writeMultiVals(dataToWrite, _onError, _onSuccess);
+	});
+}
+
+void MC_GS600PDeviceControlBase::onSendToolingData(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll)
+{
+	if (_isDoAll) {
+		logAsync(ML_LogLabel::NORMAL_LABEL, u8"准备下发数据:全做");
+	}
+	else
+	{
+		if (!_isDataValid) {
+			logAsync(ML_LogLabel::NORMAL_LABEL, u8"准备下发数据:数据无效");
 		}
 		else
 		{
-			this->m_onClientRequireDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::CommandWriteDataSuccess));
+			logAsync(ML_LogLabel::NORMAL_LABEL, u8"准备下发数据:%1", _data.m_data);
 		}
+	}
+
+
+	writeToolingData(_data, _isDataValid, _isDoAll, {}, [=](const ME_Error& _error)
+	{
+		log(ML_LogLabel::WARNING_LABEL, QString(u8"下发数据失败 : %1").arg(_error.getMessage()));
+		this->m_onClientRequireDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::ExistError));
+	}, [=]()
+	{
+		this->m_onClientRequireDataMachine->postEvent(new MT_TriggerEvent(MT_TriggerEventType::CommandWriteDataSuccess));
 	});
 }
 
@@ -1407,6 +1891,10 @@ void MC_GS600PDeviceControlBase::executeReceiveToolingCommand()
 		MI_Device::s_receiveToolingCommandName,
 		[=](MM_MaybeOk const & _val)
 	{
+		if (!_val.hasError())
+		{
+			markCycle(ME_StationMoveType::RECEIVE, ME_StationCyclePhase::COMMANDED);
+		}
 		emit sig_startExecuteReceiveToolingCommandResult(_val);
 	},
 		[=]() {
@@ -1518,5 +2006,19 @@ void MC_GS600PDeviceControlBase::clearConnectionMakeWhenConnection()
 	m_clientConnectedConnections.shrink_to_fit();
 }
 
+QString MC_GS600PDeviceControlBase::getStationName() const
+{
+	QMutexLocker locker(&m_stationNameMutex);
+	return m_stationName.isEmpty() ? m_serverName : m_stationName;
+}
 
+void MC_GS600PDeviceControlBase::setStationName(const QString& _val)
+{
+	QMutexLocker locker(&m_stationNameMutex);
+	m_stationName = _val;
+}
 
+void MC_GS600PDeviceControlBase::markCycle(ME_StationMoveType _moveType, ME_StationCyclePhase _phase, qint64 _msecsSinceEpoch)
+{
+	MC_StationCycleAnalyzer::instance().mark(getStationName(), _moveType, _phase, _msecsSinceEpoch);
+}
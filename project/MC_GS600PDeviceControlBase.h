@@ -5,11 +5,17 @@
 #include "MR_WorkToolingData.h"
 #include "MS_StateMachineAuxiliary.h"
 #include "ML_LogBase.h"
+#include "ML_AsyncLogger.h"
+#include "MC_StationCycleAnalyzer.h"
+#include "MS_ByteStringChunkParam.h"
+#include "MA_ToolingPayloadCodec.h"
 #include <QHostAddress>
 #include <QPointer>
 #include <QObject>
 #include <map>
 #include <memory>
+#include <set>
+#include <tuple>
 #include <functional>
 #include <atomic>
 #include <QString>
@@ -23,6 +29,7 @@ class MC_OpcUaClient;
 class QStateMachine;
 class QState;
 class MC_FutureWatchBase;
+class MC_ToolingUploadJournal;
 class QTimer;
 
 
@@ -48,6 +55,13 @@ public:
 	MT_GS600PCommunicationDeviceType getCommunicationDeviceType() const { return m_communicationDeviceType; }
 	void setCommuicationDeviceType(MT_GS600PCommunicationDeviceType _val) { m_communicationDeviceType = _val; }
 
+	//OpcUa客户端(供整线并发连接等使用)
+	std::shared_ptr<MC_OpcUaClient> getClient() const { return m_client; }
+
+	//工位名称,用于节拍统计,未设置时取服务器地址
+	QString getStationName() const;
+	void setStationName(const QString& _val);
+
 	quint16 getInitCommandExecuteState() const { return m_initCommandExecuteState.load(); }
 	quint16 getPlanReceiveToolingStateRespond() const { return m_planReceiveToolingStateRespond.load(); }
 
@@ -81,6 +95,7 @@ public:
 		std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>> const& _vals,
 		std::function<void(MP_Public::ME_Error const & _val)> _onError,
 		std::function<void()> _onSuccess);
+
 	
 	QDateTime getDeviceReadyToReceiveInDateTime();
 	void setDeviceReadyToReceiveInDateTime(const QDateTime& val);
@@ -92,6 +107,9 @@ signals:
 	void sig_connectResult(const MP_Public::MM_MaybeOk& _result);
 
 	void sig_connectStateChanged(MS_ConnectState _val);
+	//连接建立/断开的边沿信号(客户端内部自动重连,上层无需轮询连接状态)
+	void sig_connectionEstablished();
+	void sig_connectionLost();
 	
 	//设备类型检测结果信号
 	void sig_deviceTypeCheckResult(const MP_Public::MM_Maybe<bool>& _result);
@@ -147,6 +165,8 @@ signals:
 	//请求数据信号
 	void sig_hasReceiveDeviceRequireDataCommand();
 	void sig_deviceRequireData(const MI_ToolingIdentifier& _val);
+	//请求数据由MC_ToolingDataCache命中并已下发,上位机无需再调用onSendToolingData
+	void sig_deviceRequireDataServedFromCache(const MI_ToolingIdentifier& _val);
 
 	//请求上传数据信号
 	void sig_hasReceiveDeviceRequireUploadDataCommand();
@@ -198,9 +218,39 @@ public slots:
 	//发送工装数据
 	void onSendToolingData(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll = false );
 
+	//请求数据时先查MC_ToolingDataCache,命中则直接下发;默认关闭
+	bool getIsUseToolingDataCache() const { return m_isUseToolingDataCache.load(); }
+	void setIsUseToolingDataCache(bool _val) { m_isUseToolingDataCache = _val; }
+
+	//块大小不为0时工装数据内容按块下发/读取(设备内容节点为定长数组,实际长度见MI_GS600PDeviceField),见MC_OpcUaClient::writeByteStringChunked;
+	//块大小为0(默认)时整块传输;长度字段名由本类填写,m_lengthKeyName无需设置
+	MS_ByteStringChunkParam getToolingDataChunkParam() const;
+	void setToolingDataChunkParam(const MS_ByteStringChunkParam& _val);
+
+	//工装数据载荷编码,连接后从设备能力字段读取,设备未提供该字段时不编码;下发时按此编码,协商的编码不为NONE时上传数据才按帧头解码
+	ME_ToolingPayloadCodec getToolingPayloadCodec() const { return static_cast<ME_ToolingPayloadCodec>(m_toolingPayloadCodec.load()); }
+	bool getIsUseToolingPayloadCodec() const { return m_isUseToolingPayloadCodec.load(); }
+	void setIsUseToolingPayloadCodec(bool _val) { m_isUseToolingPayloadCodec = _val; }
+
 	//上传完数据
 	void onHasUploadData();
 
+	//上传数据先写入预写日志,落盘后即释放分控,再由日志逐条交付sig_deviceUploadData,见MC_ToolingUploadJournal
+	//启用后onHasUploadData表示已处理完最近交付的一条
+	MP_Public::MM_MaybeOk enableUploadJournal(const QString& _filePath);
+	void disableUploadJournal();
+	bool isUploadJournalEnabled() const { return m_isUploadJournalEnabled.load(); }
+
+	/**
+	 * 批量上传:设备提供_slotCount个结果槽位,字段名为单条上传字段名加"_槽位序号"(从1开始),
+	 * 每个槽位有 有效位/识别码类型/识别码/工装序号/内容 五个字段;一次读取全部槽位,
+	 * 有效的槽位逐条交付sig_deviceUploadData(每条对应一次onHasUploadData),全部完成后一次写入清除其有效位并置执行完成
+	 * 某轮失败时槽位有效位未清除,下一轮会重新读到;已交付(或已写入日志)的记录不再重复交付,其确认计入下一轮
+	 * 槽位数为0(默认)时按单条上传
+	 */
+	int getUploadSlotCount() const { return m_uploadSlotCount.load(); }
+	void setUploadSlotCount(int _val) { m_uploadSlotCount = qMax(0, _val); }
+
 	//开始等待执行数据请求指令
 	void startWaitExecuteRequireData();
 	//停止执行数据请求指令
@@ -244,6 +294,13 @@ public slots:
 
 
 protected:
+	//握手热路径日志,只记录格式串和原始参数,格式化与写文件在后台线程完成(_format须为u8字面量)
+	template<typename... Args>
+	void logAsync(ML_LogLabel _label, const char* _format, Args&&... _args)
+	{
+		ML_AsyncLogger::instance().record(reinterpret_cast<quintptr>(this), _label, _format, std::forward<Args>(_args)...);
+	}
+
 	//数据相关连接
 	virtual void makeDataConnections();
 	//送板相关连接
@@ -279,6 +336,19 @@ protected:
 
 	void readMultiVal(std::vector<QString> const& _keyNames, std::function<void(MP_Public::ME_Error const & _error)> const & _onFail, std::function<void(std::map<QString, QVariant> const & _val)> const & _onSuccess);
 
+	//下发工装数据时写入的字段
+	std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>> makeToolingDataVals(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll) const;
+	//读取设备支持的载荷编码,读取完成前的下发及上传等待读取完成
+	void readToolingPayloadCodecCapability();
+	//实际使用的载荷编码(设备能力且本端启用),为NONE时下发不编码、上传不解码
+	ME_ToolingPayloadCodec getNegotiatedToolingPayloadCodec() const;
+	//批量上传读取全部槽位并交付有效的槽位
+	void startExecuteBatchUpload(QStateMachine* _machine);
+	//下发工装数据,_headVals在数据字段之前写入;启用分块时先分块写内容,再写其余字段,设备看到有效位时内容已完整
+	void writeToolingData(const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll,
+		const std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>>& _headVals,
+		std::function<void(MP_Public::ME_Error const & _val)> _onError, std::function<void()> _onSuccess);
+
 
 	//设备通讯类型
 	MT_GS600PCommunicationDeviceType m_communicationDeviceType = MT_GS600PCommunicationDeviceType::GS600P_TYPE;
@@ -338,9 +408,41 @@ protected:
 	QDateTime m_deviceReadyToSendOutDateTime = QDateTime::currentDateTime();
 	QMutex m_deviceReadyToSendOutDateTimeMutex;
 
+	//节拍统计打点
+	void markCycle(ME_StationMoveType _moveType, ME_StationCyclePhase _phase, qint64 _msecsSinceEpoch = -1);
+
+	QString m_stationName;
+	QString m_serverName;
+	mutable QMutex m_stationNameMutex;
+
 	QTimer* m_onCheckRequireDataTimer{};
 	QTimer* m_onCheckRequireUploadTimer{};
 
+	std::atomic_bool m_isUseToolingDataCache{ false };
+
+	MS_ByteStringChunkParam m_toolingDataChunkParam;
+	mutable QMutex m_toolingDataChunkParamMutex;
+
+	std::atomic<quint16> m_toolingPayloadCodec{ static_cast<quint16>(ME_ToolingPayloadCodec::NONE) };
+	std::atomic_bool m_isUseToolingPayloadCodec{ true };
+	//载荷编码能力读取中,期间的下发及上传排队到读取完成
+	bool m_isReadingToolingPayloadCodec{ false };
+	std::vector<std::function<void()>> m_waitToolingPayloadCodecFuns;
+
+	//上传数据预写日志
+	MC_ToolingUploadJournal* m_uploadJournal{};
+	std::atomic_bool m_isUploadJournalEnabled{ false };
+
+	std::atomic_int m_uploadSlotCount{ 0 };
+	//批量上传已交付、等待上位机确认的条数(失败的一轮未确认的也计入)
+	std::atomic_int m_pendingUploadAckCount{ 0 };
+	//本轮批量上传已全部交付,确认完即可完成
+	std::atomic_bool m_isWaitingBatchUploadAck{ false };
+	//已交付但所在的一轮尚未完成的记录(槽位/识别码类型/识别码/工装序号/内容),失败后重读时不再交付
+	std::set<std::tuple<int, quint16, QByteArray, quint64, QByteArray>> m_deliveredUploadKeys;
+	//本轮批量上传读出的槽位,完成时清除其有效位
+	std::vector<int> m_drainedUploadSlots;
+
 	QString getTransitionKeyString(ME_TransitionKeyWordType _type);
 	std::map<ME_TransitionKeyWordType, QString> m_transitionKeyWordMap;
 
@@ -3,6 +3,8 @@
 #include "MT_Transition.h"
 #include "ML_GlobalLog.h"
 #include "MA_Auxiliary.h"
+#include "MC_StationCycleAnalyzer.h"
+#include "MC_EventLoopLagMonitor.h"
 #include <QStateMachine>
 #include <QState>
 #include <QTimer>
@@ -22,7 +24,8 @@ MC_OpcDeviceControl::MC_OpcDeviceControl(const QString& _name, QObject *_parent)
 	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectResult, this, [=](const MM_MaybeOk& _val)
 	{
 		emit sig_connectResult(_val);
-		if (!_val.hasError())
+		//沿用上次会话时节点及信号连接仍有效,无需重建
+		if (!_val.hasError() && !m_client->isSessionResumed())
 		{
 			clearConnectionMakeWhenConnection();
 			Q_ASSERT(m_client);
@@ -38,6 +41,9 @@ MC_OpcDeviceControl::MC_OpcDeviceControl(const QString& _name, QObject *_parent)
 		emit this->sig_connectStateChanged(_val);
 	});
 
+	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectionEstablished, this, &MC_OpcDeviceControl::sig_connectionEstablished);
+	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectionLost, this, &MC_OpcDeviceControl::sig_connectionLost);
+
 
 	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_log, this, [=](const auto& _name, ML_LogLabel _label, const QString & _log) {
 		emit sig_log(_name, _label, _log);
@@ -117,6 +123,12 @@ void MC_OpcDeviceControl::setDeviceReadyToReceiveAndSendWaferState(quint16 _val)
 		return;
 	}
 
+	//设备由未就绪进入就绪(收/送)时记周期起点,收/送之间切换不算新周期
+	if (getDeviceReadyToReceiveAndSendWaferState() == MS_IsReadyReceiveAndSendWaferState::NOT_READY
+		&& _val != MS_IsReadyReceiveAndSendWaferState::NOT_READY) {
+		MC_StationCycleAnalyzer::instance().mark(m_name, ME_StationMoveType::WAFER, ME_StationCyclePhase::READY);
+	}
+
 	m_deviceReadyToReceiveAndSendWaferState = _val;
 
 	emit sig_readyToReceiveSendWaferStateChanged(_val);
@@ -152,6 +164,10 @@ void MC_OpcDeviceControl::setReceiveAndSendWaferCommandExecuteState(quint16 _val
 		return;
 	}
 	m_receiveAndSendWaferCommandExecuteState = _val;
+	if (_val == MS_ExecuteState::FINIHED)
+	{
+		MC_StationCycleAnalyzer::instance().mark(m_name, ME_StationMoveType::WAFER, ME_StationCyclePhase::FINISHED);
+	}
 	emit this->sig_receiveAndSendCommandExecuteStateChanged(_val);
 }
 
@@ -180,6 +196,7 @@ void MC_OpcDeviceControl::makeNodeValueChangedConnection(const QString& _fieldNa
 			}
 			if (_val.canConvert<quint16>())
 			{
+				MC_EventLoopActivityScope activityScope(_fieldName);
 				_onValChanedFun(_val.value<quint16>());
 			}
 		});
@@ -544,7 +561,6 @@ void MC_OpcDeviceControl::executePlanNode(const QString& _planRespondFieldName,
 
 void MC_OpcDeviceControl::planReceiveSendWafer()
 {
-
 	executePlanNode(MI_Device::s_deviceReceiveSendWaferBeInPlanningRespondKeyName,
 		MI_Device::s_deviceReceiveSendWaferBeInPlanningKeyName,
 		[=](ME_Error const _val)
@@ -552,6 +568,7 @@ void MC_OpcDeviceControl::planReceiveSendWafer()
 		emit sig_startExecutePlanReceiveSendWaferResult(_val);
 	}, [=]()
 	{
+		MC_StationCycleAnalyzer::instance().mark(m_name, ME_StationMoveType::WAFER, ME_StationCyclePhase::PLANNED);
 		emit sig_startExecutePlanReceiveSendWaferResult(MM_MaybeOk());
 	});
 }
@@ -564,6 +581,10 @@ void MC_OpcDeviceControl::executeReceiveSendWaferCommand()
 		MI_Device::s_deviceReceivceSendWaferCommandKeyName,
 		[=](MM_MaybeOk const & _val)
 	{
+		if (!_val.hasError())
+		{
+			MC_StationCycleAnalyzer::instance().mark(m_name, ME_StationMoveType::WAFER, ME_StationCyclePhase::COMMANDED);
+		}
 		emit sig_startExecuteReceiveSendWaferCommandResult(_val);
 	},
 		[=]() {
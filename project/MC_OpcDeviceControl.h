@@ -36,6 +36,9 @@ public:
 	MT_PC100CommunicationDeviceType getCommunicationDeviceType() const { return m_communicationDeviceType; }
 	void setCommuicationDeviceType(MT_PC100CommunicationDeviceType _val) { m_communicationDeviceType = _val; }
 
+	//OpcUa客户端(供整线并发连接等使用)
+	std::shared_ptr<MC_OpcUaClient> getClient() const { return m_client; }
+
 
 	quint16 getInitCommandExecuteState() const { return m_initCommandExecuteState.load(); }
 	void setInitCommandExecuteState(quint16 _val);
@@ -80,11 +83,15 @@ public:
 
 
 
+
 signals:
 	//连接服务器结果信号
 	void sig_connectResult(const MP_Public::MM_MaybeOk& _result);
 
 	void sig_connectStateChanged(MS_ConnectState _val);
+	//连接建立/断开的边沿信号(客户端内部自动重连,上层无需轮询连接状态)
+	void sig_connectionEstablished();
+	void sig_connectionLost();
 
 	//设备类型检测结果信号
 	void sig_deviceTypeCheckResult(const MP_Public::MM_Maybe<bool>& _result);
@@ -1,8 +1,10 @@
 #include "MC_OpcUaClient.h"
 #include "MD_OpcUaClientDevice.h"
 #include "MC_FutureWatchResultProvider.h"
+#include "MC_OpcUaSessionSnapshot.h"
 #include "MA_Auxiliary.h"
 #include <QDebug>
+#include <algorithm>
 #include <functional>
 #include <QTimer>
 
@@ -10,169 +12,614 @@ using MP_Public::MM_MaybeOk;
 using MP_Public::ME_Error;
 using MP_Public::MM_Maybe;
 MC_OpcUaClient::MC_OpcUaClient(QObject *parent)
+	: MC_OpcUaClient(std::make_shared<MD_OpcUaClientDevice>(), parent)
+{
+}
+
+MC_OpcUaClient::MC_OpcUaClient(std::shared_ptr<MI_OpcUaClientBackend> _backend, QObject *parent)
 	: ML_LogBase(parent),
-	m_control(new MD_OpcUaClientDevice()),
-	m_enableMonitorTimer(new QTimer(this))
+	m_control(std::move(_backend)),
+	m_enableMonitorTimer(new QTimer(this)),
+	m_reconnectScheduler(new MC_ReconnectScheduler(this)),
+	m_resumeFallbackTimer(new QTimer(this)),
+	m_connectTimeoutTimer(new QTimer(this))
 {
-	QObject::connect(m_control.get(), &MD_OpcUaClientDevice::sig_stateChanged, this, [=](QOpcUaClient::ClientState _state)
+	m_connectTimeoutTimer->setSingleShot(true);
+	QObject::connect(m_connectTimeoutTimer, &QTimer::timeout, this, [=]()
 	{
+		if (!m_connectAttemptObject)
+		{
+			return;
+		}
+		//服务器无响应时连接可能一直不结束,中止后按失败处理,让出重连并发名额
+		m_control->abortConnect();
+		onConnectAttemptFailed(ME_Error(QString(u8"Connect server timeout! [%1:%2]").arg(m_hostAddress.toString()).arg(m_port)));
+	});
+
+	m_resumeFallbackTimer->setSingleShot(true);
+	QObject::connect(m_resumeFallbackTimer, &QTimer::timeout, this, [=]()
+	{
+		fallbackToRebuild();
+	});
+
+	QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_stateChanged, this, [=](QOpcUaClient::ClientState _state)
+	{
+		onClientStateChanged(_state);
 		emit this->sig_connectStateChanged(convertState(_state));
 	});
 
+	QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_keepAliveTimeout, this, [=]()
+	{
+		log(ML_LogLabel::WARNING_LABEL, QString(u8"保活超时[%1:%2],连接已失效!").arg(m_hostAddress.toString()).arg(m_port));
+		failPendingRequests(u8"Connection lost: keep alive timeout!");
+	});
+
+	QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_keepAliveResult, this, [=](qint64 _latencyUs, QOpcUa::UaStatusCode _status)
+	{
+		if (_status == QOpcUa::UaStatusCode::Good)
+		{
+			m_metrics->recordSuccess(ME_OpcUaOperation::KEEP_ALIVE, _latencyUs);
+		}
+		else
+		{
+			m_metrics->recordFailure(ME_OpcUaOperation::KEEP_ALIVE, _latencyUs, _status);
+		}
+	});
+
+	QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_readNodeAttributesFinished, this, [=](QVector<QOpcUaReadResult> _results, QOpcUa::UaStatusCode _serviceResult)
+	{
+		onReadNodeAttributesFinished(_results, _serviceResult);
+	});
+	QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_writeNodeAttributesFinished, this, [=](QVector<QOpcUaWriteResult> _results, QOpcUa::UaStatusCode _serviceResult)
+	{
+		onWriteNodeAttributesFinished(_results, _serviceResult);
+	});
+
+	QObject::connect(m_reconnectScheduler, &MC_ReconnectScheduler::sig_reconnect, this, [=](int _attemptCount)
+	{
+		log(ML_LogLabel::NORMAL_LABEL, QString(u8"第%1次重连[%2:%3]...").arg(_attemptCount).arg(m_hostAddress.toString()).arg(m_port));
+		connectServer();
+	});
+
+	QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_namespaceIndexChanged, this, [=](quint16 _nameSpaceId)
+	{
+		//快照中的命名空间索引已失效,按新索引重建全部节点连接
+		log(ML_LogLabel::WARNING_LABEL, QString(u8"命名空间索引已变化[%1],重建监控...").arg(_nameSpaceId));
+		m_monitorEnablingKeyWords.clear();
+		emit this->sig_connectResult(MM_MaybeOk());
+	});
+
 	m_enableMonitorTimer->setInterval(1000);
 	QObject::connect(m_enableMonitorTimer, &QTimer::timeout, this, [=]() {
-		//检查是否有没在监控中的
-		for (const auto& var : m_monitorKeyWords) {
+		checkAndEnableMonitoring();
+	});
+}
+
+void MC_OpcUaClient::scheduleMonitorCheck()
+{
+	if (m_isMonitorCheckScheduled)
+	{
+		return;
+	}
+	m_isMonitorCheckScheduled = true;
+	QTimer::singleShot(0, this, [=]()
+	{
+		m_isMonitorCheckScheduled = false;
+		checkAndEnableMonitoring();
+	});
+}
 
-			auto node = getNode(var.first);
-			if (node) {
-				if (node->monitoringStatus(QOpcUa::NodeAttribute::Value).statusCode() == QOpcUa::UaStatusCode::Good) {
+void MC_OpcUaClient::checkAndEnableMonitoring()
+{
+	//检查是否有没在监控中的
+	for (auto& var : m_monitorKeyWords) {
+
+		auto node = getNode(var.first);
+		if (node) {
+			if (m_isResumingMonitoring)
+			{
+				//沿用会话时节点上的监控状态是失效会话遗留的,不据此判断;先停用再重新开启,以本次开启结果确认
+				if (m_resumeConfirmedKeyWords.count(var.first) || m_monitorEnablingKeyWords.count(var.first))
+				{
 					continue;
 				}
-				else
+				auto keyWord = var.first;
+				m_monitorEnablingKeyWords.insert(keyWord);
+				auto object = new QObject();
+				QObject::connect(node, &QOpcUaNode::disableMonitoringFinished, object, [=](QOpcUa::NodeAttribute attr, QOpcUa::UaStatusCode statusCode) {
+					Q_UNUSED(attr);
+					Q_UNUSED(statusCode);
+					object->disconnect();
+					object->deleteLater();
+					//失效会话的订阅可能已被服务器删除,停用失败不影响重新开启
+					enableNodeMonitoring(node, keyWord);
+				});
+				if (!node->disableMonitoring(QOpcUa::NodeAttribute::Value))
 				{
-					auto object = new QObject();
-					QObject::connect(node, &QOpcUaNode::enableMonitoringFinished, object, [=](QOpcUa::NodeAttribute attr, QOpcUa::UaStatusCode statusCode) {
-
-						Q_UNUSED(attr);
-				
-						ME_DestructExecuter executer([=]() {
-							object->disconnect();
-							object->deleteLater();
-						});
-
-						if (statusCode == QOpcUa::UaStatusCode::Good) {
-
-							auto readObject = new QObject();
-							QObject::connect(node, &QOpcUaNode::attributeRead, readObject, [=]() {
-								auto iter = std::find_if(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
-									return _a.first == var.first;
-								});
-								if (iter != m_monitorKeyWords.end()) {
-									iter->second = true;
-								}
-							});
-
-							node->readAttributes(QOpcUa::NodeAttribute::Value
-								| QOpcUa::NodeAttribute::NodeClass
-								| QOpcUa::NodeAttribute::Description
-								| QOpcUa::NodeAttribute::DataType
-								| QOpcUa::NodeAttribute::BrowseName
-								| QOpcUa::NodeAttribute::DisplayName
-								| QOpcUa::NodeAttribute::Value
-							);
-
-
-						}
-					});
-
-					QOpcUaMonitoringParameters monitorParam(100);
-					monitorParam.setMonitoringMode(QOpcUaMonitoringParameters::MonitoringMode::Reporting);
-					monitorParam.setDiscardOldest(true);
-					node->enableMonitoring(QOpcUa::NodeAttribute::Value
-						, monitorParam);
+					object->disconnect();
+					object->deleteLater();
+					enableNodeMonitoring(node, keyWord);
 				}
+				continue;
 			}
-		}
 
-		if (std::all_of(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
-			auto node = getNode(_a.first);
-			if (node) {
-				return node->monitoringStatus(QOpcUa::NodeAttribute::Value).statusCode() == QOpcUa::UaStatusCode::Good;
+			if (node->monitoringStatus(QOpcUa::NodeAttribute::Value).statusCode() == QOpcUa::UaStatusCode::Good) {
+				var.second = true;
+				continue;
 			}
-			return false;
-		})
-			&&
-			std::all_of(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
-			return _a.second;
-		}))
-		{
-			log(ML_LogLabel::NORMAL_LABEL, u8"开启监控成功!");
-			m_enableMonitorTimer->stop();
-
-			logFile(ML_LogLabel::NORMAL_LABEL, u8"监控项:");
-			auto ip = m_control->getServerUrl().toString();
-			for (const auto& var : m_monitorKeyWords) {
-				logFile(ML_LogLabel::NORMAL_LABEL, ip + u8" : " + var.first);
+			else if (m_monitorEnablingKeyWords.count(var.first))
+			{
+				//已下发开启监控,等待结果
+				continue;
+			}
+			else
+			{
+				m_monitorEnablingKeyWords.insert(var.first);
+				enableNodeMonitoring(node, var.first);
+			}
+		}
+	}
+
+	if (std::all_of(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
+		auto node = getNode(_a.first);
+		if (node) {
+			return node->monitoringStatus(QOpcUa::NodeAttribute::Value).statusCode() == QOpcUa::UaStatusCode::Good;
+		}
+		return false;
+	})
+		&&
+		std::all_of(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
+		return _a.second;
+	}))
+	{
+		if (!m_enableMonitorTimer->isActive())
+		{
+			return;
+		}
+		log(ML_LogLabel::NORMAL_LABEL, u8"开启监控成功!");
+		m_enableMonitorTimer->stop();
+		m_resumeFallbackTimer->stop();
+		m_isResumingMonitoring = false;
+		m_resumeConfirmedKeyWords.clear();
+
+		logFile(ML_LogLabel::NORMAL_LABEL, u8"监控项:");
+		auto ip = m_control->getServerUrl().toString();
+		for (const auto& var : m_monitorKeyWords) {
+			logFile(ML_LogLabel::NORMAL_LABEL, ip + u8" : " + var.first);
+		}
+
+		updateSnapshot();
+	}
+}
+
+void MC_OpcUaClient::enableNodeMonitoring(QOpcUaNode* _node, const QString& _keyWord)
+{
+	auto keyWord = _keyWord;
+	auto object = new QObject();
+	QObject::connect(_node, &QOpcUaNode::enableMonitoringFinished, object, [=](QOpcUa::NodeAttribute attr, QOpcUa::UaStatusCode statusCode) {
+
+		Q_UNUSED(attr);
+
+		ME_DestructExecuter executer([=]() {
+			object->disconnect();
+			object->deleteLater();
+		});
+		m_monitorEnablingKeyWords.erase(keyWord);
+
+		if (statusCode != QOpcUa::UaStatusCode::Good) {
+			if (m_isResumingMonitoring)
+			{
+				//原有节点上无法重新开启,回退为完整重建
+				fallbackToRebuild();
 			}
+			return;
+		}
+
+		if (m_isResumingMonitoring)
+		{
+			m_resumeConfirmedKeyWords.insert(keyWord);
 		}
 
+		auto readObject = new QObject();
+		QObject::connect(_node, &QOpcUaNode::attributeRead, readObject, [=]() {
+			readObject->deleteLater();
+			auto iter = std::find_if(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
+				return _a.first == keyWord;
+			});
+			if (iter != m_monitorKeyWords.end()) {
+				iter->second = true;
+			}
+		});
+
+		_node->readAttributes(QOpcUa::NodeAttribute::Value
+			| QOpcUa::NodeAttribute::NodeClass
+			| QOpcUa::NodeAttribute::Description
+			| QOpcUa::NodeAttribute::DataType
+			| QOpcUa::NodeAttribute::BrowseName
+			| QOpcUa::NodeAttribute::DisplayName
+			| QOpcUa::NodeAttribute::Value
+		);
 	});
+
+	QOpcUaMonitoringParameters monitorParam(100);
+	monitorParam.setMonitoringMode(QOpcUaMonitoringParameters::MonitoringMode::Reporting);
+	monitorParam.setDiscardOldest(true);
+	_node->enableMonitoring(QOpcUa::NodeAttribute::Value
+		, monitorParam);
+}
+
+void MC_OpcUaClient::updateSnapshot()
+{
+	if (!m_control)
+	{
+		return;
+	}
+	auto snapshot = m_control->getServerSnapshot();
+	if (!snapshot)
+	{
+		return;
+	}
+	for (const auto& var : m_monitorKeyWords)
+	{
+		snapshot->m_monitorKeyWords.append(var.first);
+	}
+	MC_OpcUaSnapshotStore::instance().update(*snapshot);
+}
+
+void MC_OpcUaClient::seedMonitorKeyWordsFromSnapshot()
+{
+	auto snapshot = MC_OpcUaSnapshotStore::instance().find(m_control->getServerUrl().toString());
+	if (!snapshot)
+	{
+		return;
+	}
+	for (const auto& var : snapshot->m_monitorKeyWords)
+	{
+		addMonitorKeyWord(var);
+	}
 }
 
 MC_OpcUaClient::~MC_OpcUaClient()
 {
+	updateSnapshot();
+	MC_OpcUaMetricsRegistry::instance().unregisterMetrics(m_metrics);
 }
 
 void MC_OpcUaClient::createAndConnectServer(const QHostAddress& _hostAddress, quint16 _port)
 {
-	auto onFailFunctor = [=](const ME_Error& _error)
+	//同一服务器已连接或正在连接时不重新发起,结果由进行中的连接给出
+	if (m_isKeepConnected && _hostAddress == m_hostAddress && _port == m_port
+		&& (m_connectAttemptObject || m_isConnectionEstablished))
 	{
-		emit this->sig_connectResult(_error);
-		log(ML_LogLabel::WARNING_LABEL, _error.getMessage());
-	};
+		return;
+	}
+	m_hostAddress = _hostAddress;
+	m_port = _port;
+	m_traceDeviceName = QString(u8"%1:%2").arg(_hostAddress.toString()).arg(_port);
+	MC_OpcUaMetricsRegistry::instance().registerMetrics(m_traceDeviceName, m_metrics);
+	m_isKeepConnected = true;
+	m_reconnectScheduler->reset();
+	connectServer();
+}
 
+void MC_OpcUaClient::connectServer()
+{
 	QMetaObject::invokeMethod(m_control.get(), [=]()
 	{
+		finishConnectAttempt();
+		auto object = new QObject();
+		m_connectAttemptObject = object;
+		m_connectElapsedTimer.start();
+		auto connectTimeoutMs = m_reconnectScheduler->getPolicy().m_connectTimeoutMs;
+		if (connectTimeoutMs > 0)
+		{
+			m_connectTimeoutTimer->start(connectTimeoutMs);
+		}
+
 		auto createClientResult = m_control->createClient();
 		if (createClientResult.hasError())
 		{
-			onFailFunctor(*createClientResult.getError());
+			onConnectAttemptFailed(*createClientResult.getError());
 			return;
 		}
 
-	
-		auto object = new QObject();
-		QObject::connect(m_control.get(), &MD_OpcUaClientDevice::sig_connected, object, [=](const MM_MaybeOk& _connectResult)
+		QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_connected, object, [=](const MM_MaybeOk& _connectResult)
 		{
-			ME_DestructExecuter onDeleteObject([=]() {
-				object->disconnect();
-				object->deleteLater();
-			});
+			QObject::disconnect(m_control.get(), &MI_OpcUaClientBackend::sig_connected, object, nullptr);
 
 			if (_connectResult.hasError())
 			{
-				onFailFunctor(*_connectResult.getError());
+				onConnectAttemptFailed(*_connectResult.getError());
 				return;
 			}
-			auto  retObject = new QObject();
 
-			QObject::connect(m_control.get(), &MD_OpcUaClientDevice::sig_updateArrayNamespaceFinished, retObject, [=](const MM_MaybeOk& _updateNamespaceArrayResult)
+			QObject::connect(m_control.get(), &MI_OpcUaClientBackend::sig_updateArrayNamespaceFinished, object, [=](const MM_MaybeOk& _updateNamespaceArrayResult)
 			{
-				retObject->deleteLater();
 				if (_updateNamespaceArrayResult.hasError())
 				{
-					onFailFunctor(*_updateNamespaceArrayResult.getError());
+					onConnectAttemptFailed(*_updateNamespaceArrayResult.getError());
 					return;
 				}
+				finishConnectAttempt();
+				m_metrics->recordSuccess(ME_OpcUaOperation::CONNECT, m_connectElapsedTimer.nsecsElapsed() / 1000);
 
+				m_monitorEnablingKeyWords.clear();
+				if (m_control->getIsSessionResumed())
+				{
+					resumeMonitoring();
+				}
 				emit this->sig_connectResult(MM_MaybeOk());
-
+				if (!m_control->getIsSessionResumed() && m_control->getIsWarmStarted())
+				{
+					//上层(与客户端同线程,直接连接)在连接结果中清空并重建监控项后,
+					//再按快照补齐上次的监控项,随同一次检查一并开启,无需等待上层后续逐个添加
+					seedMonitorKeyWordsFromSnapshot();
+				}
+				onConnectionEstablished();
 			});
 
 			auto updateArrayNamesapceResult = m_control->updateArrayNamespace();
 			if (updateArrayNamesapceResult.hasError())
 			{
-				onFailFunctor(*updateArrayNamesapceResult.getError());
+				onConnectAttemptFailed(*updateArrayNamesapceResult.getError());
 				return;
 			}
 
 		});
-		auto connectServerResult = m_control->tryConnectServer(_hostAddress, _port);
+		auto connectServerResult = m_control->tryConnectServer(m_hostAddress, m_port);
 		if (connectServerResult.hasError())
 		{
-			onFailFunctor(*connectServerResult.getError());
+			onConnectAttemptFailed(*connectServerResult.getError());
 			return;
 		}
 	});
 }
 
+void MC_OpcUaClient::finishConnectAttempt()
+{
+	m_connectTimeoutTimer->stop();
+	if (!m_connectAttemptObject)
+	{
+		return;
+	}
+	m_connectAttemptObject->disconnect();
+	m_connectAttemptObject->deleteLater();
+	m_connectAttemptObject = nullptr;
+}
+
+namespace
+{
+	const char* operationTraceStep(ME_OpcUaOperation _operation)
+	{
+		switch (_operation)
+		{
+		case ME_OpcUaOperation::READ:
+			return "readNode";
+		case ME_OpcUaOperation::WRITE:
+			return "writeNode";
+		case ME_OpcUaOperation::READ_MULTI:
+			return "readMultiNodes";
+		case ME_OpcUaOperation::WRITE_MULTI:
+			return "writeMultiNodes";
+		case ME_OpcUaOperation::READ_CHUNK:
+			return "readChunk";
+		case ME_OpcUaOperation::WRITE_CHUNK:
+			return "writeChunk";
+		default:
+			break;
+		}
+		return "request";
+	}
+}
+
+quint64 MC_OpcUaClient::registerPendingRequest(QObject* _context, std::function<void(const QString&)> _onFail, ME_OpcUaOperation _operation)
+{
+	auto requestId = m_nextRequestId++;
+	auto& request = m_pendingRequests[requestId];
+	request.m_context = _context;
+	request.m_onFail = std::move(_onFail);
+	request.m_traceSpan = ML_TraceRecorder::instance().beginSpan(m_traceDeviceName, "opcua", operationTraceStep(_operation), requestId);
+	request.m_operation = _operation;
+	request.m_elapsedTimer.start();
+	return requestId;
+}
+
+void MC_OpcUaClient::markPendingRequestFailed(quint64 _requestId, QOpcUa::UaStatusCode _status)
+{
+	auto iter = m_pendingRequests.find(_requestId);
+	if (iter != m_pendingRequests.end())
+	{
+		iter->second.m_status = _status;
+	}
+}
+
+void MC_OpcUaClient::unregisterPendingRequest(quint64 _requestId)
+{
+	auto iter = m_pendingRequests.find(_requestId);
+	if (iter == m_pendingRequests.end())
+	{
+		return;
+	}
+	const auto& request = iter->second;
+	auto latencyUs = request.m_elapsedTimer.nsecsElapsed() / 1000;
+	if (request.m_status == QOpcUa::UaStatusCode::Good)
+	{
+		m_metrics->recordSuccess(request.m_operation, latencyUs);
+	}
+	else
+	{
+		m_metrics->recordFailure(request.m_operation, latencyUs, request.m_status);
+	}
+	ML_TraceRecorder::instance().endSpan(request.m_traceSpan);
+	m_pendingRequests.erase(iter);
+}
+
+void MC_OpcUaClient::failPendingRequests(const QString& _reason)
+{
+	std::map<quint64, MS_PendingRequest> pendingRequests;
+	pendingRequests.swap(m_pendingRequests);
+	for (auto& var : pendingRequests)
+	{
+		var.second.m_context->disconnect();
+		var.second.m_context->deleteLater();
+		m_metrics->recordFailure(var.second.m_operation, var.second.m_elapsedTimer.nsecsElapsed() / 1000, QOpcUa::UaStatusCode::BadConnectionClosed);
+		ML_TraceRecorder::instance().endSpan(var.second.m_traceSpan);
+		var.second.m_onFail(_reason);
+	}
+}
+
+void MC_OpcUaClient::resumeMonitoring()
+{
+	log(ML_LogLabel::NORMAL_LABEL, QString(u8"沿用上次会话[%1:%2],重新开启监控...").arg(m_hostAddress.toString()).arg(m_port));
+	for (auto& var : m_monitorKeyWords)
+	{
+		var.second = false;
+	}
+	m_isResumingMonitoring = true;
+	m_resumeConfirmedKeyWords.clear();
+	m_resumeFallbackTimer->start(m_resumeTimeoutMs);
+	m_enableMonitorTimer->start();
+	scheduleMonitorCheck();
+	emit this->sig_sessionResumed();
+}
+
+void MC_OpcUaClient::fallbackToRebuild()
+{
+	m_isResumingMonitoring = false;
+	m_resumeConfirmedKeyWords.clear();
+	m_resumeFallbackTimer->stop();
+	if (!m_control->getIsSessionResumed() || getConnectState() != MS_ConnectState::CONNECTED)
+	{
+		return;
+	}
+	//原有节点上的监控未能恢复或无法确认,释放节点后由上层完整重建
+	log(ML_LogLabel::WARNING_LABEL, u8"沿用会话恢复监控超时或无法确认,重建全部监控...");
+	m_control->clearNodes();
+	m_monitorEnablingKeyWords.clear();
+	emit this->sig_connectResult(MM_MaybeOk());
+}
+
+void MC_OpcUaClient::setIsKeepAliveEnabled(bool _val)
+{
+	QMetaObject::invokeMethod(m_control.get(), [=]()
+	{
+		m_control->setIsKeepAliveEnabled(_val);
+	});
+}
+
+void MC_OpcUaClient::setKeepAliveParam(int _intervalMs, int _timeoutMs, int _maxMissCount)
+{
+	QMetaObject::invokeMethod(m_control.get(), [=]()
+	{
+		m_control->setKeepAliveIntervalMs(_intervalMs);
+		m_control->setKeepAliveTimeoutMs(_timeoutMs);
+		m_control->setKeepAliveMaxMissCount(_maxMissCount);
+	});
+}
+
+MM_MaybeOk MC_OpcUaClient::startTrafficRecording(const QString& _filePath)
+{
+	//录制器自身加锁,可直接在调用线程启动
+	return m_control->startTrafficRecording(_filePath);
+}
+
+void MC_OpcUaClient::stopTrafficRecording()
+{
+	m_control->stopTrafficRecording();
+}
+
+bool MC_OpcUaClient::isSessionResumed() const
+{
+	return m_control && m_control->getIsSessionResumed();
+}
+
+void MC_OpcUaClient::onConnectAttemptFailed(const ME_Error& _error)
+{
+	finishConnectAttempt();
+	m_metrics->recordFailure(ME_OpcUaOperation::CONNECT, m_connectElapsedTimer.nsecsElapsed() / 1000, QOpcUa::UaStatusCode::BadCommunicationError);
+	emit this->sig_connectResult(_error);
+	log(ML_LogLabel::WARNING_LABEL, _error.getMessage());
+
+	if (m_isAutoReconnect && m_isKeepConnected)
+	{
+		log(ML_LogLabel::NORMAL_LABEL, QString(u8"约%1ms后重连...").arg(m_reconnectScheduler->getNextDelayMs()));
+		m_reconnectScheduler->scheduleRetry();
+	}
+}
+
+void MC_OpcUaClient::onConnectionEstablished()
+{
+	m_reconnectScheduler->reset();
+	if (m_isConnectionEstablished)
+	{
+		return;
+	}
+	m_isConnectionEstablished = true;
+	emit this->sig_connectionEstablished();
+}
+
+void MC_OpcUaClient::onClientStateChanged(QOpcUaClient::ClientState _state)
+{
+	if (_state != QOpcUaClient::Disconnected)
+	{
+		return;
+	}
+
+	if (m_connectAttemptObject)
+	{
+		//端点连接失败只有状态变化,没有sig_connected
+		onConnectAttemptFailed(ME_Error(QString(u8"Connect server fail! [%1:%2]").arg(m_hostAddress.toString()).arg(m_port)));
+		return;
+	}
+
+	if (!m_isConnectionEstablished)
+	{
+		return;
+	}
+	m_isConnectionEstablished = false;
+	m_resumeFallbackTimer->stop();
+	m_isResumingMonitoring = false;
+	m_resumeConfirmedKeyWords.clear();
+	failPendingRequests(u8"Connection lost!");
+	emit this->sig_connectionLost();
+
+	if (m_isAutoReconnect && m_isKeepConnected)
+	{
+		//已建立的连接断开多为网络抖动,首次立即重连
+		log(ML_LogLabel::WARNING_LABEL, QString(u8"连接断开[%1:%2],开始重连...").arg(m_hostAddress.toString()).arg(m_port));
+		m_reconnectScheduler->scheduleRetry(true);
+	}
+}
+
+void MC_OpcUaClient::setIsAutoReconnect(bool _val)
+{
+	m_isAutoReconnect = _val;
+	if (!m_isAutoReconnect)
+	{
+		m_reconnectScheduler->cancel();
+	}
+}
+
+MS_ReconnectPolicy MC_OpcUaClient::getReconnectPolicy() const
+{
+	return m_reconnectScheduler->getPolicy();
+}
+
+void MC_OpcUaClient::setReconnectPolicy(const MS_ReconnectPolicy& _val)
+{
+	m_reconnectScheduler->setPolicy(_val);
+}
+
 void MC_OpcUaClient::disConnectServer()
 {
+	m_isKeepConnected = false;
+	m_reconnectScheduler->cancel();
+	finishConnectAttempt();
 	if (!m_control)
 	{
 		return;
 	}
+	updateSnapshot();
 	m_control->disconnectServer();
 }
 
@@ -222,17 +669,20 @@ MC_FutureWatch<QVariant>* MC_OpcUaClient::getReadNodeVariableWatch(const QString
 		return watch;
 	}
 
+	auto requestId = registerPendingRequest(object, onFailFun, ME_OpcUaOperation::READ);
 	QObject::connect(node, &QOpcUaNode::attributeRead, object, [=](QOpcUa::NodeAttributes attributes)
 	{
 		Q_UNUSED(attributes);
 
 		ME_DestructExecuter onDeleteObject([=]() {
+			unregisterPendingRequest(requestId);
 			object->disconnect();
 			object->deleteLater();
 		});
 
 		auto curNodeAttributeUsed = QOpcUa::NodeAttribute::Value;
 		if (node->attributeError(curNodeAttributeUsed) != QOpcUa::UaStatusCode::Good) {
+			markPendingRequestFailed(requestId, node->attributeError(curNodeAttributeUsed));
 			onFailFun(u8"Failed to read attribute: " + statusToString(node->attributeError(curNodeAttributeUsed)));
 			return;
 		}
@@ -248,6 +698,7 @@ MC_FutureWatch<QVariant>* MC_OpcUaClient::getReadNodeVariableWatch(const QString
 		}
 		else
 		{
+			markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadTypeMismatch);
 			onFailFun(u8"Read value attribute: value type is not right!");
 		}
 
@@ -256,6 +707,10 @@ MC_FutureWatch<QVariant>* MC_OpcUaClient::getReadNodeVariableWatch(const QString
 	auto readAttributesResult = node->readAttributes(QOpcUaNode::mandatoryBaseAttributes() | QOpcUa::NodeAttribute::Value);
 	if (!readAttributesResult)
 	{
+		markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadInternalError);
+		unregisterPendingRequest(requestId);
+		object->disconnect();
+		object->deleteLater();
 		onFailFun(u8"Dispatch read attribute fail!");
 	}
 	return watch;
@@ -383,17 +838,20 @@ MC_FutureWatch<void>* MC_OpcUaClient::getWriteNodeVariableWatch(const QString& _
 		return watch;
 	}
 
+	auto requestId = registerPendingRequest(object, onFailFun, ME_OpcUaOperation::WRITE);
 	QObject::connect(node, &QOpcUaNode::attributeWritten, object, [=](QOpcUa::NodeAttributes attributes)
 	{
 
 		Q_UNUSED(attributes);
 		ME_DestructExecuter onDeleteObject([=]() {
+			unregisterPendingRequest(requestId);
 			object->disconnect();
 			object->deleteLater();
 		});
 
 		auto curNodeAttributeUsed = QOpcUa::NodeAttribute::Value;
 		if (node->attributeError(curNodeAttributeUsed) != QOpcUa::UaStatusCode::Good) {
+			markPendingRequestFailed(requestId, node->attributeError(curNodeAttributeUsed));
 			onFailFun(u8"Failed to write attribute: " + statusToString(node->attributeError(curNodeAttributeUsed)));
 		}
 		else
@@ -407,6 +865,10 @@ MC_FutureWatch<void>* MC_OpcUaClient::getWriteNodeVariableWatch(const QString& _
 	auto writeAttributesResult = node->writeAttribute(QOpcUa::NodeAttribute::Value, _val, _type);
 	if (!writeAttributesResult)
 	{
+		markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadInternalError);
+		unregisterPendingRequest(requestId);
+		object->disconnect();
+		object->deleteLater();
 		onFailFun("Dispatch write attribute fail!");
 	}
 	return watch;
@@ -432,21 +894,31 @@ MC_FutureWatch<std::map<QString, QVariant>>* MC_OpcUaClient::getReadMultiNodeVar
 		return watch;
 	}
 
-	QObject::connect(m_control.get(), &MD_OpcUaClientDevice::sig_readNodeAttributesFinished, object, [=](QVector<QOpcUaReadResult> _results, QOpcUa::UaStatusCode _serviceResult)
+	QVector <QOpcUaReadItem> readItems;
+	for (const auto& var : _keyNames)
+	{
+		readItems.push_back(QOpcUaReadItem(QOpcUa::nodeIdFromString(m_control->getNamespaceId(), var), QOpcUa::NodeAttribute::Value));
+	}
+
+	auto requestId = registerPendingRequest(object, onFailFun, ME_OpcUaOperation::READ_MULTI);
+	auto readAttributesResult = dispatchReadItems(requestId, readItems, [=](const QVector<QOpcUaReadResult>& _results, QOpcUa::UaStatusCode _serviceResult)
 	{
 		ME_DestructExecuter onDeleteObject([=]() {
+			unregisterPendingRequest(requestId);
 			object->disconnect();
 			object->deleteLater();
 		});
 
 		if (_serviceResult != QOpcUa::UaStatusCode::Good)
 		{
+			markPendingRequestFailed(requestId, _serviceResult);
 			onFailFun(u8"Fail to read nodes attributes (read service):" + statusToString(_serviceResult));
 			return;
 		}
 
 		if (_results.size() != _keyNames.size())
 		{
+			markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadUnexpectedError);
 			onFailFun(u8"Fail to read nodes attributes: result size is not right!");
 			return;
 		}
@@ -457,28 +929,25 @@ MC_FutureWatch<std::map<QString, QVariant>>* MC_OpcUaClient::getReadMultiNodeVar
 			auto curItemStatus{ _results.at(curIndex).statusCode() };
 			if (curItemStatus != QOpcUa::UaStatusCode::Good)
 			{
+				markPendingRequestFailed(requestId, curItemStatus);
 				onFailFun(u8"Fail to read nodes attributes: result item status is not good! " + _keyNames.at(curIndex) + " : " + statusToString(curItemStatus));
 				return;
 			}
-			ret[_keyNames.at(curIndex)] = _results.at(curIndex).value();
+			ret.emplace(_keyNames.at(curIndex), _results.at(curIndex).value());
 		}
 
+		//值(含工装数据的ByteString)为隐式共享,整个map移交给watch,不复制数据
 		MC_FutureWatchResultProvider provider;
 		provider.setIsSuccess(*watch, true);
-		provider.setResult(*watch, ret);
+		provider.setResult(*watch, std::move(ret));
 		provider.setFutureWatchFinished(*watch);
 	});
-
-
-	QVector <QOpcUaReadItem> readItems;
-	for (const auto& var : _keyNames)
-	{
-		readItems.push_back(QOpcUaReadItem(QOpcUa::nodeIdFromString(m_control->getNamespaceId(), var), QOpcUa::NodeAttribute::Value));
-	}
-
-	auto readAttributesResult = m_control->readNodeAttributes(readItems);
 	if (readAttributesResult.hasError())
 	{
+		markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadInternalError);
+		unregisterPendingRequest(requestId);
+		object->disconnect();
+		object->deleteLater();
 		onFailFun(readAttributesResult.getError()->getMessage());
 	}
 	return watch;
@@ -504,10 +973,31 @@ MC_FutureWatch<void>* MC_OpcUaClient::getWriteMultiNodeVariablesWatch(const std:
 		return watch;
 	}
 
+	//服务器不保证一次请求内各项的处理顺序,同一字段写多次时结果不确定,直接拒绝
+	std::set<QString> keyNames;
+	for (const auto& var : _vals)
+	{
+		if (!keyNames.insert(var.first).second)
+		{
+			onFailFun(u8"Write nodes attributes: field is repeated! " + var.first);
+			return watch;
+		}
+	}
+
 
-	QObject::connect(m_control.get(), &MD_OpcUaClientDevice::sig_writeNodeAttributesFinished, object, [=](QVector<QOpcUaWriteResult> _results, QOpcUa::UaStatusCode _serviceResult)
+	QVector<QOpcUaWriteItem> itemsToWrite;
+	for (const auto& var : _vals)
+	{
+		itemsToWrite.push_back(QOpcUaWriteItem(
+			QOpcUa::nodeIdFromString(m_control->getNamespaceId(),
+				var.first), QOpcUa::NodeAttribute::Value, var.second.second, var.second.first));
+	}
+
+	auto requestId = registerPendingRequest(object, onFailFun, ME_OpcUaOperation::WRITE_MULTI);
+	auto writeAttributesResult = dispatchWriteItems(requestId, itemsToWrite, [=](const QVector<QOpcUaWriteResult>& _results, QOpcUa::UaStatusCode _serviceResult)
 	{
 		ME_DestructExecuter onDeleteObject([=]() {
+			unregisterPendingRequest(requestId);
 			object->disconnect();
 			object->deleteLater();
 		});
@@ -515,12 +1005,14 @@ MC_FutureWatch<void>* MC_OpcUaClient::getWriteMultiNodeVariablesWatch(const std:
 	
 		if (_serviceResult != QOpcUa::UaStatusCode::Good)
 		{
+			markPendingRequestFailed(requestId, _serviceResult);
 			onFailFun(u8"Fail to write nodes attributes (write service):" + statusToString(_serviceResult));
 			return;
 		}
 
 		if (_results.size() != _vals.size())
 		{
+			markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadUnexpectedError);
 			onFailFun(u8"Fail to read node attributes: result size is not right!");
 			return;
 		}
@@ -530,6 +1022,7 @@ MC_FutureWatch<void>* MC_OpcUaClient::getWriteMultiNodeVariablesWatch(const std:
 			auto curItemStatus{ _results.at(curIndex).statusCode() };
 			if (curItemStatus != QOpcUa::UaStatusCode::Good)
 			{
+				markPendingRequestFailed(requestId, curItemStatus);
 				onFailFun(u8"Fail to write nodes attributes: result item status is not good! "
 					+ _vals.at(curIndex).first + "( index :" + QString::number(curIndex) + " )"
 					+ " : " + statusToString(curItemStatus));
@@ -541,22 +1034,451 @@ MC_FutureWatch<void>* MC_OpcUaClient::getWriteMultiNodeVariablesWatch(const std:
 		provider.setFutureWatchFinished(*watch);
 	
 	});
+	if (writeAttributesResult.hasError())
+	{
+		markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadInternalError);
+		unregisterPendingRequest(requestId);
+		object->disconnect();
+		object->deleteLater();
+		onFailFun(writeAttributesResult.getError()->getMessage());
+	}
+	return watch;
+}
 
-	QVector<QOpcUaWriteItem> itemsToWrite;
-	for (const auto& var : _vals)
+namespace
+{
+	template<typename TResult>
+	bool isAttributesResultsMatched(const std::vector<std::pair<QString, QString>>& _itemKeys, const QVector<TResult>& _results)
 	{
-		itemsToWrite.push_back(QOpcUaWriteItem(
-			QOpcUa::nodeIdFromString(m_control->getNamespaceId(),
-				var.first), QOpcUa::NodeAttribute::Value, var.second.second, var.second.first));
+		if (static_cast<int>(_itemKeys.size()) != _results.size())
+		{
+			return false;
+		}
+		for (auto curIndex = 0; curIndex < _results.size(); ++curIndex)
+		{
+			if (_itemKeys.at(curIndex).first != _results.at(curIndex).nodeId()
+				|| _itemKeys.at(curIndex).second != _results.at(curIndex).indexRange())
+			{
+				return false;
+			}
+		}
+		return true;
 	}
-	auto writeAttributesResult = m_control->writeNodeAttributes(itemsToWrite);
-	if (writeAttributesResult.hasError())
+
+	//取出与应答对应的请求;相同的请求同时在途时按下发顺序对应
+	template<typename TQueue, typename TResult>
+	bool takeMatchedAttributesRequest(TQueue& _queue, const QVector<TResult>& _results, const std::function<bool(quint64)>& _isAlive, typename TQueue::value_type* _request)
 	{
-		onFailFun(writeAttributesResult.getError()->getMessage());
+		//已因断线等原因结束的请求不再等待应答
+		_queue.erase(std::remove_if(_queue.begin(), _queue.end(), [&](const auto& _val) {
+			return !_isAlive(_val.m_requestId);
+		}), _queue.end());
+
+		auto iter = std::find_if(_queue.begin(), _queue.end(), [&](const auto& _val) {
+			return isAttributesResultsMatched(_val.m_itemKeys, _results);
+		});
+		//服务级失败时后端可能不带逐项结果,交给最早的请求
+		if (iter == _queue.end() && _results.isEmpty() && !_queue.empty())
+		{
+			iter = _queue.begin();
+		}
+		if (iter == _queue.end())
+		{
+			return false;
+		}
+		*_request = std::move(*iter);
+		_queue.erase(iter);
+		return true;
+	}
+
+	QString chunkIndexRange(qint64 _offset, qint64 _length)
+	{
+		//单个元素的IndexRange不能写成a:a
+		if (_length <= 1)
+		{
+			return QString::number(_offset);
+		}
+		return QString(u8"%1:%2").arg(_offset).arg(_offset + _length - 1);
+	}
+}
+
+MM_MaybeOk MC_OpcUaClient::dispatchReadItems(quint64 _requestId, const QVector<QOpcUaReadItem>& _items,
+	std::function<void(const QVector<QOpcUaReadResult>&, QOpcUa::UaStatusCode)> _onFinished)
+{
+	MS_PendingAttributesRequest<QOpcUaReadResult> request;
+	request.m_requestId = _requestId;
+	for (const auto& var : _items)
+	{
+		request.m_itemKeys.emplace_back(var.nodeId(), var.indexRange());
+	}
+	request.m_onFinished = std::move(_onFinished);
+	m_pendingReadAttributesRequests.push_back(std::move(request));
+
+	auto result = m_control->readNodeAttributes(_items);
+	if (result.hasError())
+	{
+		m_pendingReadAttributesRequests.pop_back();
+	}
+	return result;
+}
+
+MM_MaybeOk MC_OpcUaClient::dispatchWriteItems(quint64 _requestId, const QVector<QOpcUaWriteItem>& _items,
+	std::function<void(const QVector<QOpcUaWriteResult>&, QOpcUa::UaStatusCode)> _onFinished)
+{
+	MS_PendingAttributesRequest<QOpcUaWriteResult> request;
+	request.m_requestId = _requestId;
+	for (const auto& var : _items)
+	{
+		request.m_itemKeys.emplace_back(var.nodeId(), var.indexRange());
+	}
+	request.m_onFinished = std::move(_onFinished);
+	m_pendingWriteAttributesRequests.push_back(std::move(request));
+
+	auto result = m_control->writeNodeAttributes(_items);
+	if (result.hasError())
+	{
+		m_pendingWriteAttributesRequests.pop_back();
+	}
+	return result;
+}
+
+void MC_OpcUaClient::onReadNodeAttributesFinished(const QVector<QOpcUaReadResult>& _results, QOpcUa::UaStatusCode _serviceResult)
+{
+	MS_PendingAttributesRequest<QOpcUaReadResult> request;
+	if (!takeMatchedAttributesRequest(m_pendingReadAttributesRequests, _results, [this](quint64 _requestId) {
+		return m_pendingRequests.count(_requestId) > 0;
+	}, &request))
+	{
+		return;
+	}
+	request.m_onFinished(_results, _serviceResult);
+}
+
+void MC_OpcUaClient::onWriteNodeAttributesFinished(const QVector<QOpcUaWriteResult>& _results, QOpcUa::UaStatusCode _serviceResult)
+{
+	MS_PendingAttributesRequest<QOpcUaWriteResult> request;
+	if (!takeMatchedAttributesRequest(m_pendingWriteAttributesRequests, _results, [this](quint64 _requestId) {
+		return m_pendingRequests.count(_requestId) > 0;
+	}, &request))
+	{
+		return;
+	}
+	request.m_onFinished(_results, _serviceResult);
+}
+
+struct MC_OpcUaClient::MS_ByteStringChunkTransfer
+{
+	bool m_isWrite{ false };
+	QString m_keyName;
+	MS_ByteStringChunkParam m_param;
+	//写入的数据
+	QByteArray m_data;
+	//已读到的块,按偏移排列
+	std::map<qint64, QByteArray> m_readChunks;
+	qint64 m_nextOffset{ 0 };
+	//写入时为数据长度,读取时读到末块前为-1
+	qint64 m_endOffset{ -1 };
+	int m_inFlightCount{ 0 };
+	bool m_isFinished{ false };
+	std::function<void(const QString&)> m_onFail;
+	std::function<void(const QByteArray&)> m_onSuccess;
+};
+
+MC_FutureWatch<void>* MC_OpcUaClient::writeByteStringChunked(const QString& _keyName, const QByteArray& _data, const MS_ByteStringChunkParam& _param)
+{
+	auto watch(new MC_FutureWatch<void>());
+	auto onFailFun = [=](const QString& _val)
+	{
+		MC_FutureWatchResultProvider provider;
+		provider.setIsSuccess(*watch, false);
+		provider.setErrorInfo(*watch, _val);
+		provider.setFutureWatchFinished(*watch);
+	};
+
+	if (_param.m_chunkSize <= 0)
+	{
+		onFailFun(u8"Write byte string chunked: chunk size is not right!");
+		return watch;
+	}
+
+	auto transfer = std::make_shared<MS_ByteStringChunkTransfer>();
+	transfer->m_isWrite = true;
+	transfer->m_keyName = _keyName;
+	transfer->m_param = _param;
+	transfer->m_data = _data;
+	transfer->m_endOffset = _data.size();
+	transfer->m_onFail = onFailFun;
+	transfer->m_onSuccess = [=](const QByteArray&)
+	{
+		MC_FutureWatchResultProvider provider;
+		provider.setIsSuccess(*watch, true);
+		provider.setFutureWatchFinished(*watch);
+	};
+	pumpByteStringChunks(transfer);
+	return watch;
+}
+
+MC_FutureWatch<QByteArray>* MC_OpcUaClient::readByteStringChunked(const QString& _keyName, const MS_ByteStringChunkParam& _param)
+{
+	auto watch(new MC_FutureWatch<QByteArray>());
+	auto onFailFun = [=](const QString& _val)
+	{
+		MC_FutureWatchResultProvider provider;
+		provider.setIsSuccess(*watch, false);
+		provider.setErrorInfo(*watch, _val);
+		provider.setFutureWatchFinished(*watch);
+	};
+
+	if (_param.m_chunkSize <= 0)
+	{
+		onFailFun(u8"Read byte string chunked: chunk size is not right!");
+		return watch;
+	}
+
+	auto transfer = std::make_shared<MS_ByteStringChunkTransfer>();
+	transfer->m_keyName = _keyName;
+	transfer->m_param = _param;
+	transfer->m_onFail = onFailFun;
+	transfer->m_onSuccess = [=](const QByteArray& _data)
+	{
+		MC_FutureWatchResultProvider provider;
+		provider.setIsSuccess(*watch, true);
+		provider.setResult(*watch, _data);
+		provider.setFutureWatchFinished(*watch);
+	};
+	if (_param.m_lengthKeyName.isEmpty())
+	{
+		pumpByteStringChunks(transfer);
+		return watch;
 	}
+
+	//先读实际长度,定长节点只读有效部分
+	auto lengthWatch = getReadNodeVariableWatch(_param.m_lengthKeyName);
+	QObject::connect(lengthWatch, &MC_FutureWatchBase::finished, this, [=]()
+	{
+		ME_DestructExecuter onDeleteObject([=]() {
+			lengthWatch->deleteLater();
+		});
+		if (!lengthWatch->getIsSuccess())
+		{
+			failByteStringTransfer(transfer, QString(u8"Read byte string length %1 fail: %2").arg(_param.m_lengthKeyName).arg(lengthWatch->getErrorString()));
+			return;
+		}
+		auto isConvertOk = false;
+		auto length = lengthWatch->getResult().toLongLong(&isConvertOk);
+		if (!isConvertOk || length < 0)
+		{
+			failByteStringTransfer(transfer, QString(u8"Read byte string length %1 fail: value is not right!").arg(_param.m_lengthKeyName));
+			return;
+		}
+		transfer->m_endOffset = length;
+		pumpByteStringChunks(transfer);
+	});
 	return watch;
 }
 
+void MC_OpcUaClient::pumpByteStringChunks(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer)
+{
+	auto maxInFlightCount = qMax(1, _transfer->m_param.m_maxInFlightCount);
+	while (!_transfer->m_isFinished && _transfer->m_inFlightCount < maxInFlightCount
+		&& (_transfer->m_endOffset < 0 || _transfer->m_nextOffset < _transfer->m_endOffset))
+	{
+		auto offset = _transfer->m_nextOffset;
+		_transfer->m_nextOffset += _transfer->m_param.m_chunkSize;
+		++_transfer->m_inFlightCount;
+		sendByteStringChunk(_transfer, offset, 0);
+	}
+
+	if (_transfer->m_isFinished || _transfer->m_inFlightCount > 0 || _transfer->m_endOffset < 0)
+	{
+		return;
+	}
+	_transfer->m_isFinished = true;
+
+	if (_transfer->m_isWrite)
+	{
+		if (_transfer->m_param.m_lengthKeyName.isEmpty())
+		{
+			_transfer->m_onSuccess(QByteArray());
+			return;
+		}
+		//内容全部写完后再写长度,设备按长度取内容
+		auto lengthWatch = getWriteNodeVariableWatch(_transfer->m_param.m_lengthKeyName,
+			QVariant::fromValue(static_cast<quint32>(_transfer->m_endOffset)), QOpcUa::Types::UInt32);
+		QObject::connect(lengthWatch, &MC_FutureWatchBase::finished, this, [=]()
+		{
+			ME_DestructExecuter onDeleteObject([=]() {
+				lengthWatch->deleteLater();
+			});
+			if (!lengthWatch->getIsSuccess())
+			{
+				_transfer->m_onFail(QString(u8"Write byte string length %1 fail: %2").arg(_transfer->m_param.m_lengthKeyName).arg(lengthWatch->getErrorString()));
+				return;
+			}
+			_transfer->m_onSuccess(QByteArray());
+		});
+		return;
+	}
+
+	//只有一块时直接交出,不复制
+	QByteArray data;
+	if (_transfer->m_readChunks.size() == 1 && _transfer->m_readChunks.begin()->second.size() == _transfer->m_endOffset)
+	{
+		data = _transfer->m_readChunks.begin()->second;
+	}
+	else
+	{
+		data.reserve(static_cast<int>(_transfer->m_endOffset));
+		for (const auto& var : _transfer->m_readChunks)
+		{
+			if (var.first >= _transfer->m_endOffset)
+			{
+				break;
+			}
+			data.append(var.second.constData(), static_cast<int>(qMin<qint64>(var.second.size(), _transfer->m_endOffset - var.first)));
+		}
+	}
+	_transfer->m_readChunks.clear();
+	_transfer->m_onSuccess(data);
+}
+
+void MC_OpcUaClient::sendByteStringChunk(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer, qint64 _offset, int _retryCount)
+{
+	auto object = new QObject();
+	//长度已知时末块只传剩余部分
+	auto length = _transfer->m_param.m_chunkSize;
+	if (_transfer->m_endOffset >= 0)
+	{
+		length = static_cast<int>(qMin<qint64>(length, _transfer->m_endOffset - _offset));
+	}
+	auto nodeId = QOpcUa::nodeIdFromString(m_control->getNamespaceId(), _transfer->m_keyName);
+	auto indexRange = chunkIndexRange(_offset, length);
+
+	//断线等导致的失败不重试,整个传输失败
+	auto requestId = registerPendingRequest(object, [=](const QString& _error)
+	{
+		failByteStringTransfer(_transfer, _error);
+	}, _transfer->m_isWrite ? ME_OpcUaOperation::WRITE_CHUNK : ME_OpcUaOperation::READ_CHUNK);
+
+	auto onDeleteObjectFun = [=]()
+	{
+		unregisterPendingRequest(requestId);
+		object->disconnect();
+		object->deleteLater();
+	};
+
+	MM_MaybeOk dispatchResult;
+	if (_transfer->m_isWrite)
+	{
+		QVector<QOpcUaWriteItem> itemsToWrite;
+		itemsToWrite.push_back(QOpcUaWriteItem(nodeId, QOpcUa::NodeAttribute::Value,
+			QVariant(_transfer->m_data.mid(static_cast<int>(_offset), length)), QOpcUa::Types::ByteString, indexRange));
+		dispatchResult = dispatchWriteItems(requestId, itemsToWrite, [=](const QVector<QOpcUaWriteResult>& _results, QOpcUa::UaStatusCode _serviceResult)
+		{
+			ME_DestructExecuter onDeleteObject(onDeleteObjectFun);
+			auto status = _serviceResult;
+			if (status == QOpcUa::UaStatusCode::Good)
+			{
+				status = _results.size() == 1 ? _results.at(0).statusCode() : QOpcUa::UaStatusCode::BadUnexpectedError;
+			}
+			if (status != QOpcUa::UaStatusCode::Good)
+			{
+				markPendingRequestFailed(requestId, status);
+			}
+			onByteStringChunkFinished(_transfer, _offset, _retryCount, status, QByteArray());
+		});
+	}
+	else
+	{
+		QVector<QOpcUaReadItem> readItems;
+		readItems.push_back(QOpcUaReadItem(nodeId, QOpcUa::NodeAttribute::Value, indexRange));
+		dispatchResult = dispatchReadItems(requestId, readItems, [=](const QVector<QOpcUaReadResult>& _results, QOpcUa::UaStatusCode _serviceResult)
+		{
+			ME_DestructExecuter onDeleteObject(onDeleteObjectFun);
+			auto status = _serviceResult;
+			if (status == QOpcUa::UaStatusCode::Good)
+			{
+				status = _results.size() == 1 ? _results.at(0).statusCode() : QOpcUa::UaStatusCode::BadUnexpectedError;
+			}
+			//超出末尾不算失败
+			if (status != QOpcUa::UaStatusCode::Good && status != QOpcUa::UaStatusCode::BadIndexRangeNoData)
+			{
+				markPendingRequestFailed(requestId, status);
+			}
+			onByteStringChunkFinished(_transfer, _offset, _retryCount, status,
+				status == QOpcUa::UaStatusCode::Good ? _results.at(0).value().toByteArray() : QByteArray());
+		});
+	}
+
+	if (dispatchResult.hasError())
+	{
+		markPendingRequestFailed(requestId, QOpcUa::UaStatusCode::BadInternalError);
+		onDeleteObjectFun();
+		--_transfer->m_inFlightCount;
+		failByteStringTransfer(_transfer, dispatchResult.getError()->getMessage());
+	}
+}
+
+void MC_OpcUaClient::onByteStringChunkFinished(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer, qint64 _offset, int _retryCount, QOpcUa::UaStatusCode _status, const QByteArray& _data)
+{
+	if (_transfer->m_isFinished)
+	{
+		--_transfer->m_inFlightCount;
+		return;
+	}
+
+	auto isEndOfData = !_transfer->m_isWrite && _status == QOpcUa::UaStatusCode::BadIndexRangeNoData;
+	if (_status != QOpcUa::UaStatusCode::Good && !isEndOfData)
+	{
+		if (_retryCount < _transfer->m_param.m_maxRetryCount)
+		{
+			log(ML_LogLabel::WARNING_LABEL, QString(u8"分块传输[%1]偏移[%2]失败,第%3次重试 : %4")
+				.arg(_transfer->m_keyName).arg(_offset).arg(_retryCount + 1).arg(statusToString(_status)));
+			sendByteStringChunk(_transfer, _offset, _retryCount + 1);
+			return;
+		}
+		--_transfer->m_inFlightCount;
+		failByteStringTransfer(_transfer, QString(u8"Transfer byte string chunked fail: %1 offset %2 : %3")
+			.arg(_transfer->m_keyName).arg(_offset).arg(statusToString(_status)));
+		return;
+	}
+
+	--_transfer->m_inFlightCount;
+	if (!_transfer->m_isWrite)
+	{
+		//按长度字段读取时节点不应短于该长度
+		auto expectedLength = qMin<qint64>(_transfer->m_param.m_chunkSize, _transfer->m_endOffset - _offset);
+		if (!_transfer->m_param.m_lengthKeyName.isEmpty() && _data.size() < expectedLength)
+		{
+			failByteStringTransfer(_transfer, QString(u8"Transfer byte string chunked fail: %1 offset %2 : node is shorter than length %3")
+				.arg(_transfer->m_keyName).arg(_offset).arg(_transfer->m_endOffset));
+			return;
+		}
+		if (!_data.isEmpty())
+		{
+			_transfer->m_readChunks.emplace(_offset, _data);
+		}
+		//不足一块即为末块
+		if (_data.size() < _transfer->m_param.m_chunkSize)
+		{
+			auto endOffset = _offset + _data.size();
+			_transfer->m_endOffset = _transfer->m_endOffset < 0 ? endOffset : qMin(_transfer->m_endOffset, endOffset);
+		}
+	}
+	pumpByteStringChunks(_transfer);
+}
+
+void MC_OpcUaClient::failByteStringTransfer(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer, const QString& _error)
+{
+	if (_transfer->m_isFinished)
+	{
+		return;
+	}
+	_transfer->m_isFinished = true;
+	_transfer->m_readChunks.clear();
+	_transfer->m_onFail(_error);
+}
+
 void MC_OpcUaClient::addMonitorKeyWord(const QString& _val)
 {
 	if (std::find_if(m_monitorKeyWords.begin(), m_monitorKeyWords.end(), [=](const auto& _a) {
@@ -565,5 +1487,6 @@ void MC_OpcUaClient::addMonitorKeyWord(const QString& _val)
 	{
 		m_monitorKeyWords.emplace_back(std::make_pair(_val, false));
 		m_enableMonitorTimer->start();
+		scheduleMonitorCheck();
 	}
 }
@@ -4,14 +4,23 @@
 #include "MC_FutureWatch.h"
 #include "MI_Device.h"
 #include "ML_LogBase.h"
+#include "MC_ReconnectScheduler.h"
+#include "ML_TraceRecorder.h"
+#include "MC_OpcUaMetrics.h"
+#include "MS_ByteStringChunkParam.h"
+#include <QElapsedTimer>
 #include <QHostAddress>
 #include <QObject>
 #include <QtOpcUa>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <map>
+#include <set>
 #include <utility>
 
-class MD_OpcUaClientDevice;
+class MI_OpcUaClientBackend;
 class QTimer;
 
 class MC_OpcUaClient : public ML_LogBase
@@ -20,11 +29,19 @@ class MC_OpcUaClient : public ML_LogBase
 
 public:
 	MC_OpcUaClient(QObject *parent = nullptr);
+	//使用指定后端(如基准测试的空后端),默认为MD_OpcUaClientDevice
+	MC_OpcUaClient(std::shared_ptr<MI_OpcUaClientBackend> _backend, QObject *parent = nullptr);
 	~MC_OpcUaClient();
 
 signals:
 	void sig_connectResult(const MP_Public::MM_MaybeOk& _isConnectOk);
 	void sig_connectStateChanged(MS_ConnectState _state);
+	//连接建立(含命名空间解析)的边沿信号,只在未连接->已连接时发出一次
+	void sig_connectionEstablished();
+	//已建立的连接断开的边沿信号
+	void sig_connectionLost();
+	//断线重连后沿用了原有节点及信号连接,仅重新开启监控
+	void sig_sessionResumed();
 
 public slots:
 	void createAndConnectServer(const QHostAddress& _hostAddress, quint16 _port);
@@ -38,6 +55,19 @@ public slots:
 	MC_FutureWatch<std::map<QString, QVariant>>* readMultiNodeVariables(const std::vector<QString>& _keyNames);
 	MC_FutureWatch<void>* writeMultiNodeVariables(const std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>>& _vals);
 
+	/**
+	 * 按IndexRange分块写入ByteString,每块为一次单独的写服务请求,块之间可穿插其他读写
+	 * 服务器节点须已具备不小于_data的长度(如PLC中定长的字节数组),写入不改变节点长度,
+	 * 全部块写完后将实际长度写入_param.m_lengthKeyName(不为空时)
+	 */
+	MC_FutureWatch<void>* writeByteStringChunked(const QString& _keyName, const QByteArray& _data, const MS_ByteStringChunkParam& _param);
+	/**
+	 * 按IndexRange分块读取ByteString
+	 * _param.m_lengthKeyName不为空时先读实际长度,只读到该长度(定长节点的填充部分不返回);
+	 * 否则读到不足一块或超出范围(BadIndexRangeNoData)时结束
+	 */
+	MC_FutureWatch<QByteArray>* readByteStringChunked(const QString& _keyName, const MS_ByteStringChunkParam& _param);
+
 	QOpcUaNode* getNode(const QString& _keyName);
 
 	QOpcUaNode* getNode(quint16 _namespace,const QString& _keyName);
@@ -46,6 +76,30 @@ public slots:
 
 	void addMonitorKeyWord(const QString& _val);
 
+	//断开后是否自动重连(用户主动断开时不重连)
+	bool getIsAutoReconnect() const { return m_isAutoReconnect; }
+	void setIsAutoReconnect(bool _val);
+	MS_ReconnectPolicy getReconnectPolicy() const;
+	void setReconnectPolicy(const MS_ReconnectPolicy& _val);
+	bool isConnectionEstablished() const { return m_isConnectionEstablished; }
+
+	//读写/连接/保活的次数、失败及延时统计
+	std::shared_ptr<MC_OpcUaMetrics> getMetrics() const { return m_metrics; }
+	//本次连接是否沿用了上次会话,为真时上层无需重建监控及信号连接
+	bool isSessionResumed() const;
+
+	//保活参数,见MD_OpcUaClientDevice
+	void setIsKeepAliveEnabled(bool _val);
+	void setKeepAliveParam(int _intervalMs, int _timeoutMs, int _maxMissCount);
+
+	//录制收发及数据变化,见MC_OpcUaTrafficRecorder
+	MP_Public::MM_MaybeOk startTrafficRecording(const QString& _filePath);
+	void stopTrafficRecording();
+
+	//沿用会话后监控未能在该时间内全部恢复则回退为完整重建
+	int getResumeTimeoutMs() const { return m_resumeTimeoutMs; }
+	void setResumeTimeoutMs(int _val) { m_resumeTimeoutMs = _val; }
+
 	private slots:
 
 	MS_ConnectState convertState(QOpcUaClient::ClientState state);
@@ -56,11 +110,103 @@ public slots:
 	MC_FutureWatch<std::map<QString, QVariant>>* getReadMultiNodeVariablesWatch(const std::vector<QString>& _keyNames);
 	MC_FutureWatch<void>* getWriteMultiNodeVariablesWatch(const std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>>& _vals);
 
+	//检查监控项并对未监控的开启监控
+	void checkAndEnableMonitoring();
+	//对单个节点下发开启监控,成功后读取一次属性再标记为已监控
+	void enableNodeMonitoring(QOpcUaNode* _node, const QString& _keyWord);
+	//合并同一轮事件中的多次添加,只检查一次
+	void scheduleMonitorCheck();
+
+	//将当前连接的端点/命名空间/监控项写入快照
+	void updateSnapshot();
+	void seedMonitorKeyWordsFromSnapshot();
+
+	//按保存的地址发起一次连接
+	void connectServer();
+	void onConnectAttemptFailed(const MP_Public::ME_Error& _error);
+	void onConnectionEstablished();
+	void onClientStateChanged(QOpcUaClient::ClientState _state);
+	//作废当前连接尝试的回调
+	void finishConnectAttempt();
+	//登记未完成的读写请求,连接失效时立即以失败结束
+	quint64 registerPendingRequest(QObject* _context, std::function<void(const QString&)> _onFail, ME_OpcUaOperation _operation);
+	//请求完成时登记结果,未标记失败的按成功统计
+	void markPendingRequestFailed(quint64 _requestId, QOpcUa::UaStatusCode _status);
+	void unregisterPendingRequest(quint64 _requestId);
+	void failPendingRequests(const QString& _reason);
+
+	//下发批量读写并登记应答处理,应答按节点及IndexRange与请求对应,多个批量请求同时在途时不会错取应答
+	MP_Public::MM_MaybeOk dispatchReadItems(quint64 _requestId, const QVector<QOpcUaReadItem>& _items,
+		std::function<void(const QVector<QOpcUaReadResult>&, QOpcUa::UaStatusCode)> _onFinished);
+	MP_Public::MM_MaybeOk dispatchWriteItems(quint64 _requestId, const QVector<QOpcUaWriteItem>& _items,
+		std::function<void(const QVector<QOpcUaWriteResult>&, QOpcUa::UaStatusCode)> _onFinished);
+	void onReadNodeAttributesFinished(const QVector<QOpcUaReadResult>& _results, QOpcUa::UaStatusCode _serviceResult);
+	void onWriteNodeAttributesFinished(const QVector<QOpcUaWriteResult>& _results, QOpcUa::UaStatusCode _serviceResult);
+
+	struct MS_ByteStringChunkTransfer;
+	//补足在途的块,全部完成时结束传输
+	void pumpByteStringChunks(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer);
+	void sendByteStringChunk(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer, qint64 _offset, int _retryCount);
+	void onByteStringChunkFinished(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer, qint64 _offset, int _retryCount, QOpcUa::UaStatusCode _status, const QByteArray& _data);
+	void failByteStringTransfer(const std::shared_ptr<MS_ByteStringChunkTransfer>& _transfer, const QString& _error);
+
+	//在原有节点上重新开启监控
+	void resumeMonitoring();
+	void fallbackToRebuild();
 
 private:
-	std::shared_ptr<MD_OpcUaClientDevice> m_control = nullptr;
+	std::shared_ptr<MI_OpcUaClientBackend> m_control = nullptr;
 
 	std::vector<std::pair<QString, bool>> m_monitorKeyWords;
+	//已下发开启监控尚未返回的监控项
+	std::set<QString> m_monitorEnablingKeyWords;
 	QTimer* m_enableMonitorTimer{};
+	bool m_isMonitorCheckScheduled{ false };
+
+	MC_ReconnectScheduler* m_reconnectScheduler{};
+	QHostAddress m_hostAddress;
+	quint16 m_port{ 0 };
+	//追踪/指标中的设备名 ip:port
+	QString m_traceDeviceName;
+	std::shared_ptr<MC_OpcUaMetrics> m_metrics{ std::make_shared<MC_OpcUaMetrics>() };
+	QElapsedTimer m_connectElapsedTimer;
+	bool m_isAutoReconnect{ true };
+	//用户要求保持连接(createAndConnectServer后,disConnectServer前)
+	bool m_isKeepConnected{ false };
+	//其他线程(工位状态机)会读取
+	std::atomic_bool m_isConnectionEstablished{ false };
+	//当前连接尝试的回调上下文
+	QObject* m_connectAttemptObject{};
+	//单次连接超时,见MS_ReconnectPolicy::m_connectTimeoutMs
+	QTimer* m_connectTimeoutTimer{};
+
+	struct MS_PendingRequest
+	{
+		QObject* m_context{};
+		std::function<void(const QString&)> m_onFail;
+		ML_TraceSpan m_traceSpan;
+		ME_OpcUaOperation m_operation{ ME_OpcUaOperation::READ };
+		QElapsedTimer m_elapsedTimer;
+		QOpcUa::UaStatusCode m_status{ QOpcUa::UaStatusCode::Good };
+	};
+	std::map<quint64, MS_PendingRequest> m_pendingRequests;
+	quint64 m_nextRequestId{ 1 };
+
+	//在途的批量读写,按下发顺序排列;每项为(节点,IndexRange)
+	template<typename T>
+	struct MS_PendingAttributesRequest
+	{
+		quint64 m_requestId{ 0 };
+		std::vector<std::pair<QString, QString>> m_itemKeys;
+		std::function<void(const QVector<T>&, QOpcUa::UaStatusCode)> m_onFinished;
+	};
+	std::deque<MS_PendingAttributesRequest<QOpcUaReadResult>> m_pendingReadAttributesRequests;
+	std::deque<MS_PendingAttributesRequest<QOpcUaWriteResult>> m_pendingWriteAttributesRequests;
+
+	QTimer* m_resumeFallbackTimer{};
+	int m_resumeTimeoutMs{ 3000 };
+	//沿用会话恢复监控中,只认本次会话内重新开启成功的监控项
+	bool m_isResumingMonitoring{ false };
+	std::set<QString> m_resumeConfirmedKeyWords;
 
 };
@@ -0,0 +1,262 @@
+#include "MC_OpcUaFleetConnector.h"
+#include "MC_OpcUaClient.h"
+#include "MA_Auxiliary.h"
+#include <QRandomGenerator>
+#include <QTimer>
+#include <algorithm>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+QString MS_FleetConnectReport::toString() const
+{
+	QString ret = QString(u8"整线连接完成: 总数[%1] 成功[%2] 失败[%3] 总耗时[%4ms] 单台耗时 最小[%5ms] 最大[%6ms] 平均[%7ms]")
+		.arg(m_totalCount)
+		.arg(m_successCount)
+		.arg(m_failCount)
+		.arg(m_totalElapsedMs)
+		.arg(m_minLatencyMs)
+		.arg(m_maxLatencyMs)
+		.arg(m_avgLatencyMs);
+
+	for (const auto& var : m_items)
+	{
+		ret += QString(u8"\n  %1 (%2) : %3 延时[%4ms] 耗时[%5ms] %6")
+			.arg(var.m_name)
+			.arg(var.m_serverAddress)
+			.arg(var.m_isSuccess ? u8"成功" : u8"失败")
+			.arg(var.m_startDelayMs)
+			.arg(var.m_latencyMs)
+			.arg(var.m_errorInfo);
+	}
+	return ret;
+}
+
+MC_OpcUaFleetConnector::MC_OpcUaFleetConnector(QObject *_parent)
+	: ML_LogBase(_parent)
+{
+	qRegisterMetaType<MS_FleetConnectItemReport>("MS_FleetConnectItemReport");
+	qRegisterMetaType<MS_FleetConnectReport>("MS_FleetConnectReport");
+}
+
+MC_OpcUaFleetConnector::~MC_OpcUaFleetConnector()
+{
+}
+
+MM_MaybeOk MC_OpcUaFleetConnector::addClient(const QString& _name, MC_OpcUaClient* _client, const QHostAddress& _hostAddress, quint16 _port)
+{
+	if (m_isRunning)
+	{
+		return MM_MaybeOk(ME_Error(u8"Fleet connector is running!"));
+	}
+	if (!_client)
+	{
+		return MM_MaybeOk(ME_Error(u8"Client is null!"));
+	}
+	if (_hostAddress.isNull())
+	{
+		return MM_MaybeOk(ME_Error(u8"Host address is null!"));
+	}
+
+	MS_FleetConnectEntry entry;
+	entry.m_name = _name;
+	entry.m_client = _client;
+	entry.m_hostAddress = _hostAddress;
+	entry.m_port = _port;
+	entry.m_report.m_name = _name;
+	entry.m_report.m_serverAddress = QString("%1:%2").arg(_hostAddress.toString()).arg(_port);
+	m_entries.emplace_back(entry);
+	return MM_MaybeOk();
+}
+
+void MC_OpcUaFleetConnector::clearClients()
+{
+	if (m_isRunning)
+	{
+		return;
+	}
+	m_entries.clear();
+	m_entries.shrink_to_fit();
+}
+
+MM_MaybeOk MC_OpcUaFleetConnector::start()
+{
+	if (m_isRunning)
+	{
+		return MM_MaybeOk(ME_Error(u8"Fleet connector is running!"));
+	}
+
+	m_isRunning = true;
+	m_nextIndex = 0;
+	m_inFlightCount = 0;
+	m_finishedCount = 0;
+	for (auto& var : m_entries)
+	{
+		var.m_report.m_isSuccess = false;
+		var.m_report.m_errorInfo.clear();
+		var.m_report.m_startDelayMs = 0;
+		var.m_report.m_latencyMs = 0;
+		var.m_isFinished = false;
+	}
+	m_totalTimer.start();
+
+	log(ML_LogLabel::NORMAL_LABEL, QString(u8"开始整线连接: 数量[%1] 并发[%2] 抖动[%3ms]")
+		.arg(m_entries.size())
+		.arg(m_maxParallel)
+		.arg(m_startJitterMs));
+
+	if (m_entries.empty())
+	{
+		m_isRunning = false;
+		emit sig_finished(makeReport());
+		return MM_MaybeOk();
+	}
+
+	launchNext();
+	return MM_MaybeOk();
+}
+
+void MC_OpcUaFleetConnector::launchNext()
+{
+	while (m_inFlightCount < m_maxParallel && m_nextIndex < m_entries.size())
+	{
+		auto startDelayMs = m_startJitterMs > 0 ? static_cast<int>(QRandomGenerator::global()->bounded(m_startJitterMs + 1)) : 0;
+		++m_inFlightCount;
+		launchEntry(m_nextIndex++, startDelayMs);
+	}
+}
+
+void MC_OpcUaFleetConnector::launchEntry(std::size_t _index, int _startDelayMs)
+{
+	auto& entry = m_entries.at(_index);
+	entry.m_report.m_startDelayMs = _startDelayMs;
+
+	//结果回调在本对象线程中执行,object析构即断开
+	auto object = new QObject(this);
+	QTimer::singleShot(_startDelayMs, object, [=]()
+	{
+		auto& curEntry = m_entries.at(_index);
+		auto client = curEntry.m_client;
+		if (!client)
+		{
+			onEntryFinished(_index, object, ME_Error(u8"Client has been destroyed!"));
+			return;
+		}
+		//已连接的客户端不会再发出连接结果
+		if (client->isConnectionEstablished())
+		{
+			curEntry.m_connectTimer.start();
+			onEntryFinished(_index, object, MM_MaybeOk());
+			return;
+		}
+
+		QObject::connect(client, &MC_OpcUaClient::sig_connectResult, object, [=](const MM_MaybeOk& _result)
+		{
+			onEntryFinished(_index, object, _result);
+		});
+
+		if (m_connectTimeoutMs > 0)
+		{
+			QTimer::singleShot(m_connectTimeoutMs, object, [=]()
+			{
+				//中止仍在进行的连接后再释放并发名额,实际在途的连接数不超过并发上限
+				if (client)
+				{
+					QMetaObject::invokeMethod(client, [=]()
+					{
+						client->disConnectServer();
+					});
+				}
+				onEntryFinished(_index, object, ME_Error(u8"Connect timeout!"));
+			});
+		}
+
+		curEntry.m_connectTimer.start();
+		auto hostAddress = curEntry.m_hostAddress;
+		auto port = curEntry.m_port;
+		QMetaObject::invokeMethod(client, [=]()
+		{
+			client->createAndConnectServer(hostAddress, port);
+		});
+	});
+}
+
+void MC_OpcUaFleetConnector::onEntryFinished(std::size_t _index, QObject* _context, const MM_MaybeOk& _result)
+{
+	auto& entry = m_entries.at(_index);
+	//超时与结果可能在同一轮事件中到达,每项只统计一次
+	if (entry.m_isFinished)
+	{
+		return;
+	}
+	entry.m_isFinished = true;
+
+	if (entry.m_client)
+	{
+		QObject::disconnect(entry.m_client, nullptr, _context, nullptr);
+	}
+	_context->deleteLater();
+
+	entry.m_report.m_latencyMs = entry.m_connectTimer.isValid() ? entry.m_connectTimer.elapsed() : 0;
+	entry.m_report.m_isSuccess = !_result.hasError();
+	entry.m_report.m_errorInfo = _result.hasError() ? _result.getError()->getMessage() : QString();
+
+	if (_result.hasError())
+	{
+		log(ML_LogLabel::WARNING_LABEL, QString(u8"%1 连接失败: %2").arg(entry.m_report.m_serverAddress).arg(entry.m_report.m_errorInfo));
+	}
+
+	--m_inFlightCount;
+	++m_finishedCount;
+	emit sig_progress(m_finishedCount, static_cast<int>(m_entries.size()), entry.m_report);
+
+	if (m_finishedCount >= static_cast<int>(m_entries.size()))
+	{
+		m_isRunning = false;
+		auto report = makeReport();
+		log(ML_LogLabel::NORMAL_LABEL, report.toString());
+		emit sig_finished(report);
+		return;
+	}
+
+	launchNext();
+}
+
+MS_FleetConnectReport MC_OpcUaFleetConnector::makeReport() const
+{
+	MS_FleetConnectReport report;
+	report.m_totalCount = static_cast<int>(m_entries.size());
+	report.m_totalElapsedMs = m_totalTimer.isValid() ? m_totalTimer.elapsed() : 0;
+
+	//耗时只统计成功的连接,失败/超时的耗时取决于超时设置而非服务器
+	qint64 latencySum = 0;
+	int latencyCount = 0;
+	for (const auto& var : m_entries)
+	{
+		report.m_items.emplace_back(var.m_report);
+		if (!var.m_report.m_isSuccess)
+		{
+			++report.m_failCount;
+			continue;
+		}
+		++report.m_successCount;
+
+		latencySum += var.m_report.m_latencyMs;
+		if (++latencyCount == 1)
+		{
+			report.m_minLatencyMs = var.m_report.m_latencyMs;
+			report.m_maxLatencyMs = var.m_report.m_latencyMs;
+		}
+		else
+		{
+			report.m_minLatencyMs = std::min(report.m_minLatencyMs, var.m_report.m_latencyMs);
+			report.m_maxLatencyMs = std::max(report.m_maxLatencyMs, var.m_report.m_latencyMs);
+		}
+	}
+
+	if (latencyCount > 0)
+	{
+		report.m_avgLatencyMs = latencySum / latencyCount;
+	}
+	return report;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "ML_LogBase.h"
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QObject>
+#include <QString>
+#include <vector>
+
+class MC_OpcUaClient;
+
+//单个分控连接结果
+struct MS_FleetConnectItemReport
+{
+	QString m_name;
+	QString m_serverAddress;
+	bool m_isSuccess{ false };
+	QString m_errorInfo;
+	//启动抖动延时
+	qint64 m_startDelayMs{ 0 };
+	//从发起连接到收到结果的耗时
+	qint64 m_latencyMs{ 0 };
+};
+
+//整线连接汇总
+struct MS_FleetConnectReport
+{
+	int m_totalCount{ 0 };
+	int m_successCount{ 0 };
+	int m_failCount{ 0 };
+	qint64 m_totalElapsedMs{ 0 };
+	qint64 m_minLatencyMs{ 0 };
+	qint64 m_maxLatencyMs{ 0 };
+	qint64 m_avgLatencyMs{ 0 };
+	std::vector<MS_FleetConnectItemReport> m_items;
+
+	QString toString() const;
+};
+
+Q_DECLARE_METATYPE(MS_FleetConnectItemReport)
+Q_DECLARE_METATYPE(MS_FleetConnectReport)
+
+/**
+ * 整线并发连接管理
+ * 以限定的并发数同时连接多个MC_OpcUaClient,每次发起连接前加随机抖动,
+ * 冷启动耗时取决于最慢的分控而不是所有分控耗时之和
+ */
+class MC_OpcUaFleetConnector : public ML_LogBase
+{
+	Q_OBJECT
+
+public:
+	MC_OpcUaFleetConnector(QObject *_parent = nullptr);
+	~MC_OpcUaFleetConnector();
+
+	int getMaxParallel() const { return m_maxParallel; }
+	void setMaxParallel(int _val) { m_maxParallel = qMax(1, _val); }
+
+	int getStartJitterMs() const { return m_startJitterMs; }
+	void setStartJitterMs(int _val) { m_startJitterMs = qMax(0, _val); }
+
+	int getConnectTimeoutMs() const { return m_connectTimeoutMs; }
+	void setConnectTimeoutMs(int _val) { m_connectTimeoutMs = qMax(0, _val); }
+
+	bool isRunning() const { return m_isRunning; }
+
+	//添加待连接的客户端,运行中不允许添加
+	MP_Public::MM_MaybeOk addClient(const QString& _name, MC_OpcUaClient* _client, const QHostAddress& _hostAddress, quint16 _port);
+	void clearClients();
+
+signals:
+	//每完成一个连接(成功或失败)发出
+	void sig_progress(int _finishedCount, int _totalCount, const MS_FleetConnectItemReport& _item);
+	//全部连接结束发出
+	void sig_finished(const MS_FleetConnectReport& _report);
+
+public slots:
+	MP_Public::MM_MaybeOk start();
+
+private:
+	struct MS_FleetConnectEntry
+	{
+		QString m_name;
+		QPointer<MC_OpcUaClient> m_client;
+		QHostAddress m_hostAddress;
+		quint16 m_port{ 0 };
+		QElapsedTimer m_connectTimer;
+		bool m_isFinished{ false };
+		MS_FleetConnectItemReport m_report;
+	};
+
+	void launchNext();
+	void launchEntry(std::size_t _index, int _startDelayMs);
+	void onEntryFinished(std::size_t _index, QObject* _context, const MP_Public::MM_MaybeOk& _result);
+	MS_FleetConnectReport makeReport() const;
+
+	std::vector<MS_FleetConnectEntry> m_entries;
+
+	int m_maxParallel{ 8 };
+	int m_startJitterMs{ 200 };
+	int m_connectTimeoutMs{ 10000 };
+
+	bool m_isRunning{ false };
+	std::size_t m_nextIndex{ 0 };
+	int m_inFlightCount{ 0 };
+	int m_finishedCount{ 0 };
+	QElapsedTimer m_totalTimer;
+};
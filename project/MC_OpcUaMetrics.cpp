@@ -0,0 +1,400 @@
+#include "MC_OpcUaMetrics.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//Prometheus 直方图桶上界(微秒)
+	const std::vector<qint64> s_prometheusBucketsUs{
+		500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000 };
+
+	QString statusName(QOpcUa::UaStatusCode _status)
+	{
+		return QString(u8"0x%1").arg(static_cast<quint32>(_status), 8, 16, QChar('0'));
+	}
+}
+
+MC_LatencyHistogram::MC_LatencyHistogram()
+{
+	reset();
+}
+
+int MC_LatencyHistogram::bucketIndex(qint64 _valueUs)
+{
+	if (_valueUs < s_subBucketCount)
+	{
+		return static_cast<int>(std::max<qint64>(0, _valueUs));
+	}
+	auto msb = 63 - qCountLeadingZeroBits(static_cast<quint64>(_valueUs));
+	auto shift = msb - s_subBucketBits;
+	auto subIndex = static_cast<int>((_valueUs >> shift) - s_subBucketCount);
+	auto index = (shift + 1) * s_subBucketCount + subIndex;
+	return std::min(index, s_bucketCount - 1);
+}
+
+qint64 MC_LatencyHistogram::bucketUpperBound(int _index)
+{
+	auto magnitude = _index / s_subBucketCount;
+	auto subIndex = _index % s_subBucketCount;
+	if (magnitude == 0)
+	{
+		return subIndex;
+	}
+	auto shift = magnitude - 1;
+	return ((static_cast<qint64>(subIndex) + s_subBucketCount + 1) << shift) - 1;
+}
+
+void MC_LatencyHistogram::record(qint64 _valueUs)
+{
+	_valueUs = std::max<qint64>(0, _valueUs);
+	m_buckets[bucketIndex(_valueUs)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sumUs.fetch_add(static_cast<quint64>(_valueUs), std::memory_order_relaxed);
+
+	auto curMax = m_maxUs.load(std::memory_order_relaxed);
+	while (_valueUs > curMax && !m_maxUs.compare_exchange_weak(curMax, _valueUs, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MC_LatencyHistogram::reset()
+{
+	for (auto& var : m_buckets)
+	{
+		var.store(0, std::memory_order_relaxed);
+	}
+	m_count = 0;
+	m_sumUs = 0;
+	m_maxUs = 0;
+}
+
+qint64 MC_LatencyHistogram::getPercentileUs(double _quantile) const
+{
+	auto count = getCount();
+	if (count == 0)
+	{
+		return 0;
+	}
+	auto target = static_cast<quint64>(std::ceil(std::min(1.0, std::max(0.0, _quantile)) * count));
+	target = std::max<quint64>(1, target);
+
+	quint64 cumulative = 0;
+	for (auto curIndex = 0; curIndex < s_bucketCount; ++curIndex)
+	{
+		cumulative += m_buckets[curIndex].load(std::memory_order_relaxed);
+		if (cumulative >= target)
+		{
+			return std::min(bucketUpperBound(curIndex), getMaxUs());
+		}
+	}
+	return getMaxUs();
+}
+
+std::vector<std::pair<qint64, quint64>> MC_LatencyHistogram::getCumulativeBuckets(const std::vector<qint64>& _upperBoundsUs) const
+{
+	std::vector<std::pair<qint64, quint64>> ret;
+	quint64 cumulative = 0;
+	auto curIndex = 0;
+	for (auto bound : _upperBoundsUs)
+	{
+		while (curIndex < s_bucketCount && bucketUpperBound(curIndex) <= bound)
+		{
+			cumulative += m_buckets[curIndex].load(std::memory_order_relaxed);
+			++curIndex;
+		}
+		ret.emplace_back(bound, cumulative);
+	}
+	return ret;
+}
+
+QString MC_OpcUaMetrics::operationToString(ME_OpcUaOperation _operation)
+{
+	switch (_operation)
+	{
+	case ME_OpcUaOperation::READ:
+		return u8"read";
+	case ME_OpcUaOperation::WRITE:
+		return u8"write";
+	case ME_OpcUaOperation::READ_MULTI:
+		return u8"read_multi";
+	case ME_OpcUaOperation::WRITE_MULTI:
+		return u8"write_multi";
+	case ME_OpcUaOperation::READ_CHUNK:
+		return u8"read_chunk";
+	case ME_OpcUaOperation::WRITE_CHUNK:
+		return u8"write_chunk";
+	case ME_OpcUaOperation::CONNECT:
+		return u8"connect";
+	case ME_OpcUaOperation::KEEP_ALIVE:
+		return u8"keep_alive";
+	default:
+		break;
+	}
+	return u8"unknown";
+}
+
+void MC_OpcUaMetrics::recordSuccess(ME_OpcUaOperation _operation, qint64 _latencyUs)
+{
+	auto& operation = m_operations[static_cast<int>(_operation)];
+	operation.m_count.fetch_add(1, std::memory_order_relaxed);
+	operation.m_histogram.record(_latencyUs);
+}
+
+void MC_OpcUaMetrics::recordFailure(ME_OpcUaOperation _operation, qint64 _latencyUs, QOpcUa::UaStatusCode _status)
+{
+	auto& operation = m_operations[static_cast<int>(_operation)];
+	operation.m_count.fetch_add(1, std::memory_order_relaxed);
+	operation.m_failCount.fetch_add(1, std::memory_order_relaxed);
+	operation.m_histogram.record(_latencyUs);
+
+	QMutexLocker locker(&operation.m_statusMutex);
+	++operation.m_failCountByStatus[_status];
+}
+
+MS_OpcUaOperationStats MC_OpcUaMetrics::getStats(ME_OpcUaOperation _operation) const
+{
+	const auto& operation = m_operations[static_cast<int>(_operation)];
+
+	MS_OpcUaOperationStats stats;
+	stats.m_operation = _operation;
+	stats.m_count = operation.m_count.load(std::memory_order_relaxed);
+	stats.m_failCount = operation.m_failCount.load(std::memory_order_relaxed);
+	stats.m_p50Us = operation.m_histogram.getPercentileUs(0.5);
+	stats.m_p90Us = operation.m_histogram.getPercentileUs(0.9);
+	stats.m_p99Us = operation.m_histogram.getPercentileUs(0.99);
+	stats.m_maxUs = operation.m_histogram.getMaxUs();
+	auto histogramCount = operation.m_histogram.getCount();
+	stats.m_meanUs = histogramCount == 0 ? 0 : static_cast<qint64>(operation.m_histogram.getSumUs() / histogramCount);
+
+	QMutexLocker locker(&operation.m_statusMutex);
+	stats.m_failCountByStatus = operation.m_failCountByStatus;
+	return stats;
+}
+
+std::vector<MS_OpcUaOperationStats> MC_OpcUaMetrics::getAllStats() const
+{
+	std::vector<MS_OpcUaOperationStats> ret;
+	for (auto curIndex = 0; curIndex < static_cast<int>(ME_OpcUaOperation::COUNT); ++curIndex)
+	{
+		ret.push_back(getStats(static_cast<ME_OpcUaOperation>(curIndex)));
+	}
+	return ret;
+}
+
+void MC_OpcUaMetrics::reset()
+{
+	for (auto& var : m_operations)
+	{
+		var.m_histogram.reset();
+		var.m_count = 0;
+		var.m_failCount = 0;
+		QMutexLocker locker(&var.m_statusMutex);
+		var.m_failCountByStatus.clear();
+	}
+}
+
+QString MC_OpcUaMetrics::toPrometheusText(const QString& _server, const QString& _client) const
+{
+	QString text;
+	QTextStream stream(&text);
+	for (auto curIndex = 0; curIndex < static_cast<int>(ME_OpcUaOperation::COUNT); ++curIndex)
+	{
+		auto operation = static_cast<ME_OpcUaOperation>(curIndex);
+		const auto& metrics = m_operations[curIndex];
+		auto labels = QString(u8"server=\"%1\",client=\"%2\",operation=\"%3\"").arg(_server, _client, operationToString(operation));
+
+		stream << u8"opcua_requests_total{" << labels << u8"} " << metrics.m_count.load() << u8"\n";
+		stream << u8"opcua_request_failures_total{" << labels << u8"} " << metrics.m_failCount.load() << u8"\n";
+		{
+			QMutexLocker locker(&metrics.m_statusMutex);
+			for (const auto& var : metrics.m_failCountByStatus)
+			{
+				stream << u8"opcua_request_failures_by_status_total{" << labels
+					<< u8",status=\"" << statusName(var.first) << u8"\"} " << var.second << u8"\n";
+			}
+		}
+
+		for (const auto& var : metrics.m_histogram.getCumulativeBuckets(s_prometheusBucketsUs))
+		{
+			stream << u8"opcua_request_latency_seconds_bucket{" << labels
+				<< u8",le=\"" << QString::number(var.first / 1e6) << u8"\"} " << var.second << u8"\n";
+		}
+		stream << u8"opcua_request_latency_seconds_bucket{" << labels << u8",le=\"+Inf\"} " << metrics.m_histogram.getCount() << u8"\n";
+		stream << u8"opcua_request_latency_seconds_sum{" << labels << u8"} " << QString::number(metrics.m_histogram.getSumUs() / 1e6) << u8"\n";
+		stream << u8"opcua_request_latency_seconds_count{" << labels << u8"} " << metrics.m_histogram.getCount() << u8"\n";
+	}
+	stream.flush();
+	return text;
+}
+
+MC_OpcUaMetricsRegistry& MC_OpcUaMetricsRegistry::instance()
+{
+	static MC_OpcUaMetricsRegistry s_instance;
+	return s_instance;
+}
+
+MC_OpcUaMetricsRegistry::MC_OpcUaMetricsRegistry()
+	: QObject(nullptr)
+{
+	//首次使用可能在控制线程,本地套接字统一在主线程创建
+	if (QCoreApplication::instance() && thread() != QCoreApplication::instance()->thread())
+	{
+		moveToThread(QCoreApplication::instance()->thread());
+	}
+}
+
+void MC_OpcUaMetricsRegistry::registerMetrics(const QString& _server, std::shared_ptr<MC_OpcUaMetrics> _metrics)
+{
+	if (!_metrics)
+	{
+		return;
+	}
+	QMutexLocker locker(&m_mutex);
+	auto& registeredMetrics = m_metrics[_metrics.get()];
+	if (!registeredMetrics.m_metrics)
+	{
+		registeredMetrics.m_clientId = m_nextClientId++;
+		registeredMetrics.m_metrics = _metrics;
+	}
+	registeredMetrics.m_server = _server;
+}
+
+void MC_OpcUaMetricsRegistry::unregisterMetrics(const std::shared_ptr<MC_OpcUaMetrics>& _metrics)
+{
+	QMutexLocker locker(&m_mutex);
+	m_metrics.erase(_metrics.get());
+}
+
+std::vector<MC_OpcUaMetricsRegistry::MS_RegisteredMetrics> MC_OpcUaMetricsRegistry::getAllMetrics()
+{
+	QMutexLocker locker(&m_mutex);
+	std::vector<MS_RegisteredMetrics> metrics;
+	metrics.reserve(m_metrics.size());
+	for (const auto& var : m_metrics)
+	{
+		metrics.push_back(var.second);
+	}
+	return metrics;
+}
+
+int MC_OpcUaMetricsRegistry::addCollector(MT_Collector _collector)
+{
+	QMutexLocker locker(&m_mutex);
+	auto collectorId = m_nextCollectorId++;
+	m_collectors[collectorId] = std::move(_collector);
+	return collectorId;
+}
+
+void MC_OpcUaMetricsRegistry::removeCollector(int _collectorId)
+{
+	QMutexLocker locker(&m_mutex);
+	m_collectors.erase(_collectorId);
+}
+
+QString MC_OpcUaMetricsRegistry::toPrometheusText()
+{
+	auto metrics = getAllMetrics();
+	std::map<int, MT_Collector> collectors;
+	{
+		QMutexLocker locker(&m_mutex);
+		collectors = m_collectors;
+	}
+
+	QString text;
+	text += u8"# TYPE opcua_requests_total counter\n";
+	text += u8"# TYPE opcua_request_failures_total counter\n";
+	text += u8"# TYPE opcua_request_failures_by_status_total counter\n";
+	text += u8"# TYPE opcua_request_latency_seconds histogram\n";
+	for (const auto& var : metrics)
+	{
+		text += var.m_metrics->toPrometheusText(var.m_server, QString::number(var.m_clientId));
+	}
+	for (const auto& var : collectors)
+	{
+		text += var.second();
+	}
+	return text;
+}
+
+MM_MaybeOk MC_OpcUaMetricsRegistry::dumpToFile(const QString& _filePath)
+{
+	QDir().mkpath(QFileInfo(_filePath).absolutePath());
+	QSaveFile file(_filePath);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return MM_MaybeOk(ME_Error(u8"Open metrics file fail! " + file.errorString()));
+	}
+	file.write(toPrometheusText().toUtf8());
+	if (!file.commit())
+	{
+		return MM_MaybeOk(ME_Error(u8"Write metrics file fail! " + file.errorString()));
+	}
+	return MM_MaybeOk();
+}
+
+MM_MaybeOk MC_OpcUaMetricsRegistry::startLocalServer(const QString& _serverName)
+{
+	if (QThread::currentThread() != thread())
+	{
+		MM_MaybeOk result;
+		QMetaObject::invokeMethod(this, [&]()
+		{
+			result = startLocalServer(_serverName);
+		}, Qt::BlockingQueuedConnection);
+		return result;
+	}
+
+	stopLocalServer();
+
+	m_localServer = new QLocalServer(this);
+	QLocalServer::removeServer(_serverName);
+	if (!m_localServer->listen(_serverName))
+	{
+		auto error = ME_Error(u8"Listen metrics local server fail! " + m_localServer->errorString());
+		stopLocalServer();
+		return MM_MaybeOk(error);
+	}
+
+	QObject::connect(m_localServer, &QLocalServer::newConnection, this, [=]()
+	{
+		while (auto socket = m_localServer->nextPendingConnection())
+		{
+			QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+			socket->write(toPrometheusText().toUtf8());
+			socket->disconnectFromServer();
+		}
+	});
+	return MM_MaybeOk();
+}
+
+void MC_OpcUaMetricsRegistry::stopLocalServer()
+{
+	if (QThread::currentThread() != thread())
+	{
+		QMetaObject::invokeMethod(this, [=]()
+		{
+			stopLocalServer();
+		}, Qt::BlockingQueuedConnection);
+		return;
+	}
+	if (!m_localServer)
+	{
+		return;
+	}
+	m_localServer->close();
+	m_localServer->deleteLater();
+	m_localServer = nullptr;
+}
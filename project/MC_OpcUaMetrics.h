@@ -0,0 +1,164 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QtOpcUa>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class QLocalServer;
+
+/**
+ * 延时直方图(HDR风格的对数-线性分桶)
+ * 每个2的幂区间再线性分为s_subBucketCount个桶,相对误差约 1/s_subBucketCount,
+ * 记录只做原子加,可在任意线程调用
+ */
+class MC_LatencyHistogram
+{
+public:
+	static constexpr int s_subBucketBits = 4;
+	static constexpr int s_subBucketCount = 1 << s_subBucketBits;
+	//最大约 2^39 微秒,超出计入最后一个桶
+	static constexpr int s_magnitudeCount = 36;
+	static constexpr int s_bucketCount = s_magnitudeCount * s_subBucketCount;
+
+	MC_LatencyHistogram();
+
+	void record(qint64 _valueUs);
+	void reset();
+
+	quint64 getCount() const { return m_count.load(std::memory_order_relaxed); }
+	quint64 getSumUs() const { return m_sumUs.load(std::memory_order_relaxed); }
+	qint64 getMaxUs() const { return m_maxUs.load(std::memory_order_relaxed); }
+
+	//_quantile 取 0~1
+	qint64 getPercentileUs(double _quantile) const;
+
+	//Prometheus 累积桶,返回(上界微秒, 累计次数)
+	std::vector<std::pair<qint64, quint64>> getCumulativeBuckets(const std::vector<qint64>& _upperBoundsUs) const;
+
+private:
+	static int bucketIndex(qint64 _valueUs);
+	static qint64 bucketUpperBound(int _index);
+
+	std::array<std::atomic<quint64>, s_bucketCount> m_buckets;
+	std::atomic<quint64> m_count{ 0 };
+	std::atomic<quint64> m_sumUs{ 0 };
+	std::atomic<qint64> m_maxUs{ 0 };
+};
+
+//OPC UA 操作类型
+enum class ME_OpcUaOperation
+{
+	READ,
+	WRITE,
+	READ_MULTI,
+	WRITE_MULTI,
+	READ_CHUNK,
+	WRITE_CHUNK,
+	CONNECT,
+	KEEP_ALIVE,
+	COUNT
+};
+
+//单个操作类型的统计快照
+struct MS_OpcUaOperationStats
+{
+	ME_OpcUaOperation m_operation{ ME_OpcUaOperation::READ };
+	quint64 m_count{ 0 };
+	quint64 m_failCount{ 0 };
+	qint64 m_p50Us{ 0 };
+	qint64 m_p90Us{ 0 };
+	qint64 m_p99Us{ 0 };
+	qint64 m_maxUs{ 0 };
+	qint64 m_meanUs{ 0 };
+	std::map<QOpcUa::UaStatusCode, quint64> m_failCountByStatus;
+};
+
+/**
+ * 单个服务器的OPC UA指标
+ * 按操作类型统计请求次数/失败次数/往返延时分布,失败按UaStatusCode分别计数
+ */
+class MC_OpcUaMetrics
+{
+public:
+	static QString operationToString(ME_OpcUaOperation _operation);
+
+	void recordSuccess(ME_OpcUaOperation _operation, qint64 _latencyUs);
+	void recordFailure(ME_OpcUaOperation _operation, qint64 _latencyUs, QOpcUa::UaStatusCode _status);
+
+	MS_OpcUaOperationStats getStats(ME_OpcUaOperation _operation) const;
+	std::vector<MS_OpcUaOperationStats> getAllStats() const;
+	void reset();
+
+	//Prometheus 文本格式,_server/_client 分别作为 server/client 标签
+	QString toPrometheusText(const QString& _server, const QString& _client) const;
+
+private:
+	struct MS_OperationMetrics
+	{
+		MC_LatencyHistogram m_histogram;
+		std::atomic<quint64> m_count{ 0 };
+		std::atomic<quint64> m_failCount{ 0 };
+		mutable QMutex m_statusMutex;
+		std::map<QOpcUa::UaStatusCode, quint64> m_failCountByStatus;
+	};
+
+	std::array<MS_OperationMetrics, static_cast<int>(ME_OpcUaOperation::COUNT)> m_operations;
+};
+
+/**
+ * 指标汇总
+ * 各MC_OpcUaClient登记自身指标,统一导出为Prometheus文本,可写文件或通过本地套接字读取
+ * 按客户端实例(指标对象)登记,同一服务器的多个客户端各自导出;对象固定在主线程
+ */
+class MC_OpcUaMetricsRegistry : public QObject
+{
+	Q_OBJECT
+
+public:
+	static MC_OpcUaMetricsRegistry& instance();
+
+	struct MS_RegisteredMetrics
+	{
+		//登记顺序号,导出为 client 标签
+		quint64 m_clientId{ 0 };
+		QString m_server;
+		std::shared_ptr<MC_OpcUaMetrics> m_metrics;
+	};
+
+	//同一指标对象重复登记时只更新服务器名,序号不变
+	void registerMetrics(const QString& _server, std::shared_ptr<MC_OpcUaMetrics> _metrics);
+	void unregisterMetrics(const std::shared_ptr<MC_OpcUaMetrics>& _metrics);
+
+	std::vector<MS_RegisteredMetrics> getAllMetrics();
+
+	//额外指标(如事件循环延时),导出时追加在后面
+	using MT_Collector = std::function<QString()>;
+	int addCollector(MT_Collector _collector);
+	void removeCollector(int _collectorId);
+
+	QString toPrometheusText();
+	MP_Public::MM_MaybeOk dumpToFile(const QString& _filePath);
+
+	//本地套接字,客户端连接后写入一次完整的指标文本并断开;可在任意线程调用,在主线程执行
+	MP_Public::MM_MaybeOk startLocalServer(const QString& _serverName);
+	void stopLocalServer();
+
+private:
+	MC_OpcUaMetricsRegistry();
+
+	QMutex m_mutex;
+	std::map<const MC_OpcUaMetrics*, MS_RegisteredMetrics> m_metrics;
+	quint64 m_nextClientId{ 1 };
+	std::map<int, MT_Collector> m_collectors;
+	int m_nextCollectorId{ 1 };
+	QLocalServer* m_localServer{};
+};
@@ -0,0 +1,283 @@
+#include "MC_OpcUaSessionSnapshot.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	void writeEndpoint(QDataStream& _stream, const QOpcUaEndpointDescription& _endpoint)
+	{
+		auto server = _endpoint.server();
+		_stream << _endpoint.endpointUrl()
+			<< _endpoint.securityPolicy()
+			<< static_cast<qint32>(_endpoint.securityMode())
+			<< static_cast<quint8>(_endpoint.securityLevel())
+			<< _endpoint.transportProfileUri()
+			<< _endpoint.serverCertificate()
+			<< server.applicationUri()
+			<< server.productUri()
+			<< server.applicationName().locale()
+			<< server.applicationName().text()
+			<< static_cast<qint32>(server.applicationType())
+			<< server.discoveryUrls();
+
+		auto tokens = _endpoint.userIdentityTokens();
+		_stream << static_cast<quint32>(tokens.size());
+		for (const auto& var : tokens)
+		{
+			_stream << var.policyId()
+				<< static_cast<qint32>(var.tokenType())
+				<< var.issuedTokenType()
+				<< var.issuerEndpointUrl()
+				<< var.securityPolicy();
+		}
+	}
+
+	QOpcUaEndpointDescription readEndpoint(QDataStream& _stream)
+	{
+		QString endpointUrl;
+		QString securityPolicy;
+		qint32 securityMode{};
+		quint8 securityLevel{};
+		QString transportProfileUri;
+		QByteArray serverCertificate;
+		QString applicationUri;
+		QString productUri;
+		QString applicationNameLocale;
+		QString applicationNameText;
+		qint32 applicationType{};
+		QStringList discoveryUrls;
+		quint32 tokenCount{};
+
+		_stream >> endpointUrl
+			>> securityPolicy
+			>> securityMode
+			>> securityLevel
+			>> transportProfileUri
+			>> serverCertificate
+			>> applicationUri
+			>> productUri
+			>> applicationNameLocale
+			>> applicationNameText
+			>> applicationType
+			>> discoveryUrls
+			>> tokenCount;
+
+		QVector<QOpcUaUserTokenPolicy> tokens;
+		for (quint32 curIndex = 0; curIndex < tokenCount && _stream.status() == QDataStream::Ok; ++curIndex)
+		{
+			QString policyId;
+			qint32 tokenType{};
+			QString issuedTokenType;
+			QString issuerEndpointUrl;
+			QString tokenSecurityPolicy;
+			_stream >> policyId >> tokenType >> issuedTokenType >> issuerEndpointUrl >> tokenSecurityPolicy;
+
+			QOpcUaUserTokenPolicy token;
+			token.setPolicyId(policyId);
+			token.setTokenType(static_cast<QOpcUaUserTokenPolicy::TokenType>(tokenType));
+			token.setIssuedTokenType(issuedTokenType);
+			token.setIssuerEndpointUrl(issuerEndpointUrl);
+			token.setSecurityPolicy(tokenSecurityPolicy);
+			tokens.push_back(token);
+		}
+
+		QOpcUaApplicationDescription server;
+		server.setApplicationUri(applicationUri);
+		server.setProductUri(productUri);
+		server.setApplicationName(QOpcUaLocalizedText(applicationNameLocale, applicationNameText));
+		server.setApplicationType(static_cast<QOpcUaApplicationDescription::ApplicationType>(applicationType));
+		server.setDiscoveryUrls(discoveryUrls);
+
+		QOpcUaEndpointDescription endpoint;
+		endpoint.setEndpointUrl(endpointUrl);
+		endpoint.setSecurityPolicy(securityPolicy);
+		endpoint.setSecurityMode(static_cast<QOpcUaEndpointDescription::MessageSecurityMode>(securityMode));
+		endpoint.setSecurityLevel(securityLevel);
+		endpoint.setTransportProfileUri(transportProfileUri);
+		endpoint.setServerCertificate(serverCertificate);
+		endpoint.setServer(server);
+		endpoint.setUserIdentityTokens(tokens);
+		return endpoint;
+	}
+}
+
+MC_OpcUaSnapshotStore& MC_OpcUaSnapshotStore::instance()
+{
+	static MC_OpcUaSnapshotStore s_instance;
+	return s_instance;
+}
+
+MC_OpcUaSnapshotStore::MC_OpcUaSnapshotStore()
+{
+}
+
+QString MC_OpcUaSnapshotStore::getFilePath()
+{
+	QMutexLocker locker(&m_mutex);
+	return getFilePathLocked();
+}
+
+QString MC_OpcUaSnapshotStore::getFilePathLocked() const
+{
+	if (m_filePath.isEmpty())
+	{
+		return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath(u8"opcuaSnapshot.bin");
+	}
+	return m_filePath;
+}
+
+void MC_OpcUaSnapshotStore::setFilePath(const QString& _val)
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_filePath == _val)
+	{
+		return;
+	}
+	m_filePath = _val;
+	m_isLoaded = false;
+}
+
+bool MC_OpcUaSnapshotStore::getIsEnabled() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_isEnabled;
+}
+
+void MC_OpcUaSnapshotStore::setIsEnabled(bool _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_isEnabled = _val;
+}
+
+MM_MaybeOk MC_OpcUaSnapshotStore::load()
+{
+	QMutexLocker locker(&m_mutex);
+	return loadLocked();
+}
+
+MM_MaybeOk MC_OpcUaSnapshotStore::loadLocked()
+{
+	//读取失败也不再重复尝试,由运行中的连接重新生成快照
+	m_isLoaded = true;
+	auto filePath = getFilePathLocked();
+	if (!m_isAutoSaveConnected && QCoreApplication::instance())
+	{
+		m_isAutoSaveConnected = true;
+		QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, []()
+		{
+			MC_OpcUaSnapshotStore::instance().save();
+		});
+	}
+
+	QFile file(filePath);
+	if (!file.exists())
+	{
+		return MM_MaybeOk();
+	}
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return MM_MaybeOk(ME_Error(u8"Open snapshot file fail! " + file.errorString()));
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_12);
+
+	quint32 magic{};
+	quint16 version{};
+	quint32 count{};
+	stream >> magic >> version >> count;
+	if (magic != s_fileMagic || version != s_fileVersion)
+	{
+		return MM_MaybeOk(ME_Error(u8"Snapshot file format is not right!"));
+	}
+
+	std::map<QString, MS_OpcUaServerSnapshot> snapshots;
+	for (quint32 curIndex = 0; curIndex < count; ++curIndex)
+	{
+		MS_OpcUaServerSnapshot snapshot;
+		stream >> snapshot.m_serverUrl;
+		snapshot.m_endpoint = readEndpoint(stream);
+		stream >> snapshot.m_nameSpaceId >> snapshot.m_monitorKeyWords >> snapshot.m_savedDateTime;
+		if (stream.status() != QDataStream::Ok)
+		{
+			return MM_MaybeOk(ME_Error(u8"Snapshot file is broken!"));
+		}
+		snapshots[snapshot.m_serverUrl] = snapshot;
+	}
+
+	//本次运行中已更新的快照较文件中的新,保留
+	for (auto& var : snapshots)
+	{
+		m_snapshots.emplace(var.first, std::move(var.second));
+	}
+	return MM_MaybeOk();
+}
+
+MM_MaybeOk MC_OpcUaSnapshotStore::save()
+{
+	QMutexLocker locker(&m_mutex);
+	auto filePath = getFilePathLocked();
+	QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+	QSaveFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return MM_MaybeOk(ME_Error(u8"Open snapshot file fail! " + file.errorString()));
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_12);
+	stream << s_fileMagic << s_fileVersion << static_cast<quint32>(m_snapshots.size());
+	for (const auto& var : m_snapshots)
+	{
+		stream << var.second.m_serverUrl;
+		writeEndpoint(stream, var.second.m_endpoint);
+		stream << var.second.m_nameSpaceId << var.second.m_monitorKeyWords << var.second.m_savedDateTime;
+	}
+
+	if (!file.commit())
+	{
+		return MM_MaybeOk(ME_Error(u8"Write snapshot file fail! " + file.errorString()));
+	}
+	return MM_MaybeOk();
+}
+
+boost::optional<MS_OpcUaServerSnapshot> MC_OpcUaSnapshotStore::find(const QString& _serverUrl)
+{
+	QMutexLocker locker(&m_mutex);
+	if (!m_isEnabled)
+	{
+		return {};
+	}
+	if (!m_isLoaded)
+	{
+		loadLocked();
+	}
+	auto iter = m_snapshots.find(_serverUrl);
+	if (iter == m_snapshots.end())
+	{
+		return {};
+	}
+	return iter->second;
+}
+
+void MC_OpcUaSnapshotStore::update(const MS_OpcUaServerSnapshot& _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_snapshots[_val.m_serverUrl] = _val;
+}
+
+void MC_OpcUaSnapshotStore::remove(const QString& _serverUrl)
+{
+	QMutexLocker locker(&m_mutex);
+	m_snapshots.erase(_serverUrl);
+}
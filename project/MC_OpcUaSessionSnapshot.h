@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include <QtOpcUa>
+#include <QDateTime>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <boost/optional.hpp>
+#include <map>
+
+//单个服务器解析结果快照
+struct MS_OpcUaServerSnapshot
+{
+	//opc.tcp://ip:port
+	QString m_serverUrl;
+	//上次连接使用的端点
+	QOpcUaEndpointDescription m_endpoint;
+	//MI_Device::s_nameSpaceName 对应的命名空间索引
+	quint16 m_nameSpaceId{ 2 };
+	//已开启监控的字段
+	QStringList m_monitorKeyWords;
+	QDateTime m_savedDateTime;
+};
+
+/**
+ * 服务器快照存储
+ * 正常退出时保存各服务器的端点/命名空间索引/监控项,重启后据此直接连接端点,
+ * 省去FindServers/GetEndpoints及命名空间查找,快照内容在连接后再向服务器校验
+ * 首次查找时自动读取快照文件,也可在启动时显式调用load
+ */
+class MC_OpcUaSnapshotStore
+{
+public:
+	static MC_OpcUaSnapshotStore& instance();
+
+	QString getFilePath();
+	void setFilePath(const QString& _val);
+
+	bool getIsEnabled() const;
+	void setIsEnabled(bool _val);
+
+	//读取快照文件,并在程序退出时自动保存
+	MP_Public::MM_MaybeOk load();
+	MP_Public::MM_MaybeOk save();
+
+	boost::optional<MS_OpcUaServerSnapshot> find(const QString& _serverUrl);
+	void update(const MS_OpcUaServerSnapshot& _val);
+	void remove(const QString& _serverUrl);
+
+private:
+	MC_OpcUaSnapshotStore();
+	MC_OpcUaSnapshotStore(const MC_OpcUaSnapshotStore&) = delete;
+	MC_OpcUaSnapshotStore& operator=(const MC_OpcUaSnapshotStore&) = delete;
+
+	//须持有锁
+	QString getFilePathLocked() const;
+	MP_Public::MM_MaybeOk loadLocked();
+
+	static constexpr quint32 s_fileMagic = 0x4D4F5353;
+	static constexpr quint16 s_fileVersion = 1;
+
+	mutable QMutex m_mutex;
+	QString m_filePath;
+	bool m_isEnabled{ true };
+	bool m_isAutoSaveConnected{ false };
+	//是否已读取过快照文件,更换文件路径后重新读取
+	bool m_isLoaded{ false };
+	std::map<QString, MS_OpcUaServerSnapshot> m_snapshots;
+};
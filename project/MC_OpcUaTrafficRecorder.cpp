@@ -0,0 +1,111 @@
+#include "MC_OpcUaTrafficRecorder.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::MM_Maybe;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//文件头
+	constexpr quint32 s_fileMagic = 0x4F555452;
+	constexpr quint16 s_fileVersion = 1;
+	constexpr QDataStream::Version s_streamVersion = QDataStream::Qt_5_12;
+}
+
+MC_OpcUaTrafficRecorder::~MC_OpcUaTrafficRecorder()
+{
+	stop();
+}
+
+MM_MaybeOk MC_OpcUaTrafficRecorder::start(const QString& _filePath)
+{
+	stop();
+
+	QMutexLocker locker(&m_mutex);
+	QDir().mkpath(QFileInfo(_filePath).absolutePath());
+	std::unique_ptr<QFile> file(new QFile(_filePath));
+	if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		return MM_MaybeOk(ME_Error(u8"Open traffic record file fail! " + file->errorString()));
+	}
+	m_file = std::move(file);
+	m_stream.setDevice(m_file.get());
+	m_stream.setVersion(s_streamVersion);
+	m_stream << s_fileMagic << s_fileVersion;
+
+	m_recordCount = 0;
+	m_elapsedTimer.start();
+	m_isRecording = true;
+	return MM_MaybeOk();
+}
+
+void MC_OpcUaTrafficRecorder::stop()
+{
+	QMutexLocker locker(&m_mutex);
+	m_isRecording = false;
+	if (!m_file)
+	{
+		return;
+	}
+	m_stream.setDevice(nullptr);
+	m_file->close();
+	m_file.reset();
+}
+
+void MC_OpcUaTrafficRecorder::record(ME_OpcUaTrafficEventType _type, const QString& _nodeId, const QVariant& _val, quint32 _status)
+{
+	if (!isRecording())
+	{
+		return;
+	}
+
+	QMutexLocker locker(&m_mutex);
+	if (!m_file)
+	{
+		return;
+	}
+	m_stream << static_cast<quint8>(_type)
+		<< static_cast<qint64>(m_elapsedTimer.nsecsElapsed() / 1000)
+		<< _nodeId
+		<< _val
+		<< _status;
+	++m_recordCount;
+}
+
+MM_Maybe<std::vector<MS_OpcUaTrafficEvent>> MC_OpcUaTrafficRecorder::load(const QString& _filePath)
+{
+	QFile file(_filePath);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return MM_Maybe<std::vector<MS_OpcUaTrafficEvent>>(ME_Error(u8"Open traffic record file fail! " + file.errorString()));
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(s_streamVersion);
+	quint32 magic = 0;
+	quint16 version = 0;
+	stream >> magic >> version;
+	if (magic != s_fileMagic || version != s_fileVersion)
+	{
+		return MM_Maybe<std::vector<MS_OpcUaTrafficEvent>>(ME_Error(u8"Traffic record file format is not right!"));
+	}
+
+	std::vector<MS_OpcUaTrafficEvent> events;
+	while (!stream.atEnd())
+	{
+		quint8 type = 0;
+		MS_OpcUaTrafficEvent event;
+		stream >> type >> event.m_offsetUs >> event.m_nodeId >> event.m_value >> event.m_status;
+		//录制中途断电等造成的不完整记录直接丢弃
+		if (stream.status() != QDataStream::Ok)
+		{
+			break;
+		}
+		event.m_type = static_cast<ME_OpcUaTrafficEventType>(type);
+		events.emplace_back(std::move(event));
+	}
+	return MM_Maybe<std::vector<MS_OpcUaTrafficEvent>>(std::move(events));
+}
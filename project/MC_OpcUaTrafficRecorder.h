@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVariant>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//录制的事件类型
+enum class ME_OpcUaTrafficEventType : quint8
+{
+	//客户端连接状态,值为QOpcUaClient::ClientState
+	STATE_CHANGED,
+	//批量读请求/应答
+	READ_REQUEST,
+	READ_RESPONSE,
+	//批量写请求/应答
+	WRITE_REQUEST,
+	WRITE_RESPONSE,
+	//单节点读写应答(值为节点上的值)
+	NODE_READ,
+	NODE_WRITTEN,
+	//监控数据变化通知
+	DATA_CHANGE
+};
+
+//一条录制事件
+struct MS_OpcUaTrafficEvent
+{
+	ME_OpcUaTrafficEventType m_type{ ME_OpcUaTrafficEventType::STATE_CHANGED };
+	//相对录制开始的单调时间(微秒)
+	qint64 m_offsetUs{ 0 };
+	//节点ID字符串,如 ns=2;s=xxx
+	QString m_nodeId;
+	QVariant m_value;
+	quint32 m_status{ 0 };
+};
+
+/**
+ * OPC UA 收发录制
+ * 记录请求、应答及数据变化通知及其时间,顺序写入二进制文件(QDataStream),
+ * 用于离线复现现场时序问题,见MC_OpcUaTrafficReplayer
+ */
+class MC_OpcUaTrafficRecorder
+{
+public:
+	MC_OpcUaTrafficRecorder() = default;
+	~MC_OpcUaTrafficRecorder();
+
+	MP_Public::MM_MaybeOk start(const QString& _filePath);
+	void stop();
+	bool isRecording() const { return m_isRecording.load(std::memory_order_relaxed); }
+	quint64 getRecordCount() const { return m_recordCount.load(); }
+
+	void record(ME_OpcUaTrafficEventType _type, const QString& _nodeId, const QVariant& _val = QVariant(), quint32 _status = 0);
+
+	static MP_Public::MM_Maybe<std::vector<MS_OpcUaTrafficEvent>> load(const QString& _filePath);
+
+private:
+	MC_OpcUaTrafficRecorder(const MC_OpcUaTrafficRecorder&) = delete;
+	MC_OpcUaTrafficRecorder& operator=(const MC_OpcUaTrafficRecorder&) = delete;
+
+	QMutex m_mutex;
+	std::unique_ptr<QFile> m_file;
+	QDataStream m_stream;
+	QElapsedTimer m_elapsedTimer;
+	std::atomic_bool m_isRecording{ false };
+	std::atomic<quint64> m_recordCount{ 0 };
+};
@@ -0,0 +1,201 @@
+#include "MC_OpcUaTrafficReplayer.h"
+#include "MD_OpcUaSimulatorServer.h"
+#include <QTimer>
+#include <QtOpcUa>
+#include <algorithm>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//全部值回放完后等待客户端剩余写入的时间
+	constexpr int s_finishGraceMs = 1000;
+
+	bool isGoodStatus(quint32 _status)
+	{
+		return static_cast<QOpcUa::UaStatusCode>(_status) == QOpcUa::UaStatusCode::Good;
+	}
+}
+
+MC_OpcUaTrafficReplayer::MC_OpcUaTrafficReplayer(QObject *_parent)
+	: QObject(_parent),
+	m_timer(new QTimer(this))
+{
+	m_timer->setSingleShot(true);
+	m_timer->setTimerType(Qt::PreciseTimer);
+	QObject::connect(m_timer, &QTimer::timeout, this, [=]()
+	{
+		replayDue();
+	});
+}
+
+MC_OpcUaTrafficReplayer::~MC_OpcUaTrafficReplayer()
+{
+	stop();
+}
+
+MM_MaybeOk MC_OpcUaTrafficReplayer::load(const QString& _filePath)
+{
+	auto loadResult = MC_OpcUaTrafficRecorder::load(_filePath);
+	if (loadResult.getError())
+	{
+		return MM_MaybeOk(*loadResult.getError());
+	}
+	setEvents(loadResult());
+	return MM_MaybeOk();
+}
+
+void MC_OpcUaTrafficReplayer::setEvents(std::vector<MS_OpcUaTrafficEvent> _events)
+{
+	m_events = std::move(_events);
+	std::stable_sort(m_events.begin(), m_events.end(), [](const MS_OpcUaTrafficEvent& _left, const MS_OpcUaTrafficEvent& _right)
+	{
+		return _left.m_offsetUs < _right.m_offsetUs;
+	});
+}
+
+QString MC_OpcUaTrafficReplayer::fieldNameFromNodeId(const QString& _nodeId)
+{
+	quint16 nameSpaceId = 0;
+	QString identifier;
+	char identifierType = 0;
+	if (!QOpcUa::nodeIdStringSplit(_nodeId, &nameSpaceId, &identifier, &identifierType) || identifierType != 's')
+	{
+		return QString();
+	}
+	return identifier;
+}
+
+MM_MaybeOk MC_OpcUaTrafficReplayer::start()
+{
+	if (!m_simulator || !m_simulator->isRunning())
+	{
+		return MM_MaybeOk(ME_Error(u8"Replay simulator is not running!"));
+	}
+	stop();
+
+	m_report = MS_OpcUaReplayReport();
+	m_expectedWrites.clear();
+	for (const auto& var : m_events)
+	{
+		auto isClientWrite = var.m_type == ME_OpcUaTrafficEventType::WRITE_REQUEST
+			|| (var.m_type == ME_OpcUaTrafficEventType::NODE_WRITTEN && isGoodStatus(var.m_status));
+		auto fieldName = fieldNameFromNodeId(var.m_nodeId);
+		if (isClientWrite && !fieldName.isEmpty())
+		{
+			m_expectedWrites.push_back({ var.m_offsetUs, fieldName, var.m_value });
+		}
+	}
+	m_report.m_expectedWriteCount = static_cast<int>(m_expectedWrites.size());
+
+	//回放期间服务器侧的值只来自录制,屏蔽模拟行为
+	m_simulator->setWriteHook([](const QString&, const QVariant&)
+	{
+		return true;
+	});
+	m_writeConnection = QObject::connect(m_simulator, &MD_OpcUaSimulatorServer::sig_fieldWritten, this, [=](const QString& _fieldName, const QVariant& _val)
+	{
+		onClientWrite(_fieldName, _val);
+	});
+
+	m_nextIndex = 0;
+	m_isRunning = true;
+	m_elapsedTimer.start();
+	replayDue();
+	return MM_MaybeOk();
+}
+
+void MC_OpcUaTrafficReplayer::stop()
+{
+	m_timer->stop();
+	if (!m_isRunning)
+	{
+		return;
+	}
+	m_isRunning = false;
+	QObject::disconnect(m_writeConnection);
+	if (m_simulator)
+	{
+		m_simulator->setWriteHook(nullptr);
+	}
+}
+
+void MC_OpcUaTrafficReplayer::replayDue()
+{
+	if (!m_isRunning)
+	{
+		return;
+	}
+	if (m_nextIndex >= m_events.size())
+	{
+		finish();
+		return;
+	}
+
+	auto elapsedUs = m_elapsedTimer.nsecsElapsed() / 1000;
+	while (m_nextIndex < m_events.size())
+	{
+		const auto& event = m_events[m_nextIndex];
+		auto dueUs = m_speed > 0 ? static_cast<qint64>(event.m_offsetUs / m_speed) : 0;
+		if (dueUs > elapsedUs)
+		{
+			break;
+		}
+		++m_nextIndex;
+
+		auto isServerValue = event.m_type == ME_OpcUaTrafficEventType::DATA_CHANGE
+			|| ((event.m_type == ME_OpcUaTrafficEventType::NODE_READ || event.m_type == ME_OpcUaTrafficEventType::READ_RESPONSE)
+				&& isGoodStatus(event.m_status));
+		if (!isServerValue || !event.m_value.isValid())
+		{
+			continue;
+		}
+		auto fieldName = fieldNameFromNodeId(event.m_nodeId);
+		if (fieldName.isEmpty() || !m_simulator)
+		{
+			continue;
+		}
+		//值未变化时服务器不会产生通知,与现场一致
+		if (!m_simulator->setFieldValue(fieldName, event.m_value).hasError())
+		{
+			++m_report.m_replayedValueCount;
+		}
+	}
+
+	if (m_nextIndex >= m_events.size())
+	{
+		m_timer->start(s_finishGraceMs);
+		return;
+	}
+	auto nextDueUs = m_speed > 0 ? static_cast<qint64>(m_events[m_nextIndex].m_offsetUs / m_speed) : 0;
+	m_timer->start(static_cast<int>(qMax<qint64>(0, (nextDueUs - elapsedUs) / 1000)));
+}
+
+void MC_OpcUaTrafficReplayer::onClientWrite(const QString& _fieldName, const QVariant& _val)
+{
+	if (m_expectedWrites.empty())
+	{
+		++m_report.m_mismatchedWriteCount;
+		emit sig_writeDiverged(m_elapsedTimer.nsecsElapsed() / 1000, _fieldName, QVariant(), _val);
+		return;
+	}
+
+	auto expected = m_expectedWrites.front();
+	m_expectedWrites.pop_front();
+	if (expected.m_fieldName == _fieldName && expected.m_value == _val)
+	{
+		++m_report.m_matchedWriteCount;
+		return;
+	}
+	++m_report.m_mismatchedWriteCount;
+	emit sig_writeDiverged(expected.m_offsetUs, _fieldName, expected.m_value, _val);
+}
+
+void MC_OpcUaTrafficReplayer::finish()
+{
+	m_report.m_missingWriteCount = static_cast<int>(m_expectedWrites.size());
+	m_report.m_elapsedUs = m_elapsedTimer.nsecsElapsed() / 1000;
+	stop();
+	emit sig_finished(m_report);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "MC_OpcUaTrafficRecorder.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <deque>
+#include <vector>
+
+class MD_OpcUaSimulatorServer;
+class QTimer;
+
+//回放结果
+struct MS_OpcUaReplayReport
+{
+	//回放到服务器的值变化数
+	int m_replayedValueCount{ 0 };
+	//录制中客户端的写入数及与实际写入一致的次数
+	int m_expectedWriteCount{ 0 };
+	int m_matchedWriteCount{ 0 };
+	int m_mismatchedWriteCount{ 0 };
+	//回放结束时仍未出现的写入
+	int m_missingWriteCount{ 0 };
+	qint64 m_elapsedUs{ 0 };
+};
+
+/**
+ * OPC UA 收发回放
+ * 把MC_OpcUaTrafficRecorder录制的服务器侧值(数据变化、读应答)按原始时间间隔(可加速)
+ * 写入MD_OpcUaSimulatorServer,被测的MC_OpcUaClient连接该模拟服务器即按现场时序收到相同的值;
+ * 回放期间屏蔽模拟服务器的默认行为,并把客户端实际写入与录制中的写入按顺序比对
+ */
+class MC_OpcUaTrafficReplayer : public QObject
+{
+	Q_OBJECT
+
+public:
+	MC_OpcUaTrafficReplayer(QObject *_parent = nullptr);
+	~MC_OpcUaTrafficReplayer();
+
+	MP_Public::MM_MaybeOk load(const QString& _filePath);
+	void setEvents(std::vector<MS_OpcUaTrafficEvent> _events);
+
+	//回放速度倍数,1为原速,小于等于0为不等待
+	double getSpeed() const { return m_speed; }
+	void setSpeed(double _val) { m_speed = _val; }
+
+	void setSimulator(MD_OpcUaSimulatorServer* _val) { m_simulator = _val; }
+	bool isRunning() const { return m_isRunning; }
+	MS_OpcUaReplayReport getReport() const { return m_report; }
+
+signals:
+	//客户端写入与录制不一致
+	void sig_writeDiverged(qint64 _offsetUs, const QString& _fieldName, const QVariant& _expected, const QVariant& _actual);
+	void sig_finished(const MS_OpcUaReplayReport& _report);
+
+public slots:
+	MP_Public::MM_MaybeOk start();
+	void stop();
+
+private:
+	struct MS_ExpectedWrite
+	{
+		qint64 m_offsetUs{ 0 };
+		QString m_fieldName;
+		QVariant m_value;
+	};
+
+	static QString fieldNameFromNodeId(const QString& _nodeId);
+	void replayDue();
+	void onClientWrite(const QString& _fieldName, const QVariant& _val);
+	void finish();
+
+	std::vector<MS_OpcUaTrafficEvent> m_events;
+	std::size_t m_nextIndex{ 0 };
+	std::deque<MS_ExpectedWrite> m_expectedWrites;
+	QPointer<MD_OpcUaSimulatorServer> m_simulator;
+	QTimer* m_timer{};
+	QElapsedTimer m_elapsedTimer;
+	double m_speed{ 1.0 };
+	bool m_isRunning{ false };
+	QMetaObject::Connection m_writeConnection;
+	MS_OpcUaReplayReport m_report;
+};
@@ -0,0 +1,114 @@
+#include "MC_ReconnectScheduler.h"
+#include <QRandomGenerator>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+
+std::atomic<int> MC_ReconnectScheduler::s_reconnectingCount{ 0 };
+
+MC_ReconnectScheduler::MC_ReconnectScheduler(QObject *_parent)
+	: QObject(_parent),
+	m_retryTimer(new QTimer(this))
+{
+	m_retryTimer->setSingleShot(true);
+	QObject::connect(m_retryTimer, &QTimer::timeout, this, [=]()
+	{
+		onRetryTimeout();
+	});
+}
+
+MC_ReconnectScheduler::~MC_ReconnectScheduler()
+{
+	releaseSlot();
+}
+
+bool MC_ReconnectScheduler::isScheduled() const
+{
+	return m_retryTimer->isActive();
+}
+
+int MC_ReconnectScheduler::getNextDelayMs() const
+{
+	auto delay = m_policy.m_initialDelayMs * std::pow(std::max(1.0, m_policy.m_multiplier), m_attemptCount);
+	return static_cast<int>(std::min<double>(delay, m_policy.m_maxDelayMs));
+}
+
+void MC_ReconnectScheduler::scheduleRetry(bool _isTransient)
+{
+	//本次重连已结束,让出并发名额
+	releaseSlot();
+
+	if (m_retryTimer->isActive())
+	{
+		return;
+	}
+
+	auto delayMs = (_isTransient && m_attemptCount == 0) ? 0 : applyJitter(getNextDelayMs());
+	++m_attemptCount;
+	m_retryTimer->start(delayMs);
+}
+
+void MC_ReconnectScheduler::reset()
+{
+	m_retryTimer->stop();
+	m_attemptCount = 0;
+	releaseSlot();
+}
+
+void MC_ReconnectScheduler::cancel()
+{
+	reset();
+}
+
+void MC_ReconnectScheduler::onRetryTimeout()
+{
+	if (!tryAcquireSlot())
+	{
+		//其他设备正在重连,稍后再试,不计入退避次数
+		m_retryTimer->start(applyJitter(std::max(100, m_policy.m_initialDelayMs / 2)));
+		return;
+	}
+	emit sig_reconnect(m_attemptCount);
+}
+
+bool MC_ReconnectScheduler::tryAcquireSlot()
+{
+	if (m_isHoldingSlot)
+	{
+		return true;
+	}
+
+	auto curCount = s_reconnectingCount.load();
+	do
+	{
+		if (curCount >= std::max(1, m_policy.m_maxConcurrentReconnects))
+		{
+			return false;
+		}
+	} while (!s_reconnectingCount.compare_exchange_weak(curCount, curCount + 1));
+
+	m_isHoldingSlot = true;
+	return true;
+}
+
+void MC_ReconnectScheduler::releaseSlot()
+{
+	if (!m_isHoldingSlot)
+	{
+		return;
+	}
+	m_isHoldingSlot = false;
+	--s_reconnectingCount;
+}
+
+int MC_ReconnectScheduler::applyJitter(int _delayMs) const
+{
+	auto jitterRatio = std::min(1.0, std::max(0.0, m_policy.m_jitterRatio));
+	auto jitterRange = static_cast<int>(_delayMs * jitterRatio);
+	if (jitterRange <= 0)
+	{
+		return _delayMs;
+	}
+	auto offset = QRandomGenerator::global()->bounded(2 * jitterRange + 1) - jitterRange;
+	return std::max(0, _delayMs + offset);
+}
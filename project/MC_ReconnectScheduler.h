@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QObject>
+#include <atomic>
+
+class QTimer;
+
+//重连策略
+struct MS_ReconnectPolicy
+{
+	//首次重连延时
+	int m_initialDelayMs{ 500 };
+	//最大重连延时
+	int m_maxDelayMs{ 30000 };
+	//每次失败延时倍数
+	double m_multiplier{ 2.0 };
+	//随机抖动比例(0~1),避免多台设备同时重连
+	double m_jitterRatio{ 0.2 };
+	//进程内同时进行重连的设备数上限
+	int m_maxConcurrentReconnects{ 4 };
+	//单次连接超时,超时后中止连接并让出并发名额;0为不限
+	int m_connectTimeoutMs{ 10000 };
+};
+
+/**
+ * 重连调度
+ * 失败后按指数退避(带上限和抖动)安排下一次重连,已建立的连接断开时立即重连一次,
+ * 进程内所有调度共享并发上限,整线同时掉线时分批重连
+ */
+class MC_ReconnectScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	MC_ReconnectScheduler(QObject *_parent = nullptr);
+	~MC_ReconnectScheduler();
+
+	MS_ReconnectPolicy getPolicy() const { return m_policy; }
+	void setPolicy(const MS_ReconnectPolicy& _val) { m_policy = _val; }
+
+	int getAttemptCount() const { return m_attemptCount; }
+	bool isScheduled() const;
+
+	//下一次重连延时(不含抖动)
+	int getNextDelayMs() const;
+
+signals:
+	//到达重连时间,执行重连
+	void sig_reconnect(int _attemptCount);
+
+public slots:
+	//连接失败或断开后调用,_isTransient为真且是首次失败时立即重连
+	void scheduleRetry(bool _isTransient = false);
+	//连接成功后调用,清空退避状态
+	void reset();
+	//停止调度(用户主动断开)
+	void cancel();
+
+private:
+	void onRetryTimeout();
+	bool tryAcquireSlot();
+	void releaseSlot();
+	int applyJitter(int _delayMs) const;
+
+	static std::atomic<int> s_reconnectingCount;
+
+	MS_ReconnectPolicy m_policy;
+	QTimer* m_retryTimer{};
+	int m_attemptCount{ 0 };
+	bool m_isHoldingSlot{ false };
+};
@@ -0,0 +1,357 @@
+#include "MC_StationCycleAnalyzer.h"
+#include "MC_OpcUaMetrics.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const std::vector<double> s_quantiles{ 0.5, 0.95, 0.99 };
+
+	int phaseIndex(ME_StationCyclePhase _phase)
+	{
+		return static_cast<int>(_phase);
+	}
+}
+
+MC_RollingPercentileWindow::MC_RollingPercentileWindow(int _capacity)
+{
+	setCapacity(_capacity);
+}
+
+void MC_RollingPercentileWindow::push(qint64 _val)
+{
+	if (m_samples.empty())
+	{
+		return;
+	}
+	m_samples[m_nextIndex] = _val;
+	m_nextIndex = (m_nextIndex + 1) % static_cast<int>(m_samples.size());
+	m_size = std::min(m_size + 1, static_cast<int>(m_samples.size()));
+	++m_totalCount;
+	m_totalSum += _val;
+}
+
+void MC_RollingPercentileWindow::clear()
+{
+	m_nextIndex = 0;
+	m_size = 0;
+	m_totalCount = 0;
+	m_totalSum = 0;
+}
+
+void MC_RollingPercentileWindow::setCapacity(int _capacity)
+{
+	m_samples.assign(std::max(1, _capacity), 0);
+	m_nextIndex = 0;
+	m_size = 0;
+}
+
+std::vector<qint64> MC_RollingPercentileWindow::getPercentiles(const std::vector<double>& _quantiles) const
+{
+	std::vector<qint64> result(_quantiles.size(), 0);
+	if (m_size == 0)
+	{
+		return result;
+	}
+
+	std::vector<qint64> samples(m_samples.begin(), m_samples.begin() + m_size);
+	for (std::size_t curIndex = 0; curIndex < _quantiles.size(); ++curIndex)
+	{
+		auto quantile = std::min(1.0, std::max(0.0, _quantiles[curIndex]));
+		//nearest-rank
+		auto rank = static_cast<int>(std::ceil(quantile * m_size)) - 1;
+		rank = std::min(m_size - 1, std::max(0, rank));
+		std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+		result[curIndex] = samples[rank];
+	}
+	return result;
+}
+
+MC_StationCycleAnalyzer& MC_StationCycleAnalyzer::instance()
+{
+	static MC_StationCycleAnalyzer s_instance;
+	return s_instance;
+}
+
+MC_StationCycleAnalyzer::MC_StationCycleAnalyzer()
+	: QObject(nullptr)
+{
+	m_collectorId = MC_OpcUaMetricsRegistry::instance().addCollector([this]()
+	{
+		return toPrometheusText();
+	});
+}
+
+MC_StationCycleAnalyzer::~MC_StationCycleAnalyzer()
+{
+	MC_OpcUaMetricsRegistry::instance().removeCollector(m_collectorId);
+}
+
+QString MC_StationCycleAnalyzer::moveTypeToString(ME_StationMoveType _moveType)
+{
+	switch (_moveType)
+	{
+	case ME_StationMoveType::RECEIVE:
+		return u8"receive";
+	case ME_StationMoveType::SEND:
+		return u8"send";
+	case ME_StationMoveType::WAFER:
+		return u8"wafer";
+	default:
+		break;
+	}
+	return u8"unknown";
+}
+
+QString MC_StationCycleAnalyzer::intervalToString(ME_StationCycleInterval _interval)
+{
+	switch (_interval)
+	{
+	case ME_StationCycleInterval::READY_TO_PLAN:
+		return u8"ready_to_plan";
+	case ME_StationCycleInterval::PLAN_TO_COMMAND:
+		return u8"plan_to_command";
+	case ME_StationCycleInterval::COMMAND_TO_FINISH:
+		return u8"command_to_finish";
+	case ME_StationCycleInterval::TOTAL:
+		return u8"total";
+	default:
+		break;
+	}
+	return u8"unknown";
+}
+
+void MC_StationCycleAnalyzer::mark(const QString& _station, ME_StationMoveType _moveType, ME_StationCyclePhase _phase, qint64 _msecsSinceEpoch)
+{
+	if (_station.isEmpty())
+	{
+		return;
+	}
+	if (_msecsSinceEpoch < 0)
+	{
+		_msecsSinceEpoch = QDateTime::currentMSecsSinceEpoch();
+	}
+
+	auto isBottleneckChanged = false;
+	QString bottleneckStation;
+	qint64 bottleneckP95Ms = 0;
+	{
+		QMutexLocker locker(&m_mutex);
+		auto iter = m_cycles.find({ _station, _moveType });
+		if (iter == m_cycles.end())
+		{
+			iter = m_cycles.emplace(MT_StationKey{ _station, _moveType }, MS_StationCycle()).first;
+			for (auto& var : iter->second.m_windows)
+			{
+				var.setCapacity(m_windowSize);
+			}
+		}
+		auto& cycle = iter->second;
+		auto& phaseMsecs = cycle.m_phaseMsecs;
+
+		if (_phase == ME_StationCyclePhase::READY)
+		{
+			//上一次未完成即重新就绪
+			if (phaseMsecs[phaseIndex(ME_StationCyclePhase::READY)] >= 0)
+			{
+				++cycle.m_abandonedCount;
+			}
+			phaseMsecs.fill(-1);
+			phaseMsecs[phaseIndex(ME_StationCyclePhase::READY)] = _msecsSinceEpoch;
+			return;
+		}
+
+		//未记录就绪的阶段(如程序启动时正处于搬运中)忽略
+		if (phaseMsecs[phaseIndex(ME_StationCyclePhase::READY)] < 0)
+		{
+			return;
+		}
+
+		if (_phase != ME_StationCyclePhase::FINISHED)
+		{
+			if (phaseMsecs[phaseIndex(_phase)] < 0)
+			{
+				phaseMsecs[phaseIndex(_phase)] = _msecsSinceEpoch;
+			}
+			return;
+		}
+
+		auto readyMsecs = phaseMsecs[phaseIndex(ME_StationCyclePhase::READY)];
+		auto planMsecs = phaseMsecs[phaseIndex(ME_StationCyclePhase::PLANNED)];
+		auto commandMsecs = phaseMsecs[phaseIndex(ME_StationCyclePhase::COMMANDED)];
+		auto pushInterval = [&](ME_StationCycleInterval _interval, qint64 _begin, qint64 _end)
+		{
+			if (_begin >= 0 && _end >= _begin)
+			{
+				cycle.m_windows[static_cast<int>(_interval)].push(_end - _begin);
+			}
+		};
+		pushInterval(ME_StationCycleInterval::READY_TO_PLAN, readyMsecs, planMsecs);
+		pushInterval(ME_StationCycleInterval::PLAN_TO_COMMAND, planMsecs, commandMsecs);
+		pushInterval(ME_StationCycleInterval::COMMAND_TO_FINISH, commandMsecs, _msecsSinceEpoch);
+		pushInterval(ME_StationCycleInterval::TOTAL, readyMsecs, _msecsSinceEpoch);
+		++cycle.m_finishedCount;
+		phaseMsecs.fill(-1);
+
+		auto bottleneck = findBottleneck();
+		if (bottleneck.first != m_bottleneckStation)
+		{
+			m_bottleneckStation = bottleneck.first;
+			isBottleneckChanged = true;
+			bottleneckStation = bottleneck.first;
+			bottleneckP95Ms = bottleneck.second;
+		}
+	}
+
+	if (isBottleneckChanged)
+	{
+		emit sig_bottleneckChanged(bottleneckStation, bottleneckP95Ms);
+	}
+}
+
+void MC_StationCycleAnalyzer::setWindowSize(int _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_windowSize = std::max(1, _val);
+	for (auto& var : m_cycles)
+	{
+		for (auto& window : var.second.m_windows)
+		{
+			window.setCapacity(m_windowSize);
+		}
+	}
+}
+
+MS_StationCycleReport MC_StationCycleAnalyzer::makeReport(const MT_StationKey& _key, const MS_StationCycle& _cycle) const
+{
+	MS_StationCycleReport report;
+	report.m_station = _key.first;
+	report.m_moveType = _key.second;
+	report.m_finishedCount = _cycle.m_finishedCount;
+	report.m_abandonedCount = _cycle.m_abandonedCount;
+	for (auto curIndex = 0; curIndex < static_cast<int>(ME_StationCycleInterval::COUNT); ++curIndex)
+	{
+		const auto& window = _cycle.m_windows[curIndex];
+		auto percentiles = window.getPercentiles(s_quantiles);
+		auto& stats = report.m_intervals[curIndex];
+		stats.m_sampleCount = window.getSize();
+		stats.m_totalCount = window.getTotalCount();
+		stats.m_totalSumMs = window.getTotalSum();
+		stats.m_p50Ms = percentiles[0];
+		stats.m_p95Ms = percentiles[1];
+		stats.m_p99Ms = percentiles[2];
+	}
+	report.m_isBottleneck = !m_bottleneckStation.isEmpty() && report.m_station == m_bottleneckStation;
+	return report;
+}
+
+std::pair<QString, qint64> MC_StationCycleAnalyzer::findBottleneck() const
+{
+	//收送板中总节拍p95较大者作为该工位节拍
+	std::map<QString, qint64> stationP95Ms;
+	for (const auto& var : m_cycles)
+	{
+		const auto& window = var.second.m_windows[static_cast<int>(ME_StationCycleInterval::TOTAL)];
+		if (window.getSize() < m_minBottleneckSampleCount)
+		{
+			continue;
+		}
+		auto p95Ms = window.getPercentiles({ 0.95 }).front();
+		auto& stationVal = stationP95Ms[var.first.first];
+		stationVal = std::max(stationVal, p95Ms);
+	}
+
+	std::pair<QString, qint64> bottleneck{ QString(), 0 };
+	for (const auto& var : stationP95Ms)
+	{
+		if (bottleneck.first.isEmpty() || var.second > bottleneck.second)
+		{
+			bottleneck = var;
+		}
+	}
+	return bottleneck;
+}
+
+std::vector<MS_StationCycleReport> MC_StationCycleAnalyzer::getReports()
+{
+	QMutexLocker locker(&m_mutex);
+	std::vector<MS_StationCycleReport> reports;
+	reports.reserve(m_cycles.size());
+	for (const auto& var : m_cycles)
+	{
+		reports.emplace_back(makeReport(var.first, var.second));
+	}
+	return reports;
+}
+
+QString MC_StationCycleAnalyzer::getBottleneckStation()
+{
+	QMutexLocker locker(&m_mutex);
+	return m_bottleneckStation;
+}
+
+QString MC_StationCycleAnalyzer::toReportText()
+{
+	auto reports = getReports();
+	QString text;
+	QTextStream stream(&text);
+	for (const auto& var : reports)
+	{
+		stream << var.m_station << u8" " << moveTypeToString(var.m_moveType)
+			<< QString(u8" 完成%1次 中断%2次").arg(var.m_finishedCount).arg(var.m_abandonedCount)
+			<< (var.m_isBottleneck ? u8" [瓶颈]" : u8"") << u8"\n";
+		for (auto curIndex = 0; curIndex < static_cast<int>(ME_StationCycleInterval::COUNT); ++curIndex)
+		{
+			const auto& stats = var.m_intervals[curIndex];
+			stream << QString(u8"    %1: n=%2 p50=%3ms p95=%4ms p99=%5ms")
+				.arg(intervalToString(static_cast<ME_StationCycleInterval>(curIndex)), -18)
+				.arg(stats.m_sampleCount)
+				.arg(stats.m_p50Ms)
+				.arg(stats.m_p95Ms)
+				.arg(stats.m_p99Ms) << u8"\n";
+		}
+	}
+	stream.flush();
+	return text;
+}
+
+QString MC_StationCycleAnalyzer::toPrometheusText()
+{
+	auto reports = getReports();
+	QString text;
+	QTextStream stream(&text);
+	stream << u8"# TYPE station_cycle_seconds summary\n";
+	stream << u8"# TYPE station_cycle_finished_total counter\n";
+	stream << u8"# TYPE station_cycle_abandoned_total counter\n";
+	stream << u8"# TYPE station_cycle_bottleneck gauge\n";
+	for (const auto& var : reports)
+	{
+		auto labels = QString(u8"station=\"%1\",move=\"%2\"").arg(var.m_station).arg(moveTypeToString(var.m_moveType));
+		stream << u8"station_cycle_finished_total{" << labels << u8"} " << var.m_finishedCount << u8"\n";
+		stream << u8"station_cycle_abandoned_total{" << labels << u8"} " << var.m_abandonedCount << u8"\n";
+		stream << u8"station_cycle_bottleneck{" << labels << u8"} " << (var.m_isBottleneck ? 1 : 0) << u8"\n";
+		for (auto curIndex = 0; curIndex < static_cast<int>(ME_StationCycleInterval::COUNT); ++curIndex)
+		{
+			const auto& stats = var.m_intervals[curIndex];
+			auto intervalLabels = labels + QString(u8",interval=\"%1\"").arg(intervalToString(static_cast<ME_StationCycleInterval>(curIndex)));
+			stream << u8"station_cycle_seconds{" << intervalLabels << u8",quantile=\"0.5\"} " << QString::number(stats.m_p50Ms / 1e3) << u8"\n";
+			stream << u8"station_cycle_seconds{" << intervalLabels << u8",quantile=\"0.95\"} " << QString::number(stats.m_p95Ms / 1e3) << u8"\n";
+			stream << u8"station_cycle_seconds{" << intervalLabels << u8",quantile=\"0.99\"} " << QString::number(stats.m_p99Ms / 1e3) << u8"\n";
+			//分位数按滚动窗口,_sum/_count按累计值,保证单调递增
+			stream << u8"station_cycle_seconds_sum{" << intervalLabels << u8"} " << QString::number(stats.m_totalSumMs / 1e3) << u8"\n";
+			stream << u8"station_cycle_seconds_count{" << intervalLabels << u8"} " << stats.m_totalCount << u8"\n";
+		}
+	}
+	stream.flush();
+	return text;
+}
+
+void MC_StationCycleAnalyzer::reset()
+{
+	QMutexLocker locker(&m_mutex);
+	m_cycles.clear();
+	m_bottleneckStation.clear();
+}
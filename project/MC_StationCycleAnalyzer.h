@@ -0,0 +1,160 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <array>
+#include <map>
+#include <utility>
+#include <vector>
+
+//工位搬运类型
+enum class ME_StationMoveType
+{
+	RECEIVE,
+	SEND,
+	//点胶机收送晶圆,无单独就绪信号,以发起规划作为就绪
+	WAFER,
+	COUNT
+};
+
+//一次收送板的握手阶段
+enum class ME_StationCyclePhase
+{
+	READY,
+	PLANNED,
+	COMMANDED,
+	FINISHED
+};
+
+//统计的区间
+enum class ME_StationCycleInterval
+{
+	READY_TO_PLAN,
+	PLAN_TO_COMMAND,
+	COMMAND_TO_FINISH,
+	TOTAL,
+	COUNT
+};
+
+/**
+ * 固定容量的滚动窗口
+ * 只保留最近m_capacity个样本,内存固定,查询时复制后用nth_element求分位数
+ */
+class MC_RollingPercentileWindow
+{
+public:
+	explicit MC_RollingPercentileWindow(int _capacity = 256);
+
+	void push(qint64 _val);
+	void clear();
+	//修改容量会清空窗口内的样本,累计次数及总和保留
+	void setCapacity(int _capacity);
+
+	int getSize() const { return m_size; }
+	//自创建(或clear)以来的累计次数及总和,不随窗口滚动减少
+	quint64 getTotalCount() const { return m_totalCount; }
+	qint64 getTotalSum() const { return m_totalSum; }
+
+	//_quantiles 取 0~1,按顺序返回,无样本时返回0
+	std::vector<qint64> getPercentiles(const std::vector<double>& _quantiles) const;
+
+private:
+	std::vector<qint64> m_samples;
+	int m_nextIndex{ 0 };
+	int m_size{ 0 };
+	quint64 m_totalCount{ 0 };
+	qint64 m_totalSum{ 0 };
+};
+
+//单个区间的统计结果(毫秒)
+struct MS_StationCycleIntervalStats
+{
+	//窗口内的样本数,分位数按窗口计算
+	int m_sampleCount{ 0 };
+	//累计的样本数及耗时总和
+	quint64 m_totalCount{ 0 };
+	qint64 m_totalSumMs{ 0 };
+	qint64 m_p50Ms{ 0 };
+	qint64 m_p95Ms{ 0 };
+	qint64 m_p99Ms{ 0 };
+};
+
+//单个工位单种搬运的统计报告
+struct MS_StationCycleReport
+{
+	QString m_station;
+	ME_StationMoveType m_moveType{ ME_StationMoveType::RECEIVE };
+	//完成的搬运次数
+	quint64 m_finishedCount{ 0 };
+	//未完成即重新就绪的次数
+	quint64 m_abandonedCount{ 0 };
+	std::array<MS_StationCycleIntervalStats, static_cast<int>(ME_StationCycleInterval::COUNT)> m_intervals;
+	//该工位是否为当前瓶颈
+	bool m_isBottleneck{ false };
+};
+
+/**
+ * 工位节拍分析
+ * 各工位收送板时依次打点 就绪->规划->指令->完成,完成时计算各区间耗时放入滚动窗口,
+ * 按窗口求p50/p95/p99,总节拍p95最大的工位标记为瓶颈;结果同时并入Prometheus指标导出
+ */
+class MC_StationCycleAnalyzer : public QObject
+{
+	Q_OBJECT
+
+public:
+	static MC_StationCycleAnalyzer& instance();
+	~MC_StationCycleAnalyzer();
+
+	static QString moveTypeToString(ME_StationMoveType _moveType);
+	static QString intervalToString(ME_StationCycleInterval _interval);
+
+	//_msecsSinceEpoch 小于0时取当前时间
+	void mark(const QString& _station, ME_StationMoveType _moveType, ME_StationCyclePhase _phase, qint64 _msecsSinceEpoch = -1);
+
+	//每个区间保留的样本数
+	int getWindowSize() const { return m_windowSize; }
+	void setWindowSize(int _val);
+
+	//参与瓶颈判定所需的最少完成次数
+	int getMinBottleneckSampleCount() const { return m_minBottleneckSampleCount; }
+	void setMinBottleneckSampleCount(int _val) { m_minBottleneckSampleCount = _val; }
+
+	std::vector<MS_StationCycleReport> getReports();
+	//无足够样本时返回空
+	QString getBottleneckStation();
+	QString toReportText();
+	QString toPrometheusText();
+	void reset();
+
+signals:
+	void sig_bottleneckChanged(const QString& _station, qint64 _totalP95Ms);
+
+private:
+	MC_StationCycleAnalyzer();
+	MC_StationCycleAnalyzer(const MC_StationCycleAnalyzer&) = delete;
+	MC_StationCycleAnalyzer& operator=(const MC_StationCycleAnalyzer&) = delete;
+
+	struct MS_StationCycle
+	{
+		//当前进行中的搬运各阶段时间,-1 表示未到达
+		std::array<qint64, 4> m_phaseMsecs{ { -1, -1, -1, -1 } };
+		quint64 m_finishedCount{ 0 };
+		quint64 m_abandonedCount{ 0 };
+		std::array<MC_RollingPercentileWindow, static_cast<int>(ME_StationCycleInterval::COUNT)> m_windows;
+	};
+
+	using MT_StationKey = std::pair<QString, ME_StationMoveType>;
+
+	MS_StationCycleReport makeReport(const MT_StationKey& _key, const MS_StationCycle& _cycle) const;
+	//调用时须持有m_mutex,返回(工位, 总节拍p95)
+	std::pair<QString, qint64> findBottleneck() const;
+
+	QMutex m_mutex;
+	std::map<MT_StationKey, MS_StationCycle> m_cycles;
+	int m_windowSize{ 256 };
+	int m_minBottleneckSampleCount{ 5 };
+	QString m_bottleneckStation;
+	int m_collectorId{ 0 };
+};
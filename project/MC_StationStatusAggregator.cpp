@@ -0,0 +1,165 @@
+#include "MC_StationStatusAggregator.h"
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+
+namespace MS_StationStatusField
+{
+	const QString s_connectStateName = u8"connectState";
+	const QString s_executeOperateName = u8"executeOperate";
+	const QString s_deviceStateName = u8"deviceState";
+	const QString s_workAreaWorkStateName = u8"workAreaWorkState";
+	const QString s_workAreaIfHasWaferStateName = u8"workAreaIfHasWaferState";
+	const QString s_readyToReceiveSendWaferStateName = u8"readyToReceiveSendWaferState";
+	const QString s_initCommandExecuteStateName = u8"initCommandExecuteState";
+	const QString s_receiveSendCommandExecuteStateName = u8"receiveSendCommandExecuteState";
+}
+
+MC_StationStatusAggregator& MC_StationStatusAggregator::instance()
+{
+	static MC_StationStatusAggregator s_instance;
+	return s_instance;
+}
+
+MC_StationStatusAggregator::MC_StationStatusAggregator()
+	: QObject(nullptr),
+	m_publishTimer(new QTimer(this))
+{
+	qRegisterMetaType<MS_StationStatusFrame>();
+	m_publishTimer->setInterval(1000 / m_publishRateHz);
+	QObject::connect(m_publishTimer, &QTimer::timeout, this, [=]()
+	{
+		publishFrame();
+	});
+	//首次使用可能在控制线程,发布统一在主线程
+	if (QCoreApplication::instance() && thread() != QCoreApplication::instance()->thread())
+	{
+		moveToThread(QCoreApplication::instance()->thread());
+	}
+}
+
+MC_StationStatusAggregator::~MC_StationStatusAggregator()
+{
+}
+
+void MC_StationStatusAggregator::updateField(const QString& _station, const QString& _field, const QVariant& _val)
+{
+	QMutexLocker locker(&m_mutex);
+	++m_updateCount;
+	m_pendingFields[_station][_field] = _val;
+	markDirtyLocked();
+}
+
+void MC_StationStatusAggregator::schedulePublish(const QString& _station, const QString& _channel, QObject* _context, std::function<void()> _publish)
+{
+	QMutexLocker locker(&m_mutex);
+	++m_updateCount;
+	auto& pendingPublish = m_pendingPublishes[std::make_pair(_station, _channel)];
+	pendingPublish.m_context = _context;
+	pendingPublish.m_publish = std::move(_publish);
+	markDirtyLocked();
+}
+
+QHash<QString, QVariantMap> MC_StationStatusAggregator::getSnapshot() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_publishedFields;
+}
+
+int MC_StationStatusAggregator::getPublishRateHz() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_publishRateHz;
+}
+
+void MC_StationStatusAggregator::setPublishRateHz(int _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_publishRateHz = qBound(1, _val, 1000);
+	auto intervalMs = 1000 / m_publishRateHz;
+	QMetaObject::invokeMethod(this, [=]()
+	{
+		m_publishTimer->setInterval(intervalMs);
+	});
+}
+
+quint64 MC_StationStatusAggregator::getUpdateCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_updateCount;
+}
+
+quint64 MC_StationStatusAggregator::getPublishedFieldCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_publishedFieldCount;
+}
+
+void MC_StationStatusAggregator::markDirtyLocked()
+{
+	if (m_isDirty)
+	{
+		return;
+	}
+	m_isDirty = true;
+	QMetaObject::invokeMethod(this, [=]()
+	{
+		if (!m_publishTimer->isActive())
+		{
+			m_publishTimer->start();
+		}
+	});
+}
+
+void MC_StationStatusAggregator::publishFrame()
+{
+	MS_StationStatusFrame frame;
+	std::map<std::pair<QString, QString>, MS_PendingPublish> pendingPublishes;
+	{
+		QMutexLocker locker(&m_mutex);
+		if (!m_isDirty)
+		{
+			//上一帧后没有新的变化
+			m_publishTimer->stop();
+			return;
+		}
+		m_isDirty = false;
+
+		//只保留与已发布值不同的字段
+		for (auto stationIter = m_pendingFields.cbegin(); stationIter != m_pendingFields.cend(); ++stationIter)
+		{
+			auto& publishedFields = m_publishedFields[stationIter.key()];
+			for (auto fieldIter = stationIter.value().cbegin(); fieldIter != stationIter.value().cend(); ++fieldIter)
+			{
+				auto publishedIter = publishedFields.find(fieldIter.key());
+				if (publishedIter != publishedFields.end() && publishedIter.value() == fieldIter.value())
+				{
+					continue;
+				}
+				publishedFields[fieldIter.key()] = fieldIter.value();
+				frame.m_changedFields[stationIter.key()][fieldIter.key()] = fieldIter.value();
+				++m_publishedFieldCount;
+			}
+		}
+		m_pendingFields.clear();
+		pendingPublishes.swap(m_pendingPublishes);
+		if (!frame.m_changedFields.isEmpty())
+		{
+			frame.m_frameIndex = ++m_frameIndex;
+		}
+	}
+
+	if (!frame.m_changedFields.isEmpty())
+	{
+		emit sig_statusPublished(frame);
+	}
+	//_context可能属于其他线程,排队到其所在线程执行,执行前已销毁时Qt丢弃该调用
+	for (auto& var : pendingPublishes)
+	{
+		if (var.second.m_context)
+		{
+			QMetaObject::invokeMethod(var.second.m_context, std::move(var.second.m_publish), Qt::QueuedConnection);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include <functional>
+#include <map>
+#include <utility>
+
+class QTimer;
+
+//工位状态字段名
+namespace MS_StationStatusField
+{
+	extern const QString s_connectStateName;
+	extern const QString s_executeOperateName;
+	extern const QString s_deviceStateName;
+	extern const QString s_workAreaWorkStateName;
+	extern const QString s_workAreaIfHasWaferStateName;
+	extern const QString s_readyToReceiveSendWaferStateName;
+	extern const QString s_initCommandExecuteStateName;
+	extern const QString s_receiveSendCommandExecuteStateName;
+}
+
+//一帧内变化的字段,工位名 -> 字段名 -> 最新值
+struct MS_StationStatusFrame
+{
+	quint64 m_frameIndex{ 0 };
+	QHash<QString, QVariantMap> m_changedFields;
+};
+Q_DECLARE_METATYPE(MS_StationStatusFrame)
+
+/**
+ * 工位状态汇总,按固定帧率向界面发布
+ * 各工位在所在线程直接更新字段(只记录最新值,不跨线程投递),每帧只发布与上一帧不同的字段;
+ * 需要整份发布的状态(如主页设备信息)通过schedulePublish登记,每帧每个工位每个通道只执行最新登记的一次
+ * 无变化时定时器停止,不占用主线程
+ */
+class MC_StationStatusAggregator : public QObject
+{
+	Q_OBJECT
+
+public:
+	static MC_StationStatusAggregator& instance();
+	~MC_StationStatusAggregator();
+
+	//各线程均可调用
+	void updateField(const QString& _station, const QString& _field, const QVariant& _val);
+	//下一帧时把_publish排队到_context所在线程执行,同一工位同一通道在一帧内只保留最后一次;_context销毁后不再执行
+	void schedulePublish(const QString& _station, const QString& _channel, QObject* _context, std::function<void()> _publish);
+
+	//全部工位已发布的状态,界面初始化时使用
+	QHash<QString, QVariantMap> getSnapshot() const;
+
+	int getPublishRateHz() const;
+	void setPublishRateHz(int _val);
+
+	//累计收到的更新次数与发布的字段数,两者之比即合并倍数
+	quint64 getUpdateCount() const;
+	quint64 getPublishedFieldCount() const;
+
+signals:
+	void sig_statusPublished(const MS_StationStatusFrame& _frame);
+
+private:
+	MC_StationStatusAggregator();
+	MC_StationStatusAggregator(const MC_StationStatusAggregator&) = delete;
+	MC_StationStatusAggregator& operator=(const MC_StationStatusAggregator&) = delete;
+
+	//须持有锁
+	void markDirtyLocked();
+	void publishFrame();
+
+	struct MS_PendingPublish
+	{
+		QPointer<QObject> m_context;
+		std::function<void()> m_publish;
+	};
+
+	mutable QMutex m_mutex;
+	QHash<QString, QVariantMap> m_pendingFields;
+	QHash<QString, QVariantMap> m_publishedFields;
+	std::map<std::pair<QString, QString>, MS_PendingPublish> m_pendingPublishes;
+	bool m_isDirty{ false };
+	quint64 m_frameIndex{ 0 };
+	quint64 m_updateCount{ 0 };
+	quint64 m_publishedFieldCount{ 0 };
+	int m_publishRateHz{ 20 };
+	QTimer* m_publishTimer{};
+};
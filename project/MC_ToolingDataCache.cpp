@@ -0,0 +1,183 @@
+#include "MC_ToolingDataCache.h"
+#include "MC_OpcUaMetrics.h"
+#include <QMutexLocker>
+#include <QTextStream>
+
+MC_ToolingDataCache& MC_ToolingDataCache::instance()
+{
+	static MC_ToolingDataCache s_instance;
+	return s_instance;
+}
+
+MC_ToolingDataCache::MC_ToolingDataCache()
+{
+	m_clock.start();
+	m_collectorId = MC_OpcUaMetricsRegistry::instance().addCollector([this]()
+	{
+		return toPrometheusText();
+	});
+}
+
+MC_ToolingDataCache::~MC_ToolingDataCache()
+{
+	MC_OpcUaMetricsRegistry::instance().removeCollector(m_collectorId);
+}
+
+void MC_ToolingDataCache::put(quint16 _identifierType, const QByteArray& _identifier, const MR_WorkToolingData& _data, bool _isDataValid, bool _isDoAll)
+{
+	QMutexLocker locker(&m_mutex);
+	MT_Key key(_identifierType, _identifier);
+	auto iter = m_index.find(key);
+	if (iter != m_index.end())
+	{
+		eraseLocked(iter->second);
+	}
+
+	MS_Entry entry{ key, MS_CachedToolingData{ _data, _isDataValid, _isDoAll } };
+	entry.m_bytes = _identifier.size() + _data.m_data.size();
+	entry.m_expireMs = m_ttlMs > 0 ? m_clock.elapsed() + m_ttlMs : 0;
+	m_entries.push_front(std::move(entry));
+	m_index[key] = m_entries.begin();
+	m_totalBytes += m_entries.front().m_bytes;
+	evictLocked();
+}
+
+boost::optional<MS_CachedToolingData> MC_ToolingDataCache::find(quint16 _identifierType, const QByteArray& _identifier)
+{
+	QMutexLocker locker(&m_mutex);
+	auto iter = m_index.find(MT_Key(_identifierType, _identifier));
+	if (iter == m_index.end())
+	{
+		++m_missCount;
+		return boost::none;
+	}
+
+	auto entryIter = iter->second;
+	if (entryIter->m_expireMs > 0 && entryIter->m_expireMs <= m_clock.elapsed())
+	{
+		eraseLocked(entryIter);
+		++m_missCount;
+		return boost::none;
+	}
+
+	++m_hitCount;
+	m_entries.splice(m_entries.begin(), m_entries, entryIter);
+	return entryIter->m_value;
+}
+
+void MC_ToolingDataCache::remove(quint16 _identifierType, const QByteArray& _identifier)
+{
+	QMutexLocker locker(&m_mutex);
+	auto iter = m_index.find(MT_Key(_identifierType, _identifier));
+	if (iter != m_index.end())
+	{
+		eraseLocked(iter->second);
+	}
+}
+
+void MC_ToolingDataCache::clear()
+{
+	QMutexLocker locker(&m_mutex);
+	m_entries.clear();
+	m_index.clear();
+	m_totalBytes = 0;
+}
+
+int MC_ToolingDataCache::getMaxEntryCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_maxEntryCount;
+}
+
+void MC_ToolingDataCache::setMaxEntryCount(int _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_maxEntryCount = qMax(1, _val);
+	evictLocked();
+}
+
+qint64 MC_ToolingDataCache::getMaxTotalBytes() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_maxTotalBytes;
+}
+
+void MC_ToolingDataCache::setMaxTotalBytes(qint64 _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_maxTotalBytes = qMax<qint64>(1, _val);
+	evictLocked();
+}
+
+qint64 MC_ToolingDataCache::getTtlMs() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_ttlMs;
+}
+
+void MC_ToolingDataCache::setTtlMs(qint64 _val)
+{
+	QMutexLocker locker(&m_mutex);
+	m_ttlMs = qMax<qint64>(0, _val);
+}
+
+int MC_ToolingDataCache::getEntryCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return static_cast<int>(m_entries.size());
+}
+
+qint64 MC_ToolingDataCache::getTotalBytes() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_totalBytes;
+}
+
+quint64 MC_ToolingDataCache::getHitCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_hitCount;
+}
+
+quint64 MC_ToolingDataCache::getMissCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_missCount;
+}
+
+QString MC_ToolingDataCache::toPrometheusText() const
+{
+	QMutexLocker locker(&m_mutex);
+	QString text;
+	QTextStream stream(&text);
+	stream << u8"# TYPE tooling_data_cache_hits_total counter\n";
+	stream << u8"tooling_data_cache_hits_total " << m_hitCount << u8"\n";
+	stream << u8"# TYPE tooling_data_cache_misses_total counter\n";
+	stream << u8"tooling_data_cache_misses_total " << m_missCount << u8"\n";
+	stream << u8"# TYPE tooling_data_cache_evictions_total counter\n";
+	stream << u8"tooling_data_cache_evictions_total " << m_evictCount << u8"\n";
+	stream << u8"# TYPE tooling_data_cache_entries gauge\n";
+	stream << u8"tooling_data_cache_entries " << m_entries.size() << u8"\n";
+	stream << u8"# TYPE tooling_data_cache_bytes gauge\n";
+	stream << u8"tooling_data_cache_bytes " << m_totalBytes << u8"\n";
+	stream.flush();
+	return text;
+}
+
+void MC_ToolingDataCache::eraseLocked(std::list<MS_Entry>::iterator _iter)
+{
+	m_totalBytes -= _iter->m_bytes;
+	m_index.erase(_iter->m_key);
+	m_entries.erase(_iter);
+}
+
+void MC_ToolingDataCache::evictLocked()
+{
+	//最新放入的一条即使超过字节上限也保留
+	while (m_entries.size() > 1
+		&& (static_cast<int>(m_entries.size()) > m_maxEntryCount || m_totalBytes > m_maxTotalBytes))
+	{
+		eraseLocked(std::prev(m_entries.end()));
+		++m_evictCount;
+	}
+}
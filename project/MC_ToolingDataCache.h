@@ -0,0 +1,83 @@
+#pragma once
+
+#include "MR_WorkToolingData.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <list>
+#include <map>
+#include <boost/optional.hpp>
+#include <utility>
+
+//缓存的工装数据,即下发时onSendToolingData的参数
+struct MS_CachedToolingData
+{
+	MR_WorkToolingData m_data;
+	bool m_isDataValid{ true };
+	bool m_isDoAll{ false };
+};
+
+/**
+ * 工装数据缓存,按识别码类型+识别码索引,超过条数/字节上限时淘汰最久未用的,超过存活时间的视为失效
+ * 上位机在已知工装去向时预先放入(如工装离开上游工位),分控请求数据时命中即直接下发,不再等待上位机查找
+ * 各线程均可调用
+ */
+class MC_ToolingDataCache
+{
+public:
+	static MC_ToolingDataCache& instance();
+	~MC_ToolingDataCache();
+
+	void put(quint16 _identifierType, const QByteArray& _identifier, const MR_WorkToolingData& _data, bool _isDataValid = true, bool _isDoAll = false);
+	//命中时刷新其最近使用时间,不移除(同一工装可能在多个工位请求数据)
+	boost::optional<MS_CachedToolingData> find(quint16 _identifierType, const QByteArray& _identifier);
+	void remove(quint16 _identifierType, const QByteArray& _identifier);
+	void clear();
+
+	int getMaxEntryCount() const;
+	void setMaxEntryCount(int _val);
+	qint64 getMaxTotalBytes() const;
+	void setMaxTotalBytes(qint64 _val);
+	//存活时间,0 表示不过期
+	qint64 getTtlMs() const;
+	void setTtlMs(qint64 _val);
+
+	int getEntryCount() const;
+	qint64 getTotalBytes() const;
+	quint64 getHitCount() const;
+	quint64 getMissCount() const;
+
+	QString toPrometheusText() const;
+
+private:
+	MC_ToolingDataCache();
+	MC_ToolingDataCache(const MC_ToolingDataCache&) = delete;
+	MC_ToolingDataCache& operator=(const MC_ToolingDataCache&) = delete;
+
+	using MT_Key = std::pair<quint16, QByteArray>;
+	struct MS_Entry
+	{
+		MT_Key m_key;
+		MS_CachedToolingData m_value;
+		qint64 m_bytes{ 0 };
+		qint64 m_expireMs{ 0 };
+	};
+
+	void eraseLocked(std::list<MS_Entry>::iterator _iter);
+	void evictLocked();
+
+	mutable QMutex m_mutex;
+	//最近使用的在前
+	std::list<MS_Entry> m_entries;
+	std::map<MT_Key, std::list<MS_Entry>::iterator> m_index;
+	qint64 m_totalBytes{ 0 };
+	int m_maxEntryCount{ 256 };
+	qint64 m_maxTotalBytes{ 256LL * 1024 * 1024 };
+	qint64 m_ttlMs{ 10 * 60 * 1000 };
+	quint64 m_hitCount{ 0 };
+	quint64 m_missCount{ 0 };
+	quint64 m_evictCount{ 0 };
+	QElapsedTimer m_clock;
+	int m_collectorId{ -1 };
+};
@@ -0,0 +1,532 @@
+#include "MC_ToolingUploadJournal.h"
+#include "MA_Crc32c.h"
+#include <QtEndian>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//文件头: 魔数 版本 确认位置 确认序号
+	const quint32 s_fileMagic = 0x314A5554;
+	const quint32 s_fileVersion = 1;
+	const qint64 s_fileHeaderSize = 64;
+	//记录头: 魔数 载荷长度 CRC32C(序号及载荷) 保留 序号,记录按8字节对齐
+	const quint32 s_recordMagic = 0x52434554;
+	const qint64 s_recordHeaderSize = 24;
+	const qint64 s_initCapacity = 8 * 1024 * 1024;
+
+	qint64 alignRecordSize(qint64 _size)
+	{
+		return (_size + 7) & ~qint64(7);
+	}
+
+	qint64 payloadSize(const MS_ToolingUploadRecord& _record)
+	{
+		return sizeof(quint16) + sizeof(quint32) + _record.m_identifier.size() + sizeof(quint64) + sizeof(quint32) + _record.m_data.size();
+	}
+
+	template<typename T>
+	void putVal(uchar*& _pos, T _val)
+	{
+		qToLittleEndian(_val, _pos);
+		_pos += sizeof(T);
+	}
+
+	void putBytes(uchar*& _pos, const QByteArray& _val)
+	{
+		putVal<quint32>(_pos, static_cast<quint32>(_val.size()));
+		memcpy(_pos, _val.constData(), _val.size());
+		_pos += _val.size();
+	}
+
+	template<typename T>
+	bool getVal(const uchar*& _pos, const uchar* _end, T& _val)
+	{
+		if (_end - _pos < static_cast<qint64>(sizeof(T)))
+		{
+			return false;
+		}
+		_val = qFromLittleEndian<T>(_pos);
+		_pos += sizeof(T);
+		return true;
+	}
+
+	bool getBytes(const uchar*& _pos, const uchar* _end, QByteArray& _val)
+	{
+		quint32 size = 0;
+		if (!getVal(_pos, _end, size) || _end - _pos < static_cast<qint64>(size))
+		{
+			return false;
+		}
+		_val = QByteArray(reinterpret_cast<const char*>(_pos), static_cast<int>(size));
+		_pos += size;
+		return true;
+	}
+}
+
+MC_ToolingUploadJournal::MC_ToolingUploadJournal(QObject *_parent)
+	: QObject(_parent)
+{
+}
+
+MC_ToolingUploadJournal::~MC_ToolingUploadJournal()
+{
+	close();
+}
+
+MM_MaybeOk MC_ToolingUploadJournal::open(const QString& _filePath)
+{
+	if (isOpen())
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Upload journal is already open: %1").arg(m_file.fileName())));
+	}
+
+	m_file.setFileName(_filePath);
+	if (!m_file.open(QIODevice::ReadWrite))
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Fail to open upload journal %1: %2").arg(_filePath, m_file.errorString())));
+	}
+
+	auto isNewFile = m_file.size() < s_fileHeaderSize;
+	auto mapResult = mapFile(qMax(m_file.size(), s_initCapacity));
+	if (mapResult.hasError())
+	{
+		m_file.close();
+		return mapResult;
+	}
+
+	if (isNewFile)
+	{
+		m_consumedOffset = s_fileHeaderSize;
+		m_consumedSeq = 0;
+		writeHeader();
+		markDirty(0, s_fileHeaderSize, 0);
+	}
+	else
+	{
+		const uchar* pos = m_mapped;
+		const uchar* end = m_mapped + s_fileHeaderSize;
+		quint32 magic = 0;
+		quint32 version = 0;
+		quint64 consumedOffset = 0;
+		quint64 consumedSeq = 0;
+		getVal(pos, end, magic);
+		getVal(pos, end, version);
+		getVal(pos, end, consumedOffset);
+		getVal(pos, end, consumedSeq);
+		if (magic != s_fileMagic || version != s_fileVersion
+			|| consumedOffset < static_cast<quint64>(s_fileHeaderSize) || consumedOffset > static_cast<quint64>(m_capacity))
+		{
+			unmapFile();
+			m_file.close();
+			return MM_MaybeOk(ME_Error(QString(u8"%1 is not an upload journal!").arg(_filePath)));
+		}
+		m_consumedOffset = static_cast<qint64>(consumedOffset);
+		m_consumedSeq = consumedSeq;
+	}
+
+	recover();
+	m_isFlusherStopping = false;
+	m_flusherThread = std::thread([=]()
+	{
+		runFlusher();
+	});
+
+	//重启前未确认的记录
+	QMetaObject::invokeMethod(this, [=]()
+	{
+		deliverHead();
+	}, Qt::QueuedConnection);
+	return MM_MaybeOk();
+}
+
+void MC_ToolingUploadJournal::close()
+{
+	if (!isOpen())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> locker(m_dirtyMutex);
+		m_isFlusherStopping = true;
+	}
+	m_dirtyCondition.notify_all();
+	if (m_flusherThread.joinable())
+	{
+		m_flusherThread.join();
+	}
+
+	//刷盘线程退出前已刷完,这里再同步一次以得到未回调记录的确切结果
+	QString error;
+	auto result = syncRange(0, m_writeOffset, &error) ? MM_MaybeOk() : MM_MaybeOk(ME_Error(error));
+	auto pendingDurables = std::move(m_pendingDurables);
+	m_pendingDurables.clear();
+
+	unmapFile();
+	m_file.close();
+	m_writeOffset = 0;
+	m_nextSeq = 1;
+	m_consumedOffset = 0;
+	m_consumedSeq = 0;
+	m_durableSeq = 0;
+	m_isAwaitingAck = false;
+	m_dirtyBegin = -1;
+	m_dirtyEnd = -1;
+	m_dirtySeq = 0;
+	m_dirtyCount = 0;
+
+	for (const auto& var : pendingDurables)
+	{
+		var.m_onDurable(result);
+	}
+}
+
+void MC_ToolingUploadJournal::append(const MS_ToolingUploadRecord& _record, std::function<void(const MP_Public::MM_MaybeOk&)> _onDurable)
+{
+	if (!isOpen())
+	{
+		_onDurable(MM_MaybeOk(ME_Error(u8"Upload journal is not open!")));
+		return;
+	}
+
+	auto curPayloadSize = payloadSize(_record);
+	auto recordSize = alignRecordSize(s_recordHeaderSize + curPayloadSize);
+	auto capacityResult = ensureCapacity(recordSize);
+	if (capacityResult.hasError())
+	{
+		_onDurable(capacityResult);
+		return;
+	}
+
+	auto seq = m_nextSeq++;
+	auto offset = m_writeOffset;
+	auto recordBegin = m_mapped + offset;
+
+	//先写载荷,最后写记录头
+	auto pos = recordBegin + s_recordHeaderSize;
+	putVal<quint16>(pos, _record.m_identifierType);
+	putBytes(pos, _record.m_identifier);
+	putVal<quint64>(pos, _record.m_toolingIndex);
+	putBytes(pos, _record.m_data);
+
+	uchar seqBytes[sizeof(quint64)];
+	qToLittleEndian<quint64>(seq, seqBytes);
+	auto crc = MA_Crc32c::compute(seqBytes, sizeof(seqBytes));
+	crc = MA_Crc32c::compute(recordBegin + s_recordHeaderSize, curPayloadSize, crc);
+
+	pos = recordBegin;
+	putVal<quint32>(pos, s_recordMagic);
+	putVal<quint32>(pos, static_cast<quint32>(curPayloadSize));
+	putVal<quint32>(pos, crc);
+	putVal<quint32>(pos, 0);
+	putVal<quint64>(pos, seq);
+
+	m_writeOffset += recordSize;
+	m_pendingDurables.push_back(MS_PendingDurable{ seq, std::move(_onDurable) });
+	markDirty(offset, offset + recordSize, seq);
+}
+
+void MC_ToolingUploadJournal::acknowledgeHead()
+{
+	if (!isOpen() || !m_isAwaitingAck)
+	{
+		return;
+	}
+	m_isAwaitingAck = false;
+
+	qint64 recordSize = 0;
+	if (!readRecord(m_consumedOffset, m_consumedSeq + 1, nullptr, &recordSize))
+	{
+		return;
+	}
+	m_consumedOffset += recordSize;
+	++m_consumedSeq;
+	//全部确认后从头开始写,旧记录因序号不连续不会被再次读出
+	if (m_consumedOffset == m_writeOffset)
+	{
+		m_consumedOffset = s_fileHeaderSize;
+		m_writeOffset = s_fileHeaderSize;
+	}
+	writeHeader();
+	markDirty(0, s_fileHeaderSize, 0);
+	deliverHead();
+}
+
+MM_MaybeOk MC_ToolingUploadJournal::mapFile(qint64 _capacity)
+{
+	if (m_file.size() < _capacity && !m_file.resize(_capacity))
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Fail to resize upload journal to %1 bytes: %2").arg(_capacity).arg(m_file.errorString())));
+	}
+	m_mapped = m_file.map(0, _capacity);
+	if (!m_mapped)
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Fail to map upload journal: %1").arg(m_file.errorString())));
+	}
+	m_capacity = _capacity;
+	return MM_MaybeOk();
+}
+
+void MC_ToolingUploadJournal::unmapFile()
+{
+	if (m_mapped)
+	{
+		m_file.unmap(m_mapped);
+	}
+	m_mapped = nullptr;
+	m_capacity = 0;
+}
+
+MM_MaybeOk MC_ToolingUploadJournal::ensureCapacity(qint64 _size)
+{
+	if (m_writeOffset + _size <= m_capacity)
+	{
+		return MM_MaybeOk();
+	}
+
+	auto capacity = m_capacity;
+	while (m_writeOffset + _size > capacity)
+	{
+		capacity *= 2;
+	}
+
+	//扩容期间刷盘线程不能访问映射
+	QWriteLocker locker(&m_mapLock);
+	auto oldCapacity = m_capacity;
+	unmapFile();
+	auto result = mapFile(capacity);
+	if (result.hasError())
+	{
+		//保持原有映射可用
+		mapFile(oldCapacity);
+	}
+	return result;
+}
+
+void MC_ToolingUploadJournal::recover()
+{
+	auto offset = m_consumedOffset;
+	auto seq = m_consumedSeq + 1;
+	qint64 recordSize = 0;
+	while (readRecord(offset, seq, nullptr, &recordSize))
+	{
+		offset += recordSize;
+		++seq;
+	}
+	m_writeOffset = offset;
+	m_nextSeq = seq;
+	m_durableSeq = seq - 1;
+}
+
+bool MC_ToolingUploadJournal::readRecord(qint64 _offset, quint64 _expectedSeq, MS_ToolingUploadRecord* _record, qint64* _recordSize) const
+{
+	if (_offset + s_recordHeaderSize > m_capacity)
+	{
+		return false;
+	}
+
+	const uchar* pos = m_mapped + _offset;
+	const uchar* headerEnd = pos + s_recordHeaderSize;
+	quint32 magic = 0;
+	quint32 curPayloadSize = 0;
+	quint32 crc = 0;
+	quint32 reserved = 0;
+	quint64 seq = 0;
+	getVal(pos, headerEnd, magic);
+	getVal(pos, headerEnd, curPayloadSize);
+	getVal(pos, headerEnd, crc);
+	getVal(pos, headerEnd, reserved);
+	getVal(pos, headerEnd, seq);
+	if (magic != s_recordMagic || seq != _expectedSeq || _offset + s_recordHeaderSize + curPayloadSize > m_capacity)
+	{
+		return false;
+	}
+
+	auto curCrc = MA_Crc32c::compute(headerEnd - sizeof(quint64), sizeof(quint64));
+	curCrc = MA_Crc32c::compute(headerEnd, curPayloadSize, curCrc);
+	if (curCrc != crc)
+	{
+		return false;
+	}
+
+	if (_record)
+	{
+		const uchar* end = headerEnd + curPayloadSize;
+		_record->m_seq = seq;
+		if (!getVal(pos, end, _record->m_identifierType)
+			|| !getBytes(pos, end, _record->m_identifier)
+			|| !getVal(pos, end, _record->m_toolingIndex)
+			|| !getBytes(pos, end, _record->m_data))
+		{
+			return false;
+		}
+	}
+	*_recordSize = alignRecordSize(s_recordHeaderSize + curPayloadSize);
+	return true;
+}
+
+void MC_ToolingUploadJournal::writeHeader()
+{
+	auto pos = m_mapped;
+	putVal<quint32>(pos, s_fileMagic);
+	putVal<quint32>(pos, s_fileVersion);
+	putVal<quint64>(pos, static_cast<quint64>(m_consumedOffset));
+	putVal<quint64>(pos, m_consumedSeq);
+}
+
+void MC_ToolingUploadJournal::markDirty(qint64 _begin, qint64 _end, quint64 _seq)
+{
+	{
+		std::lock_guard<std::mutex> locker(m_dirtyMutex);
+		m_dirtyBegin = m_dirtyBegin < 0 ? _begin : qMin(m_dirtyBegin, _begin);
+		m_dirtyEnd = qMax(m_dirtyEnd, _end);
+		m_dirtySeq = qMax(m_dirtySeq, _seq);
+		++m_dirtyCount;
+	}
+	m_dirtyCondition.notify_one();
+}
+
+bool MC_ToolingUploadJournal::syncRange(qint64 _begin, qint64 _end, QString* _error)
+{
+	_end = qMin(_end, m_capacity);
+	if (_begin < 0 || _end <= _begin || !m_mapped)
+	{
+		return true;
+	}
+
+#ifdef Q_OS_WIN
+	if (!FlushViewOfFile(m_mapped + _begin, static_cast<SIZE_T>(_end - _begin)))
+	{
+		*_error = QString(u8"FlushViewOfFile fail: %1").arg(GetLastError());
+		return false;
+	}
+	auto fileHandle = reinterpret_cast<HANDLE>(_get_osfhandle(m_file.handle()));
+	if (!FlushFileBuffers(fileHandle))
+	{
+		*_error = QString(u8"FlushFileBuffers fail: %1").arg(GetLastError());
+		return false;
+	}
+#else
+	static const qint64 s_pageSize = sysconf(_SC_PAGESIZE);
+	auto alignedBegin = _begin / s_pageSize * s_pageSize;
+	if (msync(m_mapped + alignedBegin, static_cast<size_t>(_end - alignedBegin), MS_SYNC) != 0)
+	{
+		*_error = QString(u8"msync fail: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+		return false;
+	}
+#endif
+	return true;
+}
+
+void MC_ToolingUploadJournal::runFlusher()
+{
+	std::unique_lock<std::mutex> locker(m_dirtyMutex);
+	while (true)
+	{
+		m_dirtyCondition.wait(locker, [=]()
+		{
+			return m_isFlusherStopping || m_dirtyCount > 0;
+		});
+		if (m_dirtyCount == 0)
+		{
+			break;
+		}
+
+		//凑批:等到间隔到期或条数足够
+		if (!m_isFlusherStopping && m_dirtyCount < m_syncBatchCount.load())
+		{
+			m_dirtyCondition.wait_for(locker, std::chrono::milliseconds(m_syncIntervalMs.load()), [=]()
+			{
+				return m_isFlusherStopping || m_dirtyCount >= m_syncBatchCount.load();
+			});
+		}
+
+		auto begin = m_dirtyBegin;
+		auto end = m_dirtyEnd;
+		auto seq = m_dirtySeq;
+		m_dirtyBegin = -1;
+		m_dirtyEnd = -1;
+		m_dirtyCount = 0;
+		locker.unlock();
+
+		QString error;
+		bool isSynced = false;
+		{
+			QReadLocker mapLocker(&m_mapLock);
+			isSynced = syncRange(begin, end, &error);
+		}
+		QMetaObject::invokeMethod(this, [=]()
+		{
+			onSyncFinished(seq, error);
+		}, Qt::QueuedConnection);
+
+		locker.lock();
+		//刷盘失败的范围并回未刷范围,间隔后随下一批重试;停止时由close统一再刷一次
+		if (!isSynced && !m_isFlusherStopping)
+		{
+			m_dirtyBegin = m_dirtyBegin < 0 ? begin : qMin(m_dirtyBegin, begin);
+			m_dirtyEnd = qMax(m_dirtyEnd, end);
+			m_dirtySeq = qMax(m_dirtySeq, seq);
+			++m_dirtyCount;
+			m_dirtyCondition.wait_for(locker, std::chrono::milliseconds(qMax(10, m_syncIntervalMs.load())), [=]()
+			{
+				return m_isFlusherStopping;
+			});
+		}
+	}
+}
+
+void MC_ToolingUploadJournal::onSyncFinished(quint64 _seq, const QString& _error)
+{
+	if (!isOpen())
+	{
+		return;
+	}
+
+	//刷盘失败的范围由刷盘线程重试,覆盖它的一批成功前不交付也不回调追加方,
+	//避免追加方按失败重追加后同一条记录交付两次
+	if (!_error.isEmpty())
+	{
+		emit sig_syncFailed(_error);
+		return;
+	}
+	m_durableSeq = qMax(m_durableSeq, _seq);
+
+	while (!m_pendingDurables.empty() && m_pendingDurables.front().m_seq <= _seq)
+	{
+		auto pendingDurable = std::move(m_pendingDurables.front());
+		m_pendingDurables.pop_front();
+		pendingDurable.m_onDurable(MM_MaybeOk());
+	}
+	deliverHead();
+}
+
+void MC_ToolingUploadJournal::deliverHead()
+{
+	if (!isOpen() || m_isAwaitingAck || m_consumedSeq >= m_durableSeq)
+	{
+		return;
+	}
+
+	MS_ToolingUploadRecord record;
+	qint64 recordSize = 0;
+	if (!readRecord(m_consumedOffset, m_consumedSeq + 1, &record, &recordSize))
+	{
+		return;
+	}
+	m_isAwaitingAck = true;
+	emit sig_recordReady(record);
+}
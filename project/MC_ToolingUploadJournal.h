@@ -0,0 +1,113 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include <QFile>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//一条上传的工装数据
+struct MS_ToolingUploadRecord
+{
+	quint64 m_seq{ 0 };
+	quint16 m_identifierType{ 0 };
+	QByteArray m_identifier;
+	quint64 m_toolingIndex{ 0 };
+	QByteArray m_data;
+};
+
+/**
+ * 上传工装数据的预写日志
+ * 记录追加到内存映射的文件末尾,后台线程按批(间隔或条数)刷盘,落盘后回调追加方,此时即可释放分控;
+ * 刷盘失败时通过sig_syncFailed通知并保留未刷范围重试,成功前不回调追加方(关闭时以最后一次刷盘结果回调);
+ * 已落盘的记录按顺序逐条通过sig_recordReady交给消费方,消费方处理完调用acknowledgeHead后再交付下一条
+ * 进程重启后open会校验记录(CRC32C及序号)并从未确认的记录继续交付,尾部写了一半的记录被丢弃;
+ * 确认位置随下一批一起刷盘,崩溃时最后确认的记录可能重复交付一次
+ * 除刷盘外均在所属线程中调用
+ */
+class MC_ToolingUploadJournal : public QObject
+{
+	Q_OBJECT
+
+public:
+	MC_ToolingUploadJournal(QObject *_parent = nullptr);
+	~MC_ToolingUploadJournal();
+
+	MP_Public::MM_MaybeOk open(const QString& _filePath);
+	//刷完未落盘的记录后关闭,未落盘回调在此时给出结果
+	void close();
+	bool isOpen() const { return m_mapped != nullptr; }
+	QString getFilePath() const { return m_file.fileName(); }
+
+	//追加一条记录(m_seq由日志分配),落盘后调用_onDurable
+	void append(const MS_ToolingUploadRecord& _record, std::function<void(const MP_Public::MM_MaybeOk&)> _onDurable);
+	//消费方已处理完最近交付的记录
+	void acknowledgeHead();
+
+	//尚未确认的记录数
+	quint64 getPendingCount() const { return m_nextSeq - 1 - m_consumedSeq; }
+
+	//刷盘批次:距首条未刷记录超过该时间或未刷条数达到批量时刷盘
+	int getSyncIntervalMs() const { return m_syncIntervalMs.load(); }
+	void setSyncIntervalMs(int _val) { m_syncIntervalMs = qMax(0, _val); }
+	int getSyncBatchCount() const { return m_syncBatchCount.load(); }
+	void setSyncBatchCount(int _val) { m_syncBatchCount = qMax(1, _val); }
+
+signals:
+	void sig_recordReady(const MS_ToolingUploadRecord& _record);
+	void sig_syncFailed(const QString& _error);
+
+private:
+	struct MS_PendingDurable
+	{
+		quint64 m_seq{ 0 };
+		std::function<void(const MP_Public::MM_MaybeOk&)> m_onDurable;
+	};
+
+	MP_Public::MM_MaybeOk mapFile(qint64 _capacity);
+	void unmapFile();
+	MP_Public::MM_MaybeOk ensureCapacity(qint64 _size);
+	void recover();
+	bool readRecord(qint64 _offset, quint64 _expectedSeq, MS_ToolingUploadRecord* _record, qint64* _recordSize) const;
+	void writeHeader();
+	void markDirty(qint64 _begin, qint64 _end, quint64 _seq);
+	//同步刷盘[_begin,_end),须持有映射的共享锁
+	bool syncRange(qint64 _begin, qint64 _end, QString* _error);
+	void runFlusher();
+	void onSyncFinished(quint64 _seq, const QString& _error);
+	void deliverHead();
+
+	QFile m_file;
+	uchar* m_mapped{};
+	qint64 m_capacity{ 0 };
+	//刷盘线程读映射时持共享锁,扩容重映射时持独占锁
+	mutable QReadWriteLock m_mapLock;
+
+	//以下只在所属线程中访问
+	qint64 m_writeOffset{ 0 };
+	quint64 m_nextSeq{ 1 };
+	qint64 m_consumedOffset{ 0 };
+	quint64 m_consumedSeq{ 0 };
+	quint64 m_durableSeq{ 0 };
+	bool m_isAwaitingAck{ false };
+	std::deque<MS_PendingDurable> m_pendingDurables;
+
+	//与刷盘线程共享,由m_dirtyMutex保护
+	std::mutex m_dirtyMutex;
+	std::condition_variable m_dirtyCondition;
+	qint64 m_dirtyBegin{ -1 };
+	qint64 m_dirtyEnd{ -1 };
+	quint64 m_dirtySeq{ 0 };
+	int m_dirtyCount{ 0 };
+	bool m_isFlusherStopping{ false };
+	std::thread m_flusherThread;
+
+	std::atomic_int m_syncIntervalMs{ 5 };
+	std::atomic_int m_syncBatchCount{ 32 };
+};
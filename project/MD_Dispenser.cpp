@@ -3,6 +3,10 @@
 #include "MT_Transition.h"
 #include "MA_ThreadAuxiliary.h"
 #include "ML_GlobalLog.h"
+#include "ML_TraceRecorder.h"
+#include "MC_EventLoopLagMonitor.h"
+#include "MC_AlarmNotifier.h"
+#include "MC_StationStatusAggregator.h"
 #include <QFinalState>
 #include <QTimer>
 #include <QThread>
@@ -21,18 +25,47 @@ MD_Dispenser::MD_Dispenser(const QString& _name, QObject* _parent /*= nullptr*/)
 	m_pollingPlanResultTimer(new QTimer(this)),
 	m_pollingExecuteCommandTimer(new QTimer(this)),
 	m_pollingInitCommandFinishTimer(new QTimer(this)),
-	m_controlThread(new QThread()),
-	m_pollingConnectSuccessTimer(new QTimer(this))
+	m_controlThread(new QThread())
 {
 	auto object = Auxiliary::syncStartThread(m_controlThread.get());
 	Auxiliary::blockSyncExecute(object.get(), [=]() {
 		m_control = std::make_shared<MC_OpcDeviceControl>(_name);
+		MC_EventLoopLagMonitor::instance().watchCurrentThread(u8"control:" + _name);
 	});
 
 	QObject::connect(getControl(), &ML_LogBase::sig_log, this, [=](const auto& _name, ML_LogLabel _label, const QString& _logInfo) {
 		log(_label, _logInfo);
 	});
 
+	//状态变化在控制线程直接记入汇总,由汇总按帧率发布给界面
+	auto updateStatusField = [=](const QString& _field, const QVariant& _val) {
+		MC_StationStatusAggregator::instance().updateField(m_name, _field, _val);
+	};
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_connectStateChanged, getControl(), [=](MS_ConnectState _val) {
+		updateStatusField(MS_StationStatusField::s_connectStateName, static_cast<int>(_val));
+	}, Qt::DirectConnection);
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_deviceStateChanged, getControl(), [=](quint16 _val) {
+		updateStatusField(MS_StationStatusField::s_deviceStateName, _val);
+	}, Qt::DirectConnection);
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_deviceWorkAreaWorkStateChanged, getControl(), [=](quint16 _val) {
+		updateStatusField(MS_StationStatusField::s_workAreaWorkStateName, _val);
+	}, Qt::DirectConnection);
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_deviceWorkAreaIfHasWaferStateChanged, getControl(), [=](quint16 _val) {
+		updateStatusField(MS_StationStatusField::s_workAreaIfHasWaferStateName, _val);
+	}, Qt::DirectConnection);
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_readyToReceiveSendWaferStateChanged, getControl(), [=](qint16 _val) {
+		updateStatusField(MS_StationStatusField::s_readyToReceiveSendWaferStateName, _val);
+	}, Qt::DirectConnection);
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_initCommnandExecuteStateChanged, getControl(), [=](quint16 _val) {
+		updateStatusField(MS_StationStatusField::s_initCommandExecuteStateName, _val);
+	}, Qt::DirectConnection);
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_receiveAndSendCommandExecuteStateChanged, getControl(), [=](quint16 _val) {
+		updateStatusField(MS_StationStatusField::s_receiveSendCommandExecuteStateName, _val);
+	}, Qt::DirectConnection);
+	QObject::connect(this, &MD_Dispenser::sig_executeOperateStateChanged, this, [=](const QString& _val) {
+		updateStatusField(MS_StationStatusField::s_executeOperateName, _val);
+	}, Qt::DirectConnection);
+
 	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_connectStateChanged, this, [=](auto _result) {
 		if (_result == MS_ConnectState::CONNECTED) {
 			emit sig_deviceConnected(MP_Public::MM_MaybeOk());
@@ -85,14 +118,10 @@ MD_Dispenser::MD_Dispenser(const QString& _name, QObject* _parent /*= nullptr*/)
 		}
 	});
 
-	m_pollingConnectSuccessTimer->callOnTimeout(this, [=]() {
-		auto control{ getControl() };
-		Q_ASSERT(control);
-		if (control->getConnectState() == MS_ConnectState::CONNECTED) {
-			m_pollingConnectSuccessTimer->stop();
-			emit sig_tryConnectedSuccess();
-			emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"重新连接设备成功...");
-		}
+	//连接建立由客户端发出边沿信号,不再轮询连接状态
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_connectionEstablished, this, [=]() {
+		emit sig_tryConnectedSuccess();
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"连接设备成功...");
 	});
 
 	initRunMachine();
@@ -384,9 +413,36 @@ void MD_Dispenser::unlockForTransportWafer()
 	});
 }
 
+void MD_Dispenser::prepareToPutInOrTakeOutWafer(bool _isToTakeOutWafer)
+{
+	if (!m_isSpeculativePlan) {
+		return;
+	}
+	//设备未就绪时不预规划,仍按原流程在确认时规划
+	auto isReady = _isToTakeOutWafer ? checkIfReadyTakeOut() : checkIfReadyToPutIn();
+	if (!isReady) {
+		return;
+	}
+	QTimer::singleShot(0, this, [=]() {
+		m_speculativeIsToTakeOutWafer = _isToTakeOutWafer;
+		emit sig_goSpeculativePlanning();
+	});
+}
+
+void MD_Dispenser::cancelPrepareToPutInOrTakeOutWafer()
+{
+	QTimer::singleShot(0, this, [=]() {
+		emit sig_abortSpeculativePlanning();
+	});
+}
+
 void MD_Dispenser::updateDevicesInformationInHomePage(MN_PC100::MI_DeviceInteractionStatus & _var)
 {
-	emit sig_updateDevicesInformationInHomePage(_var);
+	//每帧只发布最新的一份,频繁更新时不再逐次复制跨线程投递
+	auto status = _var;
+	MC_StationStatusAggregator::instance().schedulePublish(m_name, u8"homePage", this, [=]() {
+		emit this->sig_updateDevicesInformationInHomePage(status);
+	});
 }
 
 QHostAddress MD_Dispenser::getHostAddress() const
@@ -399,6 +455,12 @@ quint16 MD_Dispenser::getPort() const
 	return getParam().m_port;
 }
 
+std::shared_ptr<MC_OpcUaClient> MD_Dispenser::getOpcUaClient() const
+{
+	Q_ASSERT(getControl());
+	return getControl()->getClient();
+}
+
 void MD_Dispenser::writeLogFileForParam(const QString & _var)
 {
 	emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, _var);
@@ -410,10 +472,31 @@ void MD_Dispenser::log(ML_LogLabel _label, const QString& _logInfo)
 	emit this->sig_logInfo(_label, _logInfo);
 }
 
+void MD_Dispenser::traceState(QAbstractState* _state, const char* _step)
+{
+	auto span = std::make_shared<ML_TraceSpan>();
+	QObject::connect(_state, &QAbstractState::entered, this, [=]() {
+		*span = ML_TraceRecorder::instance().beginSpan(getName(), "state", _step, m_traceTransferId);
+	});
+	QObject::connect(_state, &QAbstractState::exited, this, [=]() {
+		ML_TraceRecorder::instance().endSpan(*span);
+		*span = ML_TraceSpan();
+	});
+}
+
 void MD_Dispenser::initRunMachine()
 {
 	auto curMachine = m_runMachine;
 
+	//预规划的下发结果不随状态连接:撤销或接管时结果可能已在途,按预规划进度统一接收后再转发
+	QObject::connect(getControl(), &MC_OpcDeviceControl::sig_startExecutePlanReceiveSendWaferResult, this, [=](const MP_Public::MM_MaybeOk& _result) {
+		if (m_speculativePlanPhase != ME_SpeculativePlanPhase::DISPATCHING) {
+			return;
+		}
+		m_speculativePlanPhase = _result.hasError() ? ME_SpeculativePlanPhase::NONE : ME_SpeculativePlanPhase::DISPATCHED;
+		emit sig_speculativePlanDispatched(_result);
+	});
+
 	auto topState = new QState();
 
 
@@ -431,28 +514,43 @@ void MD_Dispenser::initRunMachine()
 	auto waitToExecuteState = new QState(m_executePutInOrTakeOutWaferTopState);
 	QObject::connect(waitToExecuteState, &QState::entered, this, [=]() {
 		m_isToTakeOutWafer = {};
+		m_speculativePlanPhase = ME_SpeculativePlanPhase::NONE;
 		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"等待执行...");
 	});
 
 	//规划
 	auto planState = new QState(m_executePutInOrTakeOutWaferTopState);
 	QObject::connect(planState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"开始规划...");
 		auto object = new QObject();
 		setStateOnExitAction(curMachine, planState, [=]() {
 			getControl()->disconnect(object);
+			this->disconnect(object);
 			object->deleteLater();
 
 			m_pollingPlanResultTimer->stop();
 		});
-		QObject::connect(getControl(), &MC_OpcDeviceControl::sig_startExecutePlanReceiveSendWaferResult, object, [=](const auto& _result) {
+		auto onPlanDispatched = [=](const MP_Public::MM_MaybeOk& _result) {
 			if (_result.hasError()) {
 				emit sig_errorInfo({ u8"Start execute plan fail!" });
 				emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"规划失败...");
 				return;
 			}
+			ML_TraceRecorder::instance().instant(getName(), "state", "planDispatched", m_traceTransferId);
 			m_pollingPlanResultTimer->start(300);
-		});
+		};
+		//接管尚未得到应答的预规划,不重复下发;仍在下发中的等下发结束再开始轮询
+		if (m_speculativePlanPhase != ME_SpeculativePlanPhase::NONE) {
+			emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"接管预规划...");
+			if (m_speculativePlanPhase == ME_SpeculativePlanPhase::DISPATCHED) {
+				m_pollingPlanResultTimer->start(300);
+			}
+			else {
+				QObject::connect(this, &MD_Dispenser::sig_speculativePlanDispatched, object, onPlanDispatched);
+			}
+			return;
+		}
+		QObject::connect(getControl(), &MC_OpcDeviceControl::sig_startExecutePlanReceiveSendWaferResult, object, onPlanDispatched);
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"开始规划...");
 		QMetaObject::invokeMethod(getControl(), [=]() {
 			getControl()->planReceiveSendWafer();
 		});
@@ -460,12 +558,102 @@ void MD_Dispenser::initRunMachine()
 
 	QObject::connect(planState, &QState::exited, this, [=]() {
 		executeStateOnExitAction(curMachine, planState);
+		m_speculativePlanPhase = ME_SpeculativePlanPhase::NONE;
+	});
+
+	//预规划:机械手确定前往本工位时提前下发规划,与机械手移动重叠
+	auto speculativePlanState = new QState(m_executePutInOrTakeOutWaferTopState);
+	QObject::connect(speculativePlanState, &QState::entered, this, [=]() {
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"开始预规划...");
+		m_isToTakeOutWafer = m_speculativeIsToTakeOutWafer;
+		m_speculativePlanPhase = ME_SpeculativePlanPhase::DISPATCHING;
+		auto object = new QObject();
+		setStateOnExitAction(curMachine, speculativePlanState, [=]() {
+			getControl()->disconnect(object);
+			this->disconnect(object);
+			object->deleteLater();
+
+			m_pollingPlanResultTimer->stop();
+		});
+		QObject::connect(this, &MD_Dispenser::sig_speculativePlanDispatched, object, [=](const MP_Public::MM_MaybeOk& _result) {
+			//预规划失败不影响工位,回到等待执行,确认取放时按原流程规划
+			if (_result.hasError()) {
+				emit sig_logInfo(ML_LogLabel::WARNING_LABEL, u8"预规划失败,回到等待执行 : " + _result.getError()->getMessage());
+				postSignalEvent(curMachine, this, &MD_Dispenser::sig_speculativePlanFailed);
+				return;
+			}
+			ML_TraceRecorder::instance().instant(getName(), "state", "planDispatched", m_traceTransferId);
+			m_pollingPlanResultTimer->start(300);
+		});
+		QMetaObject::invokeMethod(getControl(), [=]() {
+			getControl()->planReceiveSendWafer();
+		});
+	});
+
+	QObject::connect(speculativePlanState, &QState::exited, this, [=]() {
+		executeStateOnExitAction(curMachine, speculativePlanState);
+	});
+
+	//预规划已允许,等待确认取放
+	auto speculativePlannedState = new QState(m_executePutInOrTakeOutWaferTopState);
+	QObject::connect(speculativePlannedState, &QState::entered, this, [=]() {
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"预规划完成,等待确认取放...");
+	});
+
+	//撤销预规划,下发中时等下发结束再撤销,避免撤销后又被置为规划中
+	auto cancelSpeculativePlanState = new QState(m_executePutInOrTakeOutWaferTopState);
+	QObject::connect(cancelSpeculativePlanState, &QState::entered, this, [=]() {
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"撤销预规划...");
+		auto object = new QObject();
+		setStateOnExitAction(curMachine, cancelSpeculativePlanState, [=]() {
+			getControl()->disconnect(object);
+			this->disconnect(object);
+			object->deleteLater();
+		});
+		//撤销中收到确认取放,撤销完成后再重新规划,避免新的规划被撤销覆盖
+		auto isReplanRequested = std::make_shared<bool>(false);
+		QObject::connect(this, &MD_Dispenser::sig_goStartPlanning, object, [=]() {
+			emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"撤销预规划完成后重新规划...");
+			*isReplanRequested = true;
+		});
+		auto cancelPlan = [=]() {
+			QObject::connect(getControl(), &MC_OpcDeviceControl::sig_cancelPlanReceiveSendWaferResult, object, [=](const auto& _result) {
+				m_speculativePlanPhase = ME_SpeculativePlanPhase::NONE;
+				//撤销失败时设备规划字段状态不明,转入故障状态,复位后回到等待执行
+				if (_result.hasError()) {
+					emit sig_logInfo(ML_LogLabel::ERROR_LABEL, u8"撤销预规划失败 : " + _result.getError()->getMessage());
+					emit sig_errorInfo(*_result.getError());
+					return;
+				}
+				//直接转入规划,不经等待执行,以免清掉确认取放已置的取放方向
+				if (*isReplanRequested) {
+					postSignalEvent(curMachine, this, &MD_Dispenser::sig_speculativePlanCanceledToReplan);
+					return;
+				}
+				postSignalEvent(curMachine, this, &MD_Dispenser::sig_speculativePlanCanceled);
+			});
+			QMetaObject::invokeMethod(getControl(), [=]() {
+				getControl()->cancelPlanReceviceSendWafer();
+			});
+		};
+		if (m_speculativePlanPhase == ME_SpeculativePlanPhase::DISPATCHING) {
+			QObject::connect(this, &MD_Dispenser::sig_speculativePlanDispatched, object, [=]() {
+				cancelPlan();
+			});
+			return;
+		}
+		cancelPlan();
+	});
+
+	QObject::connect(cancelSpeculativePlanState, &QState::exited, this, [=]() {
+		executeStateOnExitAction(curMachine, cancelSpeculativePlanState);
 	});
 
 	//等待执行指令
 	auto waitExecuteCommandState = new QState(m_executePutInOrTakeOutWaferTopState);
 	QObject::connect(waitExecuteCommandState, &QState::entered, this, [=]() {
 		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"等待执行指令...");
+		m_speculativePlanPhase = ME_SpeculativePlanPhase::NONE;
 		setStateOnExitAction(curMachine, waitExecuteCommandState, [=]() {
 			m_pollingExecuteCommandTimer->stop();
 		});
@@ -476,10 +664,11 @@ void MD_Dispenser::initRunMachine()
 		executeStateOnExitAction(curMachine, waitExecuteCommandState);
 	});
 
-	//置锁定状态
+	//锁定设备并置执行中状态
 	auto setLockedState = new QState(m_executePutInOrTakeOutWaferTopState);
 	QObject::connect(setLockedState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"锁定设备");
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"锁定设备并置执行中状态...");
+		//服务器不保证一次请求内各项的处理顺序,锁定写入成功后再置执行中,写入回调已在控制线程,直接续写
 		QMetaObject::invokeMethod(getControl(), [=]() {
 			getControl()->writeSingleVal(
 				MI_Device::s_deviceBeLockedName,
@@ -488,24 +677,15 @@ void MD_Dispenser::initRunMachine()
 				[=](const MP_Public::ME_Error& _error) {
 				emit this->sig_errorInfo(_error); },
 				[=]() {
-					postSignalEvent(curMachine, this, &MD_Dispenser::sig_lockDeviceSuccess);
-				});
-		});
-	});
-
-	//开始执行收送wafer
-	auto startExecuteReceiveAndSendWaferState = new QState(topState);
-	QObject::connect(startExecuteReceiveAndSendWaferState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"置执行中状态...");
-		QMetaObject::invokeMethod(getControl(), [=]() {
-			getControl()->writeSingleVal(
-				MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
-				MS_ExecuteState::EXECUTING,
-				QOpcUa::Types::UInt16,
-				[=](const MP_Public::ME_Error& _error) {
-				emit this->sig_errorInfo(_error); },
-				[=]() {
-					postSignalEvent(curMachine, this, &MD_Dispenser::sig_goWaitExecuteFinished);
+					getControl()->writeSingleVal(
+						MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
+						MS_ExecuteState::EXECUTING,
+						QOpcUa::Types::UInt16,
+						[=](const MP_Public::ME_Error& _error) {
+						emit this->sig_errorInfo(_error); },
+						[=]() {
+							postSignalEvent(curMachine, this, &MD_Dispenser::sig_lockDeviceSuccess);
+						});
 				});
 		});
 	});
@@ -536,59 +716,40 @@ void MD_Dispenser::initRunMachine()
 	});
 
 
-	//置解除锁定状态
+	//解除锁定并置执行完成状态
 	auto setUnLockedState = new QState(topState);
 	QObject::connect(setUnLockedState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"解除锁定");
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"解除锁定并置执行完成状态...");
+		//解除锁定与重置指令互不依赖,一次写入;执行完成须在二者之后,单独写入
 		QMetaObject::invokeMethod(getControl(), [=]() {
-			getControl()->writeSingleVal(
-				MI_Device::s_deviceBeLockedName,
-				MS_DeviceBeLockedState::Not_Be_Locked,
-				QOpcUa::Types::UInt16,
-				[=](const MP_Public::ME_Error& _error) {
-				emit this->sig_errorInfo(_error); },
-				[=]() {
-					postSignalEvent(curMachine, this, &MD_Dispenser::sig_unlockDeviceSuccess);
-				});
-		});
-	});
-
-
-	auto onAfterExecuteFinshedState = new QState(topState);
-	QObject::connect(onAfterExecuteFinshedState, &QState::entered, this, [=]() {
-		QMetaObject::invokeMethod(getControl(), [=]() {
-			emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"置执行完成状态...");
-			getControl()->writeSingleVal(
-				MI_Device::s_deviceReceivceSendWaferCommandKeyName,
-				MI_SendCommand::NOT_EXECUTE,
-				QOpcUa::Types::UInt16,
+			getControl()->writeMultiVals({
+				{ MI_Device::s_deviceBeLockedName, { QOpcUa::Types::UInt16, MS_DeviceBeLockedState::Not_Be_Locked } },
+				{ MI_Device::s_deviceReceivceSendWaferCommandKeyName, { QOpcUa::Types::UInt16, MI_SendCommand::NOT_EXECUTE } } },
 				[=](const MP_Public::ME_Error& _error) {
 				emit this->sig_errorInfo(_error); },
 				[=]() {
-					QMetaObject::invokeMethod(getControl(), [=]() {
-						getControl()->writeSingleVal(
-							MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
-							MS_ExecuteState::FINIHED,
-							QOpcUa::Types::UInt16,
-							[=](const MP_Public::ME_Error& _error) {
-							emit this->sig_errorInfo(_error); },
-							[=]() {
-								QMetaObject::invokeMethod(this, [=]() {
-									if (m_isToTakeOutWafer.has_value()) {
-										if (m_isToTakeOutWafer.value()) {
-											emit sig_finishExecuteAferTakeOutWafer();
-											emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行送wafer完成！");
-										}
-										else {
-											emit sig_finishExecuteAferPutInWafer();
-											emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行收wafer完成!");
-										}
+					getControl()->writeSingleVal(
+						MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
+						MS_ExecuteState::FINIHED,
+						QOpcUa::Types::UInt16,
+						[=](const MP_Public::ME_Error& _error) {
+						emit this->sig_errorInfo(_error); },
+						[=]() {
+							QMetaObject::invokeMethod(this, [=]() {
+								if (m_isToTakeOutWafer.has_value()) {
+									if (m_isToTakeOutWafer.value()) {
+										emit sig_finishExecuteAferTakeOutWafer();
+										emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行送wafer完成！");
 									}
+									else {
+										emit sig_finishExecuteAferPutInWafer();
+										emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行收wafer完成!");
+									}
+								}
 
-									postSignalEvent(curMachine, this, &MD_Dispenser::sig_completeExecuteSuccess);
-								});
+								postSignalEvent(curMachine, this, &MD_Dispenser::sig_completeExecuteSuccess);
 							});
-					});
+						});
 				});
 		});
 	});
@@ -611,7 +772,8 @@ void MD_Dispenser::initRunMachine()
 	QObject::connect(errorState, &QState::entered, this, [=]() {
 		emit sig_logInfo(ML_LogLabel::ERROR_LABEL, QString(u8"点胶工位进入故障状态！"));
 		setCurrentDeviceIsErrorStatus(true);
-		MA_Auxiliary::promptMessageBox(QMessageBox::Warning, u8"警告", QString(u8"%1点胶工位进入故障状态").arg(this->getName()));
+		//只入队,不在控制线程弹出模态框
+		MC_AlarmNotifier::instance().post(ME_AlarmLevel::WARNING_LEVEL, this->getName(), u8"警告", QString(u8"%1点胶工位进入故障状态").arg(this->getName()));
 	});
 
 	//重连设备
@@ -620,19 +782,17 @@ void MD_Dispenser::initRunMachine()
 		auto control{ getControl() };
 		Q_ASSERT(control);
 		setCurrentDeviceIsErrorStatus(false);
-		if (control->getConnectState() == MS_ConnectState::CONNECTED) {
+		//连接建立的边沿信号可能在进入本状态前已发出(自动重连),进入时按建立标记重新检查;
+		//标记在发出边沿信号前置位,此处未置位则边沿信号必在进入后到达
+		if (control->getClient()->isConnectionEstablished()) {
 			//emit sig_noNeedTryConnect();
-			emit sig_tryConnectedSuccess();
+			postSignalEvent(curMachine, this, &MD_Dispenser::sig_tryConnectedSuccess);
 			return;
 		}
-	
-		m_pollingConnectSuccessTimer->start(1000);
+
 		tryConnectDevice();
 		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"重新连接设备...");
 	});
-	QObject::connect(tryConnectDeviceState, &QState::exited, this, [=]() {
-		m_pollingConnectSuccessTimer->stop();
-	});
 
 
 	//初始化复位
@@ -680,7 +840,27 @@ void MD_Dispenser::initRunMachine()
 		}
 	});
 
-	
+	//耗时追踪,每次规划开始分配新的收送片追踪ID,接管的预规划沿用预规划时分配的
+	QObject::connect(planState, &QState::entered, this, [=]() {
+		if (m_speculativePlanPhase == ME_SpeculativePlanPhase::NONE) {
+			m_traceTransferId = ML_TraceRecorder::instance().nextRequestId();
+		}
+	});
+	QObject::connect(speculativePlanState, &QState::entered, this, [=]() {
+		m_traceTransferId = ML_TraceRecorder::instance().nextRequestId();
+	});
+	traceState(waitToExecuteState, "waitToExecute");
+	traceState(planState, "plan");
+	traceState(speculativePlanState, "speculativePlan");
+	traceState(speculativePlannedState, "speculativePlanned");
+	traceState(cancelSpeculativePlanState, "cancelSpeculativePlan");
+	traceState(waitExecuteCommandState, "waitExecuteCommand");
+	traceState(setLockedState, "setLocked");
+	traceState(waitExeuteFinishedState, "waitExecuteFinished");
+	traceState(setUnLockedState, "setUnLocked");
+	traceState(errorState, "error");
+	traceState(tryConnectDeviceState, "tryConnectDevice");
+	traceState(resetDeviceState, "resetDevice");
 
 	topState->addTransition(this, &MD_Dispenser::sig_errorInfo, errorState);
 	topState->addTransition(this, &MD_Dispenser::sig_deviceDisconnected, errorState);
@@ -696,17 +876,27 @@ void MD_Dispenser::initRunMachine()
 	m_executePutInOrTakeOutWaferTopState->setInitialState(waitToExecuteState);
 
 	waitToExecuteState->addTransition(this, &MD_Dispenser::sig_goStartPlanning, planState);
+	waitToExecuteState->addTransition(this, &MD_Dispenser::sig_goSpeculativePlanning, speculativePlanState);
+
+	//确认取放时预规划未应答则转入规划状态接管,已允许则直接等待执行指令
+	speculativePlanState->addTransition(this, &MD_Dispenser::sig_goStartPlanning, planState);
+	speculativePlanState->addTransition(this, &MD_Dispenser::sig_allowPlaned, speculativePlannedState);
+	speculativePlanState->addTransition(this, &MD_Dispenser::sig_notAllowPlaned, cancelSpeculativePlanState);
+	speculativePlanState->addTransition(this, &MD_Dispenser::sig_abortSpeculativePlanning, cancelSpeculativePlanState);
+	speculativePlanState->addTransition(this, &MD_Dispenser::sig_speculativePlanFailed, waitToExecuteState);
+	speculativePlannedState->addTransition(this, &MD_Dispenser::sig_goStartPlanning, waitExecuteCommandState);
+	speculativePlannedState->addTransition(this, &MD_Dispenser::sig_abortSpeculativePlanning, cancelSpeculativePlanState);
+	cancelSpeculativePlanState->addTransition(this, &MD_Dispenser::sig_speculativePlanCanceled, waitToExecuteState);
+	//撤销中收到确认取放时,撤销完成后按原流程规划
+	cancelSpeculativePlanState->addTransition(this, &MD_Dispenser::sig_speculativePlanCanceledToReplan, planState);
 
 	planState->addTransition(this, &MD_Dispenser::sig_allowPlaned, waitExecuteCommandState);
 	planState->addTransition(this, &MD_Dispenser::sig_notAllowPlaned, failState);
 
 	waitExecuteCommandState->addTransition(this, &MD_Dispenser::sig_requiredExecuteReceiveAndSendWafer,setLockedState );
-	setLockedState->addTransition(this, &MD_Dispenser::sig_lockDeviceSuccess, startExecuteReceiveAndSendWaferState);
-	
-	startExecuteReceiveAndSendWaferState->addTransition(this, &MD_Dispenser::sig_goWaitExecuteFinished, waitExeuteFinishedState);
+	setLockedState->addTransition(this, &MD_Dispenser::sig_lockDeviceSuccess, waitExeuteFinishedState);
 	waitExeuteFinishedState->addTransition(this, &MD_Dispenser::sig_receiveAndSendWaferSuccessFinish, setUnLockedState);
-	setUnLockedState->addTransition(this, &MD_Dispenser::sig_unlockDeviceSuccess, onAfterExecuteFinshedState);
-	onAfterExecuteFinshedState->addTransition(this, &MD_Dispenser::sig_completeExecuteSuccess, m_executePutInOrTakeOutWaferTopState);
+	setUnLockedState->addTransition(this, &MD_Dispenser::sig_completeExecuteSuccess, m_executePutInOrTakeOutWaferTopState);
 
 
 	failState->addTransition(finalState);
@@ -783,10 +973,11 @@ void MD_Dispenser::initRunMachineInManual() {
 		executeStateOnExitAction(curMachine, waitExecuteCommandState);
 	});
 
-	//置锁定状态
+	//锁定设备并置执行中状态
 	auto setLockedState = new QState(topState);
 	QObject::connect(setLockedState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"锁定设备");
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"锁定设备并置执行中状态...");
+		//服务器不保证一次请求内各项的处理顺序,锁定写入成功后再置执行中,写入回调已在控制线程,直接续写
 		QMetaObject::invokeMethod(getControl(), [=]() {
 			getControl()->writeSingleVal(
 				MI_Device::s_deviceBeLockedName,
@@ -795,24 +986,15 @@ void MD_Dispenser::initRunMachineInManual() {
 				[=](const MP_Public::ME_Error& _error) {
 				emit this->sig_errorInfo(_error); },
 				[=]() {
-					postSignalEvent(curMachine, this, &MD_Dispenser::sig_lockDeviceSuccess);
-				});
-		});
-	});
-
-	//开始执行收送wafer
-	auto startExecuteReceiveAndSendWaferState = new QState(topState);
-	QObject::connect(startExecuteReceiveAndSendWaferState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"置执行中状态...");
-		QMetaObject::invokeMethod(getControl(), [=]() {
-			getControl()->writeSingleVal(
-				MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
-				MS_ExecuteState::EXECUTING,
-				QOpcUa::Types::UInt16,
-				[=](const MP_Public::ME_Error& _error) {
-				emit this->sig_errorInfo(_error); },
-				[=]() {
-					postSignalEvent(curMachine, this, &MD_Dispenser::sig_goWaitExecuteFinished);
+					getControl()->writeSingleVal(
+						MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
+						MS_ExecuteState::EXECUTING,
+						QOpcUa::Types::UInt16,
+						[=](const MP_Public::ME_Error& _error) {
+						emit this->sig_errorInfo(_error); },
+						[=]() {
+							postSignalEvent(curMachine, this, &MD_Dispenser::sig_lockDeviceSuccess);
+						});
 				});
 		});
 	});
@@ -843,59 +1025,40 @@ void MD_Dispenser::initRunMachineInManual() {
 	});
 
 
-	//置解除锁定状态
+	//解除锁定并置执行完成状态
 	auto setUnLockedState = new QState(topState);
 	QObject::connect(setUnLockedState, &QState::entered, this, [=]() {
-		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"解除锁定");
+		emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"解除锁定并置执行完成状态...");
+		//解除锁定与重置指令互不依赖,一次写入;执行完成须在二者之后,单独写入
 		QMetaObject::invokeMethod(getControl(), [=]() {
-			getControl()->writeSingleVal(
-				MI_Device::s_deviceBeLockedName,
-				MS_DeviceBeLockedState::Not_Be_Locked,
-				QOpcUa::Types::UInt16,
-				[=](const MP_Public::ME_Error& _error) {
-				emit this->sig_errorInfo(_error); },
-				[=]() {
-					postSignalEvent(curMachine, this, &MD_Dispenser::sig_unlockDeviceSuccess);
-				});
-		});
-	});
-
-
-	auto onAfterExecuteFinshedState = new QState(topState);
-	QObject::connect(onAfterExecuteFinshedState, &QState::entered, this, [=]() {
-		QMetaObject::invokeMethod(getControl(), [=]() {
-			emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"置执行完成状态...");
-			getControl()->writeSingleVal(
-				MI_Device::s_deviceReceivceSendWaferCommandKeyName,
-				MI_SendCommand::NOT_EXECUTE,
-				QOpcUa::Types::UInt16,
+			getControl()->writeMultiVals({
+				{ MI_Device::s_deviceBeLockedName, { QOpcUa::Types::UInt16, MS_DeviceBeLockedState::Not_Be_Locked } },
+				{ MI_Device::s_deviceReceivceSendWaferCommandKeyName, { QOpcUa::Types::UInt16, MI_SendCommand::NOT_EXECUTE } } },
 				[=](const MP_Public::ME_Error& _error) {
 				emit this->sig_errorInfo(_error); },
 				[=]() {
-					QMetaObject::invokeMethod(getControl(), [=]() {
-						getControl()->writeSingleVal(
-							MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
-							MS_ExecuteState::FINIHED,
-							QOpcUa::Types::UInt16,
-							[=](const MP_Public::ME_Error& _error) {
-							emit this->sig_errorInfo(_error); },
-							[=]() {
-								QMetaObject::invokeMethod(this, [=]() {
-									if (m_isToTakeOutWafer.has_value()) {
-										if (m_isToTakeOutWafer.value()) {
-											emit sig_finishExecuteAferTakeOutWafer();
-											emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行送wafer完成！");
-										}
-										else {
-											emit sig_finishExecuteAferPutInWafer();
-											emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行收wafer完成!");
-										}
+					getControl()->writeSingleVal(
+						MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName,
+						MS_ExecuteState::FINIHED,
+						QOpcUa::Types::UInt16,
+						[=](const MP_Public::ME_Error& _error) {
+						emit this->sig_errorInfo(_error); },
+						[=]() {
+							QMetaObject::invokeMethod(this, [=]() {
+								if (m_isToTakeOutWafer.has_value()) {
+									if (m_isToTakeOutWafer.value()) {
+										emit sig_finishExecuteAferTakeOutWafer();
+										emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行送wafer完成！");
+									}
+									else {
+										emit sig_finishExecuteAferPutInWafer();
+										emit sig_logInfo(ML_LogLabel::NORMAL_LABEL, u8"执行收wafer完成!");
 									}
+								}
 
-									postSignalEvent(curMachine, this, &MD_Dispenser::sig_completeExecuteSuccess);
-								});
+								postSignalEvent(curMachine, this, &MD_Dispenser::sig_completeExecuteSuccess);
 							});
-					});
+						});
 				});
 		});
 	});
@@ -922,17 +1085,13 @@ void MD_Dispenser::initRunMachineInManual() {
 	QObject::connect(tryConnectDeviceState, &QState::entered, this, [=]() {
 		auto control{ getControl() };
 		Q_ASSERT(control);
-		if (control->getConnectState() == MS_ConnectState::CONNECTED) {
+		if (control->getClient()->isConnectionEstablished()) {
 			emit sig_noNeedTryConnect();
 			return;
 		}
 
-		m_pollingConnectSuccessTimer->start(1000);
 		tryConnectDevice();
 	});
-	QObject::connect(tryConnectDeviceState, &QState::exited, this, [=]() {
-		m_pollingConnectSuccessTimer->stop();
-	});
 
 	//初始化复位
 	auto resetDeviceState = new QState(topState);
@@ -970,12 +1129,9 @@ void MD_Dispenser::initRunMachineInManual() {
 	planState->addTransition(this, &MD_Dispenser::sig_notAllowPlaned, failState);
 
 	waitExecuteCommandState->addTransition(this, &MD_Dispenser::sig_requiredExecuteReceiveAndSendWafer, setLockedState);
-	setLockedState->addTransition(this, &MD_Dispenser::sig_lockDeviceSuccess, startExecuteReceiveAndSendWaferState);
-
-	startExecuteReceiveAndSendWaferState->addTransition(this, &MD_Dispenser::sig_goWaitExecuteFinished, waitExeuteFinishedState);
+	setLockedState->addTransition(this, &MD_Dispenser::sig_lockDeviceSuccess, waitExeuteFinishedState);
 	waitExeuteFinishedState->addTransition(this, &MD_Dispenser::sig_receiveAndSendWaferSuccessFinish, setUnLockedState);
-	setUnLockedState->addTransition(this, &MD_Dispenser::sig_unlockDeviceSuccess, onAfterExecuteFinshedState);
-	onAfterExecuteFinshedState->addTransition(this, &MD_Dispenser::sig_completeExecuteSuccess, successState);
+	setUnLockedState->addTransition(this, &MD_Dispenser::sig_completeExecuteSuccess, successState);
 
 
 	failState->addTransition(finalState);
@@ -8,7 +8,10 @@
 #include <QString>
 #include <QObject>
 
+class QAbstractState;
+
 class MC_OpcDeviceControl;
+class MC_OpcUaClient;
 class MS_StateMachine;
 class QTimer;
 class QThread;
@@ -22,6 +25,14 @@ struct MS_DispenserHardwareSet {
 	}
 };
 
+//预规划进度
+enum class ME_SpeculativePlanPhase
+{
+	NONE,
+	DISPATCHING,//规划请求下发中
+	DISPATCHED,//规划请求已下发
+};
+
 class MD_Dispenser : public MI_DeviceInterface, public MS_StateMachineAuxiliary
 {
 	Q_OBJECT
@@ -73,6 +84,13 @@ public:
 	void requireDeviceConfirmCanTakeOutWaferFromDeviceAtOnceInManual() override;
 	void unlockForTransportWafer() override;
 
+	//上游机械手确定前往本工位取放时调用,开启预规划后提前下发规划请求,规划与机械手移动重叠
+	void prepareToPutInOrTakeOutWafer(bool _isToTakeOutWafer);
+	//机械手放弃本次移动时调用,撤销尚未确认的预规划
+	void cancelPrepareToPutInOrTakeOutWafer();
+	bool getIsSpeculativePlan() const { return m_isSpeculativePlan; }
+	void setIsSpeculativePlan(bool _val) { m_isSpeculativePlan = _val; }
+
 	bool operateSafetyDoorSwitch(bool _var) override { return true; }
 	bool acquireSafetyDoorSwitchStatus() override { return true; }
 
@@ -98,6 +116,9 @@ public:
 	MP_DispenserParam& getParam() { return m_param; }
 	void setParam(const MP_DispenserParam& val) { m_param = val; }
 
+	//OpcUa客户端(供整线并发连接等使用)
+	std::shared_ptr<MC_OpcUaClient> getOpcUaClient() const;
+
 	void writeLogFileForParam(const QString& _var) override;
 
 	bool getLigthCurtainAlarmInputIO() const override { return m_ligthCurtainAlarmInputIO; }
@@ -117,14 +138,18 @@ signals:
 	void sig_allowPlaned();//允许规划信号
 	void sig_notAllowPlaned();//不允许规划信号
 	void sig_requiredExecuteReceiveAndSendWafer();//需求执行收送wafer
-	void sig_goWaitExecuteFinished();//等待执行结束
 	void sig_completeExecuteSuccess();//执行成功结束
 
 	void sig_requireStop();
 	void sig_goStartPlanning();
+	void sig_goSpeculativePlanning();//开始预规划
+	void sig_abortSpeculativePlanning();//放弃预规划
+	void sig_speculativePlanCanceled();//预规划已撤销
+	void sig_speculativePlanCanceledToReplan();//预规划已撤销,按确认取放重新规划
+	void sig_speculativePlanDispatched(const MP_Public::MM_MaybeOk& _result);//预规划请求下发结束
+	void sig_speculativePlanFailed();//预规划请求下发失败
 
 	void sig_lockDeviceSuccess();
-	void sig_unlockDeviceSuccess();
 
 	void sig_tryConnectedSuccess(); //重连成功
 	void sig_noNeedTryConnect();//不需要重连
@@ -166,13 +191,20 @@ private:
 
 	bool m_isWaitActionExecute = false;//是否在等待执行动作
 
+	std::atomic_bool m_isSpeculativePlan = false;//是否开启预规划
+	bool m_speculativeIsToTakeOutWafer = false;//预规划对应的取放方向
+	ME_SpeculativePlanPhase m_speculativePlanPhase = ME_SpeculativePlanPhase::NONE;
+
 	QTimer* m_pollingPlanResultTimer{}; //轮询规划结果
 	QTimer* m_pollingExecuteCommandTimer{};//轮询执行指令
 	QTimer* m_pollingInitCommandFinishTimer{};//轮询初始化指令结束
-	QTimer* m_pollingConnectSuccessTimer{};//轮询连接成功
 
 	void initRunMachine();
 	void initRunMachineInManual();
+
+	//状态进入/退出记录追踪区间,关联当前收送片的追踪ID
+	void traceState(QAbstractState* _state, const char* _step);
+	quint64 m_traceTransferId{ 0 };
 	bool m_isExistWaferInManual{ false };//半自动状态下检测当前工位是否存在wafer
 
 	MS_DispenserHardwareSet m_hardwareSet;
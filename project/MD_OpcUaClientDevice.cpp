@@ -3,6 +3,7 @@
 #include "MA_Auxiliary.h"
 #include <QDebug>
 #include <QMutexLocker>
+#include <QTimer>
 
 using MP_Public::MM_MaybeOk;
 using MP_Public::ME_Error;
@@ -33,8 +34,23 @@ MM_Maybe<QOpcUaClient*> MD_OpcUaClientDevice::getAvailableClient()
 
 
 MD_OpcUaClientDevice::MD_OpcUaClientDevice(QObject *_parent)
-	: QObject(_parent)
+	: MI_OpcUaClientBackend(_parent),
+	m_keepAliveTimer(new QTimer(this))
 {
+	connect(m_keepAliveTimer, &QTimer::timeout, this, &MD_OpcUaClientDevice::onKeepAliveTick);
+}
+
+void MD_OpcUaClientDevice::setIsKeepAliveEnabled(bool _val)
+{
+	m_isKeepAliveEnabled = _val;
+	if (!m_isKeepAliveEnabled)
+	{
+		stopKeepAlive();
+	}
+	else if (getConnectState() == QOpcUaClient::Connected && !m_keepAliveNode)
+	{
+		startKeepAlive();
+	}
 }
 
 MD_OpcUaClientDevice::~MD_OpcUaClientDevice()
@@ -69,7 +85,30 @@ MP_Public::MM_MaybeOk  MD_OpcUaClientDevice::createClient()
 
 	connect(m_opcuaClient, &QOpcUaClient::disconnected, this, &MD_OpcUaClientDevice::sig_disconnected);
 	connect(m_opcuaClient, &QOpcUaClient::errorChanged, this, &MD_OpcUaClientDevice::sig_errorChanged);
-	connect(m_opcuaClient, &QOpcUaClient::stateChanged, this, &MD_OpcUaClientDevice::sig_stateChanged);
+	connect(m_opcuaClient, &QOpcUaClient::stateChanged, this, &MD_OpcUaClientDevice::onClientStateChanged);
+	//录制应答,先于转发连接,上层处理时发出的新请求排在应答之后
+	connect(m_opcuaClient, &QOpcUaClient::readNodeAttributesFinished, this, [=](QVector<QOpcUaReadResult> _results, QOpcUa::UaStatusCode)
+	{
+		if (!m_trafficRecorder.isRecording())
+		{
+			return;
+		}
+		for (const auto& var : _results)
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::READ_RESPONSE, var.nodeId(), var.value(), static_cast<quint32>(var.statusCode()));
+		}
+	});
+	connect(m_opcuaClient, &QOpcUaClient::writeNodeAttributesFinished, this, [=](QVector<QOpcUaWriteResult> _results, QOpcUa::UaStatusCode)
+	{
+		if (!m_trafficRecorder.isRecording())
+		{
+			return;
+		}
+		for (const auto& var : _results)
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::WRITE_RESPONSE, var.nodeId(), QVariant(), static_cast<quint32>(var.statusCode()));
+		}
+	});
 	connect(m_opcuaClient, &QOpcUaClient::readNodeAttributesFinished, this, &MD_OpcUaClientDevice::sig_readNodeAttributesFinished);
 	connect(m_opcuaClient, &QOpcUaClient::writeNodeAttributesFinished, this, &MD_OpcUaClientDevice::sig_writeNodeAttributesFinished);
 	return MM_MaybeOk();
@@ -80,13 +119,56 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::tryConnectServer(const QHostAddress&
 	QUrl url{ QLatin1String("opc.tcp://localhost:4840") };
 	url.setHost(_hostAddress.toString());
 	url.setPort(_port);
-	m_serverUrl = url;
 
 	if (!m_opcuaClient)
 	{
+		m_serverUrl = url;
 		return MM_MaybeOk(ME_Error(u8"Client is null"));
 	}
 
+	//同一服务器非主动断开后重连,保留节点对象,命名空间索引不变时沿用原有监控及信号连接
+	auto isResuming = m_isSessionResumable && url == m_serverUrl && !m_endpoint.endpointUrl().isEmpty();
+	m_resumeNameSpaceId = isResuming ? boost::optional<quint16>(m_nameSpaceId) : boost::none;
+	if (!isResuming)
+	{
+		clearNodes();
+	}
+	m_serverUrl = url;
+
+	m_isNamespaceResolved = false;
+	m_isSessionResumable = false;
+	m_isSessionResumed = false;
+	m_isWarmStarted = false;
+	m_isWarmConnecting = false;
+	m_isResumeConnecting = false;
+	++m_connectGeneration;
+
+	if (isResuming)
+	{
+		//直接连接上次会话的端点,失败时回退到完整发现流程
+		m_isWarmConnecting = true;
+		m_isResumeConnecting = true;
+		m_opcuaClient->connectToEndpoint(m_endpoint);
+		return MM_MaybeOk();
+	}
+
+	auto snapshot = MC_OpcUaSnapshotStore::instance().find(url.toString());
+	if (snapshot)
+	{
+		//由快照直接连接端点,失败时回退到完整发现流程
+		m_isWarmConnecting = true;
+		m_endpoint = snapshot->m_endpoint;
+		m_nameSpaceId = snapshot->m_nameSpaceId;
+		m_opcuaClient->connectToEndpoint(snapshot->m_endpoint);
+		return MM_MaybeOk();
+	}
+
+	discoverAndConnectServer(url);
+	return MM_MaybeOk();
+}
+
+void MD_OpcUaClientDevice::discoverAndConnectServer(const QUrl& _url)
+{
 	auto onFailFunctor = [=](const QString& _error)
 	{
 		QMetaObject::invokeMethod(this, [=]()
@@ -95,10 +177,16 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::tryConnectServer(const QHostAddress&
 		}, Qt::QueuedConnection);
 	};
 
+	//中止或重新发起连接后,仍在途的发现结果不再继续连接
+	auto generation = m_connectGeneration;
 	auto object = new QObject();
 	auto connection = connect(m_opcuaClient, &QOpcUaClient::findServersFinished, object, [=](const QVector<QOpcUaApplicationDescription> &servers, QOpcUa::UaStatusCode statusCode)
 	{
 		object->deleteLater();
+		if (generation != m_connectGeneration)
+		{
+			return;
+		}
 
 		if (!isSuccessStatus(statusCode))
 		{
@@ -124,6 +212,10 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::tryConnectServer(const QHostAddress&
 			ME_DestructExecuter executer([=]() {
 				endPointRequestObject->deleteLater();
 			});
+			if (generation != m_connectGeneration)
+			{
+				return;
+			}
 			if (!isSuccessStatus(statusCode))
 			{
 				onFailFunctor(u8"Find end points fail!");
@@ -152,6 +244,7 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::tryConnectServer(const QHostAddress&
 				onFailFunctor(u8"Cannot find vaild end point!");
 				return;
 			}
+			m_endpoint = endPointsResult.front();
 			m_opcuaClient->connectToEndpoint(endPointsResult.front());
 
 		});
@@ -160,8 +253,152 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::tryConnectServer(const QHostAddress&
 		}
 
 	});
-	m_opcuaClient->findServers(url, QStringList(), QStringList());
-	return MM_MaybeOk();
+	m_opcuaClient->findServers(_url, QStringList(), QStringList());
+}
+
+void MD_OpcUaClientDevice::onClientStateChanged(QOpcUaClient::ClientState _state)
+{
+	m_trafficRecorder.record(ME_OpcUaTrafficEventType::STATE_CHANGED, QString(), static_cast<int>(_state));
+	if (m_isWarmConnecting)
+	{
+		if (_state == QOpcUaClient::Connected)
+		{
+			m_isWarmConnecting = false;
+			m_isWarmStarted = true;
+		}
+		else if (_state == QOpcUaClient::Disconnected)
+		{
+			//端点已失效,走完整发现流程,不向上层报告这次断开
+			m_isWarmConnecting = false;
+			qDebug() << u8"Warm connect fail, fall back to discovery : " << m_serverUrl.toString();
+			if (!m_isResumeConnecting)
+			{
+				MC_OpcUaSnapshotStore::instance().remove(m_serverUrl.toString());
+			}
+			m_isResumeConnecting = false;
+			discoverAndConnectServer(m_serverUrl);
+			return;
+		}
+	}
+
+	if (_state == QOpcUaClient::Connected)
+	{
+		startKeepAlive();
+	}
+	else if (_state == QOpcUaClient::Disconnected)
+	{
+		stopKeepAlive();
+	}
+	emit sig_stateChanged(_state);
+}
+
+void MD_OpcUaClientDevice::startKeepAlive()
+{
+	stopKeepAlive();
+	if (!m_isKeepAliveEnabled || !m_opcuaClient)
+	{
+		return;
+	}
+
+	//单独的节点对象读取服务器时间,不经过readNodeAttributes广播,避免干扰批量读写的结果
+	m_keepAliveNode = m_opcuaClient->node(QStringLiteral("ns=0;i=2258"));
+	if (!m_keepAliveNode)
+	{
+		qDebug() << u8"Create keep alive node fail : " << m_serverUrl.toString();
+		return;
+	}
+	connect(m_keepAliveNode, &QOpcUaNode::attributeRead, this, [=]()
+	{
+		m_isKeepAliveReadPending = false;
+		auto status = m_keepAliveNode->attributeError(QOpcUa::NodeAttribute::Value);
+		//已按超时计过失败(并已上报超时结果)的迟到应答不清零也不再上报,只有按时的应答才说明连接正常
+		auto isLate = m_keepAlivePendingMissCount > 0;
+		if (!isLate)
+		{
+			emit sig_keepAliveResult(m_keepAliveRequestTimer.nsecsElapsed() / 1000, status);
+		}
+		if (status == QOpcUa::UaStatusCode::Good)
+		{
+			if (!isLate)
+			{
+				m_keepAliveMissCount = 0;
+			}
+			return;
+		}
+		if (!isLate)
+		{
+			onKeepAliveMissed();
+		}
+	});
+
+	m_keepAliveMissCount = 0;
+	m_isKeepAliveReadPending = false;
+	m_keepAliveTimer->start(m_keepAliveIntervalMs);
+}
+
+void MD_OpcUaClientDevice::stopKeepAlive()
+{
+	m_keepAliveTimer->stop();
+	m_isKeepAliveReadPending = false;
+	if (m_keepAliveNode)
+	{
+		m_keepAliveNode->disconnect(this);
+		m_keepAliveNode->deleteLater();
+		m_keepAliveNode = nullptr;
+	}
+}
+
+void MD_OpcUaClientDevice::onKeepAliveTick()
+{
+	if (!m_keepAliveNode)
+	{
+		return;
+	}
+
+	//同一时刻只有一个探测在途,在途时不发新的探测;每超过一个超时时长计一次失败
+	if (m_isKeepAliveReadPending)
+	{
+		if (m_keepAliveRequestTimer.elapsed() >= m_keepAliveTimeoutMs * (m_keepAlivePendingMissCount + 1))
+		{
+			//每个探测只上报一次超时结果
+			if (m_keepAlivePendingMissCount == 0)
+			{
+				emit sig_keepAliveResult(m_keepAliveRequestTimer.nsecsElapsed() / 1000, QOpcUa::UaStatusCode::BadTimeout);
+			}
+			++m_keepAlivePendingMissCount;
+			onKeepAliveMissed();
+		}
+		return;
+	}
+	m_keepAlivePendingMissCount = 0;
+
+	m_isKeepAliveReadPending = true;
+	m_keepAliveRequestTimer.start();
+	if (!m_keepAliveNode->readAttributes(QOpcUa::NodeAttribute::Value))
+	{
+		m_isKeepAliveReadPending = false;
+		emit sig_keepAliveResult(0, QOpcUa::UaStatusCode::BadInternalError);
+		onKeepAliveMissed();
+	}
+}
+
+bool MD_OpcUaClientDevice::onKeepAliveMissed()
+{
+	++m_keepAliveMissCount;
+	if (m_keepAliveMissCount < m_keepAliveMaxMissCount)
+	{
+		return true;
+	}
+
+	//连续无响应,判定连接已失效;不调用disconnectServer,保留会话以便重连后沿用
+	qDebug() << u8"Keep alive timeout : " << m_serverUrl.toString();
+	stopKeepAlive();
+	emit sig_keepAliveTimeout();
+	if (m_opcuaClient && m_opcuaClient->state() != QOpcUaClient::Disconnected)
+	{
+		m_opcuaClient->disconnectFromEndpoint();
+	}
+	return false;
 }
 
 QOpcUaClient::ClientState MD_OpcUaClientDevice::getConnectState()
@@ -179,10 +416,47 @@ void MD_OpcUaClientDevice::disconnectServer()
 	{
 		return;
 	}
+	//主动断开,下次连接不再沿用本次会话
+	m_isSessionResumable = false;
 	m_opcuaClient->disconnectFromEndpoint();
 
 }
 
+void MD_OpcUaClientDevice::abortConnect()
+{
+	//不同于disconnectServer,保留会话可沿用标记,下次重连仍可沿用节点
+	++m_connectGeneration;
+	m_isWarmConnecting = false;
+	m_isResumeConnecting = false;
+	if (m_opcuaClient && m_opcuaClient->state() != QOpcUaClient::Disconnected)
+	{
+		m_opcuaClient->disconnectFromEndpoint();
+	}
+}
+
+void MD_OpcUaClientDevice::clearNodes()
+{
+	for (auto& var : m_nodesMap)
+	{
+		var.second->deleteLater();
+	}
+	m_nodesMap.clear();
+	m_isSessionResumed = false;
+	m_isSessionResumable = false;
+}
+
+void MD_OpcUaClientDevice::onNamespaceResolved()
+{
+	m_isNamespaceResolved = true;
+	m_isSessionResumed = m_resumeNameSpaceId && *m_resumeNameSpaceId == m_nameSpaceId && !m_nodesMap.empty();
+	if (!m_isSessionResumed)
+	{
+		clearNodes();
+	}
+	m_resumeNameSpaceId = boost::none;
+	m_isSessionResumable = true;
+}
+
 MM_MaybeOk MD_OpcUaClientDevice::updateArrayNamespace()
 {
 	if (!m_opcuaClient)
@@ -190,6 +464,18 @@ MM_MaybeOk MD_OpcUaClientDevice::updateArrayNamespace()
 		return MM_MaybeOk(ME_Error(u8"Client is null!"));
 	}
 
+	if (m_isWarmStarted)
+	{
+		//快照(或上次会话)中的命名空间索引直接可用,后台再向服务器校验
+		onNamespaceResolved();
+		QMetaObject::invokeMethod(this, [=]()
+		{
+			emit sig_updateArrayNamespaceFinished(MM_MaybeOk());
+		}, Qt::QueuedConnection);
+		validateNamespaceIndex();
+		return MM_MaybeOk();
+	}
+
 	auto object = new QObject();
 	QObject::connect(m_opcuaClient, &QOpcUaClient::namespaceArrayUpdated, object, [=](QStringList _namespace)
 	{
@@ -210,7 +496,7 @@ MM_MaybeOk MD_OpcUaClientDevice::updateArrayNamespace()
 		else
 		{
 			m_nameSpaceId = static_cast<quint16>(findIter - _namespace.begin());
-			m_nodesMap.clear();
+			onNamespaceResolved();
 			emit sig_updateArrayNamespaceFinished(MM_MaybeOk());
 		}
 
@@ -228,6 +514,58 @@ MM_MaybeOk MD_OpcUaClientDevice::updateArrayNamespace()
 	return MM_MaybeOk();
 }
 
+void MD_OpcUaClientDevice::validateNamespaceIndex()
+{
+	auto object = new QObject();
+	QObject::connect(m_opcuaClient, &QOpcUaClient::namespaceArrayUpdated, object, [=](QStringList _namespace)
+	{
+		object->deleteLater();
+		auto nameSpaceIndex = _namespace.indexOf(MI_Device::s_nameSpaceName);
+		if (nameSpaceIndex < 0)
+		{
+			//服务器已不再提供该命名空间,快照作废并断开,由上层按正常流程重连
+			qDebug() << u8"Validate namespace fail, cannot find namespace : " << m_serverUrl.toString();
+			MC_OpcUaSnapshotStore::instance().remove(m_serverUrl.toString());
+			m_isNamespaceResolved = false;
+			clearNodes();
+			disconnectServer();
+			return;
+		}
+
+		if (static_cast<quint16>(nameSpaceIndex) == m_nameSpaceId)
+		{
+			return;
+		}
+
+		qDebug() << u8"Namespace index changed : " << m_nameSpaceId << " -> " << nameSpaceIndex;
+		m_nameSpaceId = static_cast<quint16>(nameSpaceIndex);
+		clearNodes();
+		m_isSessionResumable = true;
+		emit sig_namespaceIndexChanged(m_nameSpaceId);
+	});
+
+	if (!m_opcuaClient->updateNamespaceArray())
+	{
+		object->deleteLater();
+		qDebug() << u8"Dispatch validate namespace array fail!";
+	}
+}
+
+boost::optional<MS_OpcUaServerSnapshot> MD_OpcUaClientDevice::getServerSnapshot()
+{
+	if (!m_opcuaClient || m_opcuaClient->state() != QOpcUaClient::Connected || !m_isNamespaceResolved)
+	{
+		return {};
+	}
+
+	MS_OpcUaServerSnapshot snapshot;
+	snapshot.m_serverUrl = m_serverUrl.toString();
+	snapshot.m_endpoint = m_endpoint;
+	snapshot.m_nameSpaceId = m_nameSpaceId;
+	snapshot.m_savedDateTime = QDateTime::currentDateTime();
+	return snapshot;
+}
+
 QOpcUaNode* MD_OpcUaClientDevice::getNode(const QString& _valeName)
 {
 	return getNode(m_nameSpaceId, _valeName);
@@ -252,6 +590,7 @@ QOpcUaNode* MD_OpcUaClientDevice::getNode(quint16 _namespaceId, const QString& _
 		{
 			return node;
 		}
+		makeNodeRecordConnections(node, nodeId);
 		m_nodesMap[nodeId] = node;
 		return node;
 	}
@@ -261,6 +600,13 @@ QOpcUaNode* MD_OpcUaClientDevice::getNode(quint16 _namespaceId, const QString& _
 
 MP_Public::MM_MaybeOk MD_OpcUaClientDevice::readNodeAttributes(const QVector<QOpcUaReadItem>& _nodesToRead)
 {
+	if (m_trafficRecorder.isRecording())
+	{
+		for (const auto& var : _nodesToRead)
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::READ_REQUEST, var.nodeId());
+		}
+	}
 	if (m_opcuaClient->readNodeAttributes(_nodesToRead))
 	{
 		return MP_Public::MM_MaybeOk();
@@ -273,6 +619,13 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::readNodeAttributes(const QVector<QOp
 
 MP_Public::MM_MaybeOk MD_OpcUaClientDevice::writeNodeAttributes(const QVector<QOpcUaWriteItem> &_nodesToWrite)
 {
+	if (m_trafficRecorder.isRecording())
+	{
+		for (const auto& var : _nodesToWrite)
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::WRITE_REQUEST, var.nodeId(), var.value());
+		}
+	}
 	if (m_opcuaClient->writeNodeAttributes(_nodesToWrite))
 	{
 		return MP_Public::MM_MaybeOk();
@@ -283,4 +636,31 @@ MP_Public::MM_MaybeOk MD_OpcUaClientDevice::writeNodeAttributes(const QVector<QO
 	}
 }
 
-
+void MD_OpcUaClientDevice::makeNodeRecordConnections(QOpcUaNode* _node, const QString& _nodeId)
+{
+	//单节点读写由上层直接调用节点接口,在应答处记录
+	connect(_node, &QOpcUaNode::attributeRead, this, [=](QOpcUa::NodeAttributes _attributes)
+	{
+		if (m_trafficRecorder.isRecording() && _attributes.testFlag(QOpcUa::NodeAttribute::Value))
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::NODE_READ, _nodeId,
+				_node->attribute(QOpcUa::NodeAttribute::Value),
+				static_cast<quint32>(_node->attributeError(QOpcUa::NodeAttribute::Value)));
+		}
+	});
+	connect(_node, &QOpcUaNode::attributeWritten, this, [=](QOpcUa::NodeAttribute _attribute, QOpcUa::UaStatusCode _statusCode)
+	{
+		if (m_trafficRecorder.isRecording() && _attribute == QOpcUa::NodeAttribute::Value)
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::NODE_WRITTEN, _nodeId,
+				_node->attribute(QOpcUa::NodeAttribute::Value), static_cast<quint32>(_statusCode));
+		}
+	});
+	connect(_node, &QOpcUaNode::dataChangeOccurred, this, [=](QOpcUa::NodeAttribute _attribute, QVariant _value)
+	{
+		if (m_trafficRecorder.isRecording() && _attribute == QOpcUa::NodeAttribute::Value)
+		{
+			m_trafficRecorder.record(ME_OpcUaTrafficEventType::DATA_CHANGE, _nodeId, _value);
+		}
+	});
+}
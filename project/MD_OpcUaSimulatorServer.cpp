@@ -0,0 +1,604 @@
+#include "MD_OpcUaSimulatorServer.h"
+#include "MI_GS600PDeviceField.h"
+#include "MA_ToolingPayloadCodec.h"
+#include <QTimer>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//迭代间隔,越小应答越及时
+	constexpr int s_iterateIntervalMs = 1;
+
+	UA_NodeId makeNodeId(quint16 _nameSpaceId, const QString& _fieldName)
+	{
+		return UA_NODEID_STRING_ALLOC(_nameSpaceId, _fieldName.toUtf8().constData());
+	}
+
+	QString statusToString(UA_StatusCode _status)
+	{
+		return QString::fromUtf8(UA_StatusCode_name(_status));
+	}
+
+	QString nodeIdToFieldName(const UA_NodeId& _nodeId)
+	{
+		return QString::fromUtf8(reinterpret_cast<const char*>(_nodeId.identifier.string.data),
+			static_cast<int>(_nodeId.identifier.string.length));
+	}
+
+	//定长ByteString上的IndexRange,只支持一维,超出末尾的部分截掉
+	UA_StatusCode byteStringRange(const UA_NumericRange& _range, int _size, int& _offset, int& _length)
+	{
+		if (_range.dimensionsSize != 1 || _range.dimensions[0].min > _range.dimensions[0].max)
+		{
+			return UA_STATUSCODE_BADINDEXRANGEINVALID;
+		}
+		if (_range.dimensions[0].min >= static_cast<UA_UInt32>(_size))
+		{
+			return UA_STATUSCODE_BADINDEXRANGENODATA;
+		}
+		_offset = static_cast<int>(_range.dimensions[0].min);
+		_length = static_cast<int>(qMin<qint64>(_range.dimensions[0].max, _size - 1)) - _offset + 1;
+		return UA_STATUSCODE_GOOD;
+	}
+
+	QVariant toQVariant(const UA_Variant& _val)
+	{
+		if (UA_Variant_isEmpty(&_val) || !UA_Variant_isScalar(&_val))
+		{
+			return QVariant();
+		}
+		if (_val.type == &UA_TYPES[UA_TYPES_UINT16])
+		{
+			return QVariant::fromValue(*static_cast<UA_UInt16*>(_val.data));
+		}
+		if (_val.type == &UA_TYPES[UA_TYPES_UINT32])
+		{
+			return QVariant::fromValue(static_cast<quint32>(*static_cast<UA_UInt32*>(_val.data)));
+		}
+		if (_val.type == &UA_TYPES[UA_TYPES_UINT64])
+		{
+			return QVariant::fromValue(static_cast<quint64>(*static_cast<UA_UInt64*>(_val.data)));
+		}
+		if (_val.type == &UA_TYPES[UA_TYPES_BYTESTRING] || _val.type == &UA_TYPES[UA_TYPES_STRING])
+		{
+			auto byteString = static_cast<UA_ByteString*>(_val.data);
+			return QByteArray(reinterpret_cast<const char*>(byteString->data), static_cast<int>(byteString->length));
+		}
+		return QVariant();
+	}
+}
+
+MD_OpcUaSimulatorServer::MD_OpcUaSimulatorServer(QObject *_parent)
+	: QObject(_parent),
+	m_iterateTimer(new QTimer(this))
+{
+	m_iterateTimer->setTimerType(Qt::PreciseTimer);
+	m_iterateTimer->setInterval(s_iterateIntervalMs);
+	QObject::connect(m_iterateTimer, &QTimer::timeout, this, [=]()
+	{
+		iterate();
+	});
+}
+
+MD_OpcUaSimulatorServer::~MD_OpcUaSimulatorServer()
+{
+	stop();
+}
+
+QString MD_OpcUaSimulatorServer::getEndpointUrl() const
+{
+	return QString(u8"opc.tcp://127.0.0.1:%1").arg(m_port);
+}
+
+MM_MaybeOk MD_OpcUaSimulatorServer::start(quint16 _port)
+{
+	stop();
+	m_port = _port;
+
+	m_server = UA_Server_new();
+	auto config = UA_Server_getConfig(m_server);
+	auto status = UA_ServerConfig_setMinimal(config, _port, nullptr);
+	if (status != UA_STATUSCODE_GOOD)
+	{
+		stop();
+		return MM_MaybeOk(ME_Error(u8"Config simulator server fail! " + statusToString(status)));
+	}
+	//只监听回环地址
+	UA_ServerConfig_setCustomHostname(config, UA_STRING(const_cast<char*>("127.0.0.1")));
+
+	m_nameSpaceId = UA_Server_addNamespace(m_server, QString(MI_Device::s_nameSpaceName).toUtf8().constData());
+	auto addResult = addFields();
+	if (addResult.hasError())
+	{
+		stop();
+		return addResult;
+	}
+
+	status = UA_Server_run_startup(m_server);
+	if (status != UA_STATUSCODE_GOOD)
+	{
+		stop();
+		return MM_MaybeOk(ME_Error(u8"Start simulator server fail! " + statusToString(status)));
+	}
+	m_iterateTimer->start();
+	return MM_MaybeOk();
+}
+
+void MD_OpcUaSimulatorServer::stop()
+{
+	m_iterateTimer->stop();
+	if (!m_server)
+	{
+		return;
+	}
+	UA_Server_run_shutdown(m_server);
+	UA_Server_delete(m_server);
+	m_server = nullptr;
+	m_fieldTypes.clear();
+	m_fixedByteStrings.clear();
+}
+
+void MD_OpcUaSimulatorServer::iterate()
+{
+	if (m_server)
+	{
+		UA_Server_run_iterate(m_server, false);
+	}
+}
+
+MM_MaybeOk MD_OpcUaSimulatorServer::addFields()
+{
+	//字段名, 类型, 初值
+	std::vector<std::tuple<QString, ME_FieldType, QVariant>> fields{
+		std::make_tuple(MI_Device::s_deviceTypeString, ME_FieldType::UINT16, m_behavior.m_deviceType),
+		std::make_tuple(MI_Device::s_deviceStateName, ME_FieldType::UINT16, MS_DeviceState::STATE_RESETTING),
+		std::make_tuple(MI_Device::s_deviceBeLockedName, ME_FieldType::UINT16, MS_DeviceBeLockedState::Not_Be_Locked),
+		std::make_tuple(MI_Device::s_deviceIfConfigMainControl, ME_FieldType::UINT16, MS_DeviceIfConfigMainControl::IS_CONFIG),
+		std::make_tuple(MI_Device::s_deviceIfShowMainControl, ME_FieldType::UINT16, MS_DeviceIfShowMainControlUI::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_deviceWorkAreaWorkStateName, ME_FieldType::UINT16, MS_DeviceWorkAreaWorkState::STATE_NONE_WORK),
+		std::make_tuple(MI_Device::s_deviceWorkAreaIfHasToolingName, ME_FieldType::UINT16, MS_DeviceWorkAreaIfHasToolingState::STATE_NONE),
+		std::make_tuple(MI_Device::s_deviceWorkAreaIfHasWaferName, ME_FieldType::UINT16, MS_DeviceWorkAreaIfHasWaferState::STATE_NONE),
+		std::make_tuple(MI_GS600PDeviceField::s_deviceToolingPayloadCodecName, ME_FieldType::UINT16, m_behavior.m_toolingPayloadCodec),
+
+		//初始化
+		std::make_tuple(MI_Device::s_initCommandSendName, ME_FieldType::UINT16, MI_SendCommand::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_initCommandExecuteStateName, ME_FieldType::UINT16, MS_ExecuteState::NOT_EXECUTE),
+
+		//收板
+		std::make_tuple(MI_Device::s_isReadyToReceiveToolingStateName, ME_FieldType::UINT16, MS_IsReadyReceiveAndSendToolingState::NOT_READY),
+		std::make_tuple(MI_Device::s_receiveToolingBeInPlanningStateName, ME_FieldType::UINT16, MI_PlanState::NOT_BE_IN_PLANNING),
+		std::make_tuple(MI_Device::s_receiveToolingBeInPlanningRespondName, ME_FieldType::UINT16, MI_PlanRespond::INIT_VALUE),
+		std::make_tuple(MI_Device::s_receiveToolingCommandName, ME_FieldType::UINT16, MI_SendCommand::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_receiveToolingCommandExecuteStateName, ME_FieldType::UINT16, MS_ExecuteState::NOT_EXECUTE),
+
+		//送板
+		std::make_tuple(MI_Device::s_isReadyToSendToolingStateName, ME_FieldType::UINT16, MS_IsReadyReceiveAndSendToolingState::NOT_READY),
+		std::make_tuple(MI_Device::s_sendToolingBeInPlanningStateName, ME_FieldType::UINT16, MI_PlanState::NOT_BE_IN_PLANNING),
+		std::make_tuple(MI_Device::s_sendToolingBeInPlanningRespondName, ME_FieldType::UINT16, MI_PlanRespond::INIT_VALUE),
+		std::make_tuple(MI_Device::s_sendToolingCommandName, ME_FieldType::UINT16, MI_SendCommand::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_sendToolingCommandExecuteStateName, ME_FieldType::UINT16, MS_ExecuteState::NOT_EXECUTE),
+
+		//收送晶圆
+		std::make_tuple(MI_Device::s_deviceIsReadyReceivceSendWaferKeyName, ME_FieldType::UINT16, MS_IsReadyReceiveAndSendWaferState::NOT_READY),
+		std::make_tuple(MI_Device::s_deviceReceiveSendWaferBeInPlanningKeyName, ME_FieldType::UINT16, MI_PlanState::NOT_BE_IN_PLANNING),
+		std::make_tuple(MI_Device::s_deviceReceiveSendWaferBeInPlanningRespondKeyName, ME_FieldType::UINT16, MI_PlanRespond::INIT_VALUE),
+		std::make_tuple(MI_Device::s_deviceReceivceSendWaferCommandKeyName, ME_FieldType::UINT16, MI_SendCommand::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName, ME_FieldType::UINT16, MS_ExecuteState::NOT_EXECUTE),
+
+		//请求数据
+		std::make_tuple(MI_Device::s_deviceRequireDataCommandName, ME_FieldType::UINT16, MS_DeviceRequireDataState::NOT_REQUIRE),
+		std::make_tuple(MI_Device::s_deviceRequireDataExecuteStateName, ME_FieldType::UINT16, MS_ExecuteState::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_deviceRequireDataToolingIdentifierTypeName, ME_FieldType::UINT16, 0),
+		std::make_tuple(MI_Device::s_deviceRequireDataToolingIdentifierName, ME_FieldType::BYTE_STRING, QByteArray()),
+		std::make_tuple(MI_Device::s_deviceRequireDataToolingIndexName, ME_FieldType::UINT64, 0),
+		std::make_tuple(MI_Device::s_deviceRequireDataToolingDataContentName, ME_FieldType::BYTE_STRING, QByteArray()),
+		std::make_tuple(MI_GS600PDeviceField::s_deviceRequireDataToolingDataContentLengthName, ME_FieldType::UINT32, 0),
+		std::make_tuple(MI_Device::s_deviceRequireDataToolingIfDoAllName, ME_FieldType::UINT16, MS_IfWorkToolingDoAllFlag::NOT_DO_ALL),
+		std::make_tuple(MI_Device::s_deviceRequireDataToolingDataIsValidName, ME_FieldType::UINT16, MS_DataValidState::NOT_VALID),
+
+		//上传数据
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataCommandName, ME_FieldType::UINT16, MS_DeviceReuireUploadDataState::NOT_REQUIRE),
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataExecuteStateName, ME_FieldType::UINT16, MS_ExecuteState::NOT_EXECUTE),
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierTypeName, ME_FieldType::UINT16, 0),
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierName, ME_FieldType::BYTE_STRING, QByteArray()),
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataToolingIndexName, ME_FieldType::UINT64, 0),
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataContentName, ME_FieldType::BYTE_STRING, QByteArray()),
+		std::make_tuple(MI_GS600PDeviceField::s_deviceUploadWorkResultDataContentLengthName, ME_FieldType::UINT32, 0),
+		std::make_tuple(MI_Device::s_deviceUploadWorkResultDataToolingDataIsValidName, ME_FieldType::UINT16, MS_DataValidState::NOT_VALID),
+	};
+
+	//客户端写入回调,在服务器迭代中调用,模拟行为排队到事件循环中执行
+	UA_ValueCallback valueCallback;
+	valueCallback.onRead = nullptr;
+	valueCallback.onWrite = [](UA_Server*, const UA_NodeId*, void*, const UA_NodeId* _nodeId, void* _nodeContext,
+		const UA_NumericRange*, const UA_DataValue* _data)
+	{
+		auto simulator = static_cast<MD_OpcUaSimulatorServer*>(_nodeContext);
+		if (!simulator || simulator->m_isInternalWrite || !_data || !_data->hasValue
+			|| _nodeId->identifierType != UA_NODEIDTYPE_STRING)
+		{
+			return;
+		}
+		auto fieldName = nodeIdToFieldName(*_nodeId);
+		auto val = toQVariant(_data->value);
+		++simulator->m_clientWriteCount;
+		QMetaObject::invokeMethod(simulator, [=]()
+		{
+			simulator->onClientWrite(fieldName, val);
+		}, Qt::QueuedConnection);
+	};
+
+	//定长内容节点用数据源,IndexRange读写在回调中按字节处理
+	UA_DataSource fixedByteStringSource;
+	fixedByteStringSource.read = [](UA_Server*, const UA_NodeId*, void*, const UA_NodeId* _nodeId, void* _nodeContext,
+		UA_Boolean, const UA_NumericRange* _range, UA_DataValue* _value) -> UA_StatusCode
+	{
+		auto simulator = static_cast<MD_OpcUaSimulatorServer*>(_nodeContext);
+		auto iter = simulator->m_fixedByteStrings.find(nodeIdToFieldName(*_nodeId));
+		if (iter == simulator->m_fixedByteStrings.end())
+		{
+			return UA_STATUSCODE_BADNODEIDUNKNOWN;
+		}
+		const auto& content = iter->second;
+		auto offset = 0;
+		auto length = content.size();
+		if (_range)
+		{
+			auto status = byteStringRange(*_range, content.size(), offset, length);
+			if (status != UA_STATUSCODE_GOOD)
+			{
+				return status;
+			}
+		}
+		UA_ByteString byteStringVal;
+		byteStringVal.length = static_cast<size_t>(length);
+		byteStringVal.data = reinterpret_cast<UA_Byte*>(const_cast<char*>(content.constData() + offset));
+		auto status = UA_Variant_setScalarCopy(&_value->value, &byteStringVal, &UA_TYPES[UA_TYPES_BYTESTRING]);
+		_value->hasValue = status == UA_STATUSCODE_GOOD;
+		return status;
+	};
+	fixedByteStringSource.write = [](UA_Server*, const UA_NodeId*, void*, const UA_NodeId* _nodeId, void* _nodeContext,
+		const UA_NumericRange* _range, const UA_DataValue* _data) -> UA_StatusCode
+	{
+		auto simulator = static_cast<MD_OpcUaSimulatorServer*>(_nodeContext);
+		auto fieldName = nodeIdToFieldName(*_nodeId);
+		auto iter = simulator->m_fixedByteStrings.find(fieldName);
+		if (iter == simulator->m_fixedByteStrings.end())
+		{
+			return UA_STATUSCODE_BADNODEIDUNKNOWN;
+		}
+		if (!_data || !_data->hasValue || !UA_Variant_hasScalarType(&_data->value, &UA_TYPES[UA_TYPES_BYTESTRING]))
+		{
+			return UA_STATUSCODE_BADTYPEMISMATCH;
+		}
+		auto val = toQVariant(_data->value).toByteArray();
+		auto& content = iter->second;
+		if (_range)
+		{
+			auto offset = 0;
+			auto length = 0;
+			auto status = byteStringRange(*_range, content.size(), offset, length);
+			if (status != UA_STATUSCODE_GOOD)
+			{
+				return status;
+			}
+			//写入范围须完整落在节点内且与数据等长
+			if (length != static_cast<int>(_range->dimensions[0].max - _range->dimensions[0].min + 1) || val.size() != length)
+			{
+				return UA_STATUSCODE_BADINDEXRANGEINVALID;
+			}
+			content.replace(offset, length, val);
+		}
+		else
+		{
+			//整块写入不改变节点长度,剩余部分补0
+			if (val.size() > content.size())
+			{
+				return UA_STATUSCODE_BADOUTOFRANGE;
+			}
+			auto capacity = content.size();
+			content = val;
+			content.append(QByteArray(capacity - val.size(), '\0'));
+		}
+
+		if (!simulator->m_isInternalWrite)
+		{
+			++simulator->m_clientWriteCount;
+			QMetaObject::invokeMethod(simulator, [=]()
+			{
+				simulator->onClientWrite(fieldName, val);
+			}, Qt::QueuedConnection);
+		}
+		return UA_STATUSCODE_GOOD;
+	};
+	const std::vector<QString> fixedByteStringFields{ MI_Device::s_deviceRequireDataToolingDataContentName, MI_Device::s_deviceUploadWorkResultDataContentName };
+
+	for (const auto& var : fields)
+	{
+		const auto& fieldName = std::get<0>(var);
+		auto fieldType = std::get<1>(var);
+		const auto& initVal = std::get<2>(var);
+		auto isFixedByteString = m_behavior.m_toolingDataContentCapacity > 0
+			&& std::find(fixedByteStringFields.begin(), fixedByteStringFields.end(), fieldName) != fixedByteStringFields.end();
+
+		auto nameBytes = fieldName.toUtf8();
+		UA_VariableAttributes attr = UA_VariableAttributes_default;
+		attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+		attr.displayName = UA_LOCALIZEDTEXT_ALLOC("en-US", nameBytes.constData());
+
+		UA_UInt16 uint16Val = initVal.value<quint16>();
+		UA_UInt32 uint32Val = initVal.value<quint32>();
+		UA_UInt64 uint64Val = initVal.value<quint64>();
+		auto byteArrayVal = initVal.toByteArray();
+		UA_ByteString byteStringVal;
+		byteStringVal.length = static_cast<size_t>(byteArrayVal.size());
+		byteStringVal.data = reinterpret_cast<UA_Byte*>(byteArrayVal.data());
+		switch (fieldType)
+		{
+		case ME_FieldType::UINT16:
+			UA_Variant_setScalar(&attr.value, &uint16Val, &UA_TYPES[UA_TYPES_UINT16]);
+			attr.dataType = UA_TYPES[UA_TYPES_UINT16].typeId;
+			break;
+		case ME_FieldType::UINT32:
+			UA_Variant_setScalar(&attr.value, &uint32Val, &UA_TYPES[UA_TYPES_UINT32]);
+			attr.dataType = UA_TYPES[UA_TYPES_UINT32].typeId;
+			break;
+		case ME_FieldType::UINT64:
+			UA_Variant_setScalar(&attr.value, &uint64Val, &UA_TYPES[UA_TYPES_UINT64]);
+			attr.dataType = UA_TYPES[UA_TYPES_UINT64].typeId;
+			break;
+		case ME_FieldType::BYTE_STRING:
+			UA_Variant_setScalar(&attr.value, &byteStringVal, &UA_TYPES[UA_TYPES_BYTESTRING]);
+			attr.dataType = UA_TYPES[UA_TYPES_BYTESTRING].typeId;
+			break;
+		default:
+			break;
+		}
+
+		auto nodeId = makeNodeId(m_nameSpaceId, fieldName);
+		auto browseName = UA_QUALIFIEDNAME_ALLOC(m_nameSpaceId, nameBytes.constData());
+		UA_StatusCode status = UA_STATUSCODE_GOOD;
+		if (isFixedByteString)
+		{
+			m_fixedByteStrings[fieldName] = QByteArray(m_behavior.m_toolingDataContentCapacity, '\0');
+			status = UA_Server_addDataSourceVariableNode(m_server, nodeId,
+				UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+				UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+				browseName,
+				UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+				attr, fixedByteStringSource, this, nullptr);
+		}
+		else
+		{
+			status = UA_Server_addVariableNode(m_server, nodeId,
+				UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+				UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+				browseName,
+				UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+				attr, this, nullptr);
+			if (status == UA_STATUSCODE_GOOD)
+			{
+				status = UA_Server_setVariableNode_valueCallback(m_server, nodeId, valueCallback);
+			}
+		}
+		UA_LocalizedText_clear(&attr.displayName);
+		UA_QualifiedName_clear(&browseName);
+		UA_NodeId_clear(&nodeId);
+
+		if (status != UA_STATUSCODE_GOOD)
+		{
+			return MM_MaybeOk(ME_Error(QString(u8"Add simulator field %1 fail! %2").arg(fieldName).arg(statusToString(status))));
+		}
+		m_fieldTypes[fieldName] = fieldType;
+	}
+	return MM_MaybeOk();
+}
+
+MM_MaybeOk MD_OpcUaSimulatorServer::setFieldValue(const QString& _fieldName, const QVariant& _val)
+{
+	if (!m_server)
+	{
+		return MM_MaybeOk(ME_Error(u8"Simulator server is not running!"));
+	}
+	auto iter = m_fieldTypes.find(_fieldName);
+	if (iter == m_fieldTypes.end())
+	{
+		return MM_MaybeOk(ME_Error(u8"Unknown simulator field: " + _fieldName));
+	}
+
+	UA_Variant val;
+	UA_Variant_init(&val);
+	UA_UInt16 uint16Val = _val.value<quint16>();
+	UA_UInt32 uint32Val = _val.value<quint32>();
+	UA_UInt64 uint64Val = _val.value<quint64>();
+	auto byteArrayVal = _val.toByteArray();
+	UA_ByteString byteStringVal;
+	byteStringVal.length = static_cast<size_t>(byteArrayVal.size());
+	byteStringVal.data = reinterpret_cast<UA_Byte*>(byteArrayVal.data());
+	switch (iter->second)
+	{
+	case ME_FieldType::UINT16:
+		UA_Variant_setScalar(&val, &uint16Val, &UA_TYPES[UA_TYPES_UINT16]);
+		break;
+	case ME_FieldType::UINT32:
+		UA_Variant_setScalar(&val, &uint32Val, &UA_TYPES[UA_TYPES_UINT32]);
+		break;
+	case ME_FieldType::UINT64:
+		UA_Variant_setScalar(&val, &uint64Val, &UA_TYPES[UA_TYPES_UINT64]);
+		break;
+	case ME_FieldType::BYTE_STRING:
+		UA_Variant_setScalar(&val, &byteStringVal, &UA_TYPES[UA_TYPES_BYTESTRING]);
+		break;
+	default:
+		break;
+	}
+
+	auto nodeId = makeNodeId(m_nameSpaceId, _fieldName);
+	m_isInternalWrite = true;
+	auto status = UA_Server_writeValue(m_server, nodeId, val);
+	m_isInternalWrite = false;
+	UA_NodeId_clear(&nodeId);
+	if (status != UA_STATUSCODE_GOOD)
+	{
+		return MM_MaybeOk(ME_Error(QString(u8"Write simulator field %1 fail! %2").arg(_fieldName).arg(statusToString(status))));
+	}
+	return MM_MaybeOk();
+}
+
+QVariant MD_OpcUaSimulatorServer::getFieldValue(const QString& _fieldName) const
+{
+	if (!m_server || !m_fieldTypes.count(_fieldName))
+	{
+		return QVariant();
+	}
+	UA_Variant val;
+	UA_Variant_init(&val);
+	auto nodeId = makeNodeId(m_nameSpaceId, _fieldName);
+	auto status = UA_Server_readValue(m_server, nodeId, &val);
+	UA_NodeId_clear(&nodeId);
+	QVariant result;
+	if (status == UA_STATUSCODE_GOOD)
+	{
+		result = toQVariant(val);
+	}
+	UA_Variant_clear(&val);
+	return result;
+}
+
+void MD_OpcUaSimulatorServer::setReadyToReceiveTooling(bool _isReady)
+{
+	setFieldValue(MI_Device::s_isReadyToReceiveToolingStateName, _isReady
+		? MS_IsReadyReceiveAndSendToolingState::HAS_READY : MS_IsReadyReceiveAndSendToolingState::NOT_READY);
+}
+
+void MD_OpcUaSimulatorServer::setReadyToSendTooling(bool _isReady)
+{
+	setFieldValue(MI_Device::s_isReadyToSendToolingStateName, _isReady
+		? MS_IsReadyReceiveAndSendToolingState::HAS_READY : MS_IsReadyReceiveAndSendToolingState::NOT_READY);
+}
+
+void MD_OpcUaSimulatorServer::triggerRequireData(quint16 _identifierType, const QByteArray& _identifier)
+{
+	setFieldValue(MI_Device::s_deviceRequireDataExecuteStateName, MS_ExecuteState::NOT_EXECUTE);
+	setFieldValue(MI_Device::s_deviceRequireDataToolingIdentifierTypeName, _identifierType);
+	setFieldValue(MI_Device::s_deviceRequireDataToolingIdentifierName, _identifier);
+	setFieldValue(MI_Device::s_deviceRequireDataCommandName, MS_DeviceRequireDataState::REQUIRE);
+}
+
+void MD_OpcUaSimulatorServer::triggerUploadData(quint16 _identifierType, const QByteArray& _identifier, quint64 _toolingIndex, const QByteArray& _content)
+{
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataExecuteStateName, MS_ExecuteState::NOT_EXECUTE);
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierTypeName, _identifierType);
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataToolingIdentifierName, _identifier);
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataToolingIndexName, _toolingIndex);
+	auto content = _content;
+	if (m_behavior.m_toolingPayloadCodec != static_cast<quint16>(ME_ToolingPayloadCodec::NONE))
+	{
+		content = MA_ToolingPayloadCodec::encode(_content, static_cast<ME_ToolingPayloadCodec>(m_behavior.m_toolingPayloadCodec));
+	}
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataContentName, content);
+	setFieldValue(MI_GS600PDeviceField::s_deviceUploadWorkResultDataContentLengthName, static_cast<quint32>(content.size()));
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataToolingDataIsValidName, MS_DataValidState::IS_VALID);
+	setFieldValue(MI_Device::s_deviceUploadWorkResultDataCommandName, MS_DeviceReuireUploadDataState::REQUIRE);
+}
+
+void MD_OpcUaSimulatorServer::onClientWrite(const QString& _fieldName, const QVariant& _val)
+{
+	emit sig_fieldWritten(_fieldName, _val);
+	if (m_writeHook && m_writeHook(_fieldName, _val))
+	{
+		return;
+	}
+
+	auto uint16Val = _val.value<quint16>();
+
+	//规划状态->规划应答
+	static const std::map<QString, QString> s_planFields{
+		{ MI_Device::s_receiveToolingBeInPlanningStateName, MI_Device::s_receiveToolingBeInPlanningRespondName },
+		{ MI_Device::s_sendToolingBeInPlanningStateName, MI_Device::s_sendToolingBeInPlanningRespondName },
+		{ MI_Device::s_deviceReceiveSendWaferBeInPlanningKeyName, MI_Device::s_deviceReceiveSendWaferBeInPlanningRespondKeyName } };
+	auto planIter = s_planFields.find(_fieldName);
+	if (planIter != s_planFields.end())
+	{
+		if (uint16Val == MI_PlanState::BE_IN_PLANNING)
+		{
+			respondPlan(planIter->second);
+		}
+		return;
+	}
+
+	//指令->执行状态
+	static const std::map<QString, QString> s_commandFields{
+		{ MI_Device::s_initCommandSendName, MI_Device::s_initCommandExecuteStateName },
+		{ MI_Device::s_receiveToolingCommandName, MI_Device::s_receiveToolingCommandExecuteStateName },
+		{ MI_Device::s_sendToolingCommandName, MI_Device::s_sendToolingCommandExecuteStateName },
+		{ MI_Device::s_deviceReceivceSendWaferCommandKeyName, MI_Device::s_deviceReceivceSendWaferCommandExecuteStateKeyName } };
+	auto commandIter = s_commandFields.find(_fieldName);
+	if (commandIter != s_commandFields.end())
+	{
+		if (uint16Val == MI_SendCommand::NEED_EXECUTE)
+		{
+			executeCommand(commandIter->first, commandIter->second);
+		}
+		return;
+	}
+
+	if (_fieldName == MI_Device::s_deviceRequireDataExecuteStateName && uint16Val == MS_ExecuteState::FINIHED)
+	{
+		//定长节点按长度字段截取实际内容
+		auto content = getFieldValue(MI_Device::s_deviceRequireDataToolingDataContentName).toByteArray();
+		if (m_fixedByteStrings.count(MI_Device::s_deviceRequireDataToolingDataContentName))
+		{
+			content = content.left(getFieldValue(MI_GS600PDeviceField::s_deviceRequireDataToolingDataContentLengthName).value<quint32>());
+		}
+		if (m_behavior.m_toolingPayloadCodec != static_cast<quint16>(ME_ToolingPayloadCodec::NONE))
+		{
+			auto encodedContent = content;
+			MA_ToolingPayloadCodec::decode(encodedContent, &content);
+		}
+		emit sig_requireDataFinished(content,
+			getFieldValue(MI_Device::s_deviceRequireDataToolingIndexName).value<quint64>(),
+			getFieldValue(MI_Device::s_deviceRequireDataToolingDataIsValidName).value<quint16>() == MS_DataValidState::IS_VALID,
+			getFieldValue(MI_Device::s_deviceRequireDataToolingIfDoAllName).value<quint16>() == MS_IfWorkToolingDoAllFlag::DO_ALL);
+		return;
+	}
+
+	if (_fieldName == MI_Device::s_deviceUploadWorkResultDataExecuteStateName && uint16Val == MS_ExecuteState::FINIHED)
+	{
+		emit sig_uploadDataFinished();
+		return;
+	}
+}
+
+void MD_OpcUaSimulatorServer::respondPlan(const QString& _respondFieldName)
+{
+	auto respondVal = m_behavior.m_planRespondVal;
+	QTimer::singleShot(m_behavior.m_planRespondDelayMs, this, [=]()
+	{
+		setFieldValue(_respondFieldName, respondVal);
+	});
+}
+
+void MD_OpcUaSimulatorServer::executeCommand(const QString& _commandFieldName, const QString& _executeStateFieldName)
+{
+	auto behavior = m_behavior;
+	QTimer::singleShot(behavior.m_commandExecutingDelayMs, this, [=]()
+	{
+		setFieldValue(_executeStateFieldName, MS_ExecuteState::EXECUTING);
+		QTimer::singleShot(behavior.m_commandFinishDelayMs, this, [=]()
+		{
+			if (behavior.m_isResetCommandOnFinish)
+			{
+				setFieldValue(_commandFieldName, MI_SendCommand::NOT_EXECUTE);
+			}
+			setFieldValue(_executeStateFieldName, behavior.m_commandFinalState);
+		});
+	});
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "MI_Device.h"
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <functional>
+#include <map>
+
+struct UA_Server;
+class QTimer;
+
+//模拟设备的行为参数
+struct MS_SimulatorBehavior
+{
+	//收到规划状态后多久应答,应答值
+	int m_planRespondDelayMs{ 10 };
+	quint16 m_planRespondVal{ MI_PlanRespond::ALLOWED_PLAN };
+
+	//收到指令后多久置执行中,再多久置最终状态
+	int m_commandExecutingDelayMs{ 10 };
+	int m_commandFinishDelayMs{ 50 };
+	quint16 m_commandFinalState{ MS_ExecuteState::FINIHED };
+	//完成后是否复位指令
+	bool m_isResetCommandOnFinish{ true };
+
+	//设备类型字段的值,需与控制类的通讯设备类型一致
+	quint16 m_deviceType{ 0 };
+
+	//工装数据内容节点的定长容量(字节),不为0时请求数据/上传数据内容按PLC定长字节数组模拟:
+	//支持IndexRange分块读写,实际长度由MI_GS600PDeviceField中的长度字段给出;0 为变长节点(整块传输)
+	int m_toolingDataContentCapacity{ 0 };
+	//载荷编码能力字段的值(ME_ToolingPayloadCodec),不为NONE时下发的内容按帧头解码,上传的内容按此编码
+	quint16 m_toolingPayloadCodec{ 0 };
+};
+
+/**
+ * 本地OPC UA模拟服务器(open62541)
+ * 只监听回环地址,在MI_Device::s_nameSpaceName命名空间下按字段名建立字符串NodeId变量,
+ * 覆盖MC_OpcDeviceControl/MC_GS600PDeviceControlBase用到的全部字段,
+ * 按MS_SimulatorBehavior模拟规划应答、指令执行状态推进、请求数据及上传数据(可按定长内容节点模拟分块传输),
+ * 用于在无PLC的环境下测握手吞吐和回归
+ * 服务器在所属线程的事件循环中迭代,可moveToThread到单独线程
+ */
+class MD_OpcUaSimulatorServer : public QObject
+{
+	Q_OBJECT
+
+public:
+	MD_OpcUaSimulatorServer(QObject *_parent = nullptr);
+	~MD_OpcUaSimulatorServer();
+
+	//客户端写入字段后调用,返回true表示已自行处理,不再执行默认行为
+	using MT_WriteHook = std::function<bool(const QString& _fieldName, const QVariant& _val)>;
+
+	MS_SimulatorBehavior getBehavior() const { return m_behavior; }
+	void setBehavior(const MS_SimulatorBehavior& _val) { m_behavior = _val; }
+	void setWriteHook(MT_WriteHook _val) { m_writeHook = std::move(_val); }
+
+	quint16 getPort() const { return m_port; }
+	QString getEndpointUrl() const;
+	bool isRunning() const { return m_server != nullptr; }
+
+	//客户端写入次数
+	quint64 getClientWriteCount() const { return m_clientWriteCount; }
+
+signals:
+	void sig_fieldWritten(const QString& _fieldName, const QVariant& _val);
+	//客户端完成一次请求数据(已写入数据并置完成)
+	void sig_requireDataFinished(const QByteArray& _content, quint64 _toolingIndex, bool _isValid, bool _isDoAll);
+	//客户端完成一次上传数据的读取
+	void sig_uploadDataFinished();
+
+public slots:
+	MP_Public::MM_MaybeOk start(quint16 _port = 4840);
+	void stop();
+
+	//服务端写字段,不触发模拟行为
+	MP_Public::MM_MaybeOk setFieldValue(const QString& _fieldName, const QVariant& _val);
+	QVariant getFieldValue(const QString& _fieldName) const;
+
+	//收送板就绪
+	void setReadyToReceiveTooling(bool _isReady);
+	void setReadyToSendTooling(bool _isReady);
+	//设备发起请求数据
+	void triggerRequireData(quint16 _identifierType, const QByteArray& _identifier);
+	//设备发起上传数据
+	void triggerUploadData(quint16 _identifierType, const QByteArray& _identifier, quint64 _toolingIndex, const QByteArray& _content);
+
+private:
+	enum class ME_FieldType
+	{
+		UINT16,
+		UINT32,
+		UINT64,
+		BYTE_STRING
+	};
+
+	MP_Public::MM_MaybeOk addFields();
+	void onClientWrite(const QString& _fieldName, const QVariant& _val);
+	void respondPlan(const QString& _respondFieldName);
+	void executeCommand(const QString& _commandFieldName, const QString& _executeStateFieldName);
+	void iterate();
+
+	UA_Server* m_server{};
+	QTimer* m_iterateTimer{};
+	quint16 m_port{ 4840 };
+	quint16 m_nameSpaceId{ 0 };
+	std::map<QString, ME_FieldType> m_fieldTypes;
+	//定长内容节点的数据,由数据源回调读写
+	std::map<QString, QByteArray> m_fixedByteStrings;
+	MS_SimulatorBehavior m_behavior;
+	MT_WriteHook m_writeHook;
+	//服务端自身写入时置位,避免回调中当作客户端写入
+	bool m_isInternalWrite{ false };
+	quint64 m_clientWriteCount{ 0 };
+};
@@ -0,0 +1,8 @@
+#include "MI_GS600PDeviceField.h"
+
+namespace MI_GS600PDeviceField
+{
+	const QString s_deviceToolingPayloadCodecName = u8"DeviceToolingPayloadCodec";
+	const QString s_deviceRequireDataToolingDataContentLengthName = u8"DeviceRequireDataToolingDataContentLength";
+	const QString s_deviceUploadWorkResultDataContentLengthName = u8"DeviceUploadWorkResultDataContentLength";
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QString>
+
+//GS600P在MI_Device通用字段之外扩展的设备字段名
+namespace MI_GS600PDeviceField
+{
+	//设备能力字段:设备可解码并用于上传的载荷编码(UInt16),见ME_ToolingPayloadCodec
+	extern const QString s_deviceToolingPayloadCodecName;
+	//请求数据内容的实际长度(UInt32),内容分块下发时使用,见MS_ByteStringChunkParam::m_lengthKeyName
+	extern const QString s_deviceRequireDataToolingDataContentLengthName;
+	//上传数据内容的实际长度(UInt32),内容分块读取时使用
+	extern const QString s_deviceUploadWorkResultDataContentLengthName;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "MC_OpcUaSessionSnapshot.h"
+#include <QHostAddress>
+#include <QObject>
+#include <QUrl>
+#include <QtOpcUa>
+
+/**
+ * MC_OpcUaClient使用的后端接口
+ * 实际实现为MD_OpcUaClientDevice;基准测试中替换为空后端,使客户端自身的请求流程可单独测量
+ */
+class MI_OpcUaClientBackend : public QObject
+{
+	Q_OBJECT
+
+public:
+	MI_OpcUaClientBackend(QObject *_parent = nullptr) : QObject(_parent) {}
+	virtual ~MI_OpcUaClientBackend() {}
+
+	virtual QUrl getServerUrl() = 0;
+
+signals:
+	void sig_connected(const MP_Public::MM_MaybeOk& _isConnectOK);
+	void sig_disconnected();
+	void sig_errorChanged(QOpcUaClient::ClientError _error);
+	void sig_stateChanged(QOpcUaClient::ClientState _state);
+	void sig_updateArrayNamespaceFinished(const MP_Public::MM_MaybeOk& _isSuccess);
+	//快照中的命名空间索引与服务器不一致(已按服务器更新),需重建节点连接
+	void sig_namespaceIndexChanged(quint16 _nameSpaceId);
+	//保活读取连续超时,连接已判定失效并断开
+	void sig_keepAliveTimeout();
+	//每次保活读取的往返耗时及结果,超时未应答按BadTimeout上报一次
+	void sig_keepAliveResult(qint64 _latencyUs, QOpcUa::UaStatusCode _status);
+	void sig_readNodeAttributesFinished(QVector<QOpcUaReadResult> results, QOpcUa::UaStatusCode serviceResult);
+	void sig_writeNodeAttributesFinished(QVector<QOpcUaWriteResult> _results, QOpcUa::UaStatusCode _serviceResult);
+
+public:
+	virtual MP_Public::MM_MaybeOk createClient() = 0;
+	virtual MP_Public::MM_MaybeOk tryConnectServer(const QHostAddress& _hostAddress, quint16 _port) = 0;
+	virtual QOpcUaClient::ClientState getConnectState() = 0;
+	virtual void disconnectServer() = 0;
+	//中止进行中的连接(超时),不影响下次连接沿用会话
+	virtual void abortConnect() = 0;
+	virtual MP_Public::MM_MaybeOk updateArrayNamespace() = 0;
+	virtual QOpcUaNode* getNode(const QString& _valeName) = 0;
+	virtual QOpcUaNode* getNode(quint16 _namespaceId, const QString& _name) = 0;
+	virtual quint16 getNamespaceId() const = 0;
+	//批量读写,结果通过sig_readNodeAttributesFinished/sig_writeNodeAttributesFinished按下发顺序返回
+	virtual MP_Public::MM_MaybeOk readNodeAttributes(const QVector<QOpcUaReadItem>& _nodesToRead) = 0;
+	virtual MP_Public::MM_MaybeOk writeNodeAttributes(const QVector<QOpcUaWriteItem>& _nodesToWrite) = 0;
+
+	//是否由快照(或上次会话)直接连接端点
+	virtual bool getIsWarmStarted() const = 0;
+	//本次连接是否沿用了上次会话的节点对象(节点上的监控需重新开启,信号连接仍有效)
+	virtual bool getIsSessionResumed() const = 0;
+	//释放全部节点对象,上层需重建监控及信号连接
+	virtual void clearNodes() = 0;
+
+	virtual void setIsKeepAliveEnabled(bool _val) = 0;
+	virtual void setKeepAliveIntervalMs(int _val) = 0;
+	virtual void setKeepAliveTimeoutMs(int _val) = 0;
+	virtual void setKeepAliveMaxMissCount(int _val) = 0;
+	//当前连接的快照(未连接或未解析命名空间时为空)
+	virtual boost::optional<MS_OpcUaServerSnapshot> getServerSnapshot() = 0;
+
+	virtual MP_Public::MM_MaybeOk startTrafficRecording(const QString& _filePath) = 0;
+	virtual void stopTrafficRecording() = 0;
+};
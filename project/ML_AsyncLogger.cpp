@@ -0,0 +1,294 @@
+#include "ML_AsyncLogger.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <chrono>
+
+namespace
+{
+	//环形队列容量
+	constexpr std::size_t s_ringCapacity = 8192;
+	//空闲多久刷新一次文件(也是后台线程空闲等待的最长时间)
+	constexpr int s_flushIntervalMs = 200;
+
+	const char* labelToString(ML_LogLabel _label)
+	{
+		switch (_label)
+		{
+		case ML_LogLabel::NORMAL_LABEL:
+			return "NORMAL";
+		case ML_LogLabel::WARNING_LABEL:
+			return "WARNING";
+		case ML_LogLabel::ERROR_LABEL:
+			return "ERROR";
+		default:
+			break;
+		}
+		return "UNKNOWN";
+	}
+}
+
+ML_AsyncLogger& ML_AsyncLogger::instance()
+{
+	static ML_AsyncLogger s_instance;
+	return s_instance;
+}
+
+ML_AsyncLogger::ML_AsyncLogger()
+	: QObject(nullptr),
+	m_ring(s_ringCapacity)
+{
+	qRegisterMetaType<quintptr>("quintptr");
+	qRegisterMetaType<ML_LogLabel>("ML_LogLabel");
+}
+
+ML_AsyncLogger::~ML_AsyncLogger()
+{
+	stop();
+}
+
+qint64 ML_AsyncLogger::currentMSecsSinceEpoch()
+{
+	return QDateTime::currentMSecsSinceEpoch();
+}
+
+QString ML_AsyncLogger::getFilePath() const
+{
+	QMutexLocker locker(&m_filePathMutex);
+	return m_filePath;
+}
+
+void ML_AsyncLogger::setFilePath(const QString& _val)
+{
+	QMutexLocker locker(&m_filePathMutex);
+	m_filePath = _val;
+}
+
+void ML_AsyncLogger::setEchoTarget(quintptr _owner, QObject* _context, MT_EchoFunction _echo)
+{
+	QMutexLocker locker(&m_echoTargetsMutex);
+	auto& echoTarget = m_echoTargets[_owner];
+	echoTarget.m_context = _context;
+	echoTarget.m_echo = std::move(_echo);
+}
+
+void ML_AsyncLogger::removeEchoTarget(quintptr _owner)
+{
+	QMutexLocker locker(&m_echoTargetsMutex);
+	m_echoTargets.erase(_owner);
+}
+
+void ML_AsyncLogger::push(ML_LogRecord&& _record)
+{
+	if (!m_isStarted.load(std::memory_order_acquire))
+	{
+		auto isStarted = false;
+		if (m_isStarted.compare_exchange_strong(isStarted, true))
+		{
+			m_isRunning = true;
+			m_thread.reset(new std::thread([=]()
+			{
+				run();
+			}));
+		}
+	}
+
+	if (!m_ring.tryPush(std::move(_record)))
+	{
+		++m_droppedCount;
+		return;
+	}
+	++m_pushedCount;
+
+	//与后台线程"置等待标志后再取一次"配对,二者至少有一方能看到对方
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_isWorkerWaiting.load())
+	{
+		std::lock_guard<std::mutex> locker(m_wakeMutex);
+		m_wakeCondition.notify_one();
+	}
+}
+
+void ML_AsyncLogger::flush()
+{
+	if (!m_isRunning)
+	{
+		return;
+	}
+	auto targetCount = m_pushedCount.load();
+	std::unique_lock<std::mutex> locker(m_wakeMutex);
+	m_wakeCondition.notify_one();
+	m_writtenCondition.wait(locker, [&]()
+	{
+		return !m_isRunning || m_writtenCount.load() >= targetCount;
+	});
+}
+
+void ML_AsyncLogger::stop()
+{
+	{
+		std::lock_guard<std::mutex> locker(m_wakeMutex);
+		m_isRunning = false;
+		m_wakeCondition.notify_one();
+		m_writtenCondition.notify_all();
+	}
+	if (m_thread && m_thread->joinable())
+	{
+		m_thread->join();
+	}
+	m_thread.reset();
+}
+
+void ML_AsyncLogger::run()
+{
+	auto filePath = getFilePath();
+	if (filePath.isEmpty())
+	{
+		filePath = QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation))
+			.filePath(QString(u8"log/asyncLog_%1.log").arg(QDate::currentDate().toString(u8"yyyyMMdd")));
+	}
+	QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+	QFile file(filePath);
+	auto isFileOpen = file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+
+	quint64 reportedDroppedCount = 0;
+	auto isDirty = false;
+	auto lastFlushTime = std::chrono::steady_clock::now();
+
+	ML_LogRecord logRecord;
+	auto hasRecord = false;
+	for (;;)
+	{
+		if (hasRecord || m_ring.tryPop(logRecord))
+		{
+			hasRecord = false;
+			auto text = format(logRecord);
+			if (isFileOpen)
+			{
+				stream << QDateTime::fromMSecsSinceEpoch(logRecord.m_msecsSinceEpoch).toString(u8"yyyy-MM-dd hh:mm:ss.zzz")
+					<< u8" [" << labelToString(logRecord.m_label) << u8"] " << text << u8"\n";
+				isDirty = true;
+			}
+			if (m_isEchoEnabled)
+			{
+				echo(logRecord, text);
+			}
+			logRecord = ML_LogRecord();
+			++m_writtenCount;
+			continue;
+		}
+
+		auto droppedCount = m_droppedCount.load();
+		if (droppedCount != reportedDroppedCount && isFileOpen)
+		{
+			stream << QDateTime::currentDateTime().toString(u8"yyyy-MM-dd hh:mm:ss.zzz")
+				<< u8" [WARNING] " << QString(u8"日志队列已满,丢弃%1条").arg(droppedCount - reportedDroppedCount) << u8"\n";
+			reportedDroppedCount = droppedCount;
+			isDirty = true;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (isDirty && now - lastFlushTime >= std::chrono::milliseconds(s_flushIntervalMs))
+		{
+			stream.flush();
+			isDirty = false;
+			lastFlushTime = now;
+		}
+
+		std::unique_lock<std::mutex> locker(m_wakeMutex);
+		//持锁通知,flush检查写出数与等待之间不会漏掉
+		m_writtenCondition.notify_all();
+		if (!m_isRunning)
+		{
+			break;
+		}
+		m_isWorkerWaiting = true;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		hasRecord = m_ring.tryPop(logRecord);
+		if (!hasRecord)
+		{
+			m_wakeCondition.wait_for(locker, std::chrono::milliseconds(s_flushIntervalMs));
+		}
+		m_isWorkerWaiting = false;
+	}
+
+	stream.flush();
+}
+
+void ML_AsyncLogger::echo(const ML_LogRecord& _record, const QString& _text)
+{
+	QMutexLocker locker(&m_echoTargetsMutex);
+	auto iter = m_echoTargets.find(_record.m_owner);
+	if (iter == m_echoTargets.end())
+	{
+		locker.unlock();
+		emit sig_logFormatted(_record.m_owner, _record.m_label, _text);
+		return;
+	}
+	//持锁投递,removeEchoTarget返回后不会再向_context投递
+	auto echoFunction = iter->second.m_echo;
+	auto label = _record.m_label;
+	QMetaObject::invokeMethod(iter->second.m_context, [=]()
+	{
+		echoFunction(label, _text);
+	}, Qt::QueuedConnection);
+}
+
+QString ML_AsyncLogger::format(const ML_LogRecord& _record) const
+{
+	//一次替换全部占位符,参数内容中的%N不会被再次替换
+	auto text = QString::fromUtf8(_record.m_format);
+	std::array<QString, ML_LogRecord::s_maxArgCount> args;
+	for (auto curIndex = 0; curIndex < _record.m_argCount; ++curIndex)
+	{
+		args[curIndex] = argToString(_record.m_args[curIndex]);
+	}
+	switch (_record.m_argCount)
+	{
+	case 1:
+		return text.arg(args[0]);
+	case 2:
+		return text.arg(args[0], args[1]);
+	case 3:
+		return text.arg(args[0], args[1], args[2]);
+	case 4:
+		return text.arg(args[0], args[1], args[2], args[3]);
+	default:
+		break;
+	}
+	return text;
+}
+
+QString ML_AsyncLogger::argToString(const ML_LogArg& _arg) const
+{
+	switch (_arg.m_type)
+	{
+	case ML_LogArg::ME_Type::INT:
+		return QString::number(_arg.m_int);
+	case ML_LogArg::ME_Type::UINT:
+		return QString::number(_arg.m_uint);
+	case ML_LogArg::ME_Type::DOUBLE:
+		return QString::number(_arg.m_double);
+	case ML_LogArg::ME_Type::STRING:
+		return _arg.m_string;
+	case ML_LogArg::ME_Type::BYTES:
+	{
+		auto maxLength = m_maxBytesArgLength.load();
+		if (maxLength >= 0 && _arg.m_bytes.size() > maxLength)
+		{
+			return QString::fromUtf8(_arg.m_bytes.left(maxLength))
+				+ QString(u8"...(%1 bytes)").arg(_arg.m_bytes.size());
+		}
+		return QString::fromUtf8(_arg.m_bytes);
+	}
+	default:
+		break;
+	}
+	return QString();
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "ML_LogBase.h"
+#include "ML_LockFreeRing.h"
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+//日志参数,只保存原始值,格式化在后台线程完成
+struct ML_LogArg
+{
+	enum class ME_Type
+	{
+		NONE,
+		INT,
+		UINT,
+		DOUBLE,
+		STRING,
+		BYTES
+	};
+
+	ME_Type m_type{ ME_Type::NONE };
+	qint64 m_int{ 0 };
+	quint64 m_uint{ 0 };
+	double m_double{ 0 };
+	//隐式共享,入队不拷贝数据
+	QString m_string;
+	QByteArray m_bytes;
+};
+
+//一条日志记录
+struct ML_LogRecord
+{
+	static constexpr int s_maxArgCount = 4;
+
+	//记录者,用于回显时区分来源
+	quintptr m_owner{ 0 };
+	ML_LogLabel m_label{ ML_LogLabel::NORMAL_LABEL };
+	qint64 m_msecsSinceEpoch{ 0 };
+	//格式串须为静态字符串(u8字面量),使用%1~%4占位
+	const char* m_format{};
+	int m_argCount{ 0 };
+	std::array<ML_LogArg, s_maxArgCount> m_args;
+};
+
+/**
+ * 异步日志
+ * 调用线程只把格式串指针和原始参数写入无锁队列,格式化与写文件在后台线程完成,
+ * 队列满时丢弃并计数,不阻塞握手流程;
+ * 格式化后的文本按记录者回显到setEchoTarget登记的对象,未登记的记录者通过sig_logFormatted回显
+ */
+class ML_AsyncLogger : public QObject
+{
+	Q_OBJECT
+
+public:
+	static ML_AsyncLogger& instance();
+	~ML_AsyncLogger();
+
+	//须在第一次记录前设置,默认 AppLocalDataLocation/log/asyncLog_yyyyMMdd.log
+	QString getFilePath() const;
+	void setFilePath(const QString& _val);
+
+	bool getIsEchoEnabled() const { return m_isEchoEnabled; }
+	void setIsEchoEnabled(bool _val) { m_isEchoEnabled = _val; }
+
+	//字节数组参数输出的最大长度,超出部分只记录长度
+	int getMaxBytesArgLength() const { return m_maxBytesArgLength; }
+	void setMaxBytesArgLength(int _val) { m_maxBytesArgLength = _val; }
+
+	using MT_EchoFunction = std::function<void(ML_LogLabel, const QString&)>;
+	//该记录者的日志在_context所在线程回显,_context析构前须调用removeEchoTarget
+	void setEchoTarget(quintptr _owner, QObject* _context, MT_EchoFunction _echo);
+	void removeEchoTarget(quintptr _owner);
+
+	quint64 getDroppedCount() const { return m_droppedCount.load(); }
+	quint64 getWrittenCount() const { return m_writtenCount.load(); }
+
+	template<typename... Args>
+	void record(quintptr _owner, ML_LogLabel _label, const char* _format, Args&&... _args)
+	{
+		static_assert(sizeof...(Args) <= ML_LogRecord::s_maxArgCount, "Too many log args!");
+		ML_LogRecord logRecord;
+		logRecord.m_owner = _owner;
+		logRecord.m_label = _label;
+		logRecord.m_msecsSinceEpoch = currentMSecsSinceEpoch();
+		logRecord.m_format = _format;
+		fillArgs(logRecord, std::forward<Args>(_args)...);
+		push(std::move(logRecord));
+	}
+
+	//等待队列中的日志全部写出
+	void flush();
+	void stop();
+
+signals:
+	void sig_logFormatted(quintptr _owner, ML_LogLabel _label, const QString& _text);
+
+private:
+	ML_AsyncLogger();
+
+	static qint64 currentMSecsSinceEpoch();
+
+	void push(ML_LogRecord&& _record);
+	void run();
+	void echo(const ML_LogRecord& _record, const QString& _text);
+	QString format(const ML_LogRecord& _record) const;
+	QString argToString(const ML_LogArg& _arg) const;
+
+	static void fillArgs(ML_LogRecord&) {}
+	template<typename T, typename... Args>
+	static void fillArgs(ML_LogRecord& _record, T&& _val, Args&&... _args)
+	{
+		setArg(_record.m_args[_record.m_argCount++], std::forward<T>(_val));
+		fillArgs(_record, std::forward<Args>(_args)...);
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value && std::is_signed<typename std::decay<T>::type>::value>::type
+		setArg(ML_LogArg& _arg, T _val) { _arg.m_type = ML_LogArg::ME_Type::INT; _arg.m_int = _val; }
+	template<typename T>
+	static typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value && !std::is_signed<typename std::decay<T>::type>::value>::type
+		setArg(ML_LogArg& _arg, T _val) { _arg.m_type = ML_LogArg::ME_Type::UINT; _arg.m_uint = _val; }
+	template<typename T>
+	static typename std::enable_if<std::is_enum<typename std::decay<T>::type>::value>::type
+		setArg(ML_LogArg& _arg, T _val) { _arg.m_type = ML_LogArg::ME_Type::INT; _arg.m_int = static_cast<qint64>(_val); }
+	static void setArg(ML_LogArg& _arg, double _val) { _arg.m_type = ML_LogArg::ME_Type::DOUBLE; _arg.m_double = _val; }
+	static void setArg(ML_LogArg& _arg, const QString& _val) { _arg.m_type = ML_LogArg::ME_Type::STRING; _arg.m_string = _val; }
+	static void setArg(ML_LogArg& _arg, const QByteArray& _val) { _arg.m_type = ML_LogArg::ME_Type::BYTES; _arg.m_bytes = _val; }
+
+	ML_LockFreeRing<ML_LogRecord> m_ring;
+	std::unique_ptr<std::thread> m_thread;
+	std::atomic_bool m_isRunning{ false };
+	std::atomic_bool m_isStarted{ false };
+	std::atomic<quint64> m_pushedCount{ 0 };
+	std::atomic<quint64> m_writtenCount{ 0 };
+	std::atomic<quint64> m_droppedCount{ 0 };
+
+	//后台线程空闲时在m_wakeCondition上等待,入队时仅在其等待时唤醒
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic_bool m_isWorkerWaiting{ false };
+	//flush等待写出
+	std::condition_variable m_writtenCondition;
+
+	mutable QMutex m_filePathMutex;
+	QString m_filePath;
+	std::atomic_bool m_isEchoEnabled{ true };
+	std::atomic<int> m_maxBytesArgLength{ 256 };
+
+	struct MS_EchoTarget
+	{
+		QObject* m_context{};
+		MT_EchoFunction m_echo;
+	};
+	QMutex m_echoTargetsMutex;
+	std::map<quintptr, MS_EchoTarget> m_echoTargets;
+};
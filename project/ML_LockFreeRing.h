@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * 有界无锁环形队列(多生产者多消费者)
+ * 每个槽位带序号,生产者/消费者只通过CAS推进各自的位置,队列满时tryPush直接返回false,不阻塞调用线程
+ */
+template<typename T>
+class ML_LockFreeRing
+{
+public:
+	//容量向上取整为2的幂
+	explicit ML_LockFreeRing(std::size_t _capacity)
+	{
+		std::size_t capacity = 2;
+		while (capacity < _capacity)
+		{
+			capacity <<= 1;
+		}
+		m_mask = capacity - 1;
+		m_cells.reset(new MS_Cell[capacity]);
+		for (std::size_t curIndex = 0; curIndex < capacity; ++curIndex)
+		{
+			m_cells[curIndex].m_sequence.store(curIndex, std::memory_order_relaxed);
+		}
+		m_enqueuePos.store(0, std::memory_order_relaxed);
+		m_dequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	ML_LockFreeRing(const ML_LockFreeRing&) = delete;
+	ML_LockFreeRing& operator=(const ML_LockFreeRing&) = delete;
+
+	std::size_t capacity() const { return m_mask + 1; }
+
+	bool tryPush(T&& _val)
+	{
+		MS_Cell* cell{};
+		auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &m_cells[pos & m_mask];
+			auto sequence = cell->m_sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+			if (diff == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				//已满
+				return false;
+			}
+			else
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		cell->m_data = std::move(_val);
+		cell->m_sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T& _val)
+	{
+		MS_Cell* cell{};
+		auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &m_cells[pos & m_mask];
+			auto sequence = cell->m_sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+			if (diff == 0)
+			{
+				if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				//为空
+				return false;
+			}
+			else
+			{
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+		_val = std::move(cell->m_data);
+		//释放槽位中的数据(如隐式共享的QByteArray),不在队列里长期持有
+		cell->m_data = T();
+		cell->m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct MS_Cell
+	{
+		std::atomic<std::size_t> m_sequence;
+		T m_data;
+	};
+
+	std::unique_ptr<MS_Cell[]> m_cells;
+	std::size_t m_mask{ 0 };
+
+	alignas(64) std::atomic<std::size_t> m_enqueuePos;
+	alignas(64) std::atomic<std::size_t> m_dequeuePos;
+};
@@ -0,0 +1,195 @@
+#include "ML_TraceRecorder.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <chrono>
+#include <map>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	constexpr std::size_t s_ringCapacity = 65536;
+}
+
+ML_TraceRecorder& ML_TraceRecorder::instance()
+{
+	static ML_TraceRecorder s_instance;
+	return s_instance;
+}
+
+ML_TraceRecorder::ML_TraceRecorder()
+	: m_ring(s_ringCapacity)
+{
+}
+
+qint64 ML_TraceRecorder::currentTimestampUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ML_TraceSpan ML_TraceRecorder::beginSpan(const QString& _device, const char* _category, const char* _step, quint64 _requestId)
+{
+	if (!getIsEnabled())
+	{
+		return {};
+	}
+
+	ML_TraceSpan span;
+	span.m_spanId = m_nextSpanId++;
+	span.m_device = _device;
+	span.m_category = _category;
+	span.m_step = _step;
+	span.m_requestId = _requestId;
+
+	ML_TraceEvent event;
+	event.m_phase = 'b';
+	event.m_timestampUs = currentTimestampUs();
+	event.m_spanId = span.m_spanId;
+	event.m_device = _device;
+	event.m_category = _category;
+	event.m_step = _step;
+	event.m_requestId = _requestId;
+	push(std::move(event));
+	return span;
+}
+
+void ML_TraceRecorder::endSpan(const ML_TraceSpan& _span)
+{
+	if (!_span.isValid())
+	{
+		return;
+	}
+
+	ML_TraceEvent event;
+	event.m_phase = 'e';
+	event.m_timestampUs = currentTimestampUs();
+	event.m_spanId = _span.m_spanId;
+	event.m_device = _span.m_device;
+	event.m_category = _span.m_category;
+	event.m_step = _span.m_step;
+	event.m_requestId = _span.m_requestId;
+	push(std::move(event));
+}
+
+void ML_TraceRecorder::instant(const QString& _device, const char* _category, const char* _step, quint64 _requestId)
+{
+	if (!getIsEnabled())
+	{
+		return;
+	}
+
+	ML_TraceEvent event;
+	event.m_phase = 'n';
+	event.m_timestampUs = currentTimestampUs();
+	event.m_spanId = m_nextSpanId++;
+	event.m_device = _device;
+	event.m_category = _category;
+	event.m_step = _step;
+	event.m_requestId = _requestId;
+	push(std::move(event));
+}
+
+void ML_TraceRecorder::push(ML_TraceEvent&& _event)
+{
+	if (!m_ring.tryPush(std::move(_event)))
+	{
+		//队列满时先转移到导出缓存再重试一次
+		drain();
+		if (!m_ring.tryPush(std::move(_event)))
+		{
+			++m_droppedCount;
+		}
+	}
+}
+
+void ML_TraceRecorder::drain()
+{
+	QMutexLocker locker(&m_eventsMutex);
+	ML_TraceEvent event;
+	while (m_ring.tryPop(event))
+	{
+		m_events.push_back(std::move(event));
+		event = ML_TraceEvent();
+	}
+	while (m_maxEventCount > 0 && m_events.size() > static_cast<std::size_t>(m_maxEventCount))
+	{
+		m_events.pop_front();
+		++m_droppedCount;
+	}
+}
+
+void ML_TraceRecorder::clear()
+{
+	drain();
+	QMutexLocker locker(&m_eventsMutex);
+	m_events.clear();
+}
+
+MM_MaybeOk ML_TraceRecorder::exportChromeTrace(const QString& _filePath)
+{
+	drain();
+
+	QJsonArray traceEvents;
+	{
+		QMutexLocker locker(&m_eventsMutex);
+
+		//每个设备一行
+		std::map<QString, int> deviceLanes;
+		for (const auto& var : m_events)
+		{
+			if (deviceLanes.count(var.m_device))
+			{
+				continue;
+			}
+			auto lane = static_cast<int>(deviceLanes.size()) + 1;
+			deviceLanes[var.m_device] = lane;
+
+			QJsonObject metaEvent;
+			metaEvent[u8"name"] = u8"thread_name";
+			metaEvent[u8"ph"] = u8"M";
+			metaEvent[u8"pid"] = 1;
+			metaEvent[u8"tid"] = lane;
+			metaEvent[u8"args"] = QJsonObject{ { u8"name", var.m_device } };
+			traceEvents.append(metaEvent);
+		}
+
+		for (const auto& var : m_events)
+		{
+			QJsonObject traceEvent;
+			traceEvent[u8"name"] = QString::fromUtf8(var.m_step ? var.m_step : "");
+			traceEvent[u8"cat"] = QString::fromUtf8(var.m_category ? var.m_category : "");
+			traceEvent[u8"ph"] = QString(QChar(var.m_phase));
+			traceEvent[u8"ts"] = static_cast<double>(var.m_timestampUs);
+			traceEvent[u8"pid"] = 1;
+			traceEvent[u8"tid"] = deviceLanes[var.m_device];
+			traceEvent[u8"id"] = QString(u8"0x%1").arg(var.m_spanId, 0, 16);
+			traceEvent[u8"args"] = QJsonObject{
+				{ u8"device", var.m_device },
+				{ u8"requestId", static_cast<double>(var.m_requestId) } };
+			traceEvents.append(traceEvent);
+		}
+	}
+
+	QJsonObject root;
+	root[u8"traceEvents"] = traceEvents;
+	root[u8"displayTimeUnit"] = u8"ms";
+
+	QDir().mkpath(QFileInfo(_filePath).absolutePath());
+	QSaveFile file(_filePath);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return MM_MaybeOk(ME_Error(u8"Open trace file fail! " + file.errorString()));
+	}
+	file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+	if (!file.commit())
+	{
+		return MM_MaybeOk(ME_Error(u8"Write trace file fail! " + file.errorString()));
+	}
+	return MM_MaybeOk();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "ML_LockFreeRing.h"
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <deque>
+
+//一个追踪区间,beginSpan返回,endSpan时原样传回
+struct ML_TraceSpan
+{
+	//0 表示未记录(追踪未开启)
+	quint64 m_spanId{ 0 };
+	QString m_device;
+	const char* m_category{};
+	const char* m_step{};
+	quint64 m_requestId{ 0 };
+
+	bool isValid() const { return m_spanId != 0; }
+};
+
+//追踪事件
+struct ML_TraceEvent
+{
+	//'b' 开始 'e' 结束 'n' 瞬时
+	char m_phase{ 'n' };
+	//单调时钟,微秒
+	qint64 m_timestampUs{ 0 };
+	quint64 m_spanId{ 0 };
+	QString m_device;
+	const char* m_category{};
+	const char* m_step{};
+	quint64 m_requestId{ 0 };
+};
+
+/**
+ * 握手耗时追踪
+ * 状态进入/退出及OPC UA请求/应答处记录区间,调用线程只写入无锁队列,
+ * 导出为Chrome trace JSON(chrome://tracing 或 Perfetto 打开),每个设备一行,可看出每次收送片的关键路径
+ * 步骤名/分类须为静态字符串
+ */
+class ML_TraceRecorder
+{
+public:
+	static ML_TraceRecorder& instance();
+
+	//默认关闭,关闭时记录接口直接返回
+	bool getIsEnabled() const { return m_isEnabled.load(std::memory_order_relaxed); }
+	void setIsEnabled(bool _val) { m_isEnabled = _val; }
+
+	//导出时保留的最大事件数,超出丢弃最早的
+	int getMaxEventCount() const { return m_maxEventCount; }
+	void setMaxEventCount(int _val) { m_maxEventCount = _val; }
+
+	quint64 getDroppedCount() const { return m_droppedCount.load(); }
+
+	//生成一个请求ID,用于把同一次收送片的多个步骤关联起来
+	quint64 nextRequestId() { return m_nextRequestId++; }
+
+	ML_TraceSpan beginSpan(const QString& _device, const char* _category, const char* _step, quint64 _requestId = 0);
+	void endSpan(const ML_TraceSpan& _span);
+	void instant(const QString& _device, const char* _category, const char* _step, quint64 _requestId = 0);
+
+	//导出到Chrome trace JSON文件,已导出的事件仍保留,可多次导出
+	MP_Public::MM_MaybeOk exportChromeTrace(const QString& _filePath);
+	void clear();
+
+private:
+	ML_TraceRecorder();
+	ML_TraceRecorder(const ML_TraceRecorder&) = delete;
+	ML_TraceRecorder& operator=(const ML_TraceRecorder&) = delete;
+
+	static qint64 currentTimestampUs();
+	void push(ML_TraceEvent&& _event);
+	void drain();
+
+	ML_LockFreeRing<ML_TraceEvent> m_ring;
+	std::atomic_bool m_isEnabled{ false };
+	std::atomic<quint64> m_nextSpanId{ 1 };
+	std::atomic<quint64> m_nextRequestId{ 1 };
+	std::atomic<quint64> m_droppedCount{ 0 };
+
+	QMutex m_eventsMutex;
+	std::deque<ML_TraceEvent> m_events;
+	int m_maxEventCount{ 200000 };
+};
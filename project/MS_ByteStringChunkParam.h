@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QString>
+
+//大ByteString分块传输参数
+struct MS_ByteStringChunkParam
+{
+	//每块字节数,0 表示不分块
+	int m_chunkSize{ 0 };
+	//同时在途的块数,其余读写请求可在块之间穿插
+	int m_maxInFlightCount{ 4 };
+	//单块失败后的重试次数
+	int m_maxRetryCount{ 2 };
+	//内容实际长度字段(UInt32),内容节点为定长数组时必须设置:写入时内容写完后写该字段,读取时先读该字段并只读到该长度
+	//为空时读取到不足一块或超出范围为止
+	QString m_lengthKeyName;
+};
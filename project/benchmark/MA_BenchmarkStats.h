@@ -0,0 +1,106 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QString>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+//基准测试样本(微秒)及统计,输出为JSON供CI趋势跟踪
+class MA_BenchmarkSamples
+{
+public:
+	void add(qint64 _valueUs) { m_valuesUs.emplace_back(_valueUs); }
+	void addFailure() { ++m_failCount; }
+	void clear() { m_valuesUs.clear(); m_failCount = 0; }
+
+	//合并其他样本(如多个工位)
+	void append(const MA_BenchmarkSamples& _other)
+	{
+		m_valuesUs.insert(m_valuesUs.end(), _other.m_valuesUs.begin(), _other.m_valuesUs.end());
+		m_failCount += _other.m_failCount;
+	}
+
+	int getCount() const { return static_cast<int>(m_valuesUs.size()); }
+	int getFailCount() const { return m_failCount; }
+	int getCountAbove(qint64 _thresholdUs) const
+	{
+		return static_cast<int>(std::count_if(m_valuesUs.begin(), m_valuesUs.end(), [=](qint64 _val) { return _val > _thresholdUs; }));
+	}
+
+	//nearest-rank,_quantile 取 0~1
+	qint64 getPercentileUs(double _quantile) const
+	{
+		if (m_valuesUs.empty())
+		{
+			return 0;
+		}
+		auto values = m_valuesUs;
+		auto rank = static_cast<int>(std::ceil(_quantile * values.size())) - 1;
+		rank = std::min(static_cast<int>(values.size()) - 1, std::max(0, rank));
+		std::nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
+	double getMeanUs() const
+	{
+		if (m_valuesUs.empty())
+		{
+			return 0;
+		}
+		return std::accumulate(m_valuesUs.begin(), m_valuesUs.end(), 0.0) / m_valuesUs.size();
+	}
+
+	qint64 getMaxUs() const
+	{
+		return m_valuesUs.empty() ? 0 : *std::max_element(m_valuesUs.begin(), m_valuesUs.end());
+	}
+
+	//_elapsedUs 为整段耗时,大于0时附带吞吐(次/秒)
+	QJsonObject toJson(const QString& _name, qint64 _elapsedUs = 0) const
+	{
+		QJsonObject result;
+		result[u8"name"] = _name;
+		result[u8"count"] = getCount();
+		result[u8"failCount"] = getFailCount();
+		result[u8"meanUs"] = getMeanUs();
+		result[u8"p50Us"] = static_cast<double>(getPercentileUs(0.5));
+		result[u8"p90Us"] = static_cast<double>(getPercentileUs(0.9));
+		result[u8"p99Us"] = static_cast<double>(getPercentileUs(0.99));
+		result[u8"maxUs"] = static_cast<double>(getMaxUs());
+		if (_elapsedUs > 0)
+		{
+			result[u8"elapsedUs"] = static_cast<double>(_elapsedUs);
+			result[u8"opsPerSecond"] = getCount() * 1e6 / _elapsedUs;
+		}
+		return result;
+	}
+
+private:
+	std::vector<qint64> m_valuesUs;
+	int m_failCount{ 0 };
+};
+
+//写入基准测试报告(先写临时文件再替换,中途失败不留下半个文件)
+inline MP_Public::MM_MaybeOk writeBenchmarkReport(const QJsonObject& _report, const QString& _filePath)
+{
+	QDir().mkpath(QFileInfo(_filePath).absolutePath());
+	QSaveFile file(_filePath);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return MP_Public::MM_MaybeOk(MP_Public::ME_Error(u8"Open benchmark report fail! " + file.errorString()));
+	}
+	file.write(QJsonDocument(_report).toJson(QJsonDocument::Indented));
+	if (!file.commit())
+	{
+		return MP_Public::MM_MaybeOk(MP_Public::ME_Error(u8"Write benchmark report fail! " + file.errorString()));
+	}
+	return MP_Public::MM_MaybeOk();
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//阻止编译器把基准中的结果优化掉
+template<typename T>
+inline void doNotOptimize(const T& _val)
+{
+#if defined(_MSC_VER)
+	static const void* volatile s_sink = nullptr;
+	s_sink = &_val;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "m"(_val) : "memory");
+#endif
+}
+
+/**
+ * 微基准的单次运行状态,用法同 Google Benchmark:
+ *   while (_state.keepRunning()) { ...被测代码... }
+ * 循环外的准备/清理不计时,需在循环内排除的部分用 pauseTiming/resumeTiming 包围
+ */
+class MA_MicroBenchmarkState
+{
+public:
+	explicit MA_MicroBenchmarkState(qint64 _iterationCount)
+		: m_iterationCount(_iterationCount),
+		m_remainCount(_iterationCount)
+	{
+	}
+
+	bool keepRunning()
+	{
+		if (!m_isStarted)
+		{
+			m_isStarted = true;
+			m_timer.start();
+		}
+		if (m_remainCount-- > 0)
+		{
+			return true;
+		}
+		pauseTiming();
+		return false;
+	}
+
+	void pauseTiming()
+	{
+		if (m_timer.isValid())
+		{
+			m_elapsedNs += m_timer.nsecsElapsed();
+			m_timer.invalidate();
+		}
+	}
+
+	void resumeTiming()
+	{
+		m_timer.start();
+	}
+
+	//每次迭代处理的条目数(如批量大小),用于换算单条耗时
+	void setItemsPerIteration(qint64 _val) { m_itemsPerIteration = _val; }
+	qint64 getItemsPerIteration() const { return m_itemsPerIteration; }
+
+	qint64 getIterationCount() const { return m_iterationCount; }
+	qint64 getElapsedNs() const { return m_elapsedNs; }
+
+private:
+	qint64 m_iterationCount{ 0 };
+	qint64 m_remainCount{ 0 };
+	qint64 m_itemsPerIteration{ 1 };
+	qint64 m_elapsedNs{ 0 };
+	bool m_isStarted{ false };
+	QElapsedTimer m_timer;
+};
+
+/**
+ * 微基准集合
+ * 每个用例先按10倍递增迭代次数直到单轮耗时达到m_minTimeMs,再以该次数重复m_repetitionCount轮,
+ * 输出每轮的单次耗时(纳秒)统计
+ */
+class MA_MicroBenchmarkSuite
+{
+public:
+	using MT_BenchmarkFun = std::function<void(MA_MicroBenchmarkState&)>;
+
+	void add(const QString& _name, MT_BenchmarkFun _fun) { m_cases.emplace_back(_name, std::move(_fun)); }
+
+	int getMinTimeMs() const { return m_minTimeMs; }
+	void setMinTimeMs(int _val) { m_minTimeMs = std::max(1, _val); }
+	int getRepetitionCount() const { return m_repetitionCount; }
+	void setRepetitionCount(int _val) { m_repetitionCount = std::max(1, _val); }
+	//只运行名称匹配的用例,空为全部
+	void setFilter(const QString& _val) { m_filter = _val; }
+
+	QJsonArray run() const
+	{
+		QJsonArray results;
+		QRegularExpression filter(m_filter);
+		for (const auto& var : m_cases)
+		{
+			if (!m_filter.isEmpty() && !filter.match(var.first).hasMatch())
+			{
+				continue;
+			}
+			results.append(runCase(var.first, var.second));
+		}
+		return results;
+	}
+
+private:
+	QJsonObject runCase(const QString& _name, const MT_BenchmarkFun& _fun) const
+	{
+		constexpr qint64 maxIterationCount = 1000000000;
+		const qint64 minTimeNs = static_cast<qint64>(m_minTimeMs) * 1000000;
+
+		qint64 iterationCount = 1;
+		for (;;)
+		{
+			MA_MicroBenchmarkState state(iterationCount);
+			_fun(state);
+			if (state.getElapsedNs() >= minTimeNs || iterationCount >= maxIterationCount)
+			{
+				break;
+			}
+			//按已测耗时估算,最多放大10倍
+			auto scale = state.getElapsedNs() > 0 ? static_cast<double>(minTimeNs) * 1.4 / state.getElapsedNs() : 10.0;
+			iterationCount = std::min(maxIterationCount, static_cast<qint64>(iterationCount * std::min(10.0, std::max(2.0, scale))));
+		}
+
+		std::vector<double> nsPerItems;
+		qint64 itemsPerIteration = 1;
+		for (auto curIndex = 0; curIndex < m_repetitionCount; ++curIndex)
+		{
+			MA_MicroBenchmarkState state(iterationCount);
+			_fun(state);
+			itemsPerIteration = std::max<qint64>(1, state.getItemsPerIteration());
+			nsPerItems.emplace_back(static_cast<double>(state.getElapsedNs()) / (iterationCount * itemsPerIteration));
+		}
+		std::sort(nsPerItems.begin(), nsPerItems.end());
+
+		QJsonObject result;
+		result[u8"name"] = _name;
+		result[u8"iterations"] = static_cast<double>(iterationCount);
+		result[u8"itemsPerIteration"] = static_cast<double>(itemsPerIteration);
+		result[u8"repetitions"] = m_repetitionCount;
+		result[u8"meanNs"] = std::accumulate(nsPerItems.begin(), nsPerItems.end(), 0.0) / nsPerItems.size();
+		result[u8"medianNs"] = nsPerItems[nsPerItems.size() / 2];
+		result[u8"minNs"] = nsPerItems.front();
+		result[u8"maxNs"] = nsPerItems.back();
+		return result;
+	}
+
+	std::vector<std::pair<QString, MT_BenchmarkFun>> m_cases;
+	int m_minTimeMs{ 200 };
+	int m_repetitionCount{ 5 };
+	QString m_filter;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QtGlobal>
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <QFile>
+#include <sys/resource.h>
+#endif
+
+//进程资源占用快照
+struct MS_ProcessUsage
+{
+	//用户态+内核态累计CPU时间
+	qint64 m_cpuTimeUs{ 0 };
+	//常驻内存
+	qint64 m_residentBytes{ 0 };
+	int m_threadCount{ 0 };
+};
+
+inline MS_ProcessUsage sampleProcessUsage()
+{
+	MS_ProcessUsage usage;
+#if defined(Q_OS_WIN)
+	FILETIME createTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &kernelTime, &userTime))
+	{
+		auto toUs = [](const FILETIME& _val)
+		{
+			return static_cast<qint64>((static_cast<quint64>(_val.dwHighDateTime) << 32 | _val.dwLowDateTime) / 10);
+		};
+		usage.m_cpuTimeUs = toUs(kernelTime) + toUs(userTime);
+	}
+
+	PROCESS_MEMORY_COUNTERS memoryCounters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+	{
+		usage.m_residentBytes = static_cast<qint64>(memoryCounters.WorkingSetSize);
+	}
+
+	auto snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+	if (snapshot != INVALID_HANDLE_VALUE)
+	{
+		THREADENTRY32 entry;
+		entry.dwSize = sizeof(entry);
+		auto processId = GetCurrentProcessId();
+		for (auto isOk = Thread32First(snapshot, &entry); isOk; isOk = Thread32Next(snapshot, &entry))
+		{
+			if (entry.th32OwnerProcessID == processId)
+			{
+				++usage.m_threadCount;
+			}
+		}
+		CloseHandle(snapshot);
+	}
+#else
+	rusage resourceUsage;
+	if (getrusage(RUSAGE_SELF, &resourceUsage) == 0)
+	{
+		usage.m_cpuTimeUs = static_cast<qint64>(resourceUsage.ru_utime.tv_sec + resourceUsage.ru_stime.tv_sec) * 1000000
+			+ resourceUsage.ru_utime.tv_usec + resourceUsage.ru_stime.tv_usec;
+	}
+
+	//VmRSS/Threads 见 proc(5)
+	QFile file(u8"/proc/self/status");
+	if (file.open(QIODevice::ReadOnly))
+	{
+		for (const auto& var : file.readAll().split('\n'))
+		{
+			if (var.startsWith("VmRSS:"))
+			{
+				usage.m_residentBytes = var.mid(6).trimmed().split(' ').value(0).toLongLong() * 1024;
+			}
+			else if (var.startsWith("Threads:"))
+			{
+				usage.m_threadCount = var.mid(8).trimmed().toInt();
+			}
+		}
+	}
+#endif
+	return usage;
+}
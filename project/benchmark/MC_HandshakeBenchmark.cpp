@@ -0,0 +1,575 @@
+#include "MC_HandshakeBenchmark.h"
+#include "MC_StationCycleRunner.h"
+#include "MC_OpcUaClient.h"
+#include "MC_OpcDeviceControl.h"
+#include "MC_GS600PDeviceControlBase.h"
+#include "MR_WorkToolingData.h"
+#include "MI_ToolingIdentifier.h"
+#include <QDateTime>
+#include <QHostAddress>
+#include <QThread>
+#include <QTimer>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	//批量读取用的字段
+	const std::vector<QString> s_batchReadFields{
+		MI_Device::s_deviceStateName,
+		MI_Device::s_deviceBeLockedName,
+		MI_Device::s_deviceWorkAreaWorkStateName,
+		MI_Device::s_deviceWorkAreaIfHasToolingName,
+		MI_Device::s_initCommandExecuteStateName,
+		MI_Device::s_isReadyToReceiveToolingStateName,
+		MI_Device::s_receiveToolingBeInPlanningStateName,
+		MI_Device::s_receiveToolingBeInPlanningRespondName,
+		MI_Device::s_receiveToolingCommandExecuteStateName,
+		MI_Device::s_isReadyToSendToolingStateName,
+		MI_Device::s_sendToolingBeInPlanningStateName,
+		MI_Device::s_sendToolingBeInPlanningRespondName,
+		MI_Device::s_sendToolingCommandExecuteStateName,
+		MI_Device::s_deviceRequireDataCommandName,
+		MI_Device::s_deviceRequireDataExecuteStateName,
+		MI_Device::s_deviceUploadWorkResultDataCommandName };
+}
+
+MC_HandshakeBenchmark::MC_HandshakeBenchmark(const MS_HandshakeBenchmarkConfig& _config, QObject *_parent)
+	: QObject(_parent),
+	m_config(_config)
+{
+}
+
+MC_HandshakeBenchmark::~MC_HandshakeBenchmark()
+{
+	if (m_serverThread)
+	{
+		m_serverThread->quit();
+		m_serverThread->wait();
+		delete m_serverThread;
+	}
+}
+
+QJsonObject MC_HandshakeBenchmark::getReport() const
+{
+	QJsonObject config;
+	config[u8"iterationCount"] = m_config.m_iterationCount;
+	config[u8"warmupCount"] = m_config.m_warmupCount;
+	config[u8"scalingCycleCount"] = m_config.m_scalingCycleCount;
+	config[u8"toolingDataSize"] = m_config.m_toolingDataSize;
+	config[u8"timeoutMs"] = m_config.m_timeoutMs;
+
+	QJsonObject report;
+	report[u8"benchmark"] = u8"handshake";
+	report[u8"timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+	report[u8"config"] = config;
+	report[u8"results"] = m_results;
+	if (!m_error.isEmpty())
+	{
+		report[u8"error"] = m_error;
+	}
+	return report;
+}
+
+MM_MaybeOk MC_HandshakeBenchmark::writeReport(const QJsonObject& _report, const QString& _filePath)
+{
+	return writeBenchmarkReport(_report, _filePath);
+}
+
+void MC_HandshakeBenchmark::start()
+{
+	m_steps.clear();
+	m_results = QJsonArray();
+	m_error.clear();
+
+	addStep([=]() { stepSetUp(); });
+	addStep([=]() { stepReadRtt(); });
+	addStep([=]() { stepWriteRtt(); });
+	for (auto var : m_config.m_batchSizes)
+	{
+		addStep([=]() { stepReadMulti(var); });
+	}
+	addStep([=]() { stepCommandLatency(); });
+	addStep([=]() { stepRequireDataRoundTrip(); });
+	addStep([=]() { stepUploadRoundTrip(); });
+	for (auto var : m_config.m_stationCounts)
+	{
+		addStep([=]() { stepStationScaling(var); });
+	}
+	addStep([=]() { stepTearDown(); });
+	nextStep();
+}
+
+void MC_HandshakeBenchmark::addStep(std::function<void()> _step)
+{
+	m_steps.emplace_back(std::move(_step));
+}
+
+void MC_HandshakeBenchmark::nextStep()
+{
+	if (m_steps.empty())
+	{
+		emit sig_finished(m_error.isEmpty() ? MM_MaybeOk() : MM_MaybeOk(ME_Error(m_error)));
+		return;
+	}
+	auto step = std::move(m_steps.front());
+	m_steps.pop_front();
+	//排队执行,避免在上一步的信号处理中嵌套
+	QMetaObject::invokeMethod(this, [=]()
+	{
+		step();
+	}, Qt::QueuedConnection);
+}
+
+void MC_HandshakeBenchmark::abort(const QString& _error)
+{
+	m_error = _error;
+	m_steps.clear();
+	addStep([=]() { stepTearDown(); });
+	nextStep();
+}
+
+void MC_HandshakeBenchmark::repeat(int _count, MT_Operation _operation, MT_RepeatFinished _onFinished)
+{
+	m_repeatState.m_totalCount = m_config.m_warmupCount + _count;
+	m_repeatState.m_index = 0;
+	m_repeatState.m_operation = std::move(_operation);
+	m_repeatState.m_onFinished = std::move(_onFinished);
+	m_repeatState.m_samples.clear();
+	runRepeatOnce();
+}
+
+void MC_HandshakeBenchmark::runRepeatOnce()
+{
+	auto& state = m_repeatState;
+	if (state.m_index >= state.m_totalCount)
+	{
+		auto onFinished = std::move(state.m_onFinished);
+		state.m_operation = nullptr;
+		onFinished(state.m_samples, state.m_elapsedTimer.nsecsElapsed() / 1000);
+		return;
+	}
+	if (state.m_index == m_config.m_warmupCount)
+	{
+		state.m_elapsedTimer.start();
+	}
+	auto isWarmup = state.m_index < m_config.m_warmupCount;
+	++state.m_index;
+
+	auto context = new QObject(this);
+	auto isDone = std::make_shared<bool>(false);
+	auto operationTimer = std::make_shared<QElapsedTimer>();
+	auto done = [=](bool _isOk)
+	{
+		if (*isDone)
+		{
+			return;
+		}
+		*isDone = true;
+		auto elapsedUs = operationTimer->nsecsElapsed() / 1000;
+		context->deleteLater();
+		if (!isWarmup)
+		{
+			if (_isOk)
+			{
+				m_repeatState.m_samples.add(elapsedUs);
+			}
+			else
+			{
+				m_repeatState.m_samples.addFailure();
+			}
+		}
+		QMetaObject::invokeMethod(this, [=]()
+		{
+			runRepeatOnce();
+		}, Qt::QueuedConnection);
+	};
+	QTimer::singleShot(m_config.m_timeoutMs, context, [=]()
+	{
+		done(false);
+	});
+	operationTimer->start();
+	state.m_operation(context, done);
+}
+
+MD_OpcUaSimulatorServer* MC_HandshakeBenchmark::createSimulator(quint16 _port, MM_MaybeOk& _result)
+{
+	MD_OpcUaSimulatorServer* simulator = nullptr;
+	auto behavior = m_config.m_behavior;
+	//在服务器线程中创建,迭代定时器属于该线程
+	QMetaObject::invokeMethod(m_serverThreadObject, [&]()
+	{
+		simulator = new MD_OpcUaSimulatorServer();
+		simulator->setBehavior(behavior);
+		_result = simulator->start(_port);
+		if (_result.hasError())
+		{
+			delete simulator;
+			simulator = nullptr;
+		}
+	}, Qt::BlockingQueuedConnection);
+	return simulator;
+}
+
+void MC_HandshakeBenchmark::destroySimulator(MD_OpcUaSimulatorServer* _simulator)
+{
+	if (!_simulator)
+	{
+		return;
+	}
+	QMetaObject::invokeMethod(m_serverThreadObject, [=]()
+	{
+		delete _simulator;
+	}, Qt::BlockingQueuedConnection);
+}
+
+void MC_HandshakeBenchmark::stepSetUp()
+{
+	m_serverThread = new QThread();
+	m_serverThreadObject = new QObject();
+	m_serverThreadObject->moveToThread(m_serverThread);
+	QObject::connect(m_serverThread, &QThread::finished, m_serverThreadObject, &QObject::deleteLater);
+	m_serverThread->start();
+
+	MM_MaybeOk result;
+	m_simulator = createSimulator(m_config.m_basePort, result);
+	if (!m_simulator)
+	{
+		abort(result.getError()->getMessage());
+		return;
+	}
+
+	m_client.reset(new MC_OpcUaClient());
+	m_control = new MC_GS600PDeviceControlBase(this);
+	QObject::connect(m_control, &MC_GS600PDeviceControlBase::sig_deviceRequireData, this, [=](const MI_ToolingIdentifier& _val)
+	{
+		m_control->onSendToolingData(MR_WorkToolingData(_val, 1, QByteArray(m_config.m_toolingDataSize, 'x')), true);
+	});
+	QObject::connect(m_control, &MC_GS600PDeviceControlBase::sig_deviceUploadData, this, [=](const MR_WorkToolingData&)
+	{
+		m_control->onHasUploadData();
+	});
+
+	//客户端及控制类各自建立一个会话
+	auto pendingCount = std::make_shared<int>(2);
+	auto object = new QObject(this);
+	auto onConnected = [=](const MM_MaybeOk& _val)
+	{
+		if (*pendingCount <= 0)
+		{
+			return;
+		}
+		if (_val.hasError())
+		{
+			*pendingCount = 0;
+			object->deleteLater();
+			abort(u8"Connect simulator fail! " + _val.getError()->getMessage());
+			return;
+		}
+		if (--*pendingCount > 0)
+		{
+			return;
+		}
+		object->deleteLater();
+		m_control->startWaitExecuteRequireData();
+		m_control->startWaitUploadData();
+		QTimer::singleShot(m_config.m_settleMs, this, [=]()
+		{
+			nextStep();
+		});
+	};
+	QObject::connect(m_client.get(), &MC_OpcUaClient::sig_connectResult, object, onConnected);
+	QObject::connect(m_control, &MC_GS600PDeviceControlBase::sig_connectResult, object, onConnected);
+	m_client->createAndConnectServer(QHostAddress::LocalHost, m_config.m_basePort);
+	m_control->tryConnect(QHostAddress::LocalHost, m_config.m_basePort);
+}
+
+void MC_HandshakeBenchmark::stepReadRtt()
+{
+	repeat(m_config.m_iterationCount, [=](QObject* _context, std::function<void(bool)> _done)
+	{
+		auto watch = m_client->readNodeVariable(MI_Device::s_deviceStateName);
+		QObject::connect(watch, &MC_FutureWatchBase::finished, _context, [=]()
+		{
+			watch->deleteLater();
+			_done(watch->getIsSuccess());
+		});
+	}, [=](const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)
+	{
+		m_results.append(_samples.toJson(u8"readNodeVariable", _elapsedUs));
+		nextStep();
+	});
+}
+
+void MC_HandshakeBenchmark::stepWriteRtt()
+{
+	repeat(m_config.m_iterationCount, [=](QObject* _context, std::function<void(bool)> _done)
+	{
+		auto watch = m_client->writeNodeVariable(MI_Device::s_deviceBeLockedName, MS_DeviceBeLockedState::Not_Be_Locked, QOpcUa::Types::UInt16);
+		QObject::connect(watch, &MC_FutureWatchBase::finished, _context, [=]()
+		{
+			watch->deleteLater();
+			_done(watch->getIsSuccess());
+		});
+	}, [=](const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)
+	{
+		m_results.append(_samples.toJson(u8"writeNodeVariable", _elapsedUs));
+		nextStep();
+	});
+}
+
+void MC_HandshakeBenchmark::stepReadMulti(int _batchSize)
+{
+	auto batchSize = std::min<int>(std::max(1, _batchSize), static_cast<int>(s_batchReadFields.size()));
+	std::vector<QString> keyNames(s_batchReadFields.begin(), s_batchReadFields.begin() + batchSize);
+	repeat(m_config.m_iterationCount, [=](QObject* _context, std::function<void(bool)> _done)
+	{
+		auto watch = m_client->readMultiNodeVariables(keyNames);
+		QObject::connect(watch, &MC_FutureWatchBase::finished, _context, [=]()
+		{
+			watch->deleteLater();
+			_done(watch->getIsSuccess());
+		});
+	}, [=](const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)
+	{
+		auto result = _samples.toJson(u8"readMultiNodeVariables", _elapsedUs);
+		result[u8"batchSize"] = batchSize;
+		if (_elapsedUs > 0)
+		{
+			result[u8"valuesPerSecond"] = _samples.getCount() * batchSize * 1e6 / _elapsedUs;
+		}
+		m_results.append(result);
+		nextStep();
+	});
+}
+
+void MC_HandshakeBenchmark::stepCommandLatency()
+{
+	//指令发送(startExecuteCommand返回)延时单独统计,repeat统计到执行完成
+	auto sendSamples = std::make_shared<MA_BenchmarkSamples>();
+	auto sendIndex = std::make_shared<int>(0);
+	repeat(m_config.m_iterationCount, [=](QObject* _context, std::function<void(bool)> _done)
+	{
+		auto isWarmup = (*sendIndex)++ < m_config.m_warmupCount;
+		auto sendTimer = std::make_shared<QElapsedTimer>();
+		sendTimer->start();
+		QObject::connect(m_control, &MC_GS600PDeviceControlBase::sig_startExecuteReceiveToolingCommandResult, _context, [=](const MM_MaybeOk& _val)
+		{
+			if (_val.hasError())
+			{
+				_done(false);
+				return;
+			}
+			if (!isWarmup)
+			{
+				sendSamples->add(sendTimer->nsecsElapsed() / 1000);
+			}
+		});
+		QObject::connect(m_control, &MC_GS600PDeviceControlBase::sig_receiveToolingCommandExecuteStateChanged, _context, [=](quint16 _state)
+		{
+			if (_state == MS_ExecuteState::FINIHED)
+			{
+				_done(true);
+			}
+			else if (_state == MS_ExecuteState::ERROR_EXECUTING)
+			{
+				_done(false);
+			}
+		});
+		m_control->executeReceiveToolingCommand();
+	}, [=](const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)
+	{
+		m_results.append(sendSamples->toJson(u8"startExecuteCommand.send"));
+		m_results.append(_samples.toJson(u8"startExecuteCommand.finish", _elapsedUs));
+		nextStep();
+	});
+}
+
+void MC_HandshakeBenchmark::stepRequireDataRoundTrip()
+{
+	auto identifierIndex = std::make_shared<int>(0);
+	repeat(m_config.m_iterationCount, [=](QObject* _context, std::function<void(bool)> _done)
+	{
+		QObject::connect(m_simulator, &MD_OpcUaSimulatorServer::sig_requireDataFinished, _context, [=]()
+		{
+			_done(true);
+		});
+		auto identifier = QByteArray::number(++*identifierIndex);
+		auto simulator = m_simulator;
+		QMetaObject::invokeMethod(simulator, [=]()
+		{
+			simulator->triggerRequireData(0, identifier);
+		});
+	}, [=](const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)
+	{
+		auto result = _samples.toJson(u8"requireToolingData", _elapsedUs);
+		result[u8"toolingDataSize"] = m_config.m_toolingDataSize;
+		m_results.append(result);
+		nextStep();
+	});
+}
+
+void MC_HandshakeBenchmark::stepUploadRoundTrip()
+{
+	auto identifierIndex = std::make_shared<int>(0);
+	auto content = QByteArray(m_config.m_toolingDataSize, 'y');
+	repeat(m_config.m_iterationCount, [=](QObject* _context, std::function<void(bool)> _done)
+	{
+		QObject::connect(m_simulator, &MD_OpcUaSimulatorServer::sig_uploadDataFinished, _context, [=]()
+		{
+			_done(true);
+		});
+		auto index = ++*identifierIndex;
+		auto simulator = m_simulator;
+		QMetaObject::invokeMethod(simulator, [=]()
+		{
+			simulator->triggerUploadData(0, QByteArray::number(index), static_cast<quint64>(index), content);
+		});
+	}, [=](const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)
+	{
+		auto result = _samples.toJson(u8"uploadToolingData", _elapsedUs);
+		result[u8"toolingDataSize"] = m_config.m_toolingDataSize;
+		m_results.append(result);
+		nextStep();
+	});
+}
+
+void MC_HandshakeBenchmark::stepStationScaling(int _stationCount)
+{
+	auto stepObject = new QObject(this);
+	std::vector<MD_OpcUaSimulatorServer*> simulators;
+	std::vector<MC_OpcDeviceControl*> controls;
+	for (auto curIndex = 0; curIndex < _stationCount; ++curIndex)
+	{
+		MM_MaybeOk result;
+		auto simulator = createSimulator(static_cast<quint16>(m_config.m_basePort + 1 + curIndex), result);
+		if (!simulator)
+		{
+			for (auto var : simulators)
+			{
+				destroySimulator(var);
+			}
+			delete stepObject;
+			abort(result.getError()->getMessage());
+			return;
+		}
+		simulators.emplace_back(simulator);
+		controls.emplace_back(new MC_OpcDeviceControl(QString(u8"station%1").arg(curIndex + 1), stepObject));
+	}
+
+	auto cleanUp = [=]()
+	{
+		for (auto var : controls)
+		{
+			var->disconnectServer();
+		}
+		stepObject->deleteLater();
+		for (auto var : simulators)
+		{
+			destroySimulator(var);
+		}
+	};
+
+	auto runners = std::make_shared<std::vector<MC_StationCycleRunner*>>();
+	auto runningCount = std::make_shared<int>(_stationCount);
+	auto elapsedTimer = std::make_shared<QElapsedTimer>();
+	auto onStationFinished = [=]()
+	{
+		if (--*runningCount > 0)
+		{
+			return;
+		}
+		auto elapsedUs = elapsedTimer->nsecsElapsed() / 1000;
+		QJsonArray perStation;
+		auto totalCount = 0;
+		auto failCount = 0;
+		for (auto var : *runners)
+		{
+			perStation.append(static_cast<double>(var->getSamples().getPercentileUs(0.99)));
+			totalCount += var->getSamples().getCount();
+			failCount += var->getSamples().getFailCount();
+		}
+		QJsonObject result;
+		result[u8"name"] = u8"stationScaling";
+		result[u8"stationCount"] = _stationCount;
+		result[u8"cycleCount"] = totalCount;
+		result[u8"failCount"] = failCount;
+		result[u8"elapsedUs"] = static_cast<double>(elapsedUs);
+		result[u8"cyclesPerSecond"] = elapsedUs > 0 ? totalCount * 1e6 / elapsedUs : 0.0;
+		result[u8"stationP99Us"] = perStation;
+		m_results.append(result);
+		cleanUp();
+		nextStep();
+	};
+
+	auto pendingCount = std::make_shared<int>(_stationCount);
+	auto connectObject = new QObject(stepObject);
+	for (auto var : controls)
+	{
+		QObject::connect(var, &MC_OpcDeviceControl::sig_connectResult, connectObject, [=](const MM_MaybeOk& _val)
+		{
+			if (*pendingCount <= 0)
+			{
+				return;
+			}
+			if (_val.hasError())
+			{
+				*pendingCount = 0;
+				cleanUp();
+				abort(u8"Connect simulator fail! " + _val.getError()->getMessage());
+				return;
+			}
+			if (--*pendingCount > 0)
+			{
+				return;
+			}
+			connectObject->deleteLater();
+			QTimer::singleShot(m_config.m_settleMs, stepObject, [=]()
+			{
+				elapsedTimer->start();
+				for (auto control : controls)
+				{
+					auto runner = new MC_StationCycleRunner(control, m_config.m_scalingCycleCount, m_config.m_timeoutMs, onStationFinished, stepObject);
+					runners->emplace_back(runner);
+				}
+				for (auto runner : *runners)
+				{
+					runner->start();
+				}
+			});
+		});
+	}
+	for (auto curIndex = 0; curIndex < _stationCount; ++curIndex)
+	{
+		controls[curIndex]->tryConnect(QHostAddress::LocalHost, static_cast<quint16>(m_config.m_basePort + 1 + curIndex));
+	}
+}
+
+void MC_HandshakeBenchmark::stepTearDown()
+{
+	if (m_control)
+	{
+		m_control->stopExecuteRequireData();
+		m_control->stopExecuteUploadData();
+		m_control->disconnectServer();
+		m_control->deleteLater();
+		m_control = nullptr;
+	}
+	if (m_client)
+	{
+		m_client->disConnectServer();
+		m_client.reset();
+	}
+	destroySimulator(m_simulator);
+	m_simulator = nullptr;
+	if (m_serverThread)
+	{
+		m_serverThread->quit();
+		m_serverThread->wait();
+		delete m_serverThread;
+		m_serverThread = nullptr;
+		m_serverThreadObject = nullptr;
+	}
+	nextStep();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "MD_OpcUaSimulatorServer.h"
+#include "MA_BenchmarkStats.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class MC_OpcUaClient;
+class MC_GS600PDeviceControlBase;
+class QThread;
+
+//握手基准测试参数
+struct MS_HandshakeBenchmarkConfig
+{
+	//模拟服务器端口,多工位测试依次加1
+	quint16 m_basePort{ 48400 };
+	//每项测量次数及预热次数
+	int m_iterationCount{ 200 };
+	int m_warmupCount{ 20 };
+	//批量读取的批大小
+	std::vector<int> m_batchSizes{ 1, 2, 4, 8, 16 };
+	//多工位测试的工位数及每个工位的收送晶圆次数
+	std::vector<int> m_stationCounts{ 1, 2, 4, 8, 16, 32 };
+	int m_scalingCycleCount{ 50 };
+	//单次操作超时,超时计为失败
+	int m_timeoutMs{ 5000 };
+	//连接后等待监控建立的时间
+	int m_settleMs{ 500 };
+	//工装数据大小(字节)
+	int m_toolingDataSize{ 1024 };
+	//模拟设备行为,默认无延时以测客户端本身开销
+	MS_SimulatorBehavior m_behavior{ 0, MI_PlanRespond::ALLOWED_PLAN, 0, 0, MS_ExecuteState::FINIHED, true, 0 };
+};
+
+/**
+ * 握手吞吐/延时基准测试
+ * 在回环地址启动MD_OpcUaSimulatorServer,依次测量:
+ * 单次读写往返、批量读取吞吐与批大小的关系、收板指令发送及完成延时、
+ * 工装数据请求/上传往返、多工位收送晶圆的并发伸缩曲线,结果为JSON
+ */
+class MC_HandshakeBenchmark : public QObject
+{
+	Q_OBJECT
+
+public:
+	MC_HandshakeBenchmark(const MS_HandshakeBenchmarkConfig& _config, QObject *_parent = nullptr);
+	~MC_HandshakeBenchmark();
+
+	QJsonObject getReport() const;
+	static MP_Public::MM_MaybeOk writeReport(const QJsonObject& _report, const QString& _filePath);
+
+signals:
+	void sig_finished(const MP_Public::MM_MaybeOk& _result);
+
+public slots:
+	void start();
+
+private:
+	//_context 在本次操作结束后释放,操作完成时调用_done
+	using MT_Operation = std::function<void(QObject* _context, std::function<void(bool _isOk)> _done)>;
+	using MT_RepeatFinished = std::function<void(const MA_BenchmarkSamples& _samples, qint64 _elapsedUs)>;
+
+	void addStep(std::function<void()> _step);
+	void nextStep();
+	void abort(const QString& _error);
+
+	void repeat(int _count, MT_Operation _operation, MT_RepeatFinished _onFinished);
+	void runRepeatOnce();
+
+	MD_OpcUaSimulatorServer* createSimulator(quint16 _port, MP_Public::MM_MaybeOk& _result);
+	void destroySimulator(MD_OpcUaSimulatorServer* _simulator);
+
+	void stepSetUp();
+	void stepReadRtt();
+	void stepWriteRtt();
+	void stepReadMulti(int _batchSize);
+	void stepCommandLatency();
+	void stepRequireDataRoundTrip();
+	void stepUploadRoundTrip();
+	void stepStationScaling(int _stationCount);
+	void stepTearDown();
+
+	MS_HandshakeBenchmarkConfig m_config;
+	std::deque<std::function<void()>> m_steps;
+	QJsonArray m_results;
+	QString m_error;
+
+	QThread* m_serverThread{};
+	QObject* m_serverThreadObject{};
+	MD_OpcUaSimulatorServer* m_simulator{};
+	std::shared_ptr<MC_OpcUaClient> m_client;
+	MC_GS600PDeviceControlBase* m_control{};
+
+	//repeat 的进行状态
+	struct MS_RepeatState
+	{
+		int m_totalCount{ 0 };
+		int m_index{ 0 };
+		MT_Operation m_operation;
+		MT_RepeatFinished m_onFinished;
+		MA_BenchmarkSamples m_samples;
+		QElapsedTimer m_elapsedTimer;
+	};
+	MS_RepeatState m_repeatState;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "MI_OpcUaClientBackend.h"
+#include <QObject>
+#include <QtOpcUa>
+#include <deque>
+#include <functional>
+
+/**
+ * 空后端:实现MI_OpcUaClientBackend,不经过网络,供真实的MC_OpcUaClient使用以单独测量客户端自身开销
+ * 读写请求先排队,completePendingRequests时按下发顺序以Good完成(与实际后端一样在调用返回后才有应答)
+ */
+class MC_NullOpcUaBackend : public MI_OpcUaClientBackend
+{
+	Q_OBJECT
+
+public:
+	MC_NullOpcUaBackend(QObject *_parent = nullptr) : MI_OpcUaClientBackend(_parent) {}
+
+	//读应答的值
+	void setReadValue(const QVariant& _val) { m_readValue = _val; }
+	//最近一次写请求最后一项的值
+	const QVariant& getLastWriteValue() const { return m_lastWriteValue; }
+
+	//完成全部排队的请求,完成过程中新下发的请求也一并完成
+	void completePendingRequests()
+	{
+		while (!m_pendingRequests.empty())
+		{
+			auto request = std::move(m_pendingRequests.front());
+			m_pendingRequests.pop_front();
+			request();
+		}
+	}
+
+	QUrl getServerUrl() override { return QUrl(); }
+
+	MP_Public::MM_MaybeOk createClient() override { return MP_Public::MM_MaybeOk(); }
+	MP_Public::MM_MaybeOk tryConnectServer(const QHostAddress&, quint16) override
+	{
+		m_connectState = QOpcUaClient::Connected;
+		emit sig_stateChanged(m_connectState);
+		emit sig_connected(MP_Public::MM_MaybeOk());
+		return MP_Public::MM_MaybeOk();
+	}
+	QOpcUaClient::ClientState getConnectState() override { return m_connectState; }
+	void disconnectServer() override
+	{
+		m_connectState = QOpcUaClient::Disconnected;
+		emit sig_stateChanged(m_connectState);
+	}
+	void abortConnect() override {}
+	MP_Public::MM_MaybeOk updateArrayNamespace() override
+	{
+		emit sig_updateArrayNamespaceFinished(MP_Public::MM_MaybeOk());
+		return MP_Public::MM_MaybeOk();
+	}
+	QOpcUaNode* getNode(const QString&) override { return nullptr; }
+	QOpcUaNode* getNode(quint16, const QString&) override { return nullptr; }
+	quint16 getNamespaceId() const override { return m_nameSpaceId; }
+
+	MP_Public::MM_MaybeOk readNodeAttributes(const QVector<QOpcUaReadItem>& _nodesToRead) override
+	{
+		QVector<QOpcUaReadResult> results;
+		results.reserve(_nodesToRead.size());
+		for (const auto& var : _nodesToRead)
+		{
+			QOpcUaReadResult result;
+			result.setNodeId(var.nodeId());
+			result.setAttribute(var.attribute());
+			result.setIndexRange(var.indexRange());
+			result.setStatusCode(QOpcUa::UaStatusCode::Good);
+			result.setValue(m_readValue);
+			results.push_back(result);
+		}
+		m_pendingRequests.emplace_back([=]()
+		{
+			emit sig_readNodeAttributesFinished(results, QOpcUa::UaStatusCode::Good);
+		});
+		return MP_Public::MM_MaybeOk();
+	}
+
+	MP_Public::MM_MaybeOk writeNodeAttributes(const QVector<QOpcUaWriteItem>& _nodesToWrite) override
+	{
+		QVector<QOpcUaWriteResult> results;
+		results.reserve(_nodesToWrite.size());
+		for (const auto& var : _nodesToWrite)
+		{
+			QOpcUaWriteResult result;
+			result.setNodeId(var.nodeId());
+			result.setAttribute(var.attribute());
+			result.setIndexRange(var.indexRange());
+			result.setStatusCode(QOpcUa::UaStatusCode::Good);
+			results.push_back(result);
+			m_lastWriteValue = var.value();
+		}
+		m_pendingRequests.emplace_back([=]()
+		{
+			emit sig_writeNodeAttributesFinished(results, QOpcUa::UaStatusCode::Good);
+		});
+		return MP_Public::MM_MaybeOk();
+	}
+
+	bool getIsWarmStarted() const override { return false; }
+	bool getIsSessionResumed() const override { return false; }
+	void clearNodes() override {}
+
+	void setIsKeepAliveEnabled(bool) override {}
+	void setKeepAliveIntervalMs(int) override {}
+	void setKeepAliveTimeoutMs(int) override {}
+	void setKeepAliveMaxMissCount(int) override {}
+	boost::optional<MS_OpcUaServerSnapshot> getServerSnapshot() override { return boost::none; }
+
+	MP_Public::MM_MaybeOk startTrafficRecording(const QString&) override { return MP_Public::MM_MaybeOk(); }
+	void stopTrafficRecording() override {}
+
+private:
+	quint16 m_nameSpaceId{ 2 };
+	QOpcUaClient::ClientState m_connectState{ QOpcUaClient::Disconnected };
+	QVariant m_readValue{ QVariant::fromValue<quint16>(0) };
+	QVariant m_lastWriteValue;
+	std::deque<std::function<void()>> m_pendingRequests;
+};
@@ -0,0 +1,94 @@
+#include "MC_StationCycleRunner.h"
+#include "MC_OpcDeviceControl.h"
+#include <QTimer>
+
+using MP_Public::MM_MaybeOk;
+
+MC_StationCycleRunner::MC_StationCycleRunner(MC_OpcDeviceControl* _control, int _cycleCount, int _timeoutMs, std::function<void()> _onFinished, QObject* _parent)
+	: QObject(_parent),
+	m_control(_control),
+	m_cycleCount(_cycleCount),
+	m_timeoutMs(_timeoutMs),
+	m_onFinished(std::move(_onFinished))
+{
+}
+
+void MC_StationCycleRunner::nextCycle()
+{
+	if (m_cycleIndex >= m_cycleCount)
+	{
+		m_onFinished();
+		return;
+	}
+	++m_cycleIndex;
+
+	auto context = new QObject(this);
+	m_cycleContext = context;
+	m_cycleTimer.start();
+
+	QObject::connect(m_control, &MC_OpcDeviceControl::sig_startExecutePlanReceiveSendWaferResult, context, [=](const MM_MaybeOk& _val)
+	{
+		if (_val.hasError())
+		{
+			finishCycle(context, false);
+		}
+	});
+	QObject::connect(m_control, &MC_OpcDeviceControl::sig_planReceiveAndSendWaferRespondChanged, context, [=](quint16 _state)
+	{
+		if (_state == MI_PlanRespond::ALLOWED_PLAN)
+		{
+			m_control->executeReceiveSendWaferCommand();
+		}
+		else if (_state == MI_PlanRespond::NOT_ALLOWED_PLAN)
+		{
+			finishCycle(context, false);
+		}
+	});
+	QObject::connect(m_control, &MC_OpcDeviceControl::sig_startExecuteReceiveSendWaferCommandResult, context, [=](const MM_MaybeOk& _val)
+	{
+		if (_val.hasError())
+		{
+			finishCycle(context, false);
+		}
+	});
+	QObject::connect(m_control, &MC_OpcDeviceControl::sig_receiveAndSendCommandExecuteStateChanged, context, [=](quint16 _state)
+	{
+		if (_state == MS_ExecuteState::FINIHED)
+		{
+			finishCycle(context, true);
+		}
+		else if (_state == MS_ExecuteState::ERROR_EXECUTING)
+		{
+			finishCycle(context, false);
+		}
+	});
+	QTimer::singleShot(m_timeoutMs, context, [=]()
+	{
+		finishCycle(context, false);
+	});
+
+	m_control->planReceiveSendWafer();
+}
+
+void MC_StationCycleRunner::finishCycle(QObject* _context, bool _isOk)
+{
+	if (_context != m_cycleContext)
+	{
+		return;
+	}
+	m_cycleContext = nullptr;
+	_context->deleteLater();
+
+	if (_isOk)
+	{
+		m_samples.add(m_cycleTimer.nsecsElapsed() / 1000);
+	}
+	else
+	{
+		m_samples.addFailure();
+	}
+	QTimer::singleShot(m_cycleIntervalMs, this, [=]()
+	{
+		nextCycle();
+	});
+}
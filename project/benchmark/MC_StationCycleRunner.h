@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MA_BenchmarkStats.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <functional>
+
+class MC_OpcDeviceControl;
+
+/**
+ * 单个工位的收送晶圆循环:规划->等待允许应答->指令->等待执行完成
+ * 超时或失败计为一次失败后继续下一次,须与_control在同一线程
+ */
+class MC_StationCycleRunner : public QObject
+{
+public:
+	MC_StationCycleRunner(MC_OpcDeviceControl* _control, int _cycleCount, int _timeoutMs, std::function<void()> _onFinished, QObject* _parent = nullptr);
+
+	//两次循环之间的间隔,0为上一次结束后立即开始
+	void setCycleIntervalMs(int _val) { m_cycleIntervalMs = _val; }
+
+	void start() { nextCycle(); }
+	const MA_BenchmarkSamples& getSamples() const { return m_samples; }
+
+private:
+	void nextCycle();
+	void finishCycle(QObject* _context, bool _isOk);
+
+	MC_OpcDeviceControl* m_control{};
+	int m_cycleCount{ 0 };
+	int m_cycleIndex{ 0 };
+	int m_timeoutMs{ 0 };
+	int m_cycleIntervalMs{ 0 };
+	std::function<void()> m_onFinished;
+	QObject* m_cycleContext{};
+	QElapsedTimer m_cycleTimer;
+	MA_BenchmarkSamples m_samples;
+};
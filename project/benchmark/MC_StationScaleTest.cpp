@@ -0,0 +1,436 @@
+#include "MC_StationScaleTest.h"
+#include "MC_StationCycleRunner.h"
+#include "MC_OpcDeviceControl.h"
+#include "MC_EventLoopLagMonitor.h"
+#include <QDateTime>
+#include <QHostAddress>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QTimer>
+
+using MP_Public::MM_MaybeOk;
+using MP_Public::ME_Error;
+
+namespace
+{
+	const QString s_mainThreadName{ u8"main" };
+
+	QJsonObject lagStatsToJson(const MS_EventLoopLagStats& _stats)
+	{
+		QJsonObject result;
+		result[u8"queueLatencyP50Us"] = static_cast<double>(_stats.m_queueLatencyP50Us);
+		result[u8"queueLatencyP99Us"] = static_cast<double>(_stats.m_queueLatencyP99Us);
+		result[u8"queueLatencyMaxUs"] = static_cast<double>(_stats.m_queueLatencyMaxUs);
+		result[u8"busyP99Us"] = static_cast<double>(_stats.m_busyP99Us);
+		result[u8"busyMaxUs"] = static_cast<double>(_stats.m_busyMaxUs);
+		result[u8"longEventCount"] = static_cast<double>(_stats.m_longEventCount);
+		result[u8"stallCount"] = static_cast<double>(_stats.m_stallCount);
+		return result;
+	}
+}
+
+//工作线程,m_object用于向线程投递调用
+struct MC_StationScaleTest::MS_WorkerThread
+{
+	QThread* m_thread{};
+	QObject* m_object{};
+};
+
+struct MC_StationScaleTest::MS_Station
+{
+	QString m_name;
+	quint16 m_port{ 0 };
+	std::shared_ptr<MS_WorkerThread> m_serverThread;
+	std::shared_ptr<MS_WorkerThread> m_controlThread;
+	MD_OpcUaSimulatorServer* m_simulator{};
+	//以下在控制线程中创建及访问
+	MC_OpcDeviceControl* m_control{};
+	MC_StationCycleRunner* m_runner{};
+	bool m_isConnectReported{ false };
+	bool m_isConnected{ false };
+};
+
+MC_StationScaleTest::MC_StationScaleTest(const MS_StationScaleTestConfig& _config, QObject *_parent)
+	: QObject(_parent),
+	m_config(_config)
+{
+}
+
+MC_StationScaleTest::~MC_StationScaleTest()
+{
+	tearDownScenario();
+	for (const auto& var : m_serverThreads)
+	{
+		stopWorkerThread(var);
+	}
+}
+
+QJsonObject MC_StationScaleTest::getReport() const
+{
+	QJsonObject config;
+	config[u8"serverThreadCount"] = m_config.m_serverThreadCount;
+	config[u8"controlThreadCount"] = m_config.m_controlThreadCount;
+	config[u8"cycleCount"] = m_config.m_cycleCount;
+	config[u8"cycleIntervalMs"] = m_config.m_cycleIntervalMs;
+	config[u8"timeoutMs"] = m_config.m_timeoutMs;
+	config[u8"deadlineMs"] = m_config.m_deadlineMs;
+	config[u8"lagProbeIntervalMs"] = m_config.m_lagProbeIntervalMs;
+
+	QJsonObject report;
+	report[u8"benchmark"] = u8"stationScale";
+	report[u8"timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+	report[u8"config"] = config;
+	report[u8"results"] = m_results;
+	if (!m_error.isEmpty())
+	{
+		report[u8"error"] = m_error;
+	}
+	return report;
+}
+
+std::shared_ptr<MC_StationScaleTest::MS_WorkerThread> MC_StationScaleTest::startWorkerThread(const QString& _lagThreadName)
+{
+	auto workerThread = std::make_shared<MS_WorkerThread>();
+	workerThread->m_thread = new QThread();
+	workerThread->m_object = new QObject();
+	workerThread->m_object->moveToThread(workerThread->m_thread);
+	QObject::connect(workerThread->m_thread, &QThread::finished, workerThread->m_object, &QObject::deleteLater);
+	workerThread->m_thread->start();
+
+	if (!_lagThreadName.isEmpty())
+	{
+		QMetaObject::invokeMethod(workerThread->m_object, [=]()
+		{
+			MC_EventLoopLagMonitor::instance().watchCurrentThread(_lagThreadName);
+		}, Qt::BlockingQueuedConnection);
+	}
+	return workerThread;
+}
+
+void MC_StationScaleTest::stopWorkerThread(const std::shared_ptr<MS_WorkerThread>& _thread)
+{
+	if (!_thread || !_thread->m_thread)
+	{
+		return;
+	}
+	_thread->m_thread->quit();
+	_thread->m_thread->wait();
+	delete _thread->m_thread;
+	_thread->m_thread = nullptr;
+	_thread->m_object = nullptr;
+}
+
+void MC_StationScaleTest::start()
+{
+	m_results = QJsonArray();
+	m_error.clear();
+	MC_EventLoopLagMonitor::instance().setProbeIntervalMs(m_config.m_lagProbeIntervalMs);
+	MC_EventLoopLagMonitor::instance().watchCurrentThread(s_mainThreadName);
+	for (auto curIndex = 0; curIndex < qMax(1, m_config.m_serverThreadCount); ++curIndex)
+	{
+		m_serverThreads.emplace_back(startWorkerThread(QString()));
+	}
+	runScenario(0);
+}
+
+void MC_StationScaleTest::runScenario(std::size_t _index)
+{
+	if (_index >= m_config.m_stationCounts.size())
+	{
+		for (const auto& var : m_serverThreads)
+		{
+			stopWorkerThread(var);
+		}
+		m_serverThreads.clear();
+		emit sig_finished(MM_MaybeOk());
+		return;
+	}
+
+	m_scenarioIndex = _index;
+	m_scenarioObject = new QObject(this);
+	m_connectFailCount = 0;
+	m_idleUsage = sampleProcessUsage();
+
+	auto stationCount = m_config.m_stationCounts[_index];
+	auto behavior = m_config.m_behavior;
+	for (auto curIndex = 0; curIndex < stationCount; ++curIndex)
+	{
+		auto station = std::make_shared<MS_Station>();
+		station->m_name = QString(u8"station%1").arg(curIndex + 1);
+		station->m_port = static_cast<quint16>(m_config.m_basePort + curIndex);
+		station->m_serverThread = m_serverThreads[curIndex % m_serverThreads.size()];
+
+		//在服务器线程中创建,迭代定时器属于该线程
+		MM_MaybeOk result;
+		QMetaObject::invokeMethod(station->m_serverThread->m_object, [&]()
+		{
+			station->m_simulator = new MD_OpcUaSimulatorServer();
+			station->m_simulator->setBehavior(behavior);
+			result = station->m_simulator->start(station->m_port);
+			if (result.hasError())
+			{
+				delete station->m_simulator;
+				station->m_simulator = nullptr;
+			}
+		}, Qt::BlockingQueuedConnection);
+		if (result.hasError())
+		{
+			abort(result.getError()->getMessage());
+			return;
+		}
+		m_stations.emplace_back(station);
+	}
+
+	//只有模拟服务器时的占用,用于从总占用中扣除
+	m_baselineStartUsage = sampleProcessUsage();
+	m_phaseTimer.start();
+	QTimer::singleShot(m_config.m_baselineMs, m_scenarioObject, [=]()
+	{
+		onBaselineFinished();
+	});
+}
+
+void MC_StationScaleTest::onBaselineFinished()
+{
+	m_baselineEndUsage = sampleProcessUsage();
+	m_baselineElapsedUs = m_phaseTimer.nsecsElapsed() / 1000;
+
+	auto stationCount = static_cast<int>(m_stations.size());
+	auto controlThreadCount = m_config.m_controlThreadCount > 0 ? qMin(m_config.m_controlThreadCount, stationCount) : stationCount;
+	for (auto curIndex = 0; curIndex < controlThreadCount; ++curIndex)
+	{
+		m_controlThreads.emplace_back(startWorkerThread(QString(u8"control%1").arg(curIndex + 1)));
+	}
+
+	m_pendingCount = stationCount;
+	for (auto curIndex = 0; curIndex < stationCount; ++curIndex)
+	{
+		auto station = m_stations[curIndex];
+		station->m_controlThread = m_controlThreads[curIndex % m_controlThreads.size()];
+		QMetaObject::invokeMethod(station->m_controlThread->m_object, [=]()
+		{
+			station->m_control = new MC_OpcDeviceControl(station->m_name);
+		}, Qt::BlockingQueuedConnection);
+
+		//断线重连也会发出连接结果,只取第一次
+		QObject::connect(station->m_control, &MC_OpcDeviceControl::sig_connectResult, m_scenarioObject, [=](const MM_MaybeOk& _val)
+		{
+			if (station->m_isConnectReported)
+			{
+				return;
+			}
+			station->m_isConnectReported = true;
+			station->m_isConnected = !_val.hasError();
+			onStationConnected(station->m_isConnected);
+		});
+		QMetaObject::invokeMethod(station->m_control, [=]()
+		{
+			station->m_control->tryConnect(QHostAddress::LocalHost, station->m_port);
+		});
+	}
+
+	//未在超时内返回连接结果的工位计为连接失败
+	QTimer::singleShot(m_config.m_timeoutMs, m_scenarioObject, [=]()
+	{
+		for (const auto& var : m_stations)
+		{
+			if (!var->m_isConnectReported)
+			{
+				var->m_isConnectReported = true;
+				onStationConnected(false);
+			}
+		}
+	});
+}
+
+void MC_StationScaleTest::onStationConnected(bool _isOk)
+{
+	if (!_isOk)
+	{
+		++m_connectFailCount;
+	}
+	if (--m_pendingCount > 0)
+	{
+		return;
+	}
+	if (m_connectFailCount >= static_cast<int>(m_stations.size()))
+	{
+		abort(u8"No station connected to its simulator!");
+		return;
+	}
+	QTimer::singleShot(m_config.m_settleMs, m_scenarioObject, [=]()
+	{
+		startCycles();
+	});
+}
+
+void MC_StationScaleTest::startCycles()
+{
+	MC_EventLoopLagMonitor::instance().resetStats();
+	m_cycleStartUsage = sampleProcessUsage();
+	m_phaseTimer.start();
+	m_pendingCount = 0;
+	auto cycleCount = m_config.m_cycleCount;
+	auto timeoutMs = m_config.m_timeoutMs;
+	auto cycleIntervalMs = m_config.m_cycleIntervalMs;
+	for (const auto& var : m_stations)
+	{
+		if (!var->m_isConnected)
+		{
+			continue;
+		}
+		++m_pendingCount;
+		//各工位在一个节拍内随机错开开始,接近产线上的相位分布
+		auto startDelayMs = static_cast<int>(QRandomGenerator::global()->bounded(cycleIntervalMs + 1));
+		QMetaObject::invokeMethod(var->m_control, [=]()
+		{
+			var->m_runner = new MC_StationCycleRunner(var->m_control, cycleCount, timeoutMs, [=]()
+			{
+				QMetaObject::invokeMethod(this, [=]()
+				{
+					onStationFinished();
+				}, Qt::QueuedConnection);
+			});
+			var->m_runner->setCycleIntervalMs(cycleIntervalMs);
+			QTimer::singleShot(startDelayMs, var->m_runner, [=]()
+			{
+				var->m_runner->start();
+			});
+		});
+	}
+}
+
+void MC_StationScaleTest::onStationFinished()
+{
+	if (--m_pendingCount > 0)
+	{
+		return;
+	}
+	finishScenario();
+}
+
+void MC_StationScaleTest::finishScenario()
+{
+	auto endUsage = sampleProcessUsage();
+	auto elapsedUs = m_phaseTimer.nsecsElapsed() / 1000;
+
+	MA_BenchmarkSamples cycleSamples;
+	for (const auto& var : m_stations)
+	{
+		if (!var->m_runner)
+		{
+			continue;
+		}
+		QMetaObject::invokeMethod(var->m_control, [&]()
+		{
+			cycleSamples.append(var->m_runner->getSamples());
+		}, Qt::BlockingQueuedConnection);
+	}
+	//控制线程取最差的一个
+	QJsonObject mainLoopLag;
+	MS_EventLoopLagStats controlLagStats;
+	for (const auto& var : MC_EventLoopLagMonitor::instance().getStats())
+	{
+		if (var.m_threadName == s_mainThreadName)
+		{
+			mainLoopLag = lagStatsToJson(var);
+			continue;
+		}
+		controlLagStats.m_queueLatencyP50Us = qMax(controlLagStats.m_queueLatencyP50Us, var.m_queueLatencyP50Us);
+		controlLagStats.m_queueLatencyP99Us = qMax(controlLagStats.m_queueLatencyP99Us, var.m_queueLatencyP99Us);
+		controlLagStats.m_queueLatencyMaxUs = qMax(controlLagStats.m_queueLatencyMaxUs, var.m_queueLatencyMaxUs);
+		controlLagStats.m_queueLatencyCount += var.m_queueLatencyCount;
+		controlLagStats.m_busyP99Us = qMax(controlLagStats.m_busyP99Us, var.m_busyP99Us);
+		controlLagStats.m_busyMaxUs = qMax(controlLagStats.m_busyMaxUs, var.m_busyMaxUs);
+		controlLagStats.m_longEventCount += var.m_longEventCount;
+		controlLagStats.m_stallCount += var.m_stallCount;
+	}
+
+	auto stationCount = static_cast<int>(m_stations.size());
+	auto connectedCount = qMax(1, stationCount - m_connectFailCount);
+	auto windowUs = qMax<qint64>(1, elapsedUs);
+	//模拟服务器空载占用按时间比例扣除,其处理请求的额外开销仍计入工位
+	auto simulatorCpuRate = m_baselineElapsedUs > 0
+		? static_cast<double>(m_baselineEndUsage.m_cpuTimeUs - m_baselineStartUsage.m_cpuTimeUs) / m_baselineElapsedUs : 0.0;
+	auto totalCpuUs = static_cast<double>(endUsage.m_cpuTimeUs - m_cycleStartUsage.m_cpuTimeUs);
+	auto stationCpuUs = qMax(0.0, totalCpuUs - simulatorCpuRate * windowUs);
+	auto deadlineUs = static_cast<qint64>(m_config.m_deadlineMs) * 1000;
+
+	QJsonObject result;
+	result[u8"stationCount"] = stationCount;
+	result[u8"connectedCount"] = stationCount - m_connectFailCount;
+	result[u8"connectFailCount"] = m_connectFailCount;
+	result[u8"controlThreadCount"] = static_cast<int>(m_controlThreads.size());
+	result[u8"elapsedUs"] = static_cast<double>(elapsedUs);
+	result[u8"cycle"] = cycleSamples.toJson(u8"cycle", elapsedUs);
+	result[u8"missedDeadlineCount"] = cycleSamples.getFailCount() + cycleSamples.getCountAbove(deadlineUs);
+	result[u8"totalCpuPercent"] = totalCpuUs * 100 / windowUs;
+	result[u8"simulatorCpuPercent"] = simulatorCpuRate * 100;
+	result[u8"cpuPercentPerStation"] = stationCpuUs * 100 / windowUs / connectedCount;
+	result[u8"residentBytes"] = static_cast<double>(m_cycleStartUsage.m_residentBytes);
+	result[u8"simulatorBytesPerStation"] = static_cast<double>(m_baselineEndUsage.m_residentBytes - m_idleUsage.m_residentBytes) / stationCount;
+	result[u8"memoryBytesPerStation"] = static_cast<double>(m_cycleStartUsage.m_residentBytes - m_baselineEndUsage.m_residentBytes) / connectedCount;
+	result[u8"threadCount"] = m_cycleStartUsage.m_threadCount;
+	result[u8"threadsPerStation"] = static_cast<double>(m_cycleStartUsage.m_threadCount - m_baselineEndUsage.m_threadCount) / connectedCount;
+	result[u8"mainLoopLag"] = mainLoopLag;
+	result[u8"controlLoopLag"] = lagStatsToJson(controlLagStats);
+	m_results.append(result);
+
+	tearDownScenario();
+	//等待端口及会话释放后再开始下一场景
+	QTimer::singleShot(1000, this, [=]()
+	{
+		runScenario(m_scenarioIndex + 1);
+	});
+}
+
+void MC_StationScaleTest::tearDownScenario()
+{
+	delete m_scenarioObject;
+	m_scenarioObject = nullptr;
+
+	for (const auto& var : m_stations)
+	{
+		if (var->m_control)
+		{
+			QMetaObject::invokeMethod(var->m_controlThread->m_object, [=]()
+			{
+				delete var->m_runner;
+				var->m_runner = nullptr;
+				var->m_control->disconnectServer();
+				delete var->m_control;
+				var->m_control = nullptr;
+			}, Qt::BlockingQueuedConnection);
+		}
+	}
+	for (const auto& var : m_controlThreads)
+	{
+		stopWorkerThread(var);
+	}
+	m_controlThreads.clear();
+
+	for (const auto& var : m_stations)
+	{
+		if (var->m_simulator)
+		{
+			QMetaObject::invokeMethod(var->m_serverThread->m_object, [=]()
+			{
+				delete var->m_simulator;
+				var->m_simulator = nullptr;
+			}, Qt::BlockingQueuedConnection);
+		}
+	}
+	m_stations.clear();
+}
+
+void MC_StationScaleTest::abort(const QString& _error)
+{
+	m_error = _error;
+	tearDownScenario();
+	for (const auto& var : m_serverThreads)
+	{
+		stopWorkerThread(var);
+	}
+	m_serverThreads.clear();
+	emit sig_finished(MM_MaybeOk(ME_Error(_error)));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "MM_Maybe.h"
+#include "MD_OpcUaSimulatorServer.h"
+#include "MA_BenchmarkStats.h"
+#include "MA_ProcessStats.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <memory>
+#include <vector>
+
+//多工位规模测试参数
+struct MS_StationScaleTestConfig
+{
+	//模拟服务器端口,依次加1
+	quint16 m_basePort{ 49000 };
+	//依次测试的工位数
+	std::vector<int> m_stationCounts{ 50, 100, 200 };
+	//模拟服务器分布的线程数
+	int m_serverThreadCount{ 4 };
+	//控制类所在线程数,0为每个工位一个线程(同MD_Dispenser)
+	int m_controlThreadCount{ 0 };
+	//每个工位的收送晶圆次数及间隔(模拟产线节拍)
+	int m_cycleCount{ 30 };
+	int m_cycleIntervalMs{ 1000 };
+	//单次收送超时,计为失败
+	int m_timeoutMs{ 10000 };
+	//单次收送超过该时间计为错过节拍
+	int m_deadlineMs{ 1000 };
+	//只有模拟服务器时的空载测量时长
+	int m_baselineMs{ 2000 };
+	//全部连接后等待监控建立的时间
+	int m_settleMs{ 2000 };
+	//事件循环延迟探测间隔,见MC_EventLoopLagMonitor
+	int m_lagProbeIntervalMs{ 10 };
+	MS_SimulatorBehavior m_behavior;
+};
+
+/**
+ * 多工位规模测试
+ * 在同一进程内启动数百个MD_OpcUaSimulatorServer及对应的MC_OpcDeviceControl,
+ * 各工位按节拍循环收送晶圆,输出每个工位的CPU及内存占用、线程数、
+ * 主线程及控制线程的事件循环延迟、错过节拍的握手数,结果为JSON
+ */
+class MC_StationScaleTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	MC_StationScaleTest(const MS_StationScaleTestConfig& _config, QObject *_parent = nullptr);
+	~MC_StationScaleTest();
+
+	QJsonObject getReport() const;
+
+signals:
+	void sig_finished(const MP_Public::MM_MaybeOk& _result);
+
+public slots:
+	void start();
+
+private:
+	struct MS_Station;
+	struct MS_WorkerThread;
+
+	void runScenario(std::size_t _index);
+	void onBaselineFinished();
+	void onStationConnected(bool _isOk);
+	void startCycles();
+	void onStationFinished();
+	void finishScenario();
+	void tearDownScenario();
+	void abort(const QString& _error);
+
+	//_lagThreadName 非空时由MC_EventLoopLagMonitor监控该线程
+	std::shared_ptr<MS_WorkerThread> startWorkerThread(const QString& _lagThreadName);
+	void stopWorkerThread(const std::shared_ptr<MS_WorkerThread>& _thread);
+
+	MS_StationScaleTestConfig m_config;
+	QJsonArray m_results;
+	QString m_error;
+
+	std::vector<std::shared_ptr<MS_WorkerThread>> m_serverThreads;
+	std::vector<std::shared_ptr<MS_WorkerThread>> m_controlThreads;
+	std::vector<std::shared_ptr<MS_Station>> m_stations;
+	//当前场景的进行状态,场景内的定时及连接以m_scenarioObject为上下文
+	QObject* m_scenarioObject{};
+	std::size_t m_scenarioIndex{ 0 };
+	int m_pendingCount{ 0 };
+	int m_connectFailCount{ 0 };
+	//启动模拟服务器前、空载测量起止、开始收送时的进程占用
+	MS_ProcessUsage m_idleUsage;
+	MS_ProcessUsage m_baselineStartUsage;
+	MS_ProcessUsage m_baselineEndUsage;
+	MS_ProcessUsage m_cycleStartUsage;
+	qint64 m_baselineElapsedUs{ 0 };
+	QElapsedTimer m_phaseTimer;
+};
@@ -0,0 +1,431 @@
+#include "MA_MicroBenchmark.h"
+#include "MA_BenchmarkStats.h"
+#include "MC_NullOpcUaBackend.h"
+#include "MC_OpcUaClient.h"
+#include "MC_FutureWatch.h"
+#include "MC_FutureWatchResultProvider.h"
+#include "MI_Device.h"
+#include "MA_Auxiliary.h"
+#include "MA_Crc32c.h"
+#include "MA_ToolingPayloadCodec.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <map>
+#include <memory>
+
+using MP_Public::MM_MaybeOk;
+
+namespace
+{
+	const std::vector<QString> s_fieldNames{
+		MI_Device::s_deviceStateName,
+		MI_Device::s_deviceBeLockedName,
+		MI_Device::s_deviceWorkAreaWorkStateName,
+		MI_Device::s_deviceWorkAreaIfHasToolingName,
+		MI_Device::s_isReadyToReceiveToolingStateName,
+		MI_Device::s_receiveToolingBeInPlanningStateName,
+		MI_Device::s_receiveToolingBeInPlanningRespondName,
+		MI_Device::s_receiveToolingCommandExecuteStateName,
+		MI_Device::s_isReadyToSendToolingStateName,
+		MI_Device::s_sendToolingBeInPlanningStateName,
+		MI_Device::s_sendToolingBeInPlanningRespondName,
+		MI_Device::s_sendToolingCommandExecuteStateName,
+		MI_Device::s_deviceRequireDataCommandName,
+		MI_Device::s_deviceRequireDataExecuteStateName,
+		MI_Device::s_deviceUploadWorkResultDataCommandName,
+		MI_Device::s_initCommandExecuteStateName };
+
+	std::vector<QString> fieldNames(int _count)
+	{
+		std::vector<QString> result;
+		for (auto curIndex = 0; curIndex < _count; ++curIndex)
+		{
+			result.emplace_back(s_fieldNames[curIndex % s_fieldNames.size()]);
+		}
+		return result;
+	}
+
+	void flushDeferredDelete()
+	{
+		QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+	}
+
+	//真实的MC_OpcUaClient接空后端,测得的即为客户端门面自身的单次请求开销
+	struct MS_NullBackendClient
+	{
+		std::shared_ptr<MC_NullOpcUaBackend> m_backend{ std::make_shared<MC_NullOpcUaBackend>() };
+		MC_OpcUaClient m_client{ m_backend };
+	};
+
+	//每个请求的上下文对象及回调连接
+	void addAllocationBenchmarks(MA_MicroBenchmarkSuite& _suite)
+	{
+		_suite.add(u8"qobject/new_delete", [](MA_MicroBenchmarkState& _state)
+		{
+			while (_state.keepRunning())
+			{
+				auto object = new QObject();
+				doNotOptimize(object);
+				delete object;
+			}
+		});
+
+		_suite.add(u8"qobject/context_connect_deleteLater", [](MA_MicroBenchmarkState& _state)
+		{
+			MC_NullOpcUaBackend backend;
+			while (_state.keepRunning())
+			{
+				auto object = new QObject();
+				QObject::connect(&backend, &MC_NullOpcUaBackend::sig_readNodeAttributesFinished, object, [](QVector<QOpcUaReadResult>, QOpcUa::UaStatusCode) {});
+				object->disconnect();
+				object->deleteLater();
+				flushDeferredDelete();
+			}
+		});
+
+		_suite.add(u8"future_watch/create_finish_delete", [](MA_MicroBenchmarkState& _state)
+		{
+			QObject receiver;
+			auto finishedCount = 0;
+			while (_state.keepRunning())
+			{
+				auto watch = new MC_FutureWatch<QVariant>();
+				QObject::connect(watch, &MC_FutureWatchBase::finished, &receiver, [&finishedCount, watch]()
+				{
+					++finishedCount;
+					watch->deleteLater();
+				});
+				MC_FutureWatchResultProvider provider;
+				provider.setIsSuccess(*watch, true);
+				provider.setResult(*watch, QVariant::fromValue<quint16>(1));
+				provider.setFutureWatchFinished(*watch);
+				flushDeferredDelete();
+			}
+			doNotOptimize(finishedCount);
+		});
+	}
+
+	void addNodeIdBenchmarks(MA_MicroBenchmarkSuite& _suite)
+	{
+		_suite.add(u8"node_id/from_string", [](MA_MicroBenchmarkState& _state)
+		{
+			std::size_t curIndex = 0;
+			while (_state.keepRunning())
+			{
+				auto nodeId = QOpcUa::nodeIdFromString(2, s_fieldNames[curIndex++ % s_fieldNames.size()]);
+				doNotOptimize(nodeId);
+			}
+		});
+
+		_suite.add(u8"node_id/string_split", [](MA_MicroBenchmarkState& _state)
+		{
+			const auto nodeId = QOpcUa::nodeIdFromString(2, MI_Device::s_receiveToolingCommandExecuteStateName);
+			while (_state.keepRunning())
+			{
+				quint16 nameSpaceId = 0;
+				QString identifier;
+				char identifierType = 0;
+				auto isOk = QOpcUa::nodeIdStringSplit(nodeId, &nameSpaceId, &identifier, &identifierType);
+				doNotOptimize(isOk);
+				doNotOptimize(identifier);
+			}
+		});
+	}
+
+	void addVariantBenchmarks(MA_MicroBenchmarkSuite& _suite)
+	{
+		//readNodeVariable及数据变化回调中的判断与取值
+		_suite.add(u8"variant/uint16_check_and_value", [](MA_MicroBenchmarkState& _state)
+		{
+			const auto val = QVariant::fromValue<quint16>(3);
+			while (_state.keepRunning())
+			{
+				quint16 result = 0;
+				if (val.canConvert<quint16>())
+				{
+					result = val.value<quint16>();
+				}
+				doNotOptimize(result);
+			}
+		});
+
+		//写入的状态常量为int,服务器返回为quint16
+		_suite.add(u8"variant/int_to_uint16", [](MA_MicroBenchmarkState& _state)
+		{
+			const QVariant val(3);
+			while (_state.keepRunning())
+			{
+				auto result = val.value<quint16>();
+				doNotOptimize(result);
+			}
+		});
+
+		_suite.add(u8"variant/bytearray_value_1k", [](MA_MicroBenchmarkState& _state)
+		{
+			const QVariant val(QByteArray(1024, 'a'));
+			while (_state.keepRunning())
+			{
+				auto result = val.value<QByteArray>();
+				doNotOptimize(result);
+			}
+		});
+
+		_suite.add(u8"variant/read_result_to_map/16", [](MA_MicroBenchmarkState& _state)
+		{
+			const auto keyNames = fieldNames(16);
+			QVector<QOpcUaReadResult> results(16);
+			for (auto& var : results)
+			{
+				var.setStatusCode(QOpcUa::UaStatusCode::Good);
+				var.setValue(QVariant::fromValue<quint16>(1));
+			}
+			_state.setItemsPerIteration(16);
+			while (_state.keepRunning())
+			{
+				std::map<QString, QVariant> ret;
+				for (auto curIndex = 0; curIndex < results.size(); ++curIndex)
+				{
+					ret[keyNames.at(curIndex)] = results.at(curIndex).value();
+				}
+				doNotOptimize(ret);
+			}
+		});
+	}
+
+	void addSignalBenchmarks(MA_MicroBenchmarkSuite& _suite)
+	{
+		for (auto batchSize : { 1, 16 })
+		{
+			_suite.add(QString(u8"signal/direct_read_results/%1").arg(batchSize), [=](MA_MicroBenchmarkState& _state)
+			{
+				MC_NullOpcUaBackend backend;
+				QObject receiver;
+				auto resultCount = 0;
+				QObject::connect(&backend, &MC_NullOpcUaBackend::sig_readNodeAttributesFinished, &receiver, [&](QVector<QOpcUaReadResult> _results, QOpcUa::UaStatusCode)
+				{
+					resultCount += _results.size();
+				});
+				QVector<QOpcUaReadResult> results(batchSize);
+				while (_state.keepRunning())
+				{
+					emit backend.sig_readNodeAttributesFinished(results, QOpcUa::UaStatusCode::Good);
+				}
+				doNotOptimize(resultCount);
+			});
+
+			//跨线程调用时的参数复制及事件投递
+			_suite.add(QString(u8"signal/queued_read_results/%1").arg(batchSize), [=](MA_MicroBenchmarkState& _state)
+			{
+				MC_NullOpcUaBackend backend;
+				QObject receiver;
+				auto resultCount = 0;
+				QObject::connect(&backend, &MC_NullOpcUaBackend::sig_readNodeAttributesFinished, &receiver, [&](QVector<QOpcUaReadResult> _results, QOpcUa::UaStatusCode)
+				{
+					resultCount += _results.size();
+				}, Qt::QueuedConnection);
+				QVector<QOpcUaReadResult> results(batchSize);
+				while (_state.keepRunning())
+				{
+					emit backend.sig_readNodeAttributesFinished(results, QOpcUa::UaStatusCode::Good);
+					QCoreApplication::sendPostedEvents(&receiver, QEvent::MetaCall);
+				}
+				doNotOptimize(resultCount);
+			});
+		}
+	}
+
+	//完整的一次批量读写请求(含watch的使用方处理)
+	void addRequestBenchmarks(MA_MicroBenchmarkSuite& _suite)
+	{
+		for (auto batchSize : { 1, 4, 16 })
+		{
+			_suite.add(QString(u8"request/read_multi_null_backend/%1").arg(batchSize), [=](MA_MicroBenchmarkState& _state)
+			{
+				MS_NullBackendClient nullBackendClient;
+				QObject receiver;
+				const auto keyNames = fieldNames(batchSize);
+				auto successCount = 0;
+				while (_state.keepRunning())
+				{
+					auto watch = nullBackendClient.m_client.readMultiNodeVariables(keyNames);
+					QObject::connect(watch, &MC_FutureWatchBase::finished, &receiver, [&successCount, watch]()
+					{
+						ME_DestructExecuter onDeleteObject([=]() {
+							watch->deleteLater();
+						});
+						if (watch->getIsSuccess())
+						{
+							successCount += static_cast<int>(watch->getResult().size());
+						}
+					});
+					nullBackendClient.m_backend->completePendingRequests();
+					flushDeferredDelete();
+				}
+				doNotOptimize(successCount);
+			});
+
+			_suite.add(QString(u8"request/write_multi_null_backend/%1").arg(batchSize), [=](MA_MicroBenchmarkState& _state)
+			{
+				MS_NullBackendClient nullBackendClient;
+				QObject receiver;
+				std::vector<std::pair<QString, std::pair<QOpcUa::Types, QVariant>>> vals;
+				for (const auto& var : fieldNames(batchSize))
+				{
+					vals.emplace_back(var, std::make_pair(QOpcUa::Types::UInt16, QVariant::fromValue<quint16>(1)));
+				}
+				auto successCount = 0;
+				while (_state.keepRunning())
+				{
+					auto watch = nullBackendClient.m_client.writeMultiNodeVariables(vals);
+					QObject::connect(watch, &MC_FutureWatchBase::finished, &receiver, [&successCount, watch]()
+					{
+						ME_DestructExecuter onDeleteObject([=]() {
+							watch->deleteLater();
+						});
+						if (watch->getIsSuccess())
+						{
+							++successCount;
+						}
+					});
+					nullBackendClient.m_backend->completePendingRequests();
+					flushDeferredDelete();
+				}
+				doNotOptimize(successCount);
+			});
+		}
+	}
+
+	/**
+	 * 工装数据从读应答、结果map、取值到再次写出的整条路径
+	 * ByteString全程为同一块隐式共享缓冲区,耗时应与数据大小无关;若中途发生深复制则给出警告
+	 */
+	void addToolingPayloadBenchmarks(MA_MicroBenchmarkSuite& _suite)
+	{
+		for (auto sizeKb : { 4, 1024, 16384 })
+		{
+			_suite.add(QString(u8"tooling/payload_round_trip/%1k").arg(sizeKb), [=](MA_MicroBenchmarkState& _state)
+			{
+				MS_NullBackendClient nullBackendClient;
+				const QByteArray payload(sizeKb * 1024, 'a');
+				nullBackendClient.m_backend->setReadValue(QVariant(payload));
+				QObject receiver;
+				const std::vector<QString> keyNames{ MI_Device::s_deviceUploadWorkResultDataContentName };
+				auto copiedCount = 0;
+				while (_state.keepRunning())
+				{
+					auto watch = nullBackendClient.m_client.readMultiNodeVariables(keyNames);
+					QObject::connect(watch, &MC_FutureWatchBase::finished, &receiver, [&nullBackendClient, &payload, &copiedCount, watch]()
+					{
+						ME_DestructExecuter onDeleteObject([=]() {
+							watch->deleteLater();
+						});
+						if (!watch->getIsSuccess())
+						{
+							return;
+						}
+						const auto result = watch->getResult();
+						const auto toolingData = result.at(MI_Device::s_deviceUploadWorkResultDataContentName).value<QByteArray>();
+						auto writeWatch = nullBackendClient.m_client.writeMultiNodeVariables({
+							{ MI_Device::s_deviceRequireDataToolingDataContentName, { QOpcUa::Types::ByteString, toolingData } } });
+						if (nullBackendClient.m_backend->getLastWriteValue().value<QByteArray>().constData() != payload.constData())
+						{
+							++copiedCount;
+						}
+						writeWatch->deleteLater();
+					});
+					nullBackendClient.m_backend->completePendingRequests();
+					flushDeferredDelete();
+				}
+				if (copiedCount > 0)
+				{
+					QTextStream(stderr) << QString(u8"tooling payload deep copied %1 times\n").arg(copiedCount);
+				}
+			});
+		}
+
+		for (auto sizeKb : { 4, 1024 })
+		{
+			//配方数据以文本为主
+			QByteArray recipe;
+			for (auto curIndex = 0; recipe.size() < sizeKb * 1024; ++curIndex)
+			{
+				recipe.append(QString(u8"step=%1;temp=%2;speed=%3;\n").arg(curIndex).arg(180 + curIndex % 7).arg(1200 + curIndex % 13).toUtf8());
+			}
+			recipe.resize(sizeKb * 1024);
+
+			_suite.add(QString(u8"tooling/payload_encode_zlib/%1k").arg(sizeKb), [=](MA_MicroBenchmarkState& _state)
+			{
+				while (_state.keepRunning())
+				{
+					doNotOptimize(MA_ToolingPayloadCodec::encode(recipe, ME_ToolingPayloadCodec::ZLIB));
+				}
+			});
+			_suite.add(QString(u8"tooling/payload_decode_zlib/%1k").arg(sizeKb), [=](MA_MicroBenchmarkState& _state)
+			{
+				const auto payload = MA_ToolingPayloadCodec::encode(recipe, ME_ToolingPayloadCodec::ZLIB);
+				QByteArray data;
+				while (_state.keepRunning())
+				{
+					doNotOptimize(MA_ToolingPayloadCodec::decode(payload, &data).hasError());
+				}
+			});
+			_suite.add(QString(u8"tooling/payload_crc32c%1/%2k").arg(MA_Crc32c::isHardwareAccelerated() ? u8"_sse42" : u8"").arg(sizeKb), [=](MA_MicroBenchmarkState& _state)
+			{
+				while (_state.keepRunning())
+				{
+					doNotOptimize(MA_Crc32c::compute(recipe.constData(), recipe.size()));
+				}
+			});
+		}
+	}
+}
+
+//客户端单次操作开销的微基准,空后端立即完成请求,结果(纳秒/次)为JSON
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName(u8"clientMicroBenchmark");
+	qRegisterMetaType<QVector<QOpcUaReadResult>>();
+	qRegisterMetaType<QVector<QOpcUaWriteResult>>();
+	qRegisterMetaType<QOpcUa::UaStatusCode>();
+
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	QCommandLineOption outputOption(u8"output", u8"JSON report file path.", u8"path");
+	QCommandLineOption filterOption(u8"filter", u8"Regular expression selecting the cases to run.", u8"regex");
+	QCommandLineOption minTimeOption(u8"min-time", u8"Minimum measured time per repetition in milliseconds.", u8"ms", u8"200");
+	QCommandLineOption repetitionOption(u8"repetitions", u8"Repetitions per case.", u8"count", u8"5");
+	parser.addOptions({ outputOption, filterOption, minTimeOption, repetitionOption });
+	parser.process(app);
+
+	MA_MicroBenchmarkSuite suite;
+	suite.setFilter(parser.value(filterOption));
+	suite.setMinTimeMs(parser.value(minTimeOption).toInt());
+	suite.setRepetitionCount(parser.value(repetitionOption).toInt());
+	addAllocationBenchmarks(suite);
+	addNodeIdBenchmarks(suite);
+	addVariantBenchmarks(suite);
+	addSignalBenchmarks(suite);
+	addRequestBenchmarks(suite);
+	addToolingPayloadBenchmarks(suite);
+
+	QJsonObject report;
+	report[u8"suite"] = u8"clientMicroBenchmark";
+	report[u8"qtVersion"] = QString(qVersion());
+	report[u8"benchmarks"] = suite.run();
+
+	if (!parser.isSet(outputOption))
+	{
+		QTextStream(stdout) << QJsonDocument(report).toJson(QJsonDocument::Indented);
+		return 0;
+	}
+	auto writeResult = writeBenchmarkReport(report, parser.value(outputOption));
+	if (writeResult.hasError())
+	{
+		QTextStream(stderr) << writeResult.getError()->getMessage() << u8"\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include "MC_HandshakeBenchmark.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QTextStream>
+
+namespace
+{
+	std::vector<int> parseIntList(const QString& _val)
+	{
+		std::vector<int> result;
+		for (const auto& var : _val.split(u8',', QString::SkipEmptyParts))
+		{
+			auto isOk = false;
+			auto number = var.trimmed().toInt(&isOk);
+			if (isOk && number > 0)
+			{
+				result.emplace_back(number);
+			}
+		}
+		return result;
+	}
+}
+
+//握手基准测试入口,结果JSON写入--output指定的文件,未指定时输出到标准输出
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName(u8"handshakeBenchmark");
+
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	QCommandLineOption outputOption(u8"output", u8"JSON report file path.", u8"path");
+	QCommandLineOption portOption(u8"port", u8"Base port of the loopback simulators.", u8"port", u8"48400");
+	QCommandLineOption iterationOption(u8"iterations", u8"Measured iterations per case.", u8"count", u8"200");
+	QCommandLineOption warmupOption(u8"warmup", u8"Warm-up iterations per case.", u8"count", u8"20");
+	QCommandLineOption batchOption(u8"batch-sizes", u8"Comma separated batch sizes for multi-node reads.", u8"list", u8"1,2,4,8,16");
+	QCommandLineOption stationOption(u8"stations", u8"Comma separated station counts for the scaling curve.", u8"list", u8"1,2,4,8,16,32");
+	QCommandLineOption cycleOption(u8"cycles", u8"Handshake cycles per station in the scaling curve.", u8"count", u8"50");
+	QCommandLineOption dataSizeOption(u8"data-size", u8"Tooling data size in bytes.", u8"bytes", u8"1024");
+	parser.addOptions({ outputOption, portOption, iterationOption, warmupOption, batchOption, stationOption, cycleOption, dataSizeOption });
+	parser.process(app);
+
+	MS_HandshakeBenchmarkConfig config;
+	config.m_basePort = static_cast<quint16>(parser.value(portOption).toUInt());
+	config.m_iterationCount = parser.value(iterationOption).toInt();
+	config.m_warmupCount = parser.value(warmupOption).toInt();
+	config.m_batchSizes = parseIntList(parser.value(batchOption));
+	config.m_stationCounts = parseIntList(parser.value(stationOption));
+	config.m_scalingCycleCount = parser.value(cycleOption).toInt();
+	config.m_toolingDataSize = parser.value(dataSizeOption).toInt();
+
+	MC_HandshakeBenchmark benchmark(config);
+	QObject::connect(&benchmark, &MC_HandshakeBenchmark::sig_finished, &app, [&](const MP_Public::MM_MaybeOk& _result)
+	{
+		auto report = benchmark.getReport();
+		auto exitCode = _result.hasError() ? 1 : 0;
+		if (parser.isSet(outputOption))
+		{
+			auto writeResult = MC_HandshakeBenchmark::writeReport(report, parser.value(outputOption));
+			if (writeResult.hasError())
+			{
+				QTextStream(stderr) << writeResult.getError()->getMessage() << u8"\n";
+				exitCode = 1;
+			}
+		}
+		else
+		{
+			QTextStream(stdout) << QJsonDocument(report).toJson(QJsonDocument::Indented);
+		}
+		if (_result.hasError())
+		{
+			QTextStream(stderr) << _result.getError()->getMessage() << u8"\n";
+		}
+		app.exit(exitCode);
+	});
+	QMetaObject::invokeMethod(&benchmark, [&]()
+	{
+		benchmark.start();
+	}, Qt::QueuedConnection);
+	return app.exec();
+}
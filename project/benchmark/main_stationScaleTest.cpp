@@ -0,0 +1,83 @@
+#include "MC_StationScaleTest.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+namespace
+{
+	std::vector<int> parseIntList(const QString& _val)
+	{
+		std::vector<int> result;
+		for (const auto& var : _val.split(u8',', QString::SkipEmptyParts))
+		{
+			auto isOk = false;
+			auto number = var.trimmed().toInt(&isOk);
+			if (isOk && number > 0)
+			{
+				result.emplace_back(number);
+			}
+		}
+		return result;
+	}
+}
+
+//多工位规模测试入口,结果JSON写入--output指定的文件,未指定时输出到标准输出
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName(u8"stationScaleTest");
+
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	QCommandLineOption outputOption(u8"output", u8"JSON report file path.", u8"path");
+	QCommandLineOption portOption(u8"port", u8"Base port of the loopback simulators.", u8"port", u8"49000");
+	QCommandLineOption stationOption(u8"stations", u8"Comma separated station counts to run.", u8"list", u8"50,100,200");
+	QCommandLineOption serverThreadOption(u8"server-threads", u8"Threads hosting the simulators.", u8"count", u8"4");
+	QCommandLineOption controlThreadOption(u8"control-threads", u8"Threads hosting the device controls, 0 for one per station.", u8"count", u8"0");
+	QCommandLineOption cycleOption(u8"cycles", u8"Handshake cycles per station.", u8"count", u8"30");
+	QCommandLineOption intervalOption(u8"interval", u8"Pause between the cycles of a station in milliseconds.", u8"ms", u8"1000");
+	QCommandLineOption deadlineOption(u8"deadline", u8"Cycles slower than this many milliseconds miss their deadline.", u8"ms", u8"1000");
+	QCommandLineOption timeoutOption(u8"timeout", u8"Connect and cycle timeout in milliseconds.", u8"ms", u8"10000");
+	parser.addOptions({ outputOption, portOption, stationOption, serverThreadOption, controlThreadOption, cycleOption, intervalOption, deadlineOption, timeoutOption });
+	parser.process(app);
+
+	MS_StationScaleTestConfig config;
+	config.m_basePort = static_cast<quint16>(parser.value(portOption).toUInt());
+	config.m_stationCounts = parseIntList(parser.value(stationOption));
+	config.m_serverThreadCount = parser.value(serverThreadOption).toInt();
+	config.m_controlThreadCount = parser.value(controlThreadOption).toInt();
+	config.m_cycleCount = parser.value(cycleOption).toInt();
+	config.m_cycleIntervalMs = parser.value(intervalOption).toInt();
+	config.m_deadlineMs = parser.value(deadlineOption).toInt();
+	config.m_timeoutMs = parser.value(timeoutOption).toInt();
+
+	MC_StationScaleTest scaleTest(config);
+	QObject::connect(&scaleTest, &MC_StationScaleTest::sig_finished, &app, [&](const MP_Public::MM_MaybeOk& _result)
+	{
+		auto report = scaleTest.getReport();
+		auto exitCode = _result.hasError() ? 1 : 0;
+		if (parser.isSet(outputOption))
+		{
+			auto writeResult = writeBenchmarkReport(report, parser.value(outputOption));
+			if (writeResult.hasError())
+			{
+				QTextStream(stderr) << writeResult.getError()->getMessage() << u8"\n";
+				exitCode = 1;
+			}
+		}
+		else
+		{
+			QTextStream(stdout) << QJsonDocument(report).toJson(QJsonDocument::Indented);
+		}
+		if (_result.hasError())
+		{
+			QTextStream(stderr) << _result.getError()->getMessage() << u8"\n";
+		}
+		app.exit(exitCode);
+	});
+	QMetaObject::invokeMethod(&scaleTest, [&]()
+	{
+		scaleTest.start();
+	}, Qt::QueuedConnection);
+	return app.exec();
+}